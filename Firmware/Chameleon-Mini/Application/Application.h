@@ -11,6 +11,7 @@
 #include "../Common.h"
 #include "../Configuration.h"
 #include "../Log.h"
+#include "../Profile.h"
 
 /* Applications */
 #include "MifareUltralight.h"
@@ -47,6 +48,7 @@ INLINE void ApplicationTick(void) {
 }
 
 INLINE uint16_t ApplicationProcess(uint8_t *ByteBuffer, uint16_t ByteCount) {
+    PROFILE_SCOPE(PROFILE_APP_PROCESS);
     return ActiveConfiguration.ApplicationProcessFunc(ByteBuffer, ByteCount);
 }
 
@@ -129,17 +129,22 @@
 #define ISO14443A_BUFFER_PARITY_OFFSET    (CODEC_BUFFER_SIZE/2)
 #endif
 
+/* The portable macros mirror the side effects of the AVR versions above */
+/* on their register operands (e.g. "lsr %3" consumes bit 0 of __in), so */
+/* that a NO_INLINE_ASM build is bit-for-bit equivalent to the firmware. */
 #define SHIFT24(__b0, __b1, __b2, __in) \
                __b0 = (__b0>>1) | (__b1<<7); \
                __b1 = (__b1>>1) | (__b2<<7); \
-               __b2 = (__b2>>1) | ((__in)<<7)
+               __b2 = (__b2>>1) | ((__in)<<7); \
+               __in >>= 1
 
 #define SHIFT24_COND_DECRYPT(__b0, __b1, __b2, __in, __stream, __decrypt) \
-               __b0 = (__b0>>1) | (__b1<<7); \
-               __b1 = (__b1>>1) | (__b2<<7); \
-               __b2 = (__b2>>1) | (((__in)^((__stream)&(__decrypt)))<<7)
+               __in ^= (uint8_t) ((__stream) & (0 - ((__decrypt) & 1))); \
+               SHIFT24(__b0, __b1, __b2, __in)
 
-#define SHIFT8(__byte, __in)  __byte = (__byte>>1) | ((__in)<<7)
+#define SHIFT8(__byte, __in) \
+               __byte = (__byte>>1) | ((__in)<<7); \
+               __in >>= 1
 
 #define SPLIT_BYTE(__even, __odd, __byte) \
     __even = (__even >> 1) | (__byte<<7); __byte>>=1; \
@@ -149,8 +154,7 @@
     __even = (__even >> 1) | (__byte<<7); __byte>>=1; \
     __odd  = (__odd  >> 1) | (__byte<<7); __byte>>=1; \
     __even = (__even >> 1) | (__byte<<7); __byte>>=1; \
-    __odd  = (__odd  >> 1) | (__byte<<7)
-
+    __odd  = (__odd  >> 1) | (__byte<<7); __byte>>=1
 
 /* Generate odd parity bit */
 #define ODD_PARITY(val)	                   \
@@ -360,11 +364,8 @@ static const uint8_t C1MEM TableC3[32] = {
 /* Split Crypto1 state into even and odd bits            */
 /* to speed up the output filter network                 */
 /* Put both into one struct to enable relative adressing */
-typedef struct {
-    uint8_t Even[LFSR_SIZE / 2];
-    uint8_t Odd[LFSR_SIZE / 2];
-} Crypto1LfsrState_t;
-static Crypto1LfsrState_t State = {{0}, {0}};
+/* (Crypto1StateType in Crypto1.h, LFSR_SIZE / 2 each)   */
+static Crypto1StateType State = {{0}, {0}};
 
 
 /* Debug output of state */
@@ -382,6 +383,14 @@ void Crypto1GetState(uint8_t *pEven, uint8_t *pOdd) {
 
 }
 
+void Crypto1SaveState(Crypto1StateType *Saved) {
+    *Saved = State;
+}
+
+void Crypto1LoadState(const Crypto1StateType *Saved) {
+    State = *Saved;
+}
+
 /* Proceed LFSR by one clock cycle */
 /* Prototype to force inlining */
 static __inline__ uint8_t Crypto1LFSRbyteFeedback(uint8_t E0,
@@ -604,67 +613,68 @@ void Crypto1SetupNested(uint8_t Key[6], uint8_t Uid[4], uint8_t CardNonce[8], bo
         In = *CardNonce ^ *Uid++;
 
         /* we can reuse the filter output used to decrypt the parity bit! */
-        SHIFT8(KeyStream, Out);
+        /* SHIFT8 consumes Out, so it has to come after the decryption.  */
         Feedback  = Crypto1LFSRbyteFeedback(Even0, Even1, Even2, Odd0, Odd1, Odd2);
         Feedback ^= In;
         SHIFT24_COND_DECRYPT(Even0, Even1, Even2, Feedback, Out, Decrypt);
+        SHIFT8(KeyStream, Out);
 
         /* Bit 1 */
         In >>= 1;
         /* remember Odd/Even swap has been omitted! */
         Out = CRYPTO1_FILTER_OUTPUT_B0_24(Even0, Even1, Even2);
-        SHIFT8(KeyStream, Out);
         Feedback = Crypto1LFSRbyteFeedback(Odd0, Odd1, Odd2, Even0, Even1, Even2);
         Feedback ^= In;
         SHIFT24_COND_DECRYPT(Odd0, Odd1, Odd2, Feedback, Out, Decrypt);
+        SHIFT8(KeyStream, Out);
 
         /* Bit 2 */
         In >>= 1;
         Out = CRYPTO1_FILTER_OUTPUT_B0_24(Odd0, Odd1, Odd2);
-        SHIFT8(KeyStream, Out);
         Feedback  = Crypto1LFSRbyteFeedback(Even0, Even1, Even2, Odd0, Odd1, Odd2);
         Feedback ^= In;
         SHIFT24_COND_DECRYPT(Even0, Even1, Even2, Feedback, Out, Decrypt);
+        SHIFT8(KeyStream, Out);
 
         /* Bit 3 */
         In >>= 1;
         Out = CRYPTO1_FILTER_OUTPUT_B0_24(Even0, Even1, Even2);
-        SHIFT8(KeyStream, Out);
         Feedback = Crypto1LFSRbyteFeedback(Odd0, Odd1, Odd2, Even0, Even1, Even2);
         Feedback ^= In;
         SHIFT24_COND_DECRYPT(Odd0, Odd1, Odd2, Feedback, Out, Decrypt);
+        SHIFT8(KeyStream, Out);
 
         /* Bit 4 */
         In >>= 1;
         Out = CRYPTO1_FILTER_OUTPUT_B0_24(Odd0, Odd1, Odd2);
-        SHIFT8(KeyStream, Out);
         Feedback  = Crypto1LFSRbyteFeedback(Even0, Even1, Even2, Odd0, Odd1, Odd2);
         Feedback ^= In;
         SHIFT24_COND_DECRYPT(Even0, Even1, Even2, Feedback, Out, Decrypt);
+        SHIFT8(KeyStream, Out);
 
         /* Bit 5 */
         In >>= 1;
         Out = CRYPTO1_FILTER_OUTPUT_B0_24(Even0, Even1, Even2);
-        SHIFT8(KeyStream, Out);
         Feedback = Crypto1LFSRbyteFeedback(Odd0, Odd1, Odd2, Even0, Even1, Even2);
         Feedback ^= In;
         SHIFT24_COND_DECRYPT(Odd0, Odd1, Odd2, Feedback, Out, Decrypt);
+        SHIFT8(KeyStream, Out);
 
         /* Bit 6 */
         In >>= 1;
         Out = CRYPTO1_FILTER_OUTPUT_B0_24(Odd0, Odd1, Odd2);
-        SHIFT8(KeyStream, Out);
         Feedback  = Crypto1LFSRbyteFeedback(Even0, Even1, Even2, Odd0, Odd1, Odd2);
         Feedback ^= In;
         SHIFT24_COND_DECRYPT(Even0, Even1, Even2, Feedback, Out, Decrypt);
+        SHIFT8(KeyStream, Out);
 
         /* Bit 7 */
         In >>= 1;
         Out = CRYPTO1_FILTER_OUTPUT_B0_24(Even0, Even1, Even2);
-        SHIFT8(KeyStream, Out);
         Feedback = Crypto1LFSRbyteFeedback(Odd0, Odd1, Odd2, Even0, Even1, Even2);
         Feedback ^= In;
         SHIFT24_COND_DECRYPT(Odd0, Odd1, Odd2, Feedback, Out, Decrypt);
+        SHIFT8(KeyStream, Out);
 
         /* Generate parity bit */
         Out = CRYPTO1_FILTER_OUTPUT_B0_24(Odd0, Odd1, Odd2);
@@ -6,6 +6,16 @@
 
 void Crypto1GetState(uint8_t *pEven, uint8_t *pOdd);
 
+/* Complete cipher state, to set up an authentication ahead of time without
+ * disturbing the running session */
+typedef struct {
+    uint8_t Even[3];
+    uint8_t Odd[3];
+} Crypto1StateType;
+
+void Crypto1SaveState(Crypto1StateType *Saved);
+void Crypto1LoadState(const Crypto1StateType *Saved);
+
 /* Gets the current keystream-bit, without shifting the internal LFSR */
 uint8_t Crypto1FilterOutput(void);
 
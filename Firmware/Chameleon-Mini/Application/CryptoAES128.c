@@ -47,6 +47,10 @@ static CryptoAESBlock_t __CryptoAES_IVData = { 0 };
 /* Set the last operation mode (ECB or CBC) init for the context */
 uint8_t __CryptoAESOpMode = CRYPTO_AES_ECB_MODE;
 
+/* Key of the last CryptoAES*Buffer call, session keys are used for many calls in a row */
+static CryptoAESKeyContext_t __CryptoAESBufferKeyCtx = { 0 };
+static bool __CryptoAESBufferKeyCtxValid = false;
+
 void aes_start(void) {
     AES.CTRL |= AES_START_bm;
 }
@@ -213,18 +217,33 @@ static void CryptoAESEncryptBlock(uint8_t *Plaintext, uint8_t *Ciphertext, const
     aes_clear_interrupt_flag();
 }
 
-static void CryptoAESDecryptBlock(uint8_t *Plaintext, uint8_t *Ciphertext, const uint8_t *Key) {
-    AES.CTRL = AES_RESET_bm;
-    NOP();
-    AES.CTRL = 0;
-    uint8_t lastSubKey[CRYPTO_AES_KEY_SIZE];
-    aes_lastsubkey_generate(Key, lastSubKey);
+void CryptoAESKeyContextInit(CryptoAESKeyContext_t *KeyCtx, const uint8_t *Key) {
+    memcpy(KeyCtx->Key, Key, CRYPTO_AES_KEY_SIZE);
+    KeyCtx->LastSubKeyValid = false;
+}
+
+static const uint8_t *CryptoAESGetLastSubKey(CryptoAESKeyContext_t *KeyCtx) {
+    if (!KeyCtx->LastSubKeyValid) {
+        KeyCtx->LastSubKeyValid = aes_lastsubkey_generate(KeyCtx->Key, KeyCtx->LastSubKey);
+    }
+    return KeyCtx->LastSubKey;
+}
+
+static CryptoAESKeyContext_t *CryptoAESGetBufferKeyContext(const uint8_t *Key) {
+    if (!__CryptoAESBufferKeyCtxValid || memcmp(__CryptoAESBufferKeyCtx.Key, Key, CRYPTO_AES_KEY_SIZE)) {
+        CryptoAESKeyContextInit(&__CryptoAESBufferKeyCtx, Key);
+        __CryptoAESBufferKeyCtxValid = true;
+    }
+    return &__CryptoAESBufferKeyCtx;
+}
+
+static void CryptoAESDecryptBlockSubKey(uint8_t *Plaintext, uint8_t *Ciphertext, const uint8_t *LastSubKey) {
     AES.CTRL = AES_RESET_bm;
     NOP();
     AES.CTRL = 0;
     aes_configure_decrypt(AES_MANUAL, AES_XOR_OFF);
     aes_isr_configure(AES_INTLVL_OFF);
-    aes_set_key(lastSubKey);
+    aes_set_key((uint8_t *) LastSubKey);
     for (uint8_t i = 0; i < CRYPTO_AES_BLOCK_SIZE; i++) {
         AES.STATE = 0x00;
     }
@@ -237,6 +256,124 @@ static void CryptoAESDecryptBlock(uint8_t *Plaintext, uint8_t *Ciphertext, const
     aes_clear_interrupt_flag();
 }
 
+static void CryptoAESDecryptBlock(uint8_t *Plaintext, uint8_t *Ciphertext, const uint8_t *Key) {
+    CryptoAESDecryptBlockSubKey(Plaintext, Ciphertext, CryptoAESGetLastSubKey(CryptoAESGetBufferKeyContext(Key)));
+}
+
+#ifdef CRYPTO_AES_HARDWARE_CBC
+static void CryptoAESResetPeripheral(void) {
+    AES.CTRL = AES_RESET_bm;
+    NOP();
+    AES.CTRL = 0;
+    aes_isr_configure(AES_INTLVL_OFF);
+}
+#endif
+
+static int CryptoAESGetExitStatus(void) {
+    if (aes_is_error()) {
+        aes_clear_error_flag();
+        return AES.STATUS & AES_ERROR_bm;
+    }
+    return CRYPTO_AES_EXIT_SUCCESS;
+}
+
+#ifdef CRYPTO_AES_HARDWARE_CBC
+int CryptoAESEncryptCBC(CryptoAESKeyContext_t *KeyCtx, uint16_t Count, const uint8_t *Plaintext,
+                        uint8_t *Ciphertext, uint8_t *IV) {
+    if ((Count % CRYPTO_AES_BLOCK_SIZE) != 0) {
+        return CRYPTO_AES_EXIT_UNEVEN_BLOCKS;
+    }
+    CryptoAESResetPeripheral();
+    /* The state memory starts out as the IV and afterwards holds the last
+     * ciphertext block. Every plaintext block is XORed onto it and the 16th
+     * byte written starts the next encryption. */
+    aes_configure_encrypt(AES_MANUAL, AES_XOR_OFF);
+    aes_write_inputdata(IV);
+    aes_configure_encrypt(AES_AUTO, AES_XOR_ON);
+    for (uint16_t blk = 0; blk < Count; blk += CRYPTO_AES_BLOCK_SIZE) {
+        /* The key memory holds the last subkey after every encryption */
+        aes_set_key(KeyCtx->Key);
+        aes_write_inputdata((uint8_t *) &Plaintext[blk]);
+        do {
+            /* Wait until AES is finished or an error occurs. */
+        } while (aes_is_busy());
+        aes_read_outputdata(&Ciphertext[blk]);
+        aes_clear_interrupt_flag();
+    }
+    if (Count > 0) {
+        memcpy(IV, &Ciphertext[Count - CRYPTO_AES_BLOCK_SIZE], CRYPTO_AES_BLOCK_SIZE);
+        /* Which is what a later decryption needs, for free */
+        if (!KeyCtx->LastSubKeyValid && !aes_is_error()) {
+            aes_get_key(KeyCtx->LastSubKey);
+            KeyCtx->LastSubKeyValid = true;
+        }
+    }
+    return CryptoAESGetExitStatus();
+}
+
+int CryptoAESDecryptCBC(CryptoAESKeyContext_t *KeyCtx, uint16_t Count, uint8_t *Plaintext,
+                        const uint8_t *Ciphertext, uint8_t *IV) {
+    if ((Count % CRYPTO_AES_BLOCK_SIZE) != 0) {
+        return CRYPTO_AES_EXIT_UNEVEN_BLOCKS;
+    }
+    const uint8_t *LastSubKey = CryptoAESGetLastSubKey(KeyCtx);
+    CryptoAESBlock_t chainBlock, nextChainBlock;
+    memcpy(chainBlock, IV, CRYPTO_AES_BLOCK_SIZE);
+    CryptoAESResetPeripheral();
+    for (uint16_t blk = 0; blk < Count; blk += CRYPTO_AES_BLOCK_SIZE) {
+        /* Keep the ciphertext block, the output may overwrite it */
+        memcpy(nextChainBlock, &Ciphertext[blk], CRYPTO_AES_BLOCK_SIZE);
+        aes_configure_decrypt(AES_AUTO, AES_XOR_OFF);
+        /* The key memory holds the initial key after every decryption */
+        aes_set_key((uint8_t *) LastSubKey);
+        aes_write_inputdata(nextChainBlock);
+        do {
+            /* Wait until AES is finished or an error occurs. */
+        } while (aes_is_busy());
+        aes_clear_interrupt_flag();
+        /* P = D(C) ^ previous C, XORed onto the result in the state memory */
+        aes_configure_decrypt(AES_MANUAL, AES_XOR_ON);
+        aes_write_inputdata(chainBlock);
+        aes_read_outputdata(&Plaintext[blk]);
+        memcpy(chainBlock, nextChainBlock, CRYPTO_AES_BLOCK_SIZE);
+    }
+    memcpy(IV, chainBlock, CRYPTO_AES_BLOCK_SIZE);
+    return CryptoAESGetExitStatus();
+}
+#else
+int CryptoAESEncryptCBC(CryptoAESKeyContext_t *KeyCtx, uint16_t Count, const uint8_t *Plaintext,
+                        uint8_t *Ciphertext, uint8_t *IV) {
+    if ((Count % CRYPTO_AES_BLOCK_SIZE) != 0) {
+        return CRYPTO_AES_EXIT_UNEVEN_BLOCKS;
+    }
+    CryptoAESBlock_t inputBlock;
+    for (uint16_t blk = 0; blk < Count; blk += CRYPTO_AES_BLOCK_SIZE) {
+        memcpy(inputBlock, &Plaintext[blk], CRYPTO_AES_BLOCK_SIZE);
+        CryptoMemoryXOR(IV, inputBlock, CRYPTO_AES_BLOCK_SIZE);
+        CryptoAESEncryptBlock(inputBlock, &Ciphertext[blk], KeyCtx->Key, true);
+        memcpy(IV, &Ciphertext[blk], CRYPTO_AES_BLOCK_SIZE);
+    }
+    return CryptoAESGetExitStatus();
+}
+
+int CryptoAESDecryptCBC(CryptoAESKeyContext_t *KeyCtx, uint16_t Count, uint8_t *Plaintext,
+                        const uint8_t *Ciphertext, uint8_t *IV) {
+    if ((Count % CRYPTO_AES_BLOCK_SIZE) != 0) {
+        return CRYPTO_AES_EXIT_UNEVEN_BLOCKS;
+    }
+    const uint8_t *LastSubKey = CryptoAESGetLastSubKey(KeyCtx);
+    CryptoAESBlock_t chainBlock;
+    for (uint16_t blk = 0; blk < Count; blk += CRYPTO_AES_BLOCK_SIZE) {
+        /* Keep the ciphertext block, the output may overwrite it */
+        memcpy(chainBlock, &Ciphertext[blk], CRYPTO_AES_BLOCK_SIZE);
+        CryptoAESDecryptBlockSubKey(&Plaintext[blk], chainBlock, LastSubKey);
+        CryptoMemoryXOR(IV, &Plaintext[blk], CRYPTO_AES_BLOCK_SIZE);
+        memcpy(IV, chainBlock, CRYPTO_AES_BLOCK_SIZE);
+    }
+    return CryptoAESGetExitStatus();
+}
+#endif
+
 int CryptoAESEncryptBuffer(uint16_t Count, uint8_t *Plaintext, uint8_t *Ciphertext,
                            uint8_t *IVIn, const uint8_t *Key) {
     uint8_t *IV = IVIn;
@@ -247,6 +384,12 @@ int CryptoAESEncryptBuffer(uint16_t Count, uint8_t *Plaintext, uint8_t *Cipherte
         memset(__CryptoAES_IVData, 0x00, CRYPTO_AES_BLOCK_SIZE);
         IV = &__CryptoAES_IVData[0];
     }
+#ifdef CRYPTO_AES_HARDWARE_CBC
+    if (__CryptoAESOpMode != CRYPTO_AES_CBC_MODE) {
+        /* Plain CBC chaining, the same as the loop below */
+        return CryptoAESEncryptCBC(CryptoAESGetBufferKeyContext(Key), Count, Plaintext, Ciphertext, IV);
+    }
+#endif
     CryptoAESBlock_t inputBlock;
     size_t bufBlocks = (Count + CRYPTO_AES_BLOCK_SIZE - 1) / CRYPTO_AES_BLOCK_SIZE;
     bool unevenBlockSize = (Count % CRYPTO_AES_BLOCK_SIZE) != 0;
@@ -304,6 +447,12 @@ int CryptoAESDecryptBuffer(uint16_t Count, uint8_t *Plaintext, uint8_t *Cipherte
         memset(__CryptoAES_IVData, 0x00, CRYPTO_AES_BLOCK_SIZE);
         IV = &__CryptoAES_IVData[0];
     }
+#ifdef CRYPTO_AES_HARDWARE_CBC
+    if (__CryptoAESOpMode != CRYPTO_AES_CBC_MODE && (Count % CRYPTO_AES_BLOCK_SIZE) == 0) {
+        /* Plain CBC chaining over whole blocks, the same as the loop below */
+        return CryptoAESDecryptCBC(CryptoAESGetBufferKeyContext(Key), Count, Plaintext, Ciphertext, IV);
+    }
+#endif
     CryptoAESBlock_t inputBlock;
     size_t bufBlocks = (Count + CRYPTO_AES_BLOCK_SIZE - 1) / CRYPTO_AES_BLOCK_SIZE;
     bool unevenBlockSize = (Count % CRYPTO_AES_BLOCK_SIZE) != 0;
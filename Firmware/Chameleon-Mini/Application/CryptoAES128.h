@@ -31,6 +31,7 @@
 #define __CRYPTO_AES128_HW_H__
 
 #include <avr/io.h>
+#include <stdbool.h>
 
 /* AES Processing mode */
 #define CRYPTO_AES_PMODE_DECIPHER          0     // decipher
@@ -144,6 +145,29 @@ void aes_set_callback(const aes_callback_t callback);
 void CryptoAESGetConfigDefaults(CryptoAESConfig_t *ctx);
 void CryptoAESInitContext(CryptoAESConfig_t *ctx);
 
+/* A loaded key together with the last round key, which the hardware needs as
+ * the starting point of a decryption. The last round key is only available
+ * after an encryption with the key, so it is derived once per key and kept
+ * here instead of running a dummy encryption before every block. */
+typedef struct {
+    CryptoAESKey_t   Key;
+    CryptoAESKey_t   LastSubKey;
+    bool             LastSubKeyValid;
+} CryptoAESKeyContext_t;
+
+void CryptoAESKeyContextInit(CryptoAESKeyContext_t *KeyCtx, const uint8_t *Key);
+
+/* Standard CBC over whole blocks. The IV is updated to the last ciphertext
+ * block. Plaintext and ciphertext may be the same buffer. By default every
+ * block goes through the per block routines. With CRYPTO_AES_HARDWARE_CBC the
+ * blocks are chained in the AES state memory (auto start and XOR load) without
+ * a reset of the peripheral between them, and CryptoAESEncryptBuffer and
+ * CryptoAESDecryptBuffer use these routines as well. */
+int CryptoAESEncryptCBC(CryptoAESKeyContext_t *KeyCtx, uint16_t Count, const uint8_t *Plaintext,
+                        uint8_t *Ciphertext, uint8_t *IV);
+int CryptoAESDecryptCBC(CryptoAESKeyContext_t *KeyCtx, uint16_t Count, uint8_t *Plaintext,
+                        const uint8_t *Ciphertext, uint8_t *IV);
+
 int CryptoAESEncryptBuffer(uint16_t Count, uint8_t *Plaintext, uint8_t *Ciphertext,
                            uint8_t *IV, const uint8_t *Key);
 int CryptoAESDecryptBuffer(uint16_t Count, uint8_t *Plaintext, uint8_t *Ciphertext,
@@ -32,123 +32,163 @@ This notice must be retained at the top of all source files where indicated.
 #include "CryptoTDEA.h"
 #include "CryptoAES128.h"
 
-static uint8_t _cmac_K1[CRYPTO_MAX_BLOCK_SIZE] = { 0x00 };
-static uint8_t _cmac_K2[CRYPTO_MAX_BLOCK_SIZE] = { 0x00 };
-static uint8_t _cmac_RB[CRYPTO_MAX_BLOCK_SIZE] = { 0x00 };
-static uint8_t _cmac_final[CRYPTO_MAX_BLOCK_SIZE] = { 0x00 };
+static const uint8_t _cmac_zero_block[CRYPTO_MAX_BLOCK_SIZE] = { 0x00 };
+/* Running IV of a CMAC started without one */
+static uint8_t _cmac_null_iv[CRYPTO_MAX_BLOCK_SIZE] = { 0x00 };
+/* IV and MAC buffer of the DES MAC, not zero after use */
 static uint8_t _cmac_zeros[CRYPTO_MAX_BLOCK_SIZE] = { 0x00 };
 static uint8_t _mac_key24[CRYPTO_MAX_KEY_SIZE] = { 0x00 };
 
-static void getCMACSubK1(const uint8_t *bufferL, uint8_t blockSize, uint8_t polyByte, uint8_t *bufferOut);
-static void getCMACSubK1(const uint8_t *bufferL, uint8_t blockSize, uint8_t polyByte, uint8_t *bufferOut) {
-    _cmac_RB[blockSize - 1] = polyByte;
-    RotateArrayLeft(bufferL, bufferOut, blockSize);
-    if ((bufferL[0] & 0x80) != 0) {
-        for (int kidx = 0; kidx < blockSize; kidx++) {
-            bufferOut[kidx] = (uint8_t)(bufferOut[kidx] ^ _cmac_RB[kidx]);
-        }
-    }
-}
+/* Used by appendBufferCMAC/checkBufferCMAC for keys other than the session key */
+static CryptoCMACContext_t _cmac_context = { 0 };
 
-static void getCMACSubK2(const uint8_t *bufferK1, uint8_t blockSize, uint8_t polyByte, uint8_t *bufferOut);
-static void getCMACSubK2(const uint8_t *bufferK1, uint8_t blockSize, uint8_t polyByte, uint8_t *bufferOut) {
-    _cmac_RB[blockSize - 1] = polyByte;
-    RotateArrayLeft(bufferK1, bufferOut, blockSize);
-    if ((bufferK1[0] & 0x80) != 0) {
-        for (int kidx = 0; kidx < blockSize; kidx++) {
-            bufferOut[kidx] = (uint8_t)(bufferOut[kidx] ^ _cmac_RB[kidx]);
-        }
+/* The subkeys are L << 1 and L << 2 in GF(2^n), reduced by the polynomial byte */
+static void CryptoCMACDoubleSubkey(const uint8_t *bufferIn, uint8_t blockSize, uint8_t polyByte, uint8_t *bufferOut) {
+    uint8_t carry = 0;
+    for (int kidx = blockSize - 1; kidx >= 0; kidx--) {
+        uint8_t nextCarry = bufferIn[kidx] >> 7;
+        bufferOut[kidx] = (uint8_t)((bufferIn[kidx] << 1) | carry);
+        carry = nextCarry;
+    }
+    if (carry) {
+        bufferOut[blockSize - 1] ^= polyByte;
     }
 }
 
-static bool appendBufferCMACSubroutine(uint8_t cryptoType, const uint8_t *keyData, uint8_t *bufferK1, uint8_t *bufferK2, uint8_t *bufferIV, uint8_t blockSize, uint8_t *bufferOut, uint16_t bufferSize);
-static bool appendBufferCMACSubroutine(uint8_t cryptoType, const uint8_t *keyData, uint8_t *bufferK1, uint8_t *bufferK2, uint8_t *bufferIV, uint8_t blockSize, uint8_t *bufferOut, uint16_t bufferSize) {
-    uint16_t newBlockSize = bufferSize;
-    if (bufferSize == 0) {
-        memset(bufferOut, 0x00, blockSize);
-        bufferOut[0] = (uint8_t) 0x80;
-        newBlockSize = blockSize;
-    } else if ((bufferSize % blockSize) != 0) {
-        newBlockSize = bufferSize - (bufferSize % blockSize) + blockSize;
-        bufferOut[bufferSize] = (uint8_t) 0x80;
-    }
-    if (bufferSize != 0 && (bufferSize % blockSize) == 0) {
-        // Complete block (use K1):
-        for (int i = bufferSize - blockSize; i < bufferSize; i++) {
-            bufferOut[i] ^= bufferK1[i - bufferSize + blockSize];
-        }
-    } else {
-        // Incomplete block (use K2):
-        for (int i = bufferSize - blockSize; i < bufferSize; i++) {
-            bufferOut[i] ^= bufferK2[i - bufferSize + blockSize];
-        }
-    }
-    switch (cryptoType) {
-        case CRYPTO_TYPE_3K3DES:
-            Encrypt3DESBuffer(newBlockSize, bufferOut, &bufferOut[bufferSize], keyData, bufferIV);
+/* IV = E_K(IV ^ block) */
+static void CryptoCMACEncryptBlock(CryptoCMACContext_t *ctx, const uint8_t *block) {
+    switch (ctx->CryptoType) {
+        case CRYPTO_TYPE_3K3DES: {
+            uint8_t inputBlock[CRYPTO_3KTDEA_BLOCK_SIZE];
+            memcpy(inputBlock, ctx->IV, CRYPTO_3KTDEA_BLOCK_SIZE);
+            CryptoMemoryXOR(block, inputBlock, CRYPTO_3KTDEA_BLOCK_SIZE);
+            CryptoEncrypt3KTDEA(inputBlock, ctx->IV, ctx->KeyData);
             break;
+        }
         case CRYPTO_TYPE_AES128:
-            CryptoAESEncryptBuffer(newBlockSize, bufferOut, &bufferOut[bufferSize], keyData, bufferIV);
+            CryptoAESEncryptCBC(&ctx->AESKey, CRYPTO_AES_BLOCK_SIZE, block, ctx->Block, ctx->IV);
             break;
         default:
-            return false;
+            break;
     }
-    memmove(&bufferOut[0], &bufferOut[newBlockSize], newBlockSize);
-    memcpy(_cmac_final, &bufferOut[newBlockSize - blockSize], blockSize);
-    memcpy(&bufferOut[newBlockSize], _cmac_final, blockSize);
-    return true;
 }
 
-bool appendBufferCMAC(uint8_t cryptoType, const uint8_t *keyData, uint8_t *bufferData, uint16_t bufferSize, uint8_t *IV) {
-    uint8_t blockSize, rb;
-    uint8_t *nistL = _cmac_K2;
+bool CryptoCMACInit(CryptoCMACContext_t *ctx, uint8_t cryptoType, const uint8_t *keyData, uint8_t *IV) {
+    uint8_t rb;
     switch (cryptoType) {
         case CRYPTO_TYPE_3K3DES:
-            blockSize = CRYPTO_3KTDEA_BLOCK_SIZE;
+            ctx->BlockSize = CRYPTO_3KTDEA_BLOCK_SIZE;
             rb = CRYPTO_CMAC_RB64;
-            memset(_cmac_zeros, 0x00, blockSize);
-            Encrypt3DESBuffer(blockSize, _cmac_zeros, nistL, _cmac_zeros, keyData);
             break;
         case CRYPTO_TYPE_AES128:
-            blockSize = CRYPTO_AES_BLOCK_SIZE;
+            ctx->BlockSize = CRYPTO_AES_BLOCK_SIZE;
             rb = CRYPTO_CMAC_RB128;
-            memset(_cmac_zeros, 0x00, blockSize);
-            CryptoAESEncryptBuffer(blockSize, _cmac_zeros, nistL, _cmac_zeros, keyData);
+            CryptoAESKeyContextInit(&ctx->AESKey, keyData);
             break;
         default:
+            ctx->CryptoType = CRYPTO_TYPE_ANY;
             return false;
     }
-    getCMACSubK1(nistL, blockSize, rb, _cmac_K1);
-    getCMACSubK2(_cmac_K1, blockSize, rb, _cmac_K2);
-    if (IV == NULL) {
-        IV = _cmac_zeros;
-        memset(IV, 0x00, blockSize);
-        return appendBufferCMACSubroutine(cryptoType, keyData, _cmac_K1, _cmac_K2, IV, blockSize, bufferData, bufferSize);
+    ctx->CryptoType = cryptoType;
+    ctx->KeyData = keyData;
+    /* L = E_K(0), run through the context with a zero IV */
+    uint8_t nistL[CRYPTO_MAX_BLOCK_SIZE] = { 0x00 };
+    ctx->IV = nistL;
+    CryptoCMACEncryptBlock(ctx, _cmac_zero_block);
+    CryptoCMACDoubleSubkey(nistL, ctx->BlockSize, rb, ctx->K1);
+    CryptoCMACDoubleSubkey(ctx->K1, ctx->BlockSize, rb, ctx->K2);
+    memset(nistL, 0x00, sizeof(nistL));
+    ctx->IV = IV;
+    ctx->BlockFill = 0;
+    return true;
+}
+
+void CryptoCMACUpdate(CryptoCMACContext_t *ctx, const uint8_t *bufferData, uint16_t bufferSize) {
+    uint8_t blockSize = ctx->BlockSize;
+    while (bufferSize > 0) {
+        /* A complete block is only processed once more data follows, the last
+         * one is kept back for CryptoCMACFinalize */
+        if (ctx->BlockFill == blockSize) {
+            CryptoCMACEncryptBlock(ctx, ctx->Block);
+            ctx->BlockFill = 0;
+        }
+        if (ctx->BlockFill == 0 && bufferSize > blockSize) {
+            /* Whole blocks straight from the message */
+            CryptoCMACEncryptBlock(ctx, bufferData);
+            bufferData += blockSize;
+            bufferSize -= blockSize;
+            continue;
+        }
+        uint8_t chunkSize = MIN(bufferSize, blockSize - ctx->BlockFill);
+        memcpy(&ctx->Block[ctx->BlockFill], bufferData, chunkSize);
+        ctx->BlockFill += chunkSize;
+        bufferData += chunkSize;
+        bufferSize -= chunkSize;
+    }
+}
+
+void CryptoCMACFinalize(CryptoCMACContext_t *ctx, uint8_t *macOut) {
+    uint8_t blockSize = ctx->BlockSize;
+    if (ctx->BlockFill == blockSize) {
+        /* Complete block (use K1): */
+        CryptoMemoryXOR(ctx->K1, ctx->Block, blockSize);
     } else {
-        return appendBufferCMACSubroutine(cryptoType, keyData, _cmac_K1, _cmac_K2, IV, blockSize, bufferData, bufferSize);
+        /* Incomplete block (use K2): */
+        ctx->Block[ctx->BlockFill] = 0x80;
+        memset(&ctx->Block[ctx->BlockFill + 1], 0x00, blockSize - ctx->BlockFill - 1);
+        CryptoMemoryXOR(ctx->K2, ctx->Block, blockSize);
+    }
+    CryptoCMACEncryptBlock(ctx, ctx->Block);
+    ctx->BlockFill = 0;
+    if (macOut != NULL) {
+        memcpy(macOut, ctx->IV, blockSize);
     }
 }
 
+static CryptoCMACContext_t *getCMACContext(uint8_t cryptoType, const uint8_t *keyData, uint8_t *IV) {
+    if (SessionCMAC.CryptoType == cryptoType && SessionCMAC.KeyData == keyData && SessionCMAC.IV == IV) {
+        return &SessionCMAC;
+    }
+    if (IV == NULL) {
+        IV = _cmac_null_iv;
+        memset(IV, 0x00, CRYPTO_MAX_BLOCK_SIZE);
+    }
+    if (!CryptoCMACInit(&_cmac_context, cryptoType, keyData, IV)) {
+        return NULL;
+    }
+    return &_cmac_context;
+}
+
+uint16_t appendBufferCMAC(uint8_t cryptoType, const uint8_t *keyData, uint8_t *bufferData, uint16_t bufferSize, uint8_t *IV) {
+    CryptoCMACContext_t *ctx = getCMACContext(cryptoType, keyData, IV);
+    if (ctx == NULL) {
+        return bufferSize;
+    }
+    CryptoCMACUpdate(ctx, bufferData, bufferSize);
+    CryptoCMACFinalize(ctx, &bufferData[bufferSize]);
+    return bufferSize + ctx->BlockSize;
+}
+
 bool checkBufferCMAC(uint8_t *bufferData, uint16_t bufferSize, uint16_t checksumSize) {
+    uint8_t cryptoType;
+    uint8_t macData[CRYPTO_MAX_BLOCK_SIZE];
     if (checksumSize > bufferSize) {
         return false;
     }
     if (checksumSize == CRYPTO_3KTDEA_BLOCK_SIZE) {
-        appendBufferCMAC(CRYPTO_TYPE_3K3DES, SessionKey, &bufferData[bufferSize], bufferSize - checksumSize, SessionIV);
-        memcpy(_cmac_zeros, &bufferData[bufferSize], checksumSize);
-        if (memcmp(_cmac_zeros, &bufferData[bufferSize - checksumSize], checksumSize)) {
-            return false;
-        }
-        return true;
+        cryptoType = CRYPTO_TYPE_3K3DES;
     } else if (checksumSize == CRYPTO_AES_BLOCK_SIZE) {
-        appendBufferCMAC(CRYPTO_TYPE_AES128, SessionKey, &bufferData[bufferSize], bufferSize - checksumSize, SessionIV);
-        memcpy(_cmac_zeros, &bufferData[bufferSize], checksumSize);
-        if (memcmp(_cmac_zeros, &bufferData[bufferSize - checksumSize], checksumSize)) {
-            return false;
-        }
-        return true;
+        cryptoType = CRYPTO_TYPE_AES128;
+    } else {
+        return false;
+    }
+    CryptoCMACContext_t *ctx = getCMACContext(cryptoType, SessionKey, SessionIV);
+    if (ctx == NULL) {
+        return false;
     }
-    return false;
+    CryptoCMACUpdate(ctx, bufferData, bufferSize - checksumSize);
+    CryptoCMACFinalize(ctx, macData);
+    return memcmp(macData, &bufferData[bufferSize - checksumSize], checksumSize) == 0;
 }
 
 uint16_t appendBufferMAC(const uint8_t *keyData, uint8_t *bufferData, uint16_t bufferSize) {
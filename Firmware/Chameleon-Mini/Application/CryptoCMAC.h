@@ -36,7 +36,32 @@ This notice must be retained at the top of all source files where indicated.
 #define CRYPTO_CMAC_RB64           (0x1B)
 #define CRYPTO_CMAC_RB128          ((uint8_t) 0x87)
 
-bool appendBufferCMAC(uint8_t cryptoType, const uint8_t *keyData, uint8_t *bufferData, uint16_t bufferSize, uint8_t *IV);
+/* The subkeys K1 and K2 of a key, derived once, and the running IV. The MAC
+ * of a message is fed in pieces to CryptoCMACUpdate, CryptoCMACFinalize
+ * then writes it (which is also the new IV) to any location, e.g. right
+ * behind the message. */
+typedef struct {
+    uint8_t               CryptoType;       /* CRYPTO_TYPE_3K3DES or CRYPTO_TYPE_AES128, CRYPTO_TYPE_ANY if unused */
+    uint8_t               BlockSize;
+    uint8_t               BlockFill;
+    const uint8_t        *KeyData;
+    uint8_t              *IV;
+    uint8_t               K1[CRYPTO_MAX_BLOCK_SIZE];
+    uint8_t               K2[CRYPTO_MAX_BLOCK_SIZE];
+    uint8_t               Block[CRYPTO_MAX_BLOCK_SIZE];  /* The last block seen, it needs K1 or K2 */
+    CryptoAESKeyContext_t AESKey;
+} CryptoCMACContext_t;
+
+/* Set up by generateSessionKey for the SessionKey and SessionIV of an
+ * authenticated DESFire session */
+extern CryptoCMACContext_t SessionCMAC;
+
+bool CryptoCMACInit(CryptoCMACContext_t *ctx, uint8_t cryptoType, const uint8_t *keyData, uint8_t *IV);
+void CryptoCMACUpdate(CryptoCMACContext_t *ctx, const uint8_t *bufferData, uint16_t bufferSize);
+void CryptoCMACFinalize(CryptoCMACContext_t *ctx, uint8_t *macOut);
+
+/* Appends the CMAC and updates the IV to it, returns the new buffer size */
+uint16_t appendBufferCMAC(uint8_t cryptoType, const uint8_t *keyData, uint8_t *bufferData, uint16_t bufferSize, uint8_t *IV);
 bool checkBufferMAC(uint8_t *bufferData, uint16_t bufferSize, uint16_t checksumSize);
 
 uint16_t appendBufferMAC(const uint8_t *keyData, uint8_t *bufferData, uint16_t bufferSize);
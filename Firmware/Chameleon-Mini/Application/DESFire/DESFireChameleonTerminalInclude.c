@@ -28,13 +28,8 @@ This notice must be retained at the top of all source files where indicated.
 
 #ifndef __DESFIRE_CHAMELEON_TERMINAL_INCLUDE_C__
 #define __DESFIRE_CHAMELEON_TERMINAL_INCLUDE_C__
+/* Kept in the order of the command names, see CommandTable in Terminal/CommandLine.c */
 {
-    .Command        = DFCOMMAND_SET_HEADER,
-    .ExecFunc       = NO_FUNCTION,
-    .ExecParamFunc  = NO_FUNCTION,
-    .SetFunc        = CommandDESFireSetHeaderProperty,
-    .GetFunc        = NO_FUNCTION
-}, {
     .Command        = DFCOMMAND_COMM_MODE,
     .ExecFunc       = NO_FUNCTION,
     .ExecParamFunc  = NO_FUNCTION,
@@ -46,6 +41,12 @@ This notice must be retained at the top of all source files where indicated.
     .ExecParamFunc  = NO_FUNCTION,
     .SetFunc        = CommandDESFireSetEncryptionMode,
     .GetFunc        = NO_FUNCTION
+}, {
+    .Command        = DFCOMMAND_SET_HEADER,
+    .ExecFunc       = NO_FUNCTION,
+    .ExecParamFunc  = NO_FUNCTION,
+    .SetFunc        = CommandDESFireSetHeaderProperty,
+    .GetFunc        = NO_FUNCTION
 },
 
 #endif
@@ -41,6 +41,7 @@ This notice must be retained at the top of all source files where indicated.
 CryptoKeyBufferType SessionKey = { 0 };
 CryptoIVBufferType SessionIV = { 0 };
 BYTE SessionIVByteSize = 0;
+CryptoCMACContext_t SessionCMAC = { 0 };
 BYTE DesfireCommMode = DESFIRE_DEFAULT_COMMS_STANDARD;
 
 uint16_t AESCryptoKeySizeBytes = 0;
@@ -58,6 +59,7 @@ void InvalidateAuthState(BYTE keepPICCAuthData) {
         memset(&SessionKey[0], 0x00, CRYPTO_MAX_BLOCK_SIZE);
         memset(&SessionIV[0], 0x00, CRYPTO_MAX_BLOCK_SIZE);
         SessionIVByteSize = 0;
+        memset(&SessionCMAC, 0x00, sizeof(SessionCMAC));
     }
     Authenticated = false;
     AuthenticatedWithKey = DESFIRE_NOT_AUTHENTICATED;
@@ -128,6 +130,9 @@ bool generateSessionKey(uint8_t *sessionKey, uint8_t *rndA, uint8_t *rndB, uint1
         default:
             return false;
     }
+    /* The CMAC subkeys only depend on the session key, so they are derived here
+     * once instead of for every command */
+    CryptoCMACInit(&SessionCMAC, cryptoType, sessionKey, SessionIV);
     return true;
 }
 
@@ -150,6 +155,7 @@ BYTE GetCryptoKeyTypeFromAuthenticateMethod(BYTE authCmdMethod) {
 void InitAESCryptoKeyData(void) {
     memset(&SessionKey[0], 0x00, CRYPTO_MAX_KEY_SIZE);
     memset(&SessionIV[0], 0x00, CRYPTO_MAX_BLOCK_SIZE);
+    memset(&SessionCMAC, 0x00, sizeof(SessionCMAC));
 }
 
 #endif /* CONFIG_MF_DESFIRE_SUPPORT */
@@ -118,8 +118,6 @@ uint16_t ISO144434ProcessBlock(uint8_t *Buffer, uint16_t ByteCount, uint16_t Bit
 /*
  * ISO/IEC 14443-3A implementation
  */
-#define ISO14443A_CRCA_INIT                 ((uint16_t) 0x6363)
-uint16_t ISO14443AUpdateCRCA(const uint8_t *Buffer, uint16_t ByteCount, uint16_t InitCRCA);
 
 #define GetAndSetBufferCRCA(Buffer, ByteCount)     ({                                \
      uint16_t fullReturnBits = 0;                                                    \
@@ -130,7 +128,7 @@ uint16_t ISO14443AUpdateCRCA(const uint8_t *Buffer, uint16_t ByteCount, uint16_t
 
 #define GetAndSetNoResponseCRCA(Buffer)            ({                                \
      uint16_t fullReturnBits = 0;                                                    \
-     ISO14443AUpdateCRCA(Buffer, 0, ISO14443A_CRCA_INIT);                            \
+     ISO14443AAppendCRCA(Buffer, 0);                                                 \
      fullReturnBits = ISO14443A_CRC_FRAME_SIZE;                                      \
      fullReturnBits;                                                                 \
      })
@@ -55,11 +55,6 @@ int32_t Int32FromByteBuffer(uint8_t *byteBuffer);
 
 SIZET RoundBlockSize(SIZET byteSize, SIZET blockSize);
 
-/* Copied from the READER configuration sources: */
-uint16_t DesfireAddParityBits(uint8_t *Buffer, uint16_t bits);
-uint16_t DesfireRemoveParityBits(uint8_t *Buffer, uint16_t BitCount);
-bool DesfireCheckParityBits(uint8_t *Buffer, uint16_t BitCount);
-
 #ifdef DESFIRE_DEBUGGING
 #define DesfireDebuggingOn      (DESFIRE_DEBUGGING != 0)
 #else
@@ -61,55 +61,105 @@ bool ISO14443ASelectDesfire(void *Buffer, uint16_t *BitCount, uint8_t *UidCL, ui
 }
 #endif /* CONFIG_MF_DESFIRE_SUPPORT */
 
-#define USE_HW_CRC
-#ifdef USE_HW_CRC
-uint16_t ISO14443AAppendCRCA(void *Buffer, uint16_t ByteCount) {
-    uint8_t *DataPtr = (uint8_t *) Buffer;
+/* The data byte i of a frame with parity starts at bit 9 * i, i.e. at bit i % 8
+ * of byte i + i / 8, and is followed by its parity bit. */
+uint16_t ISO14443AAddParityBits(uint8_t *Buffer, uint16_t BitCount) {
+    if (BitCount == 7)
+        return 7;
+    if (BitCount % 8)
+        return BitCount;
+
+    uint16_t ByteCount = BitCount / 8;
+    uint8_t Carry = 0;
+
+    /* Expanding in place, so start at the end. The upper byte of every 9 bit
+     * symbol is complete, the lower one shares its bits with the previous
+     * symbol and is carried over. */
+    Buffer[ByteCount + ByteCount / 8] = 0;
+
+    for (uint16_t i = ByteCount; i-- > 0;) {
+        uint8_t Data = Buffer[i];
+        uint8_t Shift = i % 8;
+        uint8_t *Out = &Buffer[i + i / 8];
+        uint16_t Symbol = ((uint16_t) OddParityBit(Data) << 8 | Data) << Shift;
+
+        Out[1] = (Symbol >> 8) | Carry;
+
+        if (Shift == 0) {
+            Out[0] = Symbol & 0xFF;
+            Carry = 0;
+        } else {
+            Carry = Symbol & 0xFF;
+        }
+    }
 
-    CRC.CTRL = CRC_RESET0_bm;
-    CRC.CHECKSUM1 = (CRC_INIT_R >> 8) & 0xFF;
-    CRC.CHECKSUM0 = (CRC_INIT_R >> 0) & 0xFF;
-    CRC.CTRL = CRC_SOURCE_IO_gc;
+    return BitCount + ByteCount;
+}
 
-    while (ByteCount--) {
-        uint8_t Byte = *DataPtr++;
-        Byte = BitReverseByte(Byte);
+uint16_t ISO14443ARemoveParityBits(uint8_t *Buffer, uint16_t BitCount, bool *ParityOk) {
+    bool Ok = true;
 
-        CRC.DATAIN = Byte;
+    /* Short frame, no parity bit is added */
+    if (BitCount == 7) {
+        if (ParityOk != NULL)
+            *ParityOk = true;
+        return 7;
     }
 
-    DataPtr[0] = BitReverseByte(CRC.CHECKSUM1);
-    DataPtr[1] = BitReverseByte(CRC.CHECKSUM0);
+    uint16_t ByteCount = BitCount / 9;
 
-    CRC.CTRL = CRC_SOURCE_DISABLE_gc;
+    /* Byte i is read from i + i / 8 and later, so shrinking in place is safe */
+    for (uint16_t i = 0; i < ByteCount; i++) {
+        const uint8_t *In = &Buffer[i + i / 8];
+        uint16_t Symbol = (In[0] | (uint16_t) In[1] << 8) >> (i % 8);
+        uint8_t Data = Symbol & 0xFF;
 
-    return (uint16_t)(((DataPtr[0] << 8) & 0x00FF00) | (DataPtr[1] & 0x00FF));
-}
-#else
-#include <util/crc16.h>
-uint16_t ISO14443AAppendCRCA(void *Buffer, uint16_t ByteCount) {
-    uint16_t Checksum = CRC_INIT;
-    uint8_t *DataPtr = (uint8_t *) Buffer;
+        if (((Symbol >> 8) ^ OddParityBit(Data)) & 0x01)
+            Ok = false;
 
-    while (ByteCount--) {
-        uint8_t Byte = *DataPtr++;
-        Checksum = _crc_ccitt_update(Checksum, Byte);
+        Buffer[i] = Data;
     }
 
-    DataPtr[0] = (Checksum >> 0) & 0x00FF;
-    DataPtr[1] = (Checksum >> 8) & 0x00FF;
+    if (ParityOk != NULL)
+        *ParityOk = Ok;
 
-    return Checksum;
+    return ByteCount * 8;
 }
-#endif
 
+bool ISO14443ACheckParityBits(const uint8_t *Buffer, uint16_t BitCount) {
+    if (BitCount == 7)
+        return true;
+
+    uint16_t ByteCount = BitCount / 9;
+
+    for (uint16_t i = 0; i < ByteCount; i++) {
+        const uint8_t *In = &Buffer[i + i / 8];
+        uint16_t Symbol = (In[0] | (uint16_t) In[1] << 8) >> (i % 8);
+
+        if (((Symbol >> 8) ^ OddParityBit(Symbol & 0xFF)) & 0x01)
+            return false;
+    }
+
+    return true;
+}
+
+#ifndef HOST_BUILD
+#define USE_HW_CRC
+#endif
 #ifdef USE_HW_CRC
-bool ISO14443ACheckCRCA(const void *Buffer, uint16_t ByteCount) {
+/* The CRC peripheral computes the non-reflected CRC-CCITT. Feeding it the
+ * bit reversed bytes yields the bit reversed CRC-A, so the running checksum
+ * is converted on the way in and out: CHECKSUM1 holds the reversed low byte
+ * and CHECKSUM0 the reversed high byte of the CRC-A state. */
+uint16_t ISO14443ACRCAUpdate(uint16_t Checksum, const void *Buffer, uint16_t ByteCount) {
     const uint8_t *DataPtr = (const uint8_t *) Buffer;
 
+    if (ByteCount == 0)
+        return Checksum;
+
     CRC.CTRL = CRC_RESET0_bm;
-    CRC.CHECKSUM1 = (CRC_INIT_R >> 8) & 0xFF;
-    CRC.CHECKSUM0 = (CRC_INIT_R >> 0) & 0xFF;
+    CRC.CHECKSUM1 = BitReverseByte((Checksum >> 0) & 0xFF);
+    CRC.CHECKSUM0 = BitReverseByte((Checksum >> 8) & 0xFF);
     CRC.CTRL = CRC_SOURCE_IO_gc;
 
     while (ByteCount--) {
@@ -119,24 +169,68 @@ bool ISO14443ACheckCRCA(const void *Buffer, uint16_t ByteCount) {
         CRC.DATAIN = Byte;
     }
 
-    bool Result = (DataPtr[0] == BitReverseByte(CRC.CHECKSUM1)) && (DataPtr[1] == BitReverseByte(CRC.CHECKSUM0));
+    Checksum = ((uint16_t) BitReverseByte(CRC.CHECKSUM0) << 8) | BitReverseByte(CRC.CHECKSUM1);
 
     CRC.CTRL = CRC_SOURCE_DISABLE_gc;
 
-    return Result;
+    return Checksum;
 }
 #else
-#include <util/crc16.h>
-bool ISO14443ACheckCRCA(const void *Buffer, uint16_t ByteCount) {
-    uint16_t Checksum = CRC_INIT;
+/* Reflected CRC-CCITT (polynomial 0x8408), one lookup per byte */
+static const uint16_t PROGMEM CRCATable[256] = {
+    0x0000, 0x1189, 0x2312, 0x329B, 0x4624, 0x57AD, 0x6536, 0x74BF,
+    0x8C48, 0x9DC1, 0xAF5A, 0xBED3, 0xCA6C, 0xDBE5, 0xE97E, 0xF8F7,
+    0x1081, 0x0108, 0x3393, 0x221A, 0x56A5, 0x472C, 0x75B7, 0x643E,
+    0x9CC9, 0x8D40, 0xBFDB, 0xAE52, 0xDAED, 0xCB64, 0xF9FF, 0xE876,
+    0x2102, 0x308B, 0x0210, 0x1399, 0x6726, 0x76AF, 0x4434, 0x55BD,
+    0xAD4A, 0xBCC3, 0x8E58, 0x9FD1, 0xEB6E, 0xFAE7, 0xC87C, 0xD9F5,
+    0x3183, 0x200A, 0x1291, 0x0318, 0x77A7, 0x662E, 0x54B5, 0x453C,
+    0xBDCB, 0xAC42, 0x9ED9, 0x8F50, 0xFBEF, 0xEA66, 0xD8FD, 0xC974,
+    0x4204, 0x538D, 0x6116, 0x709F, 0x0420, 0x15A9, 0x2732, 0x36BB,
+    0xCE4C, 0xDFC5, 0xED5E, 0xFCD7, 0x8868, 0x99E1, 0xAB7A, 0xBAF3,
+    0x5285, 0x430C, 0x7197, 0x601E, 0x14A1, 0x0528, 0x37B3, 0x263A,
+    0xDECD, 0xCF44, 0xFDDF, 0xEC56, 0x98E9, 0x8960, 0xBBFB, 0xAA72,
+    0x6306, 0x728F, 0x4014, 0x519D, 0x2522, 0x34AB, 0x0630, 0x17B9,
+    0xEF4E, 0xFEC7, 0xCC5C, 0xDDD5, 0xA96A, 0xB8E3, 0x8A78, 0x9BF1,
+    0x7387, 0x620E, 0x5095, 0x411C, 0x35A3, 0x242A, 0x16B1, 0x0738,
+    0xFFCF, 0xEE46, 0xDCDD, 0xCD54, 0xB9EB, 0xA862, 0x9AF9, 0x8B70,
+    0x8408, 0x9581, 0xA71A, 0xB693, 0xC22C, 0xD3A5, 0xE13E, 0xF0B7,
+    0x0840, 0x19C9, 0x2B52, 0x3ADB, 0x4E64, 0x5FED, 0x6D76, 0x7CFF,
+    0x9489, 0x8500, 0xB79B, 0xA612, 0xD2AD, 0xC324, 0xF1BF, 0xE036,
+    0x18C1, 0x0948, 0x3BD3, 0x2A5A, 0x5EE5, 0x4F6C, 0x7DF7, 0x6C7E,
+    0xA50A, 0xB483, 0x8618, 0x9791, 0xE32E, 0xF2A7, 0xC03C, 0xD1B5,
+    0x2942, 0x38CB, 0x0A50, 0x1BD9, 0x6F66, 0x7EEF, 0x4C74, 0x5DFD,
+    0xB58B, 0xA402, 0x9699, 0x8710, 0xF3AF, 0xE226, 0xD0BD, 0xC134,
+    0x39C3, 0x284A, 0x1AD1, 0x0B58, 0x7FE7, 0x6E6E, 0x5CF5, 0x4D7C,
+    0xC60C, 0xD785, 0xE51E, 0xF497, 0x8028, 0x91A1, 0xA33A, 0xB2B3,
+    0x4A44, 0x5BCD, 0x6956, 0x78DF, 0x0C60, 0x1DE9, 0x2F72, 0x3EFB,
+    0xD68D, 0xC704, 0xF59F, 0xE416, 0x90A9, 0x8120, 0xB3BB, 0xA232,
+    0x5AC5, 0x4B4C, 0x79D7, 0x685E, 0x1CE1, 0x0D68, 0x3FF3, 0x2E7A,
+    0xE70E, 0xF687, 0xC41C, 0xD595, 0xA12A, 0xB0A3, 0x8238, 0x93B1,
+    0x6B46, 0x7ACF, 0x4854, 0x59DD, 0x2D62, 0x3CEB, 0x0E70, 0x1FF9,
+    0xF78F, 0xE606, 0xD49D, 0xC514, 0xB1AB, 0xA022, 0x92B9, 0x8330,
+    0x7BC7, 0x6A4E, 0x58D5, 0x495C, 0x3DE3, 0x2C6A, 0x1EF1, 0x0F78,
+};
+
+uint16_t ISO14443ACRCAUpdate(uint16_t Checksum, const void *Buffer, uint16_t ByteCount) {
     const uint8_t *DataPtr = (const uint8_t *) Buffer;
 
-    while (ByteCount--) {
-        uint8_t Byte = *DataPtr++;
+    while (ByteCount--)
+        Checksum = (Checksum >> 8) ^ pgm_read_word(&CRCATable[(Checksum ^ *DataPtr++) & 0xFF]);
 
-        Checksum = _crc_ccitt_update(Checksum, Byte);
-    }
-
-    return (DataPtr[0] == ((Checksum >> 0) & 0xFF)) && (DataPtr[1] == ((Checksum >> 8) & 0xFF));
+    return Checksum;
 }
 #endif
+
+uint16_t ISO14443AAppendCRCA(void *Buffer, uint16_t ByteCount) {
+    uint16_t Checksum = ISO14443ACRCAUpdate(ISO14443ACRCAInit(), Buffer, ByteCount);
+
+    ISO14443ACRCAFinal(Checksum, (uint8_t *) Buffer + ByteCount);
+
+    return Checksum;
+}
+
+bool ISO14443ACheckCRCA(const void *Buffer, uint16_t ByteCount) {
+    /* Running the CRC over the data and its appended CRC leaves no residue */
+    return ISO14443ACRCAUpdate(ISO14443ACRCAInit(), Buffer, ByteCount + ISO14443A_CRCA_SIZE) == 0;
+}
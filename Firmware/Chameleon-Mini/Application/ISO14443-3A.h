@@ -51,6 +51,33 @@
 uint16_t ISO14443AAppendCRCA(void *Buffer, uint16_t ByteCount);
 bool ISO14443ACheckCRCA(const void *Buffer, uint16_t ByteCount);
 
+/* Streaming CRC-A for frames that are built or received in pieces:
+ *   Checksum = ISO14443ACRCAInit();
+ *   Checksum = ISO14443ACRCAUpdate(Checksum, Data, Count); (any number of times)
+ *   ISO14443ACRCAFinal(Checksum, &Frame[FrameLength]);
+ * The checksum is plain state, so independent frames can be in flight at once.
+ * Updating over the data and its CRC gives 0 for an intact frame. */
+uint16_t ISO14443ACRCAUpdate(uint16_t Checksum, const void *Buffer, uint16_t ByteCount);
+
+INLINE uint16_t ISO14443ACRCAInit(void) {
+    return CRC_INIT;
+}
+
+INLINE void ISO14443ACRCAFinal(uint16_t Checksum, void *Buffer) {
+    uint8_t *DataPtr = (uint8_t *) Buffer;
+
+    DataPtr[0] = (Checksum >> 0) & 0xFF;
+    DataPtr[1] = (Checksum >> 8) & 0xFF;
+}
+
+/* Parity bit framing as used by the reader and sniffer codecs: every byte is
+ * followed by its odd parity bit, the bit stream is packed LSB first. 7 bit
+ * short frames carry no parity. All routines run in a single pass. */
+uint16_t ISO14443AAddParityBits(uint8_t *Buffer, uint16_t BitCount);
+/* ParityOk may be NULL, otherwise it receives the result of the parity check */
+uint16_t ISO14443ARemoveParityBits(uint8_t *Buffer, uint16_t BitCount, bool *ParityOk);
+bool ISO14443ACheckParityBits(const uint8_t *Buffer, uint16_t BitCount);
+
 #define ISO14443A_UID0_RANDOM       0x08
 #define ISO14443A_UID0_CT           0x88
 
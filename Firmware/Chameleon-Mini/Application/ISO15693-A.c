@@ -2,57 +2,61 @@
 
 #include "ISO15693-A.h"
 #include "../Common.h"
-#include <util/crc16.h>
 
 CurrentFrame FrameInfo;
 uint8_t Uid[ISO15693_GENERIC_UID_SIZE];
 uint8_t MyAFI;
 uint16_t ResponseByteCount;
 
-//Refer to ISO/IEC 15693-3:2001 page 41
-uint16_t calculateCRC(void *FrameBuf, uint16_t FrameBufSize) {
-    uint16_t reg = ISO15693_CRC16_PRESET;
-    uint8_t i, j;
-
-    uint8_t *DataPtr = (uint8_t *)FrameBuf;
-
-    for (i = 0; i < FrameBufSize; i++) {
-        reg = reg ^ *DataPtr++;
-        for (j = 0; j < 8; j++) {
-            if (reg & 0x0001) {
-                reg = (reg >> 1) ^ ISO15693_CRC16_POLYNORMAL;
-            } else {
-                reg = (reg >> 1);
-            }
-        }
-    }
+/* CRC register after each value of its low nibble has been shifted out, for
+ * the reflected polynomial of ISO/IEC 15693-3:2001 page 41. Small enough to
+ * run the CRC inside the codec interrupts. */
+const uint16_t PROGMEM ISO15693CRCNibbleTable[16] = {
+    0x0000, 0x1081, 0x2102, 0x3183, 0x4204, 0x5285, 0x6306, 0x7387,
+    0x8408, 0x9489, 0xA50A, 0xB58B, 0xC60C, 0xD68D, 0xE70E, 0xF78F,
+};
 
-    return ~reg;
-}
+/* Frame the codec has run the CRC over while demodulating */
+static struct {
+    const void *FrameBuf;
+    uint16_t FrameBytes;
+    uint16_t Checksum;
+} ReceivedCRC;
 
-void ISO15693AppendCRC(uint8_t *FrameBuf, uint16_t FrameBufSize) {
-    uint16_t crc;
+uint16_t ISO15693CRCUpdate(uint16_t Checksum, const void *Buffer, uint16_t ByteCount) {
+    const uint8_t *DataPtr = (const uint8_t *) Buffer;
 
-    crc = calculateCRC(FrameBuf, FrameBufSize);
+    while (ByteCount--)
+        Checksum = ISO15693CRCUpdateByte(Checksum, *DataPtr++);
 
-    uint8_t crcLb = crc & 0xFF;
-    uint8_t crcHb = crc >> 8;
+    return Checksum;
+}
 
+void ISO15693CRCReceived(const void *FrameBuf, uint16_t FrameBytes, uint16_t Checksum) {
+    ReceivedCRC.FrameBuf = FrameBuf;
+    ReceivedCRC.FrameBytes = FrameBytes;
+    ReceivedCRC.Checksum = Checksum;
+}
 
-    FrameBuf[FrameBufSize] = crcLb;
-    FrameBuf[FrameBufSize + 1] = crcHb;
+void ISO15693AppendCRC(uint8_t *FrameBuf, uint16_t FrameBufSize) {
+    uint16_t Checksum = ISO15693CRCUpdate(ISO15693CRCInit(), FrameBuf, FrameBufSize);
+
+    ISO15693CRCFinal(Checksum, &FrameBuf[FrameBufSize]);
 }
 
 bool ISO15693CheckCRC(void *FrameBuf, uint16_t FrameBufSize) {
-    uint16_t crc;
-    uint8_t *DataPtr = (uint8_t *)FrameBuf;
+    uint16_t Checksum;
 
-    crc = calculateCRC(DataPtr, FrameBufSize);
+    if (ReceivedCRC.FrameBuf == FrameBuf && ReceivedCRC.FrameBytes == FrameBufSize + ISO15693_CRC16_SIZE) {
+        Checksum = ReceivedCRC.Checksum;
+    } else {
+        Checksum = ISO15693CRCUpdate(ISO15693CRCInit(), FrameBuf, FrameBufSize + ISO15693_CRC16_SIZE);
+    }
 
-    uint8_t crcLb = crc & 0xFF;
-    uint8_t crcHb = crc >> 8;
+    /* Only valid for the first check, the buffer is reused for the answer */
+    ReceivedCRC.FrameBuf = NULL;
 
-    return (DataPtr[FrameBufSize] == crcLb && DataPtr[FrameBufSize + 1] == crcHb);
+    return Checksum == ISO15693_CRC16_RESIDUE;
 }
 
 /*
@@ -71,6 +71,7 @@
 #define ISO15693_CRC16_SIZE             0x2       /* Bytes */
 #define ISO15693_CRC16_POLYNORMAL       0x8408
 #define ISO15693_CRC16_PRESET           0xFFFF
+#define ISO15693_CRC16_RESIDUE          0xF0B8    /* Register after data and its CRC */
 
 /* The lock status byte has bits assigned as follow */
 #define ISO15693_MASK_UNLOCKED          ( 0 << 0 )
@@ -92,6 +93,39 @@ extern uint16_t ResponseByteCount;  /* Length of response, used when building re
 
 void ISO15693AppendCRC(uint8_t *FrameBuf, uint16_t FrameBufSize);
 bool ISO15693CheckCRC(void *FrameBuf, uint16_t FrameBufSize);
+
+/* Streaming CRC for frames that are sent or received a byte at a time:
+ *   Checksum = ISO15693CRCInit();
+ *   Checksum = ISO15693CRCUpdateByte(Checksum, Byte); (or ISO15693CRCUpdate)
+ *   ISO15693CRCFinal(Checksum, &Frame[FrameLength]);
+ * Updating over the data and its CRC gives ISO15693_CRC16_RESIDUE for an
+ * intact frame. A codec that does so while demodulating passes the register
+ * to ISO15693CRCReceived before ApplicationProcess, the following
+ * ISO15693CheckCRC of that frame then only compares it. */
+extern const uint16_t PROGMEM ISO15693CRCNibbleTable[16];
+
+uint16_t ISO15693CRCUpdate(uint16_t Checksum, const void *Buffer, uint16_t ByteCount);
+void ISO15693CRCReceived(const void *FrameBuf, uint16_t FrameBytes, uint16_t Checksum);
+
+INLINE uint16_t ISO15693CRCInit(void) {
+    return ISO15693_CRC16_PRESET;
+}
+
+INLINE uint16_t ISO15693CRCUpdateByte(uint16_t Checksum, uint8_t Byte) {
+    Checksum ^= Byte;
+    Checksum = (Checksum >> 4) ^ pgm_read_word(&ISO15693CRCNibbleTable[Checksum & 0x0F]);
+    Checksum = (Checksum >> 4) ^ pgm_read_word(&ISO15693CRCNibbleTable[Checksum & 0x0F]);
+
+    return Checksum;
+}
+
+INLINE void ISO15693CRCFinal(uint16_t Checksum, void *Buffer) {
+    uint8_t *DataPtr = (uint8_t *) Buffer;
+
+    Checksum = ~Checksum;
+    DataPtr[0] = (Checksum >> 0) & 0xFF;
+    DataPtr[1] = (Checksum >> 8) & 0xFF;
+}
 bool ISO15693PrepareFrame(uint8_t *FrameBuf, uint16_t FrameBytes, CurrentFrame *FrameStruct, uint8_t IsSelected, uint8_t *MyUid, uint8_t MyAFI);
 bool ISO15693AntiColl(uint8_t *FrameBuf, uint16_t FrameBytes, CurrentFrame *FrameStruct, uint8_t *MyUid);
 
@@ -289,6 +289,30 @@ static uint16_t CardATQAValue;
 static uint8_t CardSAKValue;
 static bool FromHalt = false;
 
+/* The next authentication is prepared by MifareClassicAppTask between frames: a card
+ * nonce with both responses and the cipher state for the sector the reader will most
+ * likely authenticate next. AUTH only has to check that the key and UID are still the
+ * ones the cipher has been set up with. */
+static struct {
+    bool NonceReady;
+    bool CipherReady;
+    uint8_t CardNonce[4];       /* Plain, sent on the first authentication */
+    uint8_t NestedNonce[8];     /* Encrypted and its parity bits, sent on a nested authentication */
+    uint8_t ReaderResponse[4];
+    uint8_t CardResponse[4];
+    uint16_t KeyAddress;
+    uint8_t Key[MEM_KEY_SIZE];
+    uint8_t Uid[MEM_UID_CL1_SIZE];
+    Crypto1StateType Cipher;
+} PreparedAuth;
+
+/* AUTH command and block expected next. After a SELECT it is the one the reader started
+ * with after the previous SELECT, after an AUTH the next sector, as when the card is
+ * read out. */
+static uint8_t PredictedAuth[CMD_AUTH_FRAME_SIZE];
+static uint8_t FirstAuth[CMD_AUTH_FRAME_SIZE] = { CMD_AUTH_A, 0 };
+static bool AuthSinceSelect = false;
+
 #define BYTE_SWAP(x) (((uint8_t)(x)>>4)|((uint8_t)(x)<<4))
 #define NO_ACCESS 0x07
 
@@ -341,6 +365,115 @@ INLINE uint8_t GetAccessCondition(uint8_t Block) {
     return (ResultForBlock);
 }
 
+/* Address of the key that an AUTH command for Block uses */
+static uint16_t AuthKeyAddress(uint8_t Cmd, uint8_t Block) {
+    uint16_t KeyOffset = (Cmd == CMD_AUTH_A ? MEM_KEY_A_OFFSET : MEM_KEY_B_OFFSET);
+
+    /* Fix for MFClassic 4k cards */
+    if (Block >= 128) {
+        return (Block & MEM_BIGSECTOR_ADDR_MASK) * MEM_BYTES_PER_BLOCK + KeyOffset + MEM_KEY_BIGSECTOR_OFFSET;
+    } else {
+        return (Block & MEM_SECTOR_ADDR_MASK) * MEM_BYTES_PER_BLOCK + KeyOffset;
+    }
+}
+
+static void ReadAuthUid(uint8_t Uid[MEM_UID_CL1_SIZE]) {
+    if (ActiveConfiguration.UidSize == 7)
+        MemoryReadBlock(Uid, MEM_UID_CL2_ADDRESS, MEM_UID_CL2_SIZE);
+    else
+        MemoryReadBlock(Uid, MEM_UID_CL1_ADDRESS, MEM_UID_CL1_SIZE);
+}
+
+static void PrepareAuthNonce(void) {
+    /* Generate a random nonce */
+    RandomGetBuffer(PreparedAuth.CardNonce, sizeof(PreparedAuth.CardNonce));
+
+    /* Precalculate the reader response from card-nonce */
+    memcpy(PreparedAuth.ReaderResponse, PreparedAuth.CardNonce, sizeof(PreparedAuth.ReaderResponse));
+    Crypto1PRNG(PreparedAuth.ReaderResponse, 64);
+
+    /* Precalculate our response from the reader response */
+    memcpy(PreparedAuth.CardResponse, PreparedAuth.ReaderResponse, sizeof(PreparedAuth.CardResponse));
+    Crypto1PRNG(PreparedAuth.CardResponse, 32);
+
+    PreparedAuth.NonceReady = true;
+    PreparedAuth.CipherReady = false;
+}
+
+static void PrepareAuthCipher(uint16_t KeyAddress, const uint8_t *Key, const uint8_t *Uid) {
+    /* Leaves the cipher set up in Crypto1. The nested setup results in the same state as
+     * Crypto1Setup and also gives the encrypted nonce. */
+    PreparedAuth.KeyAddress = KeyAddress;
+    memcpy(PreparedAuth.Key, Key, sizeof(PreparedAuth.Key));
+    memcpy(PreparedAuth.Uid, Uid, sizeof(PreparedAuth.Uid));
+    memcpy(PreparedAuth.NestedNonce, PreparedAuth.CardNonce, sizeof(PreparedAuth.CardNonce));
+
+    Crypto1SetupNested(PreparedAuth.Key, PreparedAuth.Uid, PreparedAuth.NestedNonce, false);
+    Crypto1SaveState(&PreparedAuth.Cipher);
+
+    PreparedAuth.CipherReady = true;
+}
+
+/* Sets up the cipher for an AUTH command in Buffer and puts the card nonce
+ * into Buffer. Returns the size of the answer. */
+static uint16_t AuthAnswer(uint8_t *Buffer, bool Nested) {
+    uint16_t KeyAddress = AuthKeyAddress(Buffer[0], Buffer[1]);
+    uint8_t Key[MEM_KEY_SIZE];
+    uint8_t Uid[MEM_UID_CL1_SIZE];
+
+    /* Read UID and key from memory */
+    ReadAuthUid(Uid);
+    MemoryReadBlock(Key, KeyAddress, MEM_KEY_SIZE);
+
+    if (!PreparedAuth.NonceReady) {
+        PrepareAuthNonce();
+    }
+
+    if (PreparedAuth.CipherReady && PreparedAuth.KeyAddress == KeyAddress &&
+            !memcmp(PreparedAuth.Key, Key, sizeof(Key)) && !memcmp(PreparedAuth.Uid, Uid, sizeof(Uid))) {
+        Crypto1LoadState(&PreparedAuth.Cipher);
+    } else {
+        /* Another sector than expected, or key or UID have changed in between */
+        PrepareAuthCipher(KeyAddress, Key, Uid);
+    }
+
+    memcpy(ReaderResponse, PreparedAuth.ReaderResponse, sizeof(ReaderResponse));
+    memcpy(CardResponse, PreparedAuth.CardResponse, sizeof(CardResponse));
+    PreparedAuth.NonceReady = false;
+
+    if (!AuthSinceSelect) {
+        FirstAuth[0] = Buffer[0];
+        FirstAuth[1] = Buffer[1];
+        AuthSinceSelect = true;
+    }
+
+    PredictedAuth[0] = Buffer[0];
+    PredictedAuth[1] = (Buffer[1] < 128) ? (Buffer[1] | 0x03) + 1 : (Buffer[1] | 0x0F) + 1;
+
+    if (Nested) {
+        /* Encryption is on, so we have also to encrypt the parity */
+        for (uint8_t i = 0; i < sizeof(PreparedAuth.CardNonce); i++) {
+            Buffer[i] = PreparedAuth.NestedNonce[i];
+            Buffer[ISO14443A_BUFFER_PARITY_OFFSET + i] = PreparedAuth.NestedNonce[sizeof(PreparedAuth.CardNonce) + i];
+        }
+
+        return CMD_AUTH_RB_FRAME_SIZE * BITS_PER_BYTE | ISO14443A_APP_CUSTOM_PARITY;
+    } else {
+        /* use unencrypted card nonce */
+        memcpy(Buffer, PreparedAuth.CardNonce, sizeof(PreparedAuth.CardNonce));
+
+        return CMD_AUTH_RB_FRAME_SIZE * BITS_PER_BYTE;
+    }
+}
+
+INLINE void SelectDone(void) {
+    AccessAddress = 0xff; /* invalid, force reload */
+    PredictedAuth[0] = FirstAuth[0];
+    PredictedAuth[1] = FirstAuth[1];
+    AuthSinceSelect = false;
+    State = STATE_ACTIVE;
+}
+
 INLINE bool CheckValueIntegrity(uint8_t *Block) {
     /* Value Blocks contain a value stored three times, with
      * the middle portion inverted. */
@@ -380,11 +513,20 @@ INLINE void ValueToBlock(uint8_t *Block, uint32_t Value) {
     Block[11] = Block[3];
 }
 
+/* Nothing prepared yet for the memory of a newly activated setting */
+INLINE void AuthInit(void) {
+    PreparedAuth.NonceReady = false;
+    PreparedAuth.CipherReady = false;
+    FirstAuth[0] = CMD_AUTH_A;
+    FirstAuth[1] = 0;
+}
+
 void MifareClassicAppInitMini4B(void) {
     State = STATE_IDLE;
     CardATQAValue = MFCLASSIC_MINI_4B_ATQA_VALUE;
     CardSAKValue = MFCLASSIC_MINI_4B_SAK_VALUE;
     FromHalt = false;
+    AuthInit();
 }
 
 void MifareClassicAppInit1K(void) {
@@ -392,6 +534,7 @@ void MifareClassicAppInit1K(void) {
     CardATQAValue = MFCLASSIC_1K_ATQA_VALUE;
     CardSAKValue = MFCLASSIC_1K_SAK_VALUE;
     FromHalt = false;
+    AuthInit();
 }
 
 void MifareClassicAppInit1K7B(void) {
@@ -399,6 +542,7 @@ void MifareClassicAppInit1K7B(void) {
     CardATQAValue = MFCLASSIC_1K_7B_ATQA_VALUE;
     CardSAKValue = MFCLASSIC_1K_SAK_VALUE;
     FromHalt = false;
+    AuthInit();
 }
 
 
@@ -407,6 +551,7 @@ void MifareClassicAppInit4K(void) {
     CardATQAValue = MFCLASSIC_4K_ATQA_VALUE;
     CardSAKValue = MFCLASSIC_4K_SAK_VALUE;
     FromHalt = false;
+    AuthInit();
 }
 
 void MifareClassicAppInit4K7B(void) {
@@ -414,6 +559,7 @@ void MifareClassicAppInit4K7B(void) {
     CardATQAValue = MFCLASSIC_4K_7B_ATQA_VALUE;
     CardSAKValue = MFCLASSIC_4K_SAK_VALUE;
     FromHalt = false;
+    AuthInit();
 }
 
 void MifareClassicAppReset(void) {
@@ -421,7 +567,26 @@ void MifareClassicAppReset(void) {
 }
 
 void MifareClassicAppTask(void) {
-
+    /* One step at a time, not to delay the answer to a frame that arrives meanwhile */
+    if (State == STATE_ACTIVE || State == STATE_AUTHED_IDLE) {
+        uint16_t KeyAddress = AuthKeyAddress(PredictedAuth[0], PredictedAuth[1]);
+
+        if (!PreparedAuth.NonceReady) {
+            PrepareAuthNonce();
+        } else if (!PreparedAuth.CipherReady || PreparedAuth.KeyAddress != KeyAddress) {
+            Crypto1StateType Session;
+            uint8_t Key[MEM_KEY_SIZE];
+            uint8_t Uid[MEM_UID_CL1_SIZE];
+
+            ReadAuthUid(Uid);
+            MemoryReadBlock(Key, KeyAddress, MEM_KEY_SIZE);
+
+            /* Keep the running session of an authenticated reader */
+            Crypto1SaveState(&Session);
+            PrepareAuthCipher(KeyAddress, Key, Uid);
+            Crypto1LoadState(&Session);
+        }
+    }
 }
 
 uint16_t MifareClassicAppProcess(uint8_t *Buffer, uint16_t BitCount) {
@@ -546,8 +711,7 @@ uint16_t MifareClassicAppProcess(uint8_t *Buffer, uint16_t BitCount) {
                 } else {
                     MemoryReadBlock(UidCL1, MEM_UID_CL1_ADDRESS, MEM_UID_CL1_SIZE);
                     if (ISO14443ASelect(Buffer, &BitCount, UidCL1, CardSAKValue)) {
-                        AccessAddress = 0xff; /* invalid, force reload */
-                        State = STATE_ACTIVE;
+                        SelectDone();
                     }
                 }
 
@@ -568,8 +732,7 @@ uint16_t MifareClassicAppProcess(uint8_t *Buffer, uint16_t BitCount) {
                 MemoryReadBlock(UidCL2, MEM_UID_CL2_ADDRESS, MEM_UID_CL2_SIZE);
 
                 if (ISO14443ASelect(Buffer, &BitCount, UidCL2, CardSAKValue)) {
-                    AccessAddress = 0xff; /* invalid, force reload */
-                    State = STATE_ACTIVE;
+                    SelectDone();
                 }
 
                 return BitCount;
@@ -605,17 +768,12 @@ uint16_t MifareClassicAppProcess(uint8_t *Buffer, uint16_t BitCount) {
                 if (ISO14443ACheckCRCA(Buffer, CMD_AUTH_FRAME_SIZE)) {
 
                     //uint16_t SectorAddress = Buffer[1] & MEM_SECTOR_ADDR_MASK;
-                    uint16_t KeyOffset = (Buffer[0] == CMD_AUTH_A ? MEM_KEY_A_OFFSET : MEM_KEY_B_OFFSET);
                     uint16_t AccessOffset = MEM_KEY_A_OFFSET + MEM_KEY_SIZE;
                     uint16_t SectorStartAddress;
-                    uint8_t Key[6];
-                    uint8_t Uid[4];
-                    uint8_t CardNonce[8];
 
                     /* Fix for MFClassic 4k cards */
                     if (Buffer[1] >= 128) {
                         SectorStartAddress = (Buffer[1] & MEM_BIGSECTOR_ADDR_MASK) * MEM_BYTES_PER_BLOCK ;
-                        KeyOffset += MEM_KEY_BIGSECTOR_OFFSET;
                         AccessOffset += MEM_KEY_BIGSECTOR_OFFSET;
                     } else {
                         SectorStartAddress = (Buffer[1] & MEM_SECTOR_ADDR_MASK) * MEM_BYTES_PER_BLOCK ;
@@ -631,41 +789,11 @@ uint16_t MifareClassicAppProcess(uint8_t *Buffer, uint16_t BitCount) {
                     AccessAddress = CurrentAddress;
                     //}
 
-
-                    /* Generate a random nonce and read UID and key from memory */
-                    RandomGetBuffer(CardNonce, sizeof(CardNonce));
-                    if (ActiveConfiguration.UidSize == 7)
-                        MemoryReadBlock(Uid, MEM_UID_CL2_ADDRESS, MEM_UID_CL2_SIZE);
-                    else
-                        MemoryReadBlock(Uid, MEM_UID_CL1_ADDRESS, MEM_UID_CL1_SIZE);
-                    MemoryReadBlock(Key, SectorStartAddress + KeyOffset, MEM_KEY_SIZE);
-
-                    /* Precalculate the reader response from card-nonce */
-                    for (uint8_t i = 0; i < sizeof(ReaderResponse); i++)
-                        ReaderResponse[i] = CardNonce[i];
-
-                    Crypto1PRNG(ReaderResponse, 64);
-
-                    /* Precalculate our response from the reader response */
-                    for (uint8_t i = 0; i < sizeof(CardResponse); i++)
-                        CardResponse[i] = ReaderResponse[i];
-
-                    Crypto1PRNG(CardResponse, 32);
-
                     /* Respond with the random card nonce and expect further authentication
                      * form the reader in the next frame. */
                     State = STATE_AUTHING;
 
-                    /* use unencrypted card nonce */
-                    Buffer[0] = CardNonce[0];
-                    Buffer[1] = CardNonce[1];
-                    Buffer[2] = CardNonce[2];
-                    Buffer[3] = CardNonce[3];
-
-                    /* Setup crypto1 cipher. Discard in-place encrypted CardNonce. */
-                    Crypto1Setup(Key, Uid, CardNonce);
-
-                    return CMD_AUTH_RB_FRAME_SIZE * BITS_PER_BYTE;
+                    return AuthAnswer(Buffer, false);
                 } else {
                     Buffer[0] = NAK_CRC_ERROR;
                     return ACK_NAK_FRAME_SIZE;
@@ -876,17 +1004,12 @@ uint16_t MifareClassicAppProcess(uint8_t *Buffer, uint16_t BitCount) {
                 if (ISO14443ACheckCRCA(Buffer, CMD_AUTH_FRAME_SIZE)) {
                     /* Nested authentication. */
                     //uint16_t SectorAddress = Buffer[1] & MEM_SECTOR_ADDR_MASK;
-                    uint16_t KeyOffset = (Buffer[0] == CMD_AUTH_A ? MEM_KEY_A_OFFSET : MEM_KEY_B_OFFSET);
                     uint16_t AccOffset = MEM_KEY_A_OFFSET + MEM_KEY_SIZE;
                     uint16_t SectorStartAddress;
-                    uint8_t Key[6];
-                    uint8_t Uid[4];
-                    uint8_t CardNonce[8];
 
                     /* Fix for MFClassic 4k cards */
                     if (Buffer[1] >= 128) {
                         SectorStartAddress = (Buffer[1] & MEM_BIGSECTOR_ADDR_MASK) * MEM_BYTES_PER_BLOCK ;
-                        KeyOffset += MEM_KEY_BIGSECTOR_OFFSET;
                         AccOffset += MEM_KEY_BIGSECTOR_OFFSET;
                     } else {
                         SectorStartAddress = (Buffer[1] & MEM_SECTOR_ADDR_MASK) * MEM_BYTES_PER_BLOCK ;
@@ -902,43 +1025,11 @@ uint16_t MifareClassicAppProcess(uint8_t *Buffer, uint16_t BitCount) {
                         AccessAddress = CurrentAddress;
                     }
 
-                    /* Generate a random nonce and read UID and key from memory */
-                    RandomGetBuffer(CardNonce, sizeof(CardNonce));
-                    if (ActiveConfiguration.UidSize == 7)
-                        MemoryReadBlock(Uid, MEM_UID_CL2_ADDRESS, MEM_UID_CL2_SIZE);
-                    else
-                        MemoryReadBlock(Uid, MEM_UID_CL1_ADDRESS, MEM_UID_CL1_SIZE);
-                    MemoryReadBlock(Key, SectorStartAddress + KeyOffset, MEM_KEY_SIZE);
-
-                    /* Precalculate the reader response from card-nonce */
-                    for (uint8_t i = 0; i < sizeof(ReaderResponse); i++)
-                        ReaderResponse[i] = CardNonce[i];
-
-                    Crypto1PRNG(ReaderResponse, 64);
-
-                    /* Precalculate our response from the reader response */
-                    for (uint8_t i = 0; i < sizeof(CardResponse); i++)
-                        CardResponse[i] = ReaderResponse[i];
-
-                    Crypto1PRNG(CardResponse, 32);
-
-                    /* Setup crypto1 cipher. */
-                    Crypto1SetupNested(Key, Uid, CardNonce, false);
-
                     /* Respond with the encrypted random card nonce and expect further authentication
                      * form the reader in the next frame. */
-                    Buffer[0] = CardNonce[0];
-                    Buffer[1] = CardNonce[1];
-                    Buffer[2] = CardNonce[2];
-                    Buffer[3] = CardNonce[3];
-                    /* Encryption is on, so we have also to encrypt the pariy */
-                    Buffer[ ISO14443A_BUFFER_PARITY_OFFSET + 0] =  CardNonce[4];
-                    Buffer[ ISO14443A_BUFFER_PARITY_OFFSET + 1] =  CardNonce[5];
-                    Buffer[ ISO14443A_BUFFER_PARITY_OFFSET + 2] =  CardNonce[6];
-                    Buffer[ ISO14443A_BUFFER_PARITY_OFFSET + 3] =  CardNonce[7];
                     State = STATE_AUTHING;
 
-                    return CMD_AUTH_RB_FRAME_SIZE * BITS_PER_BYTE | ISO14443A_APP_CUSTOM_PARITY;
+                    return AuthAnswer(Buffer, true);
                 } else {
                     Buffer[0] = NAK_CRC_ERROR ^ Crypto1Nibble();
                     return ACK_NAK_FRAME_SIZE;
@@ -117,66 +117,6 @@ static const CardIdentificationType PROGMEM CardIdentificationList[] = {
 static CardType CardCandidates[ARRAY_COUNT(CardIdentificationList)];
 static uint8_t CardCandidatesIdx = 0;
 
-uint16_t addParityBits(uint8_t *Buffer, uint16_t BitCount) {
-    if (BitCount == 7)
-        return 7;
-    if (BitCount % 8)
-        return BitCount;
-    uint8_t *currByte, * tmpByte;
-    uint8_t *const lastByte = Buffer + BitCount / 8 + BitCount / 64; // starting address + number of bytes + number of parity bytes
-    currByte = Buffer + BitCount / 8 - 1;
-    uint8_t parity;
-    memset(currByte + 1, 0, lastByte - currByte); // zeroize all bytes used for parity bits
-    while (currByte >= Buffer) { // loop over all input bytes
-        parity = OddParityBit(*currByte); // get parity bit
-        tmpByte = lastByte;
-        while (tmpByte > currByte) { // loop over all bytes from the last byte to the current one -- shifts the whole byte string
-            *tmpByte <<= 1; // shift this byte
-            *tmpByte |= (*(tmpByte - 1) & 0x80) >> 7; // insert the last bit from the previous byte
-            tmpByte--; // go to the previous byte
-        }
-        *(++tmpByte) &= 0xFE; // zeroize the bit, where we want to put the parity bit
-        *tmpByte |= parity & 1; // add the parity bit
-        currByte--; // go to previous input byte
-    }
-    return BitCount + (BitCount / 8);
-}
-
-uint16_t removeParityBits(uint8_t *Buffer, uint16_t BitCount) {
-    // Short frame, no parity bit is added
-    if (BitCount == 7)
-        return 7;
-
-    uint16_t i;
-    for (i = 0; i < (BitCount / 9); i++) {
-        Buffer[i] = (Buffer[i + i / 8] >> (i % 8));
-        if (i % 8)
-            Buffer[i] |= (Buffer[i + i / 8 + 1] << (8 - (i % 8)));
-    }
-    return BitCount / 9 * 8;
-}
-
-bool checkParityBits(uint8_t *Buffer, uint16_t BitCount) {
-    if (BitCount == 7)
-        return true;
-
-    //if (BitCount % 9 || BitCount == 0)
-    //	return false;
-
-    uint16_t i;
-    uint8_t currentByte, parity;
-    for (i = 0; i < (BitCount / 9); i++) {
-        currentByte = (Buffer[i + i / 8] >> (i % 8));
-        if (i % 8)
-            currentByte |= (Buffer[i + i / 8 + 1] << (8 - (i % 8)));
-        parity = OddParityBit(currentByte);
-        if (((Buffer[i + i / 8 + 1] >> (i % 8)) ^ parity) & 1) {
-            return false;
-        }
-    }
-    return true;
-}
-
 void Reader14443AAppTimeout(void) {
     Reader14443AAppReset();
     Reader14443ACodecReset();
@@ -206,7 +146,7 @@ static uint16_t Reader14443A_Deselect(uint8_t *Buffer) { // deselects the card b
     ISO14443AAppendCRCA(Buffer, 1);
     ReaderState = STATE_DESELECT;
     Selected = false;
-    return addParityBits(Buffer, 24);
+    return ISO14443AAddParityBits(Buffer, 24);
 }
 
 static uint16_t Reader14443A_Select(uint8_t *Buffer, uint16_t BitCount) {
@@ -219,13 +159,15 @@ static uint16_t Reader14443A_Select(uint8_t *Buffer, uint16_t BitCount) {
 
     // general frame handling:
     uint8_t flags = 0;
-    if (BitCount > 0 && checkParityBits(Buffer, BitCount)) {
-        flags |= FLAGS_PARITY_OK;
-        BitCount = removeParityBits(Buffer, BitCount);
-    } else if (BitCount == 0) {
+    if (BitCount > 0) {
+        bool ParityOk;
+        BitCount = ISO14443ARemoveParityBits(Buffer, BitCount, &ParityOk);
+        if (ParityOk)
+            flags |= FLAGS_PARITY_OK;
+        else
+            LogEntry(LOG_ERR_APP_CHECKSUM_FAIL, Buffer, (BitCount + 7) / 8);
+    } else {
         flags |= FLAGS_NO_DATA;
-    } else { // checkParityBits returned false
-        LogEntry(LOG_ERR_APP_CHECKSUM_FAIL, Buffer, (BitCount + 7) / 8);
     }
 
 
@@ -248,7 +190,7 @@ static uint16_t Reader14443A_Select(uint8_t *Buffer, uint16_t BitCount) {
             Buffer[0] = ISO14443A_CMD_SELECT_CL1;
             Buffer[1] = 0x20; // NVB = 16
             ReaderState = STATE_ACTIVE_CL1;
-            return addParityBits(Buffer, 2 * BITS_PER_BYTE);
+            return ISO14443AAddParityBits(Buffer, 2 * BITS_PER_BYTE);
 
         case STATE_ACTIVE_CL1 ... STATE_ACTIVE_CL3:
             if ((flags & FLAGS_PARITY_OK) == 0 || BitCount < (5 * BITS_PER_BYTE) || !CHECK_BCC(Buffer)) {
@@ -268,10 +210,10 @@ static uint16_t Reader14443A_Select(uint8_t *Buffer, uint16_t BitCount) {
             Buffer[1] = 0x70; // NVB = 56
             ISO14443AAppendCRCA(Buffer, 7);
             ReaderState = ReaderState - STATE_ACTIVE_CL1 + STATE_SAK_CL1;
-            return addParityBits(Buffer, (7 + 2) * BITS_PER_BYTE);
+            return ISO14443AAddParityBits(Buffer, (7 + 2) * BITS_PER_BYTE);
 
         case STATE_SAK_CL1 ... STATE_SAK_CL3:
-            if ((flags & FLAGS_PARITY_OK) == 0 || BitCount != (3 * BITS_PER_BYTE) || ISO14443_CRCA(Buffer, 3) != 0) {
+            if ((flags & FLAGS_PARITY_OK) == 0 || BitCount != (3 * BITS_PER_BYTE) || !ISO14443ACheckCRCA(Buffer, 1)) {
                 ReaderState = STATE_IDLE;
                 Reader14443ACodecStart();
                 return 0;
@@ -281,7 +223,7 @@ static uint16_t Reader14443A_Select(uint8_t *Buffer, uint16_t BitCount) {
                 Buffer[0] = (ReaderState == STATE_SAK_CL1) ? ISO14443A_CMD_SELECT_CL2 : ISO14443A_CMD_SELECT_CL3;
                 Buffer[1] = 0x20; // NVB = 16 bit
                 ReaderState = ReaderState - STATE_SAK_CL1 + STATE_ACTIVE_CL1 + 1;
-                return addParityBits(Buffer, 2 * BITS_PER_BYTE);
+                return ISO14443AAddParityBits(Buffer, 2 * BITS_PER_BYTE);
             } else if (IS_CASCADE_BIT_SET(Buffer) && ReaderState == STATE_SAK_CL3) {
                 // TODO handle this very strange hopefully not happening error
             }
@@ -296,7 +238,7 @@ static uint16_t Reader14443A_Select(uint8_t *Buffer, uint16_t BitCount) {
                 Reader14443ACodecStart();
                 return 0;
             }
-            if ((flags & FLAGS_PARITY_OK) == 0 || ISO14443_CRCA(Buffer, 3)) {
+            if ((flags & FLAGS_PARITY_OK) == 0 || !ISO14443ACheckCRCA(Buffer, 1)) {
                 return Reader14443A_Deselect(Buffer);
             }
             ReaderState = STATE_HALT;
@@ -314,7 +256,7 @@ INLINE uint16_t Reader14443A_Halt(uint8_t *Buffer) {
     ISO14443AAppendCRCA(Buffer, 2);
     ReaderState = STATE_HALT;
     Selected = false;
-    return addParityBits(Buffer, 4 * BITS_PER_BYTE);
+    return ISO14443AAddParityBits(Buffer, 4 * BITS_PER_BYTE);
 }
 
 INLINE uint16_t Reader14443A_RATS(uint8_t *Buffer) {
@@ -322,7 +264,7 @@ INLINE uint16_t Reader14443A_RATS(uint8_t *Buffer) {
     Buffer[1] = 0x80;
     ISO14443AAppendCRCA(Buffer, 2);
     ReaderState = STATE_ATS;
-    return addParityBits(Buffer, 4 * BITS_PER_BYTE);
+    return ISO14443AAddParityBits(Buffer, 4 * BITS_PER_BYTE);
 }
 
 static bool Identify(uint8_t *Buffer, uint16_t *BitCount) {
@@ -353,14 +295,15 @@ static bool Identify(uint8_t *Buffer, uint16_t *BitCount) {
             // if we don't have to send the RATS, we are finished for distinguishing with ISO 14443A
 
         } else if (ReaderState == STATE_ATS) { // we have got the ATS
-            if (!checkParityBits(Buffer, *BitCount)) {
-                LogEntry(LOG_ERR_APP_CHECKSUM_FAIL, Buffer, (*BitCount + 8) / 7);
+            bool ParityOk;
+            *BitCount = ISO14443ARemoveParityBits(Buffer, *BitCount, &ParityOk);
+            if (!ParityOk) {
+                LogEntry(LOG_ERR_APP_CHECKSUM_FAIL, Buffer, (*BitCount + 7) / 8);
                 *BitCount = Reader14443A_Deselect(Buffer);
                 return false;
             }
-            *BitCount = removeParityBits(Buffer, *BitCount);
 
-            if (Buffer[0] != *BitCount / 8 - 2 || ISO14443_CRCA(Buffer, Buffer[0] + 2)) {
+            if (Buffer[0] != *BitCount / 8 - 2 || !ISO14443ACheckCRCA(Buffer, Buffer[0])) {
                 *BitCount = Reader14443A_Deselect(Buffer);
                 return false;
             }
@@ -399,7 +342,7 @@ static bool Identify(uint8_t *Buffer, uint16_t *BitCount) {
                         Buffer[1] = 0x60;
                         ISO14443AAppendCRCA(Buffer, 2);
                         ReaderState = STATE_DESFIRE_INFO;
-                        *BitCount = addParityBits(Buffer, 4 * BITS_PER_BYTE);
+                        *BitCount = ISO14443AAddParityBits(Buffer, 4 * BITS_PER_BYTE);
                         return false;
 #if 0
                     case CardType_NXP_MIFARE_Ultralight:
@@ -409,7 +352,7 @@ static bool Identify(uint8_t *Buffer, uint16_t *BitCount) {
                         Buffer[1] = 0x00;
                         ISO14443AAppendCRCA(Buffer, 2);
                         ReaderState = STATE_UL_C_AUTH;
-                        *BitCount = addParityBits(Buffer, 4 * BITS_PER_BYTE);
+                        *BitCount = ISO14443AAddParityBits(Buffer, 4 * BITS_PER_BYTE);
                         return false;
 #endif
                     default:
@@ -423,14 +366,15 @@ static bool Identify(uint8_t *Buffer, uint16_t *BitCount) {
                         CardCandidatesIdx = 0; // this will return that this card is unknown to us
                         break;
                     }
-                    if (!checkParityBits(Buffer, *BitCount)) {
-                        LogEntry(LOG_ERR_APP_CHECKSUM_FAIL, Buffer, (*BitCount + 8) / 7);
+                    bool ParityOk;
+                    *BitCount = ISO14443ARemoveParityBits(Buffer, *BitCount, &ParityOk);
+                    if (!ParityOk) {
+                        LogEntry(LOG_ERR_APP_CHECKSUM_FAIL, Buffer, (*BitCount + 7) / 8);
                         CardCandidatesIdx = 0;
                         *BitCount = Reader14443A_Deselect(Buffer);
                         return false;
                     }
-                    *BitCount = removeParityBits(Buffer, *BitCount);
-                    if (ISO14443_CRCA(Buffer, *BitCount / 8)) {
+                    if (ISO14443ACRCAUpdate(ISO14443ACRCAInit(), Buffer, *BitCount / 8) != 0) {
                         CardCandidatesIdx = 0;
                         *BitCount = Reader14443A_Deselect(Buffer);
                         return false;
@@ -455,7 +399,7 @@ static bool Identify(uint8_t *Buffer, uint16_t *BitCount) {
                     if (*BitCount == 0) {
                         Buffer[0] = 0x60; // Get Version command for UL EV1
                         ISO14443AAppendCRCA(Buffer, 1);
-                        *BitCount = addParityBits(Buffer, 3 * BITS_PER_BYTE);
+                        *BitCount = ISO14443AAddParityBits(Buffer, 3 * BITS_PER_BYTE);
                         ReaderState = STATE_UL_EV1_GETVERSION;
                         return false;
                     }
@@ -488,7 +432,7 @@ uint16_t Reader14443AAppProcess(uint8_t *Buffer, uint16_t BitCount) {
         case Reader14443_Send: {
             if (ReaderSendBitCount) {
                 memcpy(Buffer, ReaderSendBuffer, (ReaderSendBitCount + 7) / 8);
-                uint16_t tmp = addParityBits(Buffer, ReaderSendBitCount);
+                uint16_t tmp = ISO14443AAddParityBits(Buffer, ReaderSendBitCount);
                 ReaderSendBitCount = 0;
                 return tmp;
             }
@@ -500,8 +444,8 @@ uint16_t Reader14443AAppProcess(uint8_t *Buffer, uint16_t BitCount) {
                 return 0;
             }
             char tmpBuf[128];
-            bool parity = checkParityBits(Buffer, BitCount);
-            BitCount = removeParityBits(Buffer, BitCount);
+            bool parity;
+            BitCount = ISO14443ARemoveParityBits(Buffer, BitCount, &parity);
             if ((2 * (BitCount + 7) / 8 + 2 + 4) > 128) { // 2 = \r\n, 4 = size of bitcount in hex
                 sprintf(tmpBuf, "Too many data.");
                 Reader14443CurrentCommand = Reader14443_Do_Nothing;
@@ -704,9 +648,10 @@ uint16_t Reader14443AAppProcess(uint8_t *Buffer, uint16_t BitCount) {
                         Reader14443ACodecStart();
                         return 0;
                     }
-                    bool readPageAgain = (BitCount < 162) || !checkParityBits(Buffer, BitCount);
-                    BitCount = removeParityBits(Buffer, BitCount);
-                    if (readPageAgain || ISO14443_CRCA(Buffer, 18)) { // the CRC function should return 0 if everything is ok
+                    bool ParityOk;
+                    bool readPageAgain = (BitCount < 162);
+                    BitCount = ISO14443ARemoveParityBits(Buffer, BitCount, &ParityOk);
+                    if (readPageAgain || !ParityOk || !ISO14443ACheckCRCA(Buffer, 16)) {
                         MFURead_CurrentAdress -= 4;
                     } else { // everything is ok for this page
                         memcpy(MFUContents + (MFURead_CurrentAdress - 4) * 4, Buffer, 16);
@@ -754,7 +699,7 @@ uint16_t Reader14443AAppProcess(uint8_t *Buffer, uint16_t BitCount) {
 
                 MFURead_CurrentAdress += 4;
 
-                return addParityBits(Buffer, 4 * BITS_PER_BYTE);
+                return ISO14443AAddParityBits(Buffer, 4 * BITS_PER_BYTE);
             }
             return rVal;
         }
@@ -898,16 +843,4 @@ uint16_t Reader14443AAppProcess(uint8_t *Buffer, uint16_t BitCount) {
     return 0;
 }
 
-uint16_t ISO14443_CRCA(uint8_t *Buffer, uint8_t ByteCount) {
-    uint8_t *DataPtr = Buffer;
-    uint16_t crc = 0x6363;
-    uint8_t ch;
-    while (ByteCount--) {
-        ch = *DataPtr++ ^ crc;
-        ch = ch ^ (ch << 4);
-        crc = (crc >> 8) ^ (ch << 8) ^ (ch << 3) ^ (ch >> 4);
-    }
-    return crc;
-}
-
 #endif
@@ -4,8 +4,6 @@
 #include "Application.h"
 #include "Codec/Codec.h"
 
-#define CRC_INIT 0x6363
-
 extern uint8_t ReaderSendBuffer[];
 extern uint16_t ReaderSendBitCount;
 
@@ -17,11 +15,6 @@ void Reader14443AAppTimeout(void);
 
 uint16_t Reader14443AAppProcess(uint8_t *Buffer, uint16_t BitCount);
 
-uint16_t addParityBits(uint8_t *Buffer, uint16_t bits);
-uint16_t removeParityBits(uint8_t *Buffer, uint16_t BitCount);
-bool checkParityBits(uint8_t *Buffer, uint16_t BitCount);
-uint16_t ISO14443_CRCA(uint8_t *Buffer, uint8_t ByteCount);
-
 typedef enum {
     Reader14443_Do_Nothing,
     Reader14443_Send,
@@ -9,10 +9,9 @@
 #include <stdbool.h>
 #include <LED.h>
 #include "Sniff14443A.h"
+#include "ISO14443-3A.h"
 #include "Codec/SniffISO14443-2A.h"
 
-extern bool checkParityBits(uint8_t *Buffer, uint16_t BitCount);
-
 Sniff14443Command Sniff14443CurrentCommand = Sniff14443_Do_Nothing;
 static enum {
     STATE_IDLE,
@@ -85,7 +84,7 @@ uint16_t Sniff14443AAppProcess(uint8_t *Buffer, uint16_t BitCount) {
                             (Buffer[0] & 0x20) == 0x00 &&        // Bit6 RFU shall be 0
                             (Buffer[1] & 0xE0) == 0x00 &&      // bit13-16 RFU shall be 0
                             (Buffer[2] & 0x01) == 0x00 &&
-                            checkParityBits(Buffer, BitCount)) {
+                            ISO14443ACheckParityBits(Buffer, BitCount)) {
                         // Assume this is a good ATQA
                         SniffState = STATE_ANTICOLLI;
                     } else {
@@ -114,7 +113,7 @@ uint16_t Sniff14443AAppProcess(uint8_t *Buffer, uint16_t BitCount) {
                 case STATE_UID:
                     if (SniffTrafficSource == TRAFFIC_CARD &&
                             BitCount == 5 * 9 &&
-                            checkParityBits(Buffer, BitCount)) {
+                            ISO14443ACheckParityBits(Buffer, BitCount)) {
                         SniffState = STATE_SELECT;
                     } else {
                         reset2REQA();
@@ -138,7 +137,7 @@ uint16_t Sniff14443AAppProcess(uint8_t *Buffer, uint16_t BitCount) {
                     // SAK: 1Byte SAK + CRC
                     if (SniffTrafficSource == TRAFFIC_CARD &&
                             BitCount == 3 * 9 &&
-                            checkParityBits(Buffer, BitCount)) {
+                            ISO14443ACheckParityBits(Buffer, BitCount)) {
                         if ((Buffer[0] & 0x04) == 0x00) {
                             // UID complete, success SELECTED,
                             // Mark the current threshold as ok and finish
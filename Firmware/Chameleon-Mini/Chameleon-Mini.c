@@ -9,10 +9,11 @@ int main(void) {
     CodecInitCommon();
     ConfigurationInit();
     TerminalInit();
-    RandomInit();
     ButtonInit();
     AntennaLevelInit();
+    RandomInit();
     LogInit();
+    ProfileInit();
     SystemInterruptInit();
 
     while (1) {
@@ -26,6 +27,7 @@ int main(void) {
             ButtonTick();
             ApplicationTick();
             LogTick();
+            MemoryTick();
             CommandLineTick();
             AntennaLevelTick();
             LEDHook(LED_POWERED, LED_ON);
@@ -34,6 +36,7 @@ int main(void) {
         CodecTask();
         LogTask();
         TerminalTask();
+        RandomTask();
     }
 }
 
@@ -21,6 +21,7 @@
 #include "LiveLogTick.h"
 #include "AntennaLevel.h"
 #include "Settings.h"
+#include "Profile.h"
 
 #define CHAMELEON_MINI_VERSION_STRING    BUILD_DATE
 
@@ -68,6 +68,10 @@
 #define CODEC_TIMER_TIMESTAMPS_OVF_VECT	TCD1_OVF_vect
 #define CODEC_TIMER_TIMESTAMPS_CCA_VECT	TCD1_CCA_vect
 #define CODEC_TIMER_TIMESTAMPS_CCB_VECT	TCD1_CCB_vect
+#define CODEC_TIMER_SNIFF_CLOCK		TCC0 /* CODEC_READER_TIMER, idle while sniffing */
+#define CODEC_TIMER_SNIFF_CLOCK_HIGH	TCC1 /* CODEC_SUBCARRIER_TIMER, idle while sniffing */
+#define CODEC_SNIFF_CLOCK_OVF_EVMUX	EVSYS_CHMUX_TCC0_OVF_gc
+#define CODEC_SNIFF_CLOCK_OVF_CLKSEL	TC_CLKSEL_EVCH7_gc
 
 #ifndef __ASSEMBLER__
 
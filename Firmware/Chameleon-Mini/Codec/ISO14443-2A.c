@@ -11,6 +11,7 @@
 #include "../LEDHook.h"
 #include "Codec.h"
 #include "Log.h"
+#include "../Profile.h"
 
 /* Sampling is done using internal clock, synchronized to the field modulation.
  * For that we need to convert the bit rate for the internal clock. */
@@ -23,6 +24,11 @@ static volatile struct {
     volatile bool LoadmodFinished;
 } Flags = { 0 };
 
+#ifdef PROFILE_HOTPATHS
+/* End of the last reader frame, for measuring the time until the answer is ready */
+static volatile uint16_t ProfileEndOfFrame;
+#endif
+
 typedef enum {
     /* Demod */
     DEMOD_DATA_BIT,
@@ -81,6 +87,8 @@ static void StartDemod(void) {
 
 // Find first pause and start sampling
 ISR_SHARED isr_ISO14443_2A_TCD0_CCC_vect(void) {
+    PROFILE_SCOPE(PROFILE_CODEC_PAUSE);
+
     /* This is the first edge of the first modulation-pause after StartDemod.
      * Now we have time to start
      * demodulating beginning from one bit-width after this edge. */
@@ -115,6 +123,8 @@ ISR_SHARED isr_ISO14443_2A_TCD0_CCC_vect(void) {
 
 // Sampling with timer and demod
 ISR(CODEC_TIMER_SAMPLING_CCA_VECT) {
+    PROFILE_SCOPE(PROFILE_CODEC_SAMPLE);
+
     /* This interrupt gets called twice for every bit to sample it. */
     uint8_t SamplePin = CODEC_DEMOD_IN_PORT.IN & CODEC_DEMOD_IN_MASK;
 
@@ -126,6 +136,7 @@ ISR(CODEC_TIMER_SAMPLING_CCA_VECT) {
         /* Analyze the sampling register after 2 samples. */
         if ((SampleRegister & 0x07) == 0x07) {
             /* No carrier modulation for 3 sample points. EOC! */
+            PROFILE_MARK(ProfileEndOfFrame);
             CODEC_TIMER_SAMPLING.CTRLA = TC_CLKSEL_OFF_gc;
             CODEC_TIMER_SAMPLING.INTFLAGS = TC0_CCAIF_bm;
 
@@ -240,6 +251,8 @@ ISR_SHARED isr_ISO14443_2A_CODEC_TIMER_LOADMOD_OVF_VECT(void) {
         [LOADMOD_FINISHED] = && LOADMOD_FINISHED_LABEL
     };
 
+    PROFILE_SCOPE(PROFILE_CODEC_LOADMOD);
+
     if ((StateRegister >= LOADMOD_FDT) && (StateRegister <= LOADMOD_FINISHED)) {
         goto *JumpTable[StateRegister];
     } else {
@@ -450,6 +463,7 @@ void ISO14443ACodecTask(void) {
             CodecSetSubcarrier(CODEC_SUBCARRIERMOD_OOK, ISO14443A_SUBCARRIER_DIVIDER);
 
             StateRegister = LOADMOD_START;
+            PROFILE_STOP(PROFILE_CODEC_TURNAROUND, ProfileEndOfFrame);
         } else {
             /* No data to be processed. Disable loadmodding and start listening again */
             CODEC_TIMER_LOADMOD.CTRLA = TC_CLKSEL_OFF_gc;
@@ -28,6 +28,7 @@
 #include "ISO15693.h"
 #include "../System.h"
 #include "../Application/Application.h"
+#include "../Application/ISO15693-A.h"
 #include "LEDHook.h"
 #include "AntennaLevel.h"
 #include "Terminal/Terminal.h"
@@ -98,6 +99,8 @@ static volatile uint8_t ByteCount;
 static volatile uint16_t BitRate1;
 static volatile uint16_t BitRate2;
 static volatile uint16_t SampleDataCount;
+static volatile uint16_t RxChecksum;
+static volatile uint16_t TxChecksum;
 
 /* This function implements CODEC_DEMOD_IN_INT0_VECT interrupt vector.
  * It is called when a pulse is detected in CODEC_DEMOD_IN_PORT (PORTB).
@@ -228,6 +231,7 @@ ISR_SHARED isr_ISO15693_CODEC_TIMER_SAMPLING_CCC_VECT(void) {
                         *CodecBufferPtr = DataRegister;
                         ++CodecBufferPtr;
                         ++ByteCount;
+                        RxChecksum = ISO15693CRCUpdateByte(RxChecksum, DataRegister);
                     }
                 }
                 break;
@@ -265,6 +269,7 @@ ISR_SHARED isr_ISO15693_CODEC_TIMER_SAMPLING_CCC_VECT(void) {
                         *CodecBufferPtr = DataRegister;
                         ++CodecBufferPtr;
                         ++ByteCount;
+                        RxChecksum = ISO15693CRCUpdateByte(RxChecksum, DataRegister);
                     }
                 }
                 break;
@@ -273,6 +278,26 @@ ISR_SHARED isr_ISO15693_CODEC_TIMER_SAMPLING_CCC_VECT(void) {
     SampleDataCount++;
 }
 
+/* Called from isr_ISO15693_CODEC_TIMER_LOADMOD_CCB_VECT on every byte boundary.
+ * ByteCount includes the CRC, which is run over the data as it is put out and
+ * then sent in place of the last two bytes. It is also stored to CodecBuffer
+ * for the log. */
+INLINE uint8_t ISO15693_NEXT_BYTE(void) {
+    uint8_t Byte;
+
+    if (ByteCount > ISO15693_CRC16_SIZE) {
+        Byte = *CodecBufferPtr;
+        TxChecksum = ISO15693CRCUpdateByte(TxChecksum, Byte);
+    } else if (ByteCount == ISO15693_CRC16_SIZE) {
+        Byte = ~TxChecksum & 0xFF;
+    } else {
+        Byte = ~TxChecksum >> 8;
+    }
+
+    *CodecBufferPtr++ = Byte;
+    return Byte;
+}
+
 /* This function is registered to CODEC_TIMER_LOADMOD (TCE0)'s Counter Channel B (CCB).
  * When the timer is enabled, this is called on counter's overflow
  *
@@ -322,7 +347,7 @@ LOADMOD_SOF_SINGLE_LABEL:
     if ((BitSent % 8) == 0) {
         /* Last SOF bit has been put out. Start sending out data */
         StateRegister = LOADMOD_BIT0_SINGLE;
-        ShiftRegister = (*CodecBufferPtr++);
+        ShiftRegister = ISO15693_NEXT_BYTE();
     } else {
         StateRegister = LOADMOD_SOF_SINGLE;
     }
@@ -359,7 +384,7 @@ LOADMOD_BIT1_SINGLE_LABEL: //Manchester encoding
             ShiftRegister = EOF_PATTERN;
             StateRegister = LOADMOD_EOF_SINGLE;
         } else {
-            ShiftRegister = (*CodecBufferPtr++);
+            ShiftRegister = ISO15693_NEXT_BYTE();
         }
     }
     return;
@@ -404,7 +429,7 @@ LOADMOD_SOF_DUAL_LABEL:
     if ((BitSent % 8) == 0) {
         /* Last SOF bit has been put out. Start sending out data */
         StateRegister = LOADMOD_BIT0_DUAL;
-        ShiftRegister = (*CodecBufferPtr++);
+        ShiftRegister = ISO15693_NEXT_BYTE();
     } else {
         StateRegister = LOADMOD_SOF_DUAL;
     }
@@ -445,7 +470,7 @@ LOADMOD_BIT1_DUAL_LABEL: //Manchester encoding
             ShiftRegister = EOF_PATTERN;
             StateRegister = LOADMOD_EOF_DUAL;
         } else {
-            ShiftRegister = (*CodecBufferPtr++);
+            ShiftRegister = ISO15693_NEXT_BYTE();
         }
     }
     return;
@@ -494,6 +519,7 @@ void StartISO15693Demod(void) {
     ModulationPauseCount = 0;
     ByteCount = 0;
     ShiftRegister = 0;
+    RxChecksum = ISO15693CRCInit();
 
     /* Set clock source for TCD0 to ISO15693_SAMPLE_CLK = TC_CLKSEL_DIV2_gc = System Clock / 2.
      * Since the Chameleon is clocked at 13.56*2 MHz (see Makefile), this counter will hit at the same frequency of reader field.
@@ -594,6 +620,7 @@ void ISO15693CodecDeInit(void) {
     ModulationPauseCount = 0;
     ByteCount = 0;
     ShiftRegister = 0;
+    RxChecksum = ISO15693CRCInit();
 
     /* Disable sample timer */
     /* Sets timer off for TCD0, disabling clock source - From 14.12.1 [8331F–AVR–04/2013] */
@@ -615,6 +642,7 @@ void ISO15693CodecDeInit(void) {
 
     CodecSetSubcarrier(CODEC_SUBCARRIERMOD_OFF, 0);
     CodecSetDemodPower(false);
+    ISO15693CRCReceived(NULL, 0, 0);
     CodecSetLoadmodState(false);
 }
 
@@ -633,6 +661,7 @@ void ISO15693CodecTask(void) {
             if (CodecBuffer[0] & REQ_SUBCARRIER_DUAL) {
                 bDualSubcarrier = true;
             }
+            ISO15693CRCReceived(CodecBuffer, DemodByteCount, RxChecksum);
             AppReceivedByteCount = ApplicationProcess(CodecBuffer, DemodByteCount);
         }
 
@@ -647,8 +676,10 @@ void ISO15693CodecTask(void) {
 
             LEDHook(LED_CODEC_TX, LED_PULSE);
 
-            ByteCount = AppReceivedByteCount;
+            /* The CRC is calculated and appended by the loadmod ISR while sending */
+            ByteCount = AppReceivedByteCount + ISO15693_CRC16_SIZE;
             CodecBufferPtr = CodecBuffer;
+            TxChecksum = ISO15693CRCInit();
 
             /* Start loadmodulating */
             if (bDualSubcarrier) {
@@ -658,12 +689,6 @@ void ISO15693CodecTask(void) {
                 CodecSetSubcarrier(CODEC_SUBCARRIERMOD_OOK, SUBCARRIER_1);
                 StateRegister = LOADMOD_START_SINGLE;
             }
-
-            /* Calculate the CRC while modulation is already ongoing */
-            ISO15693AppendCRC(CodecBuffer, AppReceivedByteCount);
-            ByteCount += ISO15693_CRC16_SIZE; /* Increase this variable as it will be read by the codec during loadmodulation */
-            LogEntry(LOG_INFO_CODEC_TX_DATA, CodecBuffer, AppReceivedByteCount + ISO15693_CRC16_SIZE);
-
         } else {
             /* Overwrite the PERBUF register, which was configured in ISO15693_EOC, with the new appropriate value.
              * This is expecially needed because, since load modulation has not been performed, we're jumping here straight after
@@ -680,6 +705,8 @@ void ISO15693CodecTask(void) {
 
     if (Flags.LoadmodFinished) {
         Flags.LoadmodFinished = 0;
+        /* The frame is complete with its CRC only now */
+        LogEntry(LOG_INFO_CODEC_TX_DATA, CodecBuffer, CodecBufferPtr - CodecBuffer);
         /* Load modulation has been finished. Stop it and start to listen for incoming data again. */
         StartISO15693Demod();
     }
@@ -14,6 +14,7 @@
 #include "LEDHook.h"
 #include "Terminal/Terminal.h"
 #include <util/delay.h>
+#include <util/atomic.h>
 
 /* Sampling is done using internal clock, synchronized to the field modulation.
  * For that we need to convert the bit rate for the internal clock. */
@@ -59,6 +60,103 @@ static volatile uint16_t rawBitCount;
 INLINE void CardSniffInit(void);
 INLINE void CardSniffDeinit(void);
 
+#ifdef ENABLE_SNIFF_TIMESTAMPS
+/* Frame timestamps in carrier cycles. CODEC_TIMER_TIMESTAMPS can not serve as
+ * the clock, as it is restarted all the time, so the two halves of the sniff
+ * clock count F_CPU / 2 = one tick per carrier cycle, cascaded through
+ * event channel 7. The edges are not timed by reading the clock in their
+ * ISR, which would add the interrupt latency, but by subtracting the count
+ * of a timer restarted by the edge: CODEC_TIMER_TIMESTAMPS for the pauses
+ * of the reader, CODEC_TIMER_LOADMOD for the load modulation of the card.
+ * Only the card SOC, where neither is running, is captured by the clock. */
+#define SNIFF_CLOCK_PRESCALER		TC_CLKSEL_DIV2_gc
+#define SYSTEM_CYCLES_PER_TICK		(F_CPU / CODEC_CARRIER_FREQ)
+
+typedef struct {
+    uint32_t SOC; /* Reader: start of the first pause, card: first modulation edge */
+    uint32_t EOC; /* Reader: end of the last pause, card: last modulation edge */
+} SniffTimestampsType;
+
+static volatile SniffTimestampsType ReaderTimestamps;
+static volatile SniffTimestampsType CardTimestamps;
+
+/* The low half keeps counting while both are read. If the high half changed
+ * in between, the low half is read again. Only to be called from the high
+ * level interrupts of this codec, so nothing else uses the TEMP registers. */
+INLINE uint32_t SniffClockRead(void) {
+    uint16_t High = CODEC_TIMER_SNIFF_CLOCK_HIGH.CNT;
+    uint16_t Low = CODEC_TIMER_SNIFF_CLOCK.CNT;
+    uint16_t HighAfter = CODEC_TIMER_SNIFF_CLOCK_HIGH.CNT;
+
+    if (HighAfter != High) {
+        Low = CODEC_TIMER_SNIFF_CLOCK.CNT;
+        High = HighAfter;
+    }
+
+    return ((uint32_t) High << 16) | Low;
+}
+
+/* Clock time SystemCycles ago */
+INLINE uint32_t SniffClockBefore(uint16_t SystemCycles) {
+    return SniffClockRead() - SystemCycles / SYSTEM_CYCLES_PER_TICK;
+}
+
+/* Clock time of a 16 bit capture taken less than 65536 ticks ago */
+INLINE uint32_t SniffClockExtend(uint16_t Capture) {
+    uint32_t Now = SniffClockRead();
+    return Now - (uint16_t)((uint16_t) Now - Capture);
+}
+
+static void SniffClockInit(void) {
+    CODEC_TIMER_SNIFF_CLOCK.CTRLA = TC_CLKSEL_OFF_gc;
+    CODEC_TIMER_SNIFF_CLOCK_HIGH.CTRLA = TC_CLKSEL_OFF_gc;
+
+    /* The high half counts the overflows of the low half */
+    EVSYS.CH7MUX = CODEC_SNIFF_CLOCK_OVF_EVMUX;
+    EVSYS.CH7CTRL = 0;
+    CODEC_TIMER_SNIFF_CLOCK_HIGH.CTRLB = TC_WGMODE_NORMAL_gc;
+    CODEC_TIMER_SNIFF_CLOCK_HIGH.CTRLD = TC_EVACT_OFF_gc;
+    CODEC_TIMER_SNIFF_CLOCK_HIGH.INTCTRLA = 0;
+    CODEC_TIMER_SNIFF_CLOCK_HIGH.INTCTRLB = 0;
+    CODEC_TIMER_SNIFF_CLOCK_HIGH.PER = 0xFFFF;
+    CODEC_TIMER_SNIFF_CLOCK_HIGH.CNT = 0;
+    CODEC_TIMER_SNIFF_CLOCK_HIGH.CTRLA = CODEC_SNIFF_CLOCK_OVF_CLKSEL;
+
+    /* Capture channel A of the low half takes the card's modulation edges from event channel 2 */
+    CODEC_TIMER_SNIFF_CLOCK.CTRLB = TC0_CCAEN_bm | TC_WGMODE_NORMAL_gc;
+    CODEC_TIMER_SNIFF_CLOCK.CTRLD = TC_EVACT_CAPT_gc | TC_EVSEL_CH2_gc;
+    CODEC_TIMER_SNIFF_CLOCK.INTCTRLA = 0;
+    CODEC_TIMER_SNIFF_CLOCK.INTCTRLB = 0;
+    CODEC_TIMER_SNIFF_CLOCK.PER = 0xFFFF;
+    CODEC_TIMER_SNIFF_CLOCK.CNT = 0;
+    CODEC_TIMER_SNIFF_CLOCK.INTFLAGS = TC0_CCAIF_bm | TC0_ERRIF_bm | TC0_OVFIF_bm;
+    CODEC_TIMER_SNIFF_CLOCK.CTRLA = SNIFF_CLOCK_PRESCALER;
+}
+
+static void SniffClockDeInit(void) {
+    CODEC_TIMER_SNIFF_CLOCK.CTRLA = TC_CLKSEL_OFF_gc;
+    CODEC_TIMER_SNIFF_CLOCK.CTRLD = TC_EVACT_OFF_gc;
+    CODEC_TIMER_SNIFF_CLOCK_HIGH.CTRLA = TC_CLKSEL_OFF_gc;
+    EVSYS.CH7MUX = 0;
+
+    CODEC_TIMER_TIMESTAMPS.CTRLA = TC_CLKSEL_OFF_gc;
+    CODEC_TIMER_TIMESTAMPS.CTRLD = TC_EVACT_OFF_gc;
+}
+
+/* Logs the timestamps of the frame logged before. They are copied with the
+ * interrupts disabled, as the next frame may already be on its way. */
+static void SniffLogTimestamps(volatile SniffTimestampsType *Timestamps) {
+    SniffTimestampsType Copy;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        Copy.SOC = Timestamps->SOC;
+        Copy.EOC = Timestamps->EOC;
+    }
+
+    LogEntry(LOG_INFO_CODEC_SNI_TIMESTAMPS, &Copy, sizeof(Copy));
+}
+#endif
+
 /////////////////////////////////////////////////
 // Reader->Card Direction Traffic
 /////////////////////////////////////////////////
@@ -89,6 +187,16 @@ INLINE void ReaderSniffInit(void) {
     CODEC_TIMER_SAMPLING.INTFLAGS = TC0_CCDIF_bm;
     CODEC_TIMER_SAMPLING.INTCTRLB = TC_CCDINTLVL_HI_gc;
 
+#ifdef ENABLE_SNIFF_TIMESTAMPS
+    /* Counts the system cycles since the start of the last modulation pause */
+    CODEC_TIMER_TIMESTAMPS.CTRLA = TC_CLKSEL_OFF_gc;
+    CODEC_TIMER_TIMESTAMPS.INTCTRLA = 0;
+    CODEC_TIMER_TIMESTAMPS.INTCTRLB = 0;
+    CODEC_TIMER_TIMESTAMPS.PER = 0xFFFF;
+    CODEC_TIMER_TIMESTAMPS.CTRLD = TC_EVACT_RESTART_gc | CODEC_TIMER_MODSTART_EVSEL;
+    CODEC_TIMER_TIMESTAMPS.CTRLA = TC_CLKSEL_DIV1_gc;
+#endif
+
     /* Start looking out for modulation pause via interrupt. */
     CODEC_DEMOD_IN_PORT.INTFLAGS = PORT_INT1IF_bm;
     CODEC_DEMOD_IN_PORT.INT1MASK = CODEC_DEMOD_IN_MASK0;
@@ -129,6 +237,14 @@ ISR(CODEC_DEMOD_IN_INT1_VECT) {
 
     /* Disable this interrupt */
     CODEC_DEMOD_IN_PORT.INT1MASK = 0;
+
+#ifdef ENABLE_SNIFF_TIMESTAMPS
+    /* The timer has been restarted by this pause. From now on it is restarted
+     * by the end of every pause, for the EOC. */
+    uint16_t SincePause = CODEC_TIMER_TIMESTAMPS.CNT;
+    CODEC_TIMER_TIMESTAMPS.CTRLD = TC_EVACT_RESTART_gc | CODEC_TIMER_MODEND_EVSEL;
+    ReaderTimestamps.SOC = SniffClockBefore(SincePause);
+#endif
 }
 
 // Sampling with timer and demod
@@ -181,6 +297,9 @@ ISR(CODEC_TIMER_SAMPLING_CCD_VECT) {
             // Start Card->Reader Sniffing without waiting for the complete of CodecTask
             // Otherwise some bit will not be captured
             if (ReaderBitCount >= ISO14443A_MIN_BITS_PER_FRAME) {
+#ifdef ENABLE_SNIFF_TIMESTAMPS
+                ReaderTimestamps.EOC = SniffClockBefore(CODEC_TIMER_TIMESTAMPS.CNT);
+#endif
                 Flags.ReaderDataAvaliable = true;
                 CardSniffInit();
             } else {
@@ -286,6 +405,8 @@ INLINE void CardSniffInit(void) {
     CODEC_TIMER_LOADMOD.INTCTRLB = TC_CCBINTLVL_HI_gc;
 
     /* This timer will be used to find out how many bit halfs since the last pause have been passed. */
+    CODEC_TIMER_TIMESTAMPS.CTRLA = TC_CLKSEL_OFF_gc;        // Started by the first pause found
+    CODEC_TIMER_TIMESTAMPS.CTRLD = TC_EVACT_OFF_gc;
     CODEC_TIMER_TIMESTAMPS.CNT = 0;                         // Reset timer
     CODEC_TIMER_TIMESTAMPS.PER = 0xFFFF;
     CODEC_TIMER_TIMESTAMPS.CCB = 160;
@@ -298,6 +419,13 @@ INLINE void CardSniffInit(void) {
     EVSYS.CH2MUX = EVSYS_CHMUX_ACA_CH0_gc; // on every ACA_AC0 INT
     EVSYS.CH2CTRL = EVSYS_DIGFILT_1SAMPLE_gc;
 
+#ifdef ENABLE_SNIFF_TIMESTAMPS
+    /* Drop the captures of the last card frame, the next one is the SOC */
+    while (CODEC_TIMER_SNIFF_CLOCK.INTFLAGS & TC0_CCAIF_bm)
+        (void) CODEC_TIMER_SNIFF_CLOCK.CCA;
+    CODEC_TIMER_SNIFF_CLOCK.INTFLAGS = TC0_ERRIF_bm;
+#endif
+
     /* Enable the AC interrupt, which either finds the SOC and then starts the pause-finding timer,
      * or it is triggered before the SOC, which mostly isn't bad at all, since the first pause
      * needs to be found. */
@@ -348,6 +476,10 @@ ISR_SHARED isr_SniffISO14443_2A_ACA_AC0_VECT(void) {  // this interrupt either f
     CODEC_TIMER_LOADMOD.CTRLD = TC_EVACT_RESTART_gc | TC_EVSEL_CH2_gc;
     CODEC_TIMER_LOADMOD.CTRLA = TC_CLKSEL_DIV1_gc;
     StateRegister = PICC_FRAME;
+
+#ifdef ENABLE_SNIFF_TIMESTAMPS
+    CardTimestamps.SOC = SniffClockExtend(CODEC_TIMER_SNIFF_CLOCK.CCA);
+#endif
 }
 
 // Called once a pause is found
@@ -431,6 +563,11 @@ ISR_SHARED isr_SniffISO14443_2A_CODEC_TIMER_LOADMOD_CCB_VECT(void) {
 // EOC of Card->Reader found
 ISR(CODEC_TIMER_TIMESTAMPS_CCB_VECT) { // EOC found
 
+#ifdef ENABLE_SNIFF_TIMESTAMPS
+    // The LOADMOD Timer has been restarted by the last modulation edge
+    CardTimestamps.EOC = SniffClockBefore(CODEC_TIMER_LOADMOD.CNT);
+#endif
+
     // Disable LOADMOD Timer
     CODEC_TIMER_LOADMOD.INTCTRLB = 0;               // Disable Interrupt
     CODEC_TIMER_LOADMOD.CTRLA = TC_CLKSEL_OFF_gc;   // Disable Clock
@@ -472,6 +609,9 @@ void Sniff14443ACodecInit(void) {
     PORTE.DIRSET = PIN3_bm | PIN2_bm;
     // Common Codec Register settings
     CodecInitCommon();
+#ifdef ENABLE_SNIFF_TIMESTAMPS
+    SniffClockInit();
+#endif
     isr_func_ACA_AC0_vect = &isr_SniffISO14443_2A_ACA_AC0_VECT;
     isr_func_CODEC_TIMER_LOADMOD_CCB_VECT = &isr_SniffISO14443_2A_CODEC_TIMER_LOADMOD_CCB_VECT;
     // Enable demodulator power
@@ -488,6 +628,9 @@ void Sniff14443ACodecDeInit(void) {
 //    SniffEnable = false;
     CardSniffDeinit();
     ReaderSniffDeInit();
+#ifdef ENABLE_SNIFF_TIMESTAMPS
+    SniffClockDeInit();
+#endif
     CodecSetDemodPower(false);
 }
 
@@ -498,6 +641,9 @@ void Sniff14443ACodecTask(void) {
         Flags.ReaderDataAvaliable = false;
 
         LogEntry(LOG_INFO_CODEC_SNI_READER_DATA, CodecBuffer, (ReaderBitCount + 7) / 8);
+#ifdef ENABLE_SNIFF_TIMESTAMPS
+        SniffLogTimestamps(&ReaderTimestamps);
+#endif
         // Let the Application layer know where this data comes from
         LEDHook(LED_CODEC_RX, LED_PULSE);
 
@@ -511,6 +657,9 @@ void Sniff14443ACodecTask(void) {
 
 //        CardBitCount = removeParityBits(CodecBuffer2,CardBitCount );
         LogEntry(LOG_INFO_CODEC_SNI_CARD_DATA_W_PARITY, CodecBuffer2, (CardBitCount + 7) / 8);
+#ifdef ENABLE_SNIFF_TIMESTAMPS
+        SniffLogTimestamps(&CardTimestamps);
+#endif
         LEDHook(LED_CODEC_RX, LED_PULSE);
 
         // Let the Application layer know where this data comes from
@@ -6,6 +6,7 @@
  */
 
 #include <avr/pgmspace.h>
+#include <util/crc16.h>
 
 #include "Configuration.h"
 #include "Settings.h"
@@ -584,4 +585,27 @@ void ConfigurationGetList(char *List, uint16_t BufferSize) {
     MapToString(ConfigurationMap, ARRAY_COUNT(ConfigurationMap), List, BufferSize);
 }
 
+uint16_t ConfigurationGetLayoutCRC(void) {
+    /* The IDs depend on which configurations are built in. The CRC covers the ID
+     * and the name of each, so that settings can be checked before they are taken
+     * over from another build. */
+    uint16_t CRC = 0xFFFF;
+
+    for (uint8_t i = 0; i < ARRAY_COUNT(ConfigurationMap); i++) {
+        CRC = _crc_ccitt_update(CRC, pgm_read_byte(&ConfigurationMap[i].Id));
+
+        for (uint8_t j = 0; j < MAP_TEXT_BUF_SIZE; j++) {
+            char c = pgm_read_byte(&ConfigurationMap[i].Text[j]);
+
+            if (c == '\0') {
+                break;
+            }
+
+            CRC = _crc_ccitt_update(CRC, c);
+        }
+    }
+
+    return CRC;
+}
+
 
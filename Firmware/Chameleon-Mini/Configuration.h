@@ -186,5 +186,6 @@ void ConfigurationGetByName(char *Configuration, uint16_t BufferSize);
 bool ConfigurationByNameIsValid(const char *Configuration);
 bool ConfigurationSetByName(const char *Configuration, bool appInitRunOnce);
 void ConfigurationGetList(char *ConfigurationList, uint16_t BufferSize);
+uint16_t ConfigurationGetLayoutCRC(void);
 
 #endif /* STANDARDS_H_ */
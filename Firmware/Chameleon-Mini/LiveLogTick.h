@@ -1,8 +1,14 @@
-/* LiveLogTick.h : Handle flushing of live logging buffers out through USB
- *                 by an atomic code block with interrupts disabled.
- *                 If there are many logs being generated at once, this will maintain
- *                 consistency in the returned buffers and prevent the contents of
- *                 USB serial data from getting jumbled or concatenated.
+/* LiveLogTick.h : Stream LIVE mode log entries out through USB.
+ *
+ *                 In LIVE mode LogMem is used as a single producer / single consumer
+ *                 byte ring. Entries are packed back to back in the usual log format
+ *                 (entry id, length, 16 bit timestamp, data) without any per-entry
+ *                 bookkeeping. The producer (LogEntry, called from the codec and
+ *                 application tasks) only ever writes LiveLogHead, the consumer
+ *                 (TerminalTask) only ever writes LiveLogTail. An entry is published
+ *                 by moving the head after all of its bytes are in place, so neither
+ *                 side has to disable interrupts. LogEntry must not be called from
+ *                 an ISR in LIVE mode, otherwise there would be a second producer.
  */
 
 #ifndef __LIVE_LOG_TICK_H__
@@ -10,116 +16,128 @@
 
 #include <inttypes.h>
 #include <stdlib.h>
-#include <avr/interrupt.h>
-#include <avr/io.h>
-#include <util/atomic.h>
+#include <string.h>
 
 #include "LUFADescriptors.h"
 
 #include "Log.h"
 #include "Terminal/Terminal.h"
 
-#define cli_memory() __asm volatile( "cli" ::: "memory" )
-#define sei_memory() __asm volatile( "sei" ::: "memory" )
-
+/* Drain the ring synchronously instead of dropping an entry that does not fit */
 #ifndef FLUSH_LOGS_ON_SPACE_ERROR
 #define FLUSH_LOGS_ON_SPACE_ERROR            (1)
 #endif
-typedef struct LogBlockListNode {
-    uint8_t                  *logBlockDataStart;
-    uint8_t                  logBlockDataSize;
-    struct LogBlockListNode  *nextBlock;
-} LogBlockListNode;
 
-#define LOG_BLOCK_LIST_NODE_SIZE             (sizeof(LogBlockListNode) + 4 - (uint8_t) (sizeof(LogBlockListNode) % 4))
-extern LogBlockListNode *LogBlockListBegin;
-extern LogBlockListNode *LogBlockListEnd;
-extern uint8_t LogBlockListElementCount;
+/* TerminalTask sends at most one USB packet worth of log data per call */
+#define LIVE_LOG_CHUNK_SIZE                  CDC_TXRX_EPSIZE
+#define LIVE_LOG_ENTRY_HEADER_SIZE           4
+
+extern volatile uint16_t LiveLogHead;
+extern volatile uint16_t LiveLogTail;
 
-#define LIVE_LOGGER_POST_TICKS              (4)
-extern uint8_t LiveLogModePostTickCount;
+INLINE uint16_t LiveLogFree(void);
+INLINE bool LiveLogAppend(LogEntryEnum logCode, uint16_t sysTickTime, const uint8_t *logData, uint8_t logDataSize);
+INLINE bool LiveLogSendChunk(void);
+INLINE void LiveLogTask(void);
+INLINE void LiveLogFlush(void);
+INLINE void LiveLogReset(void);
 
-INLINE bool AtomicAppendLogBlock(LogEntryEnum logCode, uint16_t sysTickTime, const uint8_t *logData, uint8_t logDataSize);
-INLINE void FreeLogBlocks(void);
-INLINE bool AtomicLiveLogTick(void);
-INLINE bool LiveLogTick(void);
+INLINE uint16_t
+LiveLogFree(void) {
+    uint16_t Head = LiveLogHead, Tail = LiveLogTail;
+    /* One byte stays unused to tell a full ring from an empty one */
+    if (Head >= Tail) {
+        return LOG_SIZE - 1 - (Head - Tail);
+    } else {
+        return Tail - Head - 1;
+    }
+}
 
 INLINE bool
-AtomicAppendLogBlock(LogEntryEnum logCode, uint16_t sysTickTime, const uint8_t *logData, uint8_t logDataSize) {
-    cli_memory();
-    bool status = true;
-    if ((logDataSize + 4 + 3 + LOG_BLOCK_LIST_NODE_SIZE > LogMemLeft) && (LogMemPtr != LogMem)) {
-        if (FLUSH_LOGS_ON_SPACE_ERROR) {
-            LiveLogTick();
-            FreeLogBlocks();
+LiveLogAppend(LogEntryEnum logCode, uint16_t sysTickTime, const uint8_t *logData, uint8_t logDataSize) {
+    uint16_t EntrySize = logDataSize + LIVE_LOG_ENTRY_HEADER_SIZE;
+
+    if (EntrySize > LiveLogFree()) {
+        if (!FLUSH_LOGS_ON_SPACE_ERROR) {
+            return false;
         }
-        status = false;
-    } else if (logDataSize + 4 + 3 + LOG_BLOCK_LIST_NODE_SIZE <= LogMemLeft) {
-        uint8_t alignOffset = 4 - (uint8_t)(((uint16_t) LogMemPtr) % 4);
-        uint8_t *logBlockStart = LogMemPtr + alignOffset;
-        LogBlockListNode logBlock;
-        LogMemPtr += LOG_BLOCK_LIST_NODE_SIZE + alignOffset;
-        LogMemLeft -= LOG_BLOCK_LIST_NODE_SIZE + alignOffset;
-        logBlock.logBlockDataStart = LogMemPtr;
-        logBlock.logBlockDataSize = logDataSize + 4;
-        logBlock.nextBlock = 0;
-        *(LogMemPtr++) = (uint8_t) logCode;
-        *(LogMemPtr++) = logDataSize;
-        *(LogMemPtr++) = (uint8_t)(sysTickTime >> 8);
-        *(LogMemPtr++) = (uint8_t)(sysTickTime >> 0);
-        memcpy(LogMemPtr, logData, logDataSize);
-        LogMemPtr += logDataSize;
-        LogMemLeft -= logDataSize + 4;
-        memcpy(logBlockStart, &logBlock, sizeof(LogBlockListNode));
-        if (LogBlockListBegin != NULL && LogBlockListEnd != NULL) {
-            LogBlockListEnd->nextBlock = (LogBlockListNode *) logBlockStart;
-            LogBlockListEnd = (LogBlockListNode *) logBlockStart;
-        } else {
-            LogBlockListBegin = LogBlockListEnd = (LogBlockListNode *) logBlockStart;
+        LiveLogFlush();
+    }
+
+    uint16_t Head = LiveLogHead;
+    uint8_t Header[LIVE_LOG_ENTRY_HEADER_SIZE] = {
+        (uint8_t) logCode, logDataSize, (uint8_t)(sysTickTime >> 8), (uint8_t)(sysTickTime >> 0)
+    };
+
+    for (uint8_t i = 0; i < LIVE_LOG_ENTRY_HEADER_SIZE; i++) {
+        LogMem[Head] = Header[i];
+        if (++Head == LOG_SIZE) {
+            Head = 0;
         }
-        ++LogBlockListElementCount;
+    }
+
+    uint16_t FirstPart = LOG_SIZE - Head;
+    if (logDataSize < FirstPart) {
+        memcpy(&LogMem[Head], logData, logDataSize);
+        Head += logDataSize;
     } else {
-        status = false;
+        memcpy(&LogMem[Head], logData, FirstPart);
+        memcpy(&LogMem[0], logData + FirstPart, logDataSize - FirstPart);
+        Head = logDataSize - FirstPart;
     }
-    sei_memory();
-    return status;
-}
 
-INLINE void
-FreeLogBlocks(void) {
-    LogMemPtr = &LogMem[0];
-    LogMemLeft = LOG_SIZE;
-    LogBlockListBegin = LogBlockListEnd = NULL;
-    LogBlockListElementCount = 0;
+    /* Publish the entry only after its data is in LogMem */
+    __asm volatile("" ::: "memory");
+    LiveLogHead = Head;
+    return true;
 }
 
+/* Send the next contiguous piece of the ring, at most one USB packet.
+ * Returns false if the ring was empty. */
 INLINE bool
-AtomicLiveLogTick(void) {
-    //cli_memory();
-    bool opStatus = LiveLogTick();
-    //sei_memory();
-    return opStatus;
+LiveLogSendChunk(void) {
+    uint16_t Head = LiveLogHead, Tail = LiveLogTail;
+
+    if (Head == Tail) {
+        return false;
+    }
+
+    uint16_t ByteCount = (Head > Tail) ? (Head - Tail) : (LOG_SIZE - Tail);
+    if (ByteCount > LIVE_LOG_CHUNK_SIZE) {
+        ByteCount = LIVE_LOG_CHUNK_SIZE;
+    }
+
+    TerminalSendBlock(&LogMem[Tail], ByteCount);
+
+    Tail += ByteCount;
+    if (Tail == LOG_SIZE) {
+        Tail = 0;
+    }
+    LiveLogTail = Tail;
+    return true;
 }
 
-INLINE bool
-LiveLogTick(void) {
-    LogBlockListNode logBlockCurrent, *tempBlockPtr = NULL;
-    memcpy(&logBlockCurrent, LogBlockListBegin, sizeof(LogBlockListNode));
-    while (LogBlockListElementCount > 0) {
+/* Called from TerminalTask on every main loop iteration */
+INLINE void
+LiveLogTask(void) {
+    if (LiveLogSendChunk() && (LiveLogHead == LiveLogTail)) {
+        /* Do not keep a partially filled packet back */
         TerminalFlushBuffer();
-        TerminalSendBlock(logBlockCurrent.logBlockDataStart, logBlockCurrent.logBlockDataSize);
-        tempBlockPtr = logBlockCurrent.nextBlock;
-        if (tempBlockPtr != NULL) {
-            memcpy(&logBlockCurrent, tempBlockPtr, sizeof(LogBlockListNode));
-        } else {
-            break;
-        }
-        --LogBlockListElementCount;
     }
-    FreeLogBlocks();
-    LiveLogModePostTickCount = 0;
+}
+
+INLINE void
+LiveLogFlush(void) {
+    while (LiveLogSendChunk());
     TerminalFlushBuffer();
-    return true;
+}
+
+INLINE void
+LiveLogReset(void) {
+    LiveLogHead = LiveLogTail = 0;
+    memset(LogMem, LOG_EMPTY, LOG_SIZE);
+    LogMemPtr = &LogMem[0];
+    LogMemLeft = LOG_SIZE;
 }
 
 #endif
@@ -10,22 +10,102 @@ uint8_t LogMem[LOG_SIZE];
 uint8_t *LogMemPtr;
 uint16_t LogMemLeft;
 
-static uint16_t LogFRAMAddr = FRAM_LOG_START_ADDR;
+/* Stored at FRAM_LOG_ADDR_ADDR. Tail points to the oldest entry, Head behind the newest one.
+ * TailTick and TailFormat describe the stream at the tail, so that it can be decoded
+ * after older compact entries have been overwritten. */
+typedef struct {
+    uint16_t Head;
+    uint16_t Tail;
+    uint16_t TailTick;
+    uint16_t TailFormat;
+} LogFRAMRingType;
+
+#define LOG_FRAM_FORMAT_NORMAL      0
+#define LOG_FRAM_FORMAT_COMPACT     1
+/* Stored in EEPROM, older firmware kept a plain end address in FRAM and wrote 'true' here */
+#define LOG_FRAM_LAYOUT_VERSION     2
+#define LOG_FRAM_END_ADDR           (FRAM_LOG_START_ADDR + FRAM_LOG_SIZE)
+
+static LogFRAMRingType LogFRAMRing;
 static uint8_t EEMEM LogFRAMAddrValid = false;
 static bool EnableLogSRAMtoFRAM = false;
 LogFuncType CurrentLogFunc;
 
-LogBlockListNode *LogBlockListBegin = NULL;
-LogBlockListNode *LogBlockListEnd = NULL;
-uint8_t LogBlockListElementCount = 0;
-uint8_t LiveLogModePostTickCount = 0;
+volatile uint16_t LiveLogHead = 0;
+volatile uint16_t LiveLogTail = 0;
 
 static const MapEntryType PROGMEM LogModeMap[] = {
     { .Id = LOG_MODE_OFF, 	.Text = "OFF" 		},
     { .Id = LOG_MODE_MEMORY, 	.Text = "MEMORY" 	},
-    { .Id = LOG_MODE_LIVE, 	.Text = "LIVE" 	        }
+    { .Id = LOG_MODE_LIVE, 	.Text = "LIVE" 	        },
+    { .Id = LOG_MODE_MEMORY_COMPACT, .Text = "MEMORY_COMPACT" }
 };
 
+/*
+ * Compact memory log format (LOG_MODE_MEMORY_COMPACT). A LOG_INFO_COMPACT_START
+ * entry in the normal format switches the decoder to the compact format, in
+ * which every entry starts with a single header byte:
+ *   0x00          End of log (LOG_EMPTY)
+ *   0x01          Entry type, data length, delta, data
+ *   0x02          End of compact entries, normal format follows
+ *   0x03          Entry type, delta (entry without data)
+ *   0x14          Data length (0), 16 bit timestamp: restart with an absolute timestamp,
+ *                 i.e. the same bytes as a LOG_INFO_COMPACT_START entry
+ *   0x40 - 0x7F   Delta: entry from LogCompactDictionary
+ *   0x80 - 0xFE   Delta, data: short codec frame. Bits 6-5 select the entry type
+ *                 from LogCompactFrameTypes, bits 4-0 hold the data length - 1
+ *   0xFF          LOG_INFO_SYSTEM_BOOT entry in normal format, normal format follows
+ * The delta is the systick difference to the previous entry, 7 bits per byte,
+ * least significant first, with bit 7 set if another byte follows.
+ */
+#define LOG_COMPACT_LONG                0x01
+#define LOG_COMPACT_END                 0x02
+#define LOG_COMPACT_NO_DATA             0x03
+#define LOG_COMPACT_DICTIONARY          0x40
+#define LOG_COMPACT_SHORT_FRAME         0x80
+#define LOG_COMPACT_SHORT_FRAME_MAX     32
+#define LOG_COMPACT_DICT_DATA_MAX       4
+#define LOG_COMPACT_NOT_FOUND           0xFF
+/* Worst case: restart entry, long header and a three byte delta */
+#define LOG_COMPACT_OVERHEAD_MAX        (4 + 3 + 3)
+
+typedef struct {
+    uint8_t Entry;
+    uint8_t Length;
+    uint8_t Data[LOG_COMPACT_DICT_DATA_MAX];
+} LogCompactDictEntryType;
+
+/* Frequent frames of anticollision and HLTA. Card frames are logged with parity bits. */
+static const LogCompactDictEntryType PROGMEM LogCompactDictionary[] = {
+    { LOG_INFO_CODEC_SNI_READER_DATA,        1, { 0x26 } },                   /* REQA */
+    { LOG_INFO_CODEC_SNI_READER_DATA,        1, { 0x52 } },                   /* WUPA */
+    { LOG_INFO_CODEC_SNI_READER_DATA,        2, { 0x93, 0x20 } },             /* ANTICOLLISION CL1 */
+    { LOG_INFO_CODEC_SNI_READER_DATA,        2, { 0x95, 0x20 } },             /* ANTICOLLISION CL2 */
+    { LOG_INFO_CODEC_SNI_READER_DATA,        4, { 0x50, 0x00, 0x57, 0xCD } }, /* HLTA */
+    { LOG_INFO_CODEC_SNI_CARD_DATA_W_PARITY, 3, { 0x04, 0x00, 0x02 } },       /* ATQA 0400 */
+    { LOG_INFO_CODEC_SNI_CARD_DATA_W_PARITY, 3, { 0x44, 0x01, 0x02 } },       /* ATQA 4400 */
+    { LOG_INFO_CODEC_RX_DATA,                1, { 0x26 } },                   /* REQA */
+    { LOG_INFO_CODEC_RX_DATA,                1, { 0x52 } },                   /* WUPA */
+    { LOG_INFO_CODEC_RX_DATA,                2, { 0x93, 0x20 } },             /* ANTICOLLISION CL1 */
+    { LOG_INFO_CODEC_RX_DATA,                2, { 0x95, 0x20 } },             /* ANTICOLLISION CL2 */
+    { LOG_INFO_CODEC_RX_DATA,                4, { 0x50, 0x00, 0x57, 0xCD } }, /* HLTA */
+    { LOG_INFO_CODEC_TX_DATA,                2, { 0x04, 0x00 } },             /* ATQA 0400 */
+    { LOG_INFO_CODEC_TX_DATA,                2, { 0x44, 0x00 } },             /* ATQA 4400 */
+    { LOG_INFO_APP_CMD_REQA,                 0, { 0 } },
+    { LOG_INFO_APP_CMD_WUPA,                 0, { 0 } },
+    { LOG_INFO_APP_CMD_HALT,                 0, { 0 } },
+};
+
+static const uint8_t PROGMEM LogCompactFrameTypes[] = {
+    LOG_INFO_CODEC_RX_DATA,
+    LOG_INFO_CODEC_TX_DATA,
+    LOG_INFO_CODEC_SNI_READER_DATA,
+    LOG_INFO_CODEC_SNI_CARD_DATA_W_PARITY
+};
+
+static bool LogCompactStarted = false;
+static uint16_t LogCompactLastTick;
+
 static void LogFuncOff(LogEntryEnum Entry, const void *Data, uint8_t Length) {
     /* Do nothing */
 }
@@ -55,9 +135,272 @@ static void LogFuncMemory(LogEntryEnum Entry, const void *Data, uint8_t Length)
     }
 }
 
+static uint8_t LogCompactFindDictionary(LogEntryEnum Entry, const uint8_t *Data, uint8_t Length) {
+    if (Length > LOG_COMPACT_DICT_DATA_MAX) {
+        return LOG_COMPACT_NOT_FOUND;
+    }
+
+    for (uint8_t i = 0; i < ARRAY_COUNT(LogCompactDictionary); i++) {
+        if (pgm_read_byte(&LogCompactDictionary[i].Entry) == Entry &&
+                pgm_read_byte(&LogCompactDictionary[i].Length) == Length &&
+                (Length == 0 || memcmp_P(Data, LogCompactDictionary[i].Data, Length) == 0)) {
+            return i;
+        }
+    }
+
+    return LOG_COMPACT_NOT_FOUND;
+}
+
+static void LogFuncMemoryCompact(LogEntryEnum Entry, const void *Data, uint8_t Length) {
+    uint16_t SysTick = SystemGetSysTick();
+    uint8_t Header[LOG_COMPACT_OVERHEAD_MAX];
+    uint8_t HeaderSize = 0;
+    uint16_t Delta = SysTick - LogCompactLastTick;
+
+    if (!LogCompactStarted) {
+        Header[HeaderSize++] = LOG_INFO_COMPACT_START;
+        Header[HeaderSize++] = 0;
+        Header[HeaderSize++] = (uint8_t)(SysTick >> 8);
+        Header[HeaderSize++] = (uint8_t)(SysTick >> 0);
+        Delta = 0;
+    }
+
+    uint8_t DictIndex = LogCompactFindDictionary(Entry, Data, Length);
+    /* 0xFF is taken by the boot entry and also means "no short frame header" */
+    uint8_t ShortFrame = LOG_INFO_SYSTEM_BOOT;
+
+    if (Length > 0 && Length <= LOG_COMPACT_SHORT_FRAME_MAX) {
+        for (uint8_t i = 0; i < sizeof(LogCompactFrameTypes); i++) {
+            if (pgm_read_byte(&LogCompactFrameTypes[i]) == Entry) {
+                ShortFrame = LOG_COMPACT_SHORT_FRAME | (i << 5) | (Length - 1);
+                break;
+            }
+        }
+    }
+
+    if (DictIndex != LOG_COMPACT_NOT_FOUND) {
+        Header[HeaderSize++] = LOG_COMPACT_DICTIONARY + DictIndex;
+        Length = 0;
+    } else if (Length == 0) {
+        Header[HeaderSize++] = LOG_COMPACT_NO_DATA;
+        Header[HeaderSize++] = (uint8_t) Entry;
+    } else if (ShortFrame != LOG_INFO_SYSTEM_BOOT) {
+        Header[HeaderSize++] = ShortFrame;
+    } else {
+        Header[HeaderSize++] = LOG_COMPACT_LONG;
+        Header[HeaderSize++] = (uint8_t) Entry;
+        Header[HeaderSize++] = Length;
+    }
+
+    while (Delta >= 0x80) {
+        Header[HeaderSize++] = (uint8_t) Delta | 0x80;
+        Delta >>= 7;
+    }
+    Header[HeaderSize++] = (uint8_t) Delta;
+
+    /* One byte stays free for the LOG_COMPACT_END of LogCompactEnd, otherwise
+     * the entries after a full log would be read as compact ones */
+    if (LogMemLeft > HeaderSize + Length) {
+        LogMemLeft -= HeaderSize + Length;
+
+        memcpy(LogMemPtr, Header, HeaderSize);
+        LogMemPtr += HeaderSize;
+        memcpy(LogMemPtr, Data, Length);
+        LogMemPtr += Length;
+
+        LogCompactStarted = true;
+        LogCompactLastTick = SysTick;
+    } else {
+        /* If memory full. Deactivate logmode */
+        LogSetModeById(LOG_MODE_OFF);
+        LEDHook(LED_LOG_MEM_FULL, LED_ON);
+    }
+}
+
+static void LogCompactEnd(void) {
+    if (LogCompactStarted && LogMemLeft > 0) {
+        *LogMemPtr++ = LOG_COMPACT_END;
+        LogMemLeft--;
+    }
+    LogCompactStarted = false;
+}
+
+/* Size of the complete log entry starting at Entry (at least 8 bytes are needed
+ * for the header). Compact and Tick track the stream format and timestamp. */
+static uint16_t LogEntrySize(const uint8_t *Entry, bool *Compact, uint16_t *Tick) {
+    uint8_t Header = Entry[0];
+    uint8_t HeaderSize = 1;
+    uint8_t Length = 0;
+
+    if (!*Compact || Header == LOG_INFO_COMPACT_START || Header == LOG_INFO_SYSTEM_BOOT) {
+        *Compact = (Header == LOG_INFO_COMPACT_START);
+        *Tick = ((uint16_t) Entry[2] << 8) | Entry[3];
+        return 4 + Entry[1];
+    } else if (Header == LOG_COMPACT_END) {
+        *Compact = false;
+        return 1;
+    } else if (Header == LOG_COMPACT_LONG) {
+        Length = Entry[2];
+        HeaderSize = 3;
+    } else if (Header == LOG_COMPACT_NO_DATA) {
+        HeaderSize = 2;
+    } else if (Header >= LOG_COMPACT_SHORT_FRAME) {
+        Length = (Header & 0x1F) + 1;
+    } else if (Header < LOG_COMPACT_DICTIONARY) {
+        /* Not a valid header, skip a single byte */
+        return 1;
+    }
+
+    uint16_t Delta = 0;
+    uint8_t Shift = 0;
+    do {
+        Delta |= (uint16_t)(Entry[HeaderSize] & 0x7F) << Shift;
+        Shift += 7;
+    } while (Entry[HeaderSize++] & 0x80);
+
+    *Tick += Delta;
+    return HeaderSize + Length;
+}
+
 static void LogFuncLive(LogEntryEnum Entry, const void *Data, uint8_t Length) {
     uint16_t SysTick = SystemGetSysTick();
-    AtomicAppendLogBlock(Entry, SysTick, Data, Length);
+    LiveLogAppend(Entry, SysTick, Data, Length);
+}
+
+/* Bytes stored in the FRAM ring */
+static uint16_t LogFRAMUsed(void) {
+    if (LogFRAMRing.Head >= LogFRAMRing.Tail) {
+        return LogFRAMRing.Head - LogFRAMRing.Tail;
+    } else {
+        return FRAM_LOG_SIZE - (LogFRAMRing.Tail - LogFRAMRing.Head);
+    }
+}
+
+static uint16_t LogFRAMFree(void) {
+    /* One byte stays unused to tell a full ring from an empty one */
+    return FRAM_LOG_SIZE - 1 - LogFRAMUsed();
+}
+
+/* Read ByteCount bytes starting Offset bytes behind the tail */
+static void LogFRAMRead(void *Buffer, uint16_t Offset, uint16_t ByteCount) {
+    uint16_t Address = LogFRAMRing.Tail + Offset;
+    if (Address >= LOG_FRAM_END_ADDR) {
+        Address -= FRAM_LOG_SIZE;
+    }
+
+    uint16_t FirstPart = LOG_FRAM_END_ADDR - Address;
+    if (ByteCount <= FirstPart) {
+        MemoryReadBlock(Buffer, Address, ByteCount);
+    } else {
+        MemoryReadBlock(Buffer, Address, FirstPart);
+        MemoryReadBlock((uint8_t *) Buffer + FirstPart, FRAM_LOG_START_ADDR, ByteCount - FirstPart);
+    }
+}
+
+/* Advance the head by ByteCount bytes that fit in front of the end of the ring */
+static void LogFRAMAdvanceHead(uint16_t ByteCount) {
+    LogFRAMRing.Head += ByteCount;
+    if (LogFRAMRing.Head >= LOG_FRAM_END_ADDR) {
+        LogFRAMRing.Head = FRAM_LOG_START_ADDR;
+    }
+}
+
+static void LogFRAMWrite(const void *Buffer, uint16_t ByteCount) {
+    uint16_t FirstPart = LOG_FRAM_END_ADDR - LogFRAMRing.Head;
+    if (ByteCount <= FirstPart) {
+        MemoryWriteBlock(Buffer, LogFRAMRing.Head, ByteCount);
+        LogFRAMAdvanceHead(ByteCount);
+    } else {
+        MemoryWriteBlock(Buffer, LogFRAMRing.Head, FirstPart);
+        MemoryWriteBlock((const uint8_t *) Buffer + FirstPart, FRAM_LOG_START_ADDR, ByteCount - FirstPart);
+        LogFRAMRing.Head = FRAM_LOG_START_ADDR + ByteCount - FirstPart;
+    }
+}
+
+/* LogSRAMToFRAM moves the SRAM log to FRAM in the background. The bytes in flight stay
+ * untouched at the start of LogMem, new entries are appended behind them. */
+static volatile bool LogFRAMWriteDone;
+static uint16_t LogFRAMWriteCount = 0;
+
+static void LogFRAMWriteCallback(void) {
+    /* Called from the DMA interrupt */
+    LogFRAMWriteDone = true;
+}
+
+static bool LogFRAMWriteAsync(const void *Buffer, uint16_t ByteCount) {
+    uint16_t FirstPart = LOG_FRAM_END_ADDR - LogFRAMRing.Head;
+
+    LogFRAMWriteDone = false;
+
+    if (ByteCount <= FirstPart) {
+        if (!MemoryWriteBlockAsync(Buffer, LogFRAMRing.Head, ByteCount, LogFRAMWriteCallback)) {
+            return false;
+        }
+        LogFRAMAdvanceHead(ByteCount);
+    } else {
+        if (!MemoryWriteBlockAsync(Buffer, LogFRAMRing.Head, FirstPart, NULL)) {
+            return false;
+        }
+        if (!MemoryWriteBlockAsync((const uint8_t *) Buffer + FirstPart, FRAM_LOG_START_ADDR, ByteCount - FirstPart, LogFRAMWriteCallback)) {
+            MemoryWriteBlock((const uint8_t *) Buffer + FirstPart, FRAM_LOG_START_ADDR, ByteCount - FirstPart);
+            LogFRAMWriteDone = true;
+        }
+        LogFRAMRing.Head = FRAM_LOG_START_ADDR + ByteCount - FirstPart;
+    }
+
+    return true;
+}
+
+/* Release the SRAM of a finished background write and persist the new head.
+ * With Wait set, block until the write has finished. */
+static void LogFRAMWriteComplete(bool Wait) {
+    if (LogFRAMWriteCount == 0) {
+        return;
+    }
+
+    if (!LogFRAMWriteDone) {
+        if (!Wait) {
+            return;
+        }
+
+        MemoryAsyncFlush();
+    }
+
+    uint16_t Pending = LOG_SIZE - LogMemLeft - LogFRAMWriteCount;
+
+    memmove(LogMem, LogMem + LogFRAMWriteCount, Pending);
+    memset(LogMem + Pending, LOG_EMPTY, LogFRAMWriteCount);
+    LogMemPtr -= LogFRAMWriteCount;
+    LogMemLeft += LogFRAMWriteCount;
+    LogFRAMWriteCount = 0;
+
+    MemoryWriteBlock(&LogFRAMRing, FRAM_LOG_ADDR_ADDR, sizeof(LogFRAMRing));
+}
+
+/* Advance the tail by one entry */
+static void LogFRAMDropOldest(void) {
+    uint8_t Entry[8] = { 0 };
+    bool Compact = (LogFRAMRing.TailFormat == LOG_FRAM_FORMAT_COMPACT);
+    uint16_t Used = LogFRAMUsed();
+
+    LogFRAMRead(Entry, 0, (Used < sizeof(Entry)) ? Used : sizeof(Entry));
+    uint16_t Size = LogEntrySize(Entry, &Compact, &LogFRAMRing.TailTick);
+    if (Size > Used) {
+        Size = Used;
+    }
+
+    LogFRAMRing.Tail += Size;
+    if (LogFRAMRing.Tail >= LOG_FRAM_END_ADDR) {
+        LogFRAMRing.Tail -= FRAM_LOG_SIZE;
+    }
+    LogFRAMRing.TailFormat = Compact ? LOG_FRAM_FORMAT_COMPACT : LOG_FRAM_FORMAT_NORMAL;
+}
+
+static void LogFRAMClear(void) {
+    LogFRAMRing.Head = LogFRAMRing.Tail = FRAM_LOG_START_ADDR;
+    LogFRAMRing.TailTick = 0;
+    LogFRAMRing.TailFormat = LOG_FRAM_FORMAT_NORMAL;
+    MemoryWriteBlock(&LogFRAMRing, FRAM_LOG_ADDR_ADDR, sizeof(LogFRAMRing));
 }
 
 void LogInit(void) {
@@ -68,31 +411,26 @@ void LogInit(void) {
     uint8_t result;
     ReadEEPBlock((uint16_t) &LogFRAMAddrValid, &result, 1);
     memset(LogMemPtr, LOG_EMPTY, LOG_SIZE);
-    if (result) {
-        MemoryReadBlock(&LogFRAMAddr, FRAM_LOG_ADDR_ADDR, 2);
-    } else {
-        LogFRAMAddr = FRAM_LOG_START_ADDR;
-        MemoryWriteBlock(&LogFRAMAddr, FRAM_LOG_ADDR_ADDR, 2);
-        result = true;
+    if (result == LOG_FRAM_LAYOUT_VERSION) {
+        MemoryReadBlock(&LogFRAMRing, FRAM_LOG_ADDR_ADDR, sizeof(LogFRAMRing));
+    }
+    if (result != LOG_FRAM_LAYOUT_VERSION ||
+            LogFRAMRing.Head < FRAM_LOG_START_ADDR || LogFRAMRing.Head >= LOG_FRAM_END_ADDR ||
+            LogFRAMRing.Tail < FRAM_LOG_START_ADDR || LogFRAMRing.Tail >= LOG_FRAM_END_ADDR) {
+        LogFRAMClear();
+        result = LOG_FRAM_LAYOUT_VERSION;
         WriteEEPBlock((uint16_t) &LogFRAMAddrValid, &result, 1);
     }
     LogEntry(LOG_INFO_SYSTEM_BOOT, NULL, 0);
 }
 
 void LogTick(void) {
-    /*
-     * The logging functionality slows down the timings of data exchanges between
-     *  Chameleon emulated tags and readers, so schedule the logging writes to
-     * happen only on intervals that will be outside of timing windows for individual xfers
-     * initiated from PICC <--> PCD (e.g., currently approximately every 600ms):
-     */
-    if (GlobalSettings.ActiveSettingPtr->LogMode == LOG_MODE_LIVE) {
-        if ((++LiveLogModePostTickCount % LIVE_LOGGER_POST_TICKS) == 0) {
-            AtomicLiveLogTick();
-            LiveLogModePostTickCount = 0;
-        }
-    } else if (EnableLogSRAMtoFRAM) {
+    /* LIVE mode entries are drained continuously by TerminalTask */
+    if (EnableLogSRAMtoFRAM) {
         LogSRAMToFRAM();
+    } else {
+        /* Log mode may have changed while a write was running */
+        LogFRAMWriteComplete(false);
     }
 }
 
@@ -100,43 +438,58 @@ void LogTask(void) {
 
 }
 
+/*
+ * The log is read as one stream in chronological order:
+ * 1. If the oldest FRAM entry is in the compact format, a LOG_INFO_COMPACT_START entry
+ *    with the timestamp of the overwritten entries, so that the deltas can be decoded.
+ * 2. The FRAM ring, from tail to head.
+ * 3. The whole SRAM log, followed by zeros.
+ */
 bool LogMemLoadBlock(void *Buffer, uint32_t BlockAddress, uint16_t ByteCount) {
-    if (BlockAddress < sizeof(LogMem) + (LogFRAMAddr - FRAM_LOG_START_ADDR)) {
-        bool overflow = false;
-        uint16_t remainderByteCount = 0;
-        uint16_t SizeInFRAMStored = LogFRAMAddr - FRAM_LOG_START_ADDR;
-        // prevent buffer overflows:
-        if ((BlockAddress + ByteCount) >= sizeof(LogMem) + SizeInFRAMStored) {
-            overflow = true;
-            uint16_t tmp = sizeof(LogMem) + SizeInFRAMStored - BlockAddress;
-            remainderByteCount = ByteCount - tmp;
-            ByteCount = tmp;
-        }
+    LogFRAMWriteComplete(true);
+
+    uint8_t Prefix[4] = { LOG_INFO_COMPACT_START, 0, (uint8_t)(LogFRAMRing.TailTick >> 8), (uint8_t)(LogFRAMRing.TailTick >> 0) };
+    uint16_t PrefixSize = (LogFRAMRing.TailFormat == LOG_FRAM_FORMAT_COMPACT) ? sizeof(Prefix) : 0;
+    uint16_t FRAMEnd = PrefixSize + LogFRAMUsed();
+    uint8_t *BufferPtr = (uint8_t *) Buffer;
+
+    if (BlockAddress >= FRAMEnd + sizeof(LogMem)) {
+        return false;
+    }
 
-        /*
-         * 1. case: The whole block is in FRAM.
-         * 2. case: The block wraps from FRAM to SRAM
-         * 3. case: The whole block is in SRAM.
-         */
-        if (BlockAddress < SizeInFRAMStored && (BlockAddress + ByteCount) < SizeInFRAMStored) {
-            MemoryReadBlock(Buffer, BlockAddress + FRAM_LOG_START_ADDR, ByteCount);
-        } else if (BlockAddress < SizeInFRAMStored) {
-            uint16_t FramByteCount = SizeInFRAMStored - BlockAddress;
-            MemoryReadBlock(Buffer, BlockAddress + FRAM_LOG_START_ADDR, FramByteCount);
-            memcpy(Buffer + FramByteCount, LogMem, ByteCount - FramByteCount);
+    while (ByteCount > 0) {
+        uint16_t Count;
+
+        if (BlockAddress < PrefixSize) {
+            Count = PrefixSize - BlockAddress;
+        } else if (BlockAddress < FRAMEnd) {
+            Count = FRAMEnd - BlockAddress;
+        } else if (BlockAddress < FRAMEnd + sizeof(LogMem)) {
+            Count = FRAMEnd + sizeof(LogMem) - BlockAddress;
         } else {
-            memcpy(Buffer, LogMem + BlockAddress - SizeInFRAMStored, ByteCount);
+            Count = ByteCount;
         }
 
-        if (overflow) {
-            while (remainderByteCount--)
-                ((uint8_t *) Buffer)[ByteCount + remainderByteCount] = 0x00;
+        if (Count > ByteCount) {
+            Count = ByteCount;
         }
 
-        return true;
-    } else {
-        return false;
+        if (BlockAddress < PrefixSize) {
+            memcpy(BufferPtr, Prefix + BlockAddress, Count);
+        } else if (BlockAddress < FRAMEnd) {
+            LogFRAMRead(BufferPtr, BlockAddress - PrefixSize, Count);
+        } else if (BlockAddress < FRAMEnd + sizeof(LogMem)) {
+            memcpy(BufferPtr, LogMem + BlockAddress - FRAMEnd, Count);
+        } else {
+            memset(BufferPtr, 0x00, Count);
+        }
+
+        BufferPtr += Count;
+        BlockAddress += Count;
+        ByteCount -= Count;
     }
+
+    return true;
 }
 
 INLINE void LogSRAMClear(void) {
@@ -151,14 +504,15 @@ INLINE void LogSRAMClear(void) {
 }
 
 void LogMemClear(void) {
+    LogFRAMWriteComplete(true);
     LogSRAMClear();
-    LogFRAMAddr = FRAM_LOG_START_ADDR;
-    MemoryWriteBlock(&LogFRAMAddr, FRAM_LOG_ADDR_ADDR, 2);
+    LogFRAMClear();
+    LogCompactStarted = false;
     LEDHook(LED_LOG_MEM_FULL, LED_OFF);
 }
 
 uint16_t LogMemFree(void) {
-    return LogMemLeft + FRAM_LOG_SIZE - LogFRAMAddr + FRAM_LOG_START_ADDR;
+    return LogMemLeft + LogFRAMFree();
 }
 
 
@@ -169,6 +523,28 @@ void LogSetModeById(LogModeEnum Mode) {
         GlobalSettings.Settings[i].LogMode = Mode;
     }
 #endif
+    if (CurrentLogFunc == LogFuncMemoryCompact && Mode != LOG_MODE_MEMORY_COMPACT) {
+        LogCompactEnd();
+    }
+
+    if (CurrentLogFunc == LogFuncLive && Mode != LOG_MODE_LIVE) {
+        /* Send out what is left, memory mode starts over with an empty LogMem */
+        LiveLogFlush();
+        LiveLogReset();
+    } else if (CurrentLogFunc != LogFuncLive && Mode == LOG_MODE_LIVE) {
+        /* The ring takes over LogMem, keep pending memory mode entries in FRAM.
+         * A running write only covers the entries up to its start, so repeat
+         * until the entries logged meanwhile have been written as well. */
+        LogFRAMWriteComplete(true);
+        if (EnableLogSRAMtoFRAM) {
+            while (LogMemLeft < LOG_SIZE) {
+                LogSRAMToFRAM();
+                LogFRAMWriteComplete(true);
+            }
+        }
+        LiveLogReset();
+    }
+
     GlobalSettings.ActiveSettingPtr->LogMode = Mode;
     switch (Mode) {
         case LOG_MODE_OFF:
@@ -186,6 +562,11 @@ void LogSetModeById(LogModeEnum Mode) {
             CurrentLogFunc = LogFuncLive;
             break;
 
+        case LOG_MODE_MEMORY_COMPACT:
+            EnableLogSRAMtoFRAM = true;
+            CurrentLogFunc = LogFuncMemoryCompact;
+            break;
+
         default:
             break;
     }
@@ -213,26 +594,34 @@ void LogGetModeList(char *List, uint16_t BufferSize) {
 }
 
 void LogSRAMToFRAM(void) {
-    if (LogMemLeft < LOG_SIZE) {
-        uint16_t FRAM_Free = FRAM_LOG_SIZE - (LogFRAMAddr - FRAM_LOG_START_ADDR);
-        if (FRAM_Free >= LOG_SIZE - LogMemLeft) {
-            MemoryWriteBlock(LogMem, LogFRAMAddr, LOG_SIZE - LogMemLeft);
-            LogFRAMAddr += LOG_SIZE - LogMemLeft;
-            LogSRAMClear();
-            MemoryWriteBlock(&LogFRAMAddr, FRAM_LOG_ADDR_ADDR, 2);
-        } else if (FRAM_Free > 0) {
-            // not everything fits in FRAM, simply write as much as possible to FRAM
-            MemoryWriteBlock(LogMem, LogFRAMAddr, FRAM_Free);
-            memmove(LogMem, LogMem + FRAM_Free, LOG_SIZE - FRAM_Free); // FRAM_Free is < LOG_SIZE - LogMemLeft and thus also < LOG_SIZE
-            LogMemPtr -= FRAM_Free;
-            LogMemLeft += FRAM_Free;
-            LogFRAMAddr += FRAM_Free;
-            MemoryWriteBlock(&LogFRAMAddr, FRAM_LOG_ADDR_ADDR, 2);
+    LogFRAMWriteComplete(false);
+
+    if (LogFRAMWriteCount > 0) {
+        /* The previous write is still running */
+        return;
+    }
+
+    uint16_t ByteCount = LOG_SIZE - LogMemLeft;
+
+    if (ByteCount > 0) {
+        /* Make room by overwriting the oldest entries. SRAM only ever holds whole
+         * entries, so the ring stays aligned to entry boundaries. */
+        if (LogFRAMFree() < ByteCount) {
+            while (LogFRAMFree() < ByteCount) {
+                LogFRAMDropOldest();
+            }
+
+            /* Persist the new tail before its entries get overwritten */
+            MemoryWriteBlock(&LogFRAMRing, FRAM_LOG_ADDR_ADDR, sizeof(LogFRAMRing));
+        }
+
+        if (LogFRAMWriteAsync(LogMem, ByteCount)) {
+            LogFRAMWriteCount = ByteCount;
         } else {
-            // TODO: handle the case in which the FRAM is full ???
-            // Notify the user by repeatedly blinking the LED:
-            LEDHook(LED_LOG_MEM_FULL, LED_BLINK_8X);
-            LEDHook(LED_LOG_MEM_FULL, LED_BLINK_8X);
+            /* Request queue is full */
+            LogFRAMWrite(LogMem, ByteCount);
+            LogSRAMClear();
+            MemoryWriteBlock(&LogFRAMRing, FRAM_LOG_ADDR_ADDR, sizeof(LogFRAMRing));
         }
     }
 }
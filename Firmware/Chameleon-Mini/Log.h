@@ -2,15 +2,17 @@
 #define LOG_H_
 /** @file */
 #include "Common.h"
+#include "Profile.h"
 
 #ifdef MEMORY_LIMITED_TESTING
 #define LOG_SIZE                  1284
 #else
 #define LOG_SIZE	          2048
 #endif
-#define FRAM_LOG_ADDR_ADDR	0x4000 // start of the second half of FRAM
-#define FRAM_LOG_START_ADDR	0x4002 // directly after the address
-#define FRAM_LOG_SIZE		0x3FFE // the whole second half (minus the 2 Bytes of Address)
+/* The FRAM log is a ring buffer of whole log entries. When it is full, the oldest entries are overwritten. */
+#define FRAM_LOG_ADDR_ADDR	0x4000 // start of the second half of FRAM: head, tail, tail timestamp and tail format
+#define FRAM_LOG_START_ADDR	0x4008 // directly after the ring pointers
+#define FRAM_LOG_SIZE		0x3FF8 // the whole second half (minus the 8 Bytes of ring pointers)
 
 extern uint8_t LogMem[LOG_SIZE];
 extern uint8_t *LogMemPtr;
@@ -23,6 +25,7 @@ typedef enum {
     LOG_INFO_CONFIG_SET			           = 0x11, ///< Configuration change.
     LOG_INFO_SETTING_SET		           = 0x12, ///< Setting change.
     LOG_INFO_UID_SET			           = 0x13, ///< UID change.
+    LOG_INFO_COMPACT_START		           = 0x14, ///< The following entries use the compact format of `MEMORY_COMPACT`.
     LOG_INFO_RESET_APP			           = 0x20, ///< Application reset.
 
     /* Codec */
@@ -35,6 +38,7 @@ typedef enum {
     LOG_INFO_CODEC_SNI_CARD_DATA                   = 0x46, //< Sniffing codec receive data from card
     LOG_INFO_CODEC_SNI_CARD_DATA_W_PARITY          = 0x47, //< Sniffing codec receive data from card
     LOG_INFO_CODEC_READER_FIELD_DETECTED           = 0x48, ///< Add logging of the LEDHook case for FIELD_DETECTED
+    LOG_INFO_CODEC_SNI_TIMESTAMPS                  = 0x49, ///< SOC and EOC of the preceding sniffed frame in carrier cycles, see `ENABLE_SNIFF_TIMESTAMPS`.
 
     /* App */
     LOG_INFO_APP_CMD_READ		           = 0x80, ///< Application processed read command.
@@ -68,7 +72,8 @@ typedef enum {
 typedef enum {
     LOG_MODE_OFF,
     LOG_MODE_MEMORY,
-    LOG_MODE_LIVE
+    LOG_MODE_LIVE,
+    LOG_MODE_MEMORY_COMPACT
 } LogModeEnum;
 
 typedef void (*LogFuncType)(LogEntryEnum Entry, const void *Data, uint8_t Length);
@@ -91,6 +96,9 @@ void LogGetModeList(char *List, uint16_t BufferSize);
 void LogSRAMToFRAM(void);
 
 /* Wrapper function to call current logging function */
-INLINE void LogEntry(LogEntryEnum Entry, const void *Data, uint8_t Length) { CurrentLogFunc(Entry, Data, Length); }
+INLINE void LogEntry(LogEntryEnum Entry, const void *Data, uint8_t Length) {
+    PROFILE_SCOPE(PROFILE_LOG_ENTRY);
+    CurrentLogFunc(Entry, Data, Length);
+}
 
 #endif /* LOG_H_ */
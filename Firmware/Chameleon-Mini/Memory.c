@@ -11,6 +11,11 @@
 #include "Settings.h"
 #include "LEDHook.h"
 #include "System.h"
+#include "Terminal/Terminal.h"
+#include "Profile.h"
+
+#include <string.h>
+#include <util/atomic.h>
 
 #define USE_DMA
 #define RECV_DMA DMA.CH0
@@ -38,6 +43,28 @@ void FlashWaitForSPM(void);
 
 static uint8_t ScrapBuffer[] = {0};
 
+/* One bit per flash page of the setting that is currently held in FRAM. A set bit
+ * means that the page may differ from its copy in flash and has to be looked at
+ * by MemoryStore. */
+#define MEMORY_PAGES_PER_SETTING	(MEMORY_SIZE_PER_SETTING / APP_SECTION_PAGE_SIZE)
+static uint8_t MemoryDirtyPages[(MEMORY_PAGES_PER_SETTING + 7) / 8];
+
+INLINE void MemoryMarkDirty(uint16_t Address, uint16_t ByteCount) {
+    if (Address >= MEMORY_SIZE_PER_SETTING) {
+        /* Outside of the active setting (e.g. log memory) */
+        return;
+    }
+
+    uint16_t LastAddress = Address + ByteCount - 1;
+    if (LastAddress >= MEMORY_SIZE_PER_SETTING || LastAddress < Address) {
+        LastAddress = MEMORY_SIZE_PER_SETTING - 1;
+    }
+
+    for (uint8_t Page = Address / APP_SECTION_PAGE_SIZE; Page <= LastAddress / APP_SECTION_PAGE_SIZE; Page++) {
+        MemoryDirtyPages[Page / 8] |= 1 << (Page % 8);
+    }
+}
+
 INLINE uint8_t SPITransferByte(uint8_t Data) {
     FRAM_USART.DATA = Data;
 
@@ -47,7 +74,7 @@ INLINE uint8_t SPITransferByte(uint8_t Data) {
 }
 
 #ifdef USE_DMA
-INLINE void SPIReadBlock(void *Buffer, uint16_t ByteCount) {
+INLINE void SPIStartReadDMA(void *Buffer, uint16_t ByteCount) {
     /* Set up read and write transfers */
     RECV_DMA.ADDRCTRL = DMA_CH_SRCRELOAD_NONE_gc | DMA_CH_SRCDIR_FIXED_gc | DMA_CH_DESTRELOAD_NONE_gc | DMA_CH_DESTDIR_INC_gc;
     RECV_DMA.DESTADDR0 = ((uintptr_t) Buffer >> 0) & 0xFF;
@@ -62,31 +89,9 @@ INLINE void SPIReadBlock(void *Buffer, uint16_t ByteCount) {
     /* Enable read and write transfers */
     RECV_DMA.CTRLA |= DMA_CH_ENABLE_bm;
     SEND_DMA.CTRLA |= DMA_CH_ENABLE_bm;
-
-    /* Wait for DMA to finish */
-    while (RECV_DMA.CTRLA & DMA_CH_ENABLE_bm)
-        ;
-
-    /* Clear Interrupt flag */
-    RECV_DMA.CTRLB = DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm;
-    SEND_DMA.CTRLB = DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm;
-}
-#else
-INLINE void SPIReadBlock(void *Buffer, uint16_t ByteCount) {
-    uint8_t *ByteBuffer = (uint8_t *) Buffer;
-
-    while (ByteCount-- > 0) {
-        FRAM_USART.DATA = 0;
-        while (!(FRAM_USART.STATUS & USART_RXCIF_bm));
-
-        *ByteBuffer++ = FRAM_USART.DATA;
-    }
 }
 
-#endif
-
-#ifdef USE_DMA
-INLINE void SPIWriteBlock(const void *Buffer, uint16_t ByteCount) {
+INLINE void SPIStartWriteDMA(const void *Buffer, uint16_t ByteCount) {
     /* Set up read and write transfers */
     RECV_DMA.ADDRCTRL = DMA_CH_SRCRELOAD_NONE_gc | DMA_CH_SRCDIR_FIXED_gc | DMA_CH_DESTRELOAD_NONE_gc | DMA_CH_DESTDIR_FIXED_gc;
     RECV_DMA.DESTADDR0 = ((uintptr_t) ScrapBuffer >> 0) & 0xFF;
@@ -100,16 +105,45 @@ INLINE void SPIWriteBlock(const void *Buffer, uint16_t ByteCount) {
     /* Enable read and write transfers */
     RECV_DMA.CTRLA |= DMA_CH_ENABLE_bm;
     SEND_DMA.CTRLA |= DMA_CH_ENABLE_bm;
+}
+
+INLINE void SPIClearDMA(void) {
+    /* Clear Interrupt flag, this also disables the transaction complete interrupt */
+    RECV_DMA.CTRLB = DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm;
+    SEND_DMA.CTRLB = DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm;
+}
+
+INLINE void SPIReadBlock(void *Buffer, uint16_t ByteCount) {
+    SPIStartReadDMA(Buffer, ByteCount);
 
     /* Wait for DMA to finish */
     while (RECV_DMA.CTRLA & DMA_CH_ENABLE_bm)
         ;
 
-    /* Clear Interrupt flag */
-    RECV_DMA.CTRLB = DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm;
-    SEND_DMA.CTRLB = DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm;
+    SPIClearDMA();
+}
+
+INLINE void SPIWriteBlock(const void *Buffer, uint16_t ByteCount) {
+    SPIStartWriteDMA(Buffer, ByteCount);
+
+    /* Wait for DMA to finish */
+    while (RECV_DMA.CTRLA & DMA_CH_ENABLE_bm)
+        ;
+
+    SPIClearDMA();
 }
 #else
+INLINE void SPIReadBlock(void *Buffer, uint16_t ByteCount) {
+    uint8_t *ByteBuffer = (uint8_t *) Buffer;
+
+    while (ByteCount-- > 0) {
+        FRAM_USART.DATA = 0;
+        while (!(FRAM_USART.STATUS & USART_RXCIF_bm));
+
+        *ByteBuffer++ = FRAM_USART.DATA;
+    }
+}
+
 INLINE void SPIWriteBlock(const void *Buffer, uint16_t ByteCount) {
     uint8_t *ByteBuffer = (uint8_t *) Buffer;
 
@@ -122,19 +156,15 @@ INLINE void SPIWriteBlock(const void *Buffer, uint16_t ByteCount) {
 }
 #endif
 
-INLINE void FRAMRead(void *Buffer, uint16_t Address, uint16_t ByteCount) {
+INLINE void FRAMSelectRead(uint16_t Address) {
     FRAM_PORT.OUTCLR = FRAM_CS;
 
     SPITransferByte(0x03); /* Read command */
     SPITransferByte((Address >> 8) & 0xFF);   /* Address hi and lo byte */
     SPITransferByte((Address >> 0) & 0xFF);
-
-    SPIReadBlock(Buffer, ByteCount);
-
-    FRAM_PORT.OUTSET = FRAM_CS;
 }
 
-INLINE void FRAMWrite(const void *Buffer, uint16_t Address, uint16_t ByteCount) {
+INLINE void FRAMSelectWrite(uint16_t Address) {
     FRAM_PORT.OUTCLR = FRAM_CS;
     SPITransferByte(0x06); /* Write Enable */
     FRAM_PORT.OUTSET = FRAM_CS;
@@ -147,7 +177,186 @@ INLINE void FRAMWrite(const void *Buffer, uint16_t Address, uint16_t ByteCount)
     SPITransferByte(0x02); /* Write command */
     SPITransferByte((Address >> 8) & 0xFF);   /* Address hi and lo byte */
     SPITransferByte((Address >> 0) & 0xFF);
+}
+
+/* Asynchronous requests. The queue is filled by MemoryAsyncEnqueue and emptied by the
+ * DMA interrupt; MemoryAsyncTail is the request that is currently being transferred.
+ * Requests without data complete when they reach the tail, so that every callback
+ * runs after the ones of the requests queued before. */
+typedef struct {
+    void *Buffer;
+    uint16_t Address;
+    uint16_t ByteCount;
+    bool Write;
+    MemoryCallbackType Callback;
+} MemoryAsyncRequestType;
+
+static MemoryAsyncRequestType MemoryAsyncQueue[MEMORY_ASYNC_QUEUE_SIZE];
+static volatile uint8_t MemoryAsyncTail = 0;
+static volatile uint8_t MemoryAsyncCount = 0;
+static volatile bool MemoryAsyncRunning = false; /* A transfer or MemoryAsyncRun is in progress */
+
+bool MemoryAsyncBusy(void) {
+    return MemoryAsyncCount > 0;
+}
 
+#ifdef USE_DMA
+static void MemoryAsyncComplete(void);
+
+/* The DMA interrupt cannot fire before SystemInterruptInit (ConfigurationInit recalls
+ * memory at boot), nor with interrupts disabled or while another interrupt is served */
+static bool MemoryAsyncInterruptReady(void) {
+    return (SREG & CPU_I_bm) && (PMIC.CTRL & PMIC_LOLVLEN_bm) && !(PMIC.STATUS & (PMIC_LOLVLEX_bm | PMIC_MEDLVLEX_bm | PMIC_HILVLEX_bm));
+}
+#endif
+
+void MemoryAsyncFlush(void) {
+    while (MemoryAsyncCount > 0) {
+#ifdef USE_DMA
+        if (!MemoryAsyncInterruptReady() && (RECV_DMA.CTRLB & DMA_CH_TRNIF_bm)) {
+            /* Complete the transfer in place of the interrupt */
+            MemoryAsyncComplete();
+        }
+#endif
+    }
+}
+
+#ifdef USE_DMA
+/* Called with interrupts disabled or from the DMA interrupt */
+static void MemoryAsyncStart(void) {
+    MemoryAsyncRequestType *Request = &MemoryAsyncQueue[MemoryAsyncTail];
+
+    if (Request->Write) {
+        FRAMSelectWrite(Request->Address);
+    } else {
+        FRAMSelectRead(Request->Address);
+    }
+
+    /* Interrupt when the last byte has been clocked in */
+    RECV_DMA.CTRLB = DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm | DMA_CH_TRNINTLVL_LO_gc;
+
+    if (Request->Write) {
+        SPIStartWriteDMA(Request->Buffer, Request->ByteCount);
+    } else {
+        SPIStartReadDMA(Request->Buffer, Request->ByteCount);
+    }
+}
+
+/* Complete the requests without data at the tail, then start the next transfer.
+ * Called with interrupts disabled or from the DMA interrupt, when no transfer is running. */
+static void MemoryAsyncRun(void) {
+    MemoryAsyncRunning = true;
+
+    while (MemoryAsyncCount > 0) {
+        MemoryAsyncRequestType *Request = &MemoryAsyncQueue[MemoryAsyncTail];
+
+        if (Request->ByteCount > 0) {
+            MemoryAsyncStart();
+            return;
+        }
+
+        MemoryCallbackType Callback = Request->Callback;
+
+        MemoryAsyncTail = (MemoryAsyncTail + 1) % MEMORY_ASYNC_QUEUE_SIZE;
+        MemoryAsyncCount--;
+
+        /* Requests queued by the callback are picked up by this loop */
+        if (Callback != NULL) {
+            Callback();
+        }
+    }
+
+    MemoryAsyncRunning = false;
+}
+
+/* Called from the DMA interrupt, or by MemoryAsyncFlush when it cannot fire */
+static void MemoryAsyncComplete(void) {
+    FRAM_PORT.OUTSET = FRAM_CS;
+    SPIClearDMA();
+
+    MemoryCallbackType Callback = MemoryAsyncQueue[MemoryAsyncTail].Callback;
+    bool Started = false;
+
+    MemoryAsyncTail = (MemoryAsyncTail + 1) % MEMORY_ASYNC_QUEUE_SIZE;
+
+    /* Start the next request before the callback, which may queue another one */
+    if (--MemoryAsyncCount > 0 && MemoryAsyncQueue[MemoryAsyncTail].ByteCount > 0) {
+        MemoryAsyncStart();
+        Started = true;
+    }
+
+    if (Callback != NULL) {
+        Callback();
+    }
+
+    if (!Started) {
+        MemoryAsyncRun();
+    }
+}
+
+ISR(DMA_CH0_vect) {
+    MemoryAsyncComplete();
+}
+#endif
+
+INLINE void FRAMRead(void *Buffer, uint16_t Address, uint16_t ByteCount);
+INLINE void FRAMWrite(const void *Buffer, uint16_t Address, uint16_t ByteCount);
+
+static bool MemoryAsyncEnqueue(void *Buffer, uint16_t Address, uint16_t ByteCount, bool Write, MemoryCallbackType Callback) {
+#ifdef USE_DMA
+    bool Queued = false;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (MemoryAsyncCount < MEMORY_ASYNC_QUEUE_SIZE) {
+            MemoryAsyncRequestType *Request = &MemoryAsyncQueue[(MemoryAsyncTail + MemoryAsyncCount) % MEMORY_ASYNC_QUEUE_SIZE];
+
+            Request->Buffer = Buffer;
+            Request->Address = Address;
+            Request->ByteCount = ByteCount;
+            Request->Write = Write;
+            Request->Callback = Callback;
+
+            /* A DMA transfer count of zero means 64K, MemoryAsyncRun completes these without one */
+            MemoryAsyncCount++;
+            if (!MemoryAsyncRunning) {
+                MemoryAsyncRun();
+            }
+
+            Queued = true;
+        }
+    }
+
+    return Queued;
+#else
+    if (ByteCount == 0) {
+        /* Nothing to transfer */
+    } else if (Write) {
+        FRAMWrite(Buffer, Address, ByteCount);
+    } else {
+        FRAMRead(Buffer, Address, ByteCount);
+    }
+
+    if (Callback != NULL) {
+        Callback();
+    }
+
+    return true;
+#endif
+}
+
+INLINE void FRAMRead(void *Buffer, uint16_t Address, uint16_t ByteCount) {
+    MemoryAsyncFlush();
+
+    FRAMSelectRead(Address);
+    SPIReadBlock(Buffer, ByteCount);
+
+    FRAM_PORT.OUTSET = FRAM_CS;
+}
+
+INLINE void FRAMWrite(const void *Buffer, uint16_t Address, uint16_t ByteCount) {
+    MemoryAsyncFlush();
+
+    FRAMSelectWrite(Address);
     SPIWriteBlock(Buffer, ByteCount);
 
     FRAM_PORT.OUTSET = FRAM_CS;
@@ -231,44 +440,35 @@ INLINE void FlashErase(uint32_t Address, uint16_t ByteCount) {
     }
 }
 
-INLINE void FlashToFRAM(uint32_t Address, uint16_t ByteCount) {
+INLINE bool FRAMEqualsFlash(uint16_t FRAMAddress, uint32_t Address, uint16_t ByteCount) {
     /* We assume that ByteCount is a multiple of 2 */
     uint32_t PhysicalAddress = Address + FLASH_DATA_ADDR;
+    bool Equal = true;
 
-    if ((PhysicalAddress >= FLASH_DATA_START) && (PhysicalAddress <= FLASH_DATA_END)) {
-        /* Sanity check to limit access to the allocated area.
-         * Set up FRAM memory for writing. */
-        FRAM_PORT.OUTCLR = FRAM_CS;
-        SPITransferByte(0x06); /* Write Enable */
-        FRAM_PORT.OUTSET = FRAM_CS;
-
-        asm volatile("nop");
-        asm volatile("nop");
-
-        FRAM_PORT.OUTCLR = FRAM_CS;
-
-        SPITransferByte(0x02); /* Write command */
-        SPITransferByte(0); /* Address hi and lo byte */
-        SPITransferByte(0);
+    MemoryAsyncFlush();
+    FRAMSelectRead(FRAMAddress);
 
-        /* Loop through bytes, read words from flash and write
-         * double byte into FRAM. */
-        while (ByteCount > 1) {
-            uint16_t Word = FlashReadWord(PhysicalAddress);
+    while (ByteCount > 1) {
+        uint16_t Word = 0;
 
-            SPITransferByte((Word >> 0) & 0xFF);
-            SPITransferByte((Word >> 8) & 0xFF);
+        Word |= ((uint16_t) SPITransferByte(0) << 0);
+        Word |= ((uint16_t) SPITransferByte(0) << 8);
 
-            PhysicalAddress += 2;
-            ByteCount -= 2;
+        if (Word != FlashReadWord(PhysicalAddress)) {
+            Equal = false;
+            break;
         }
 
-        /* End write procedure of FRAM */
-        FRAM_PORT.OUTSET = FRAM_CS;
+        PhysicalAddress += 2;
+        ByteCount -= 2;
     }
+
+    FRAM_PORT.OUTSET = FRAM_CS;
+
+    return Equal;
 }
 
-INLINE void FRAMToFlash(uint32_t Address, uint16_t ByteCount) {
+INLINE void FRAMToFlash(uint16_t FRAMAddress, uint32_t Address, uint16_t ByteCount) {
     /* We assume that FlashWrite is always called for write actions that are
      * aligned to APP_SECTION_PAGE_SIZE and a multiple of APP_SECTION_PAGE_SIZE.
      * Thus only full pages are written into the flash. */
@@ -278,11 +478,8 @@ INLINE void FRAMToFlash(uint32_t Address, uint16_t ByteCount) {
     if ((PhysicalAddress >= FLASH_DATA_START) && (PhysicalAddress <= FLASH_DATA_END)) {
         /* Sanity check to limit access to the allocated area and setup FRAM
          * read. */
-        FRAM_PORT.OUTCLR = FRAM_CS;
-
-        SPITransferByte(0x03); /* Read command */
-        SPITransferByte(0); /* Address hi and lo byte */
-        SPITransferByte(0);
+        MemoryAsyncFlush();
+        FRAMSelectRead(FRAMAddress);
 
         while (PageCount-- > 0) {
             /* For each page to program, wait for NVM to get ready,
@@ -318,6 +515,150 @@ INLINE void FRAMToFlash(uint32_t Address, uint16_t ByteCount) {
     }
 }
 
+/* Direct-mapped: consecutive lines, e.g. the blocks of a MIFARE Classic sector, never
+ * evict each other. Only accesses to the working copy of at most one line in size are
+ * cached, bulk transfers go to FRAM directly after synchronizing the lines they touch. */
+#define MEMORY_CACHE_NO_LINE		0xFFFF
+#define MEMORY_CACHE_LIMIT		MEMORY_SIZE_PER_SETTING
+
+typedef struct {
+    uint16_t Address; /* FRAM address of the line or MEMORY_CACHE_NO_LINE */
+    bool Dirty;
+    uint8_t Data[MEMORY_CACHE_LINE_SIZE];
+} MemoryCacheLineType;
+
+#if MEMORY_CACHE_LINES > 0
+static MemoryCacheLineType MemoryCache[MEMORY_CACHE_LINES];
+#endif
+static uint16_t MemoryCacheHits = 0;
+static uint16_t MemoryCacheMisses = 0;
+
+INLINE bool MemoryCacheable(uint16_t Address, uint16_t ByteCount) {
+    return (MEMORY_CACHE_LINES > 0) && (ByteCount <= MEMORY_CACHE_LINE_SIZE) &&
+           (Address < MEMORY_CACHE_LIMIT) && (ByteCount <= MEMORY_CACHE_LIMIT - Address);
+}
+
+/* Write back the dirty lines that overlap the given range and drop them if requested */
+static void MemoryCacheSync(uint16_t Address, uint16_t ByteCount, bool Invalidate) {
+#if MEMORY_CACHE_LINES > 0
+    uint32_t End = (uint32_t) Address + ByteCount;
+
+    for (uint8_t i = 0; i < MEMORY_CACHE_LINES; i++) {
+        MemoryCacheLineType *Line = &MemoryCache[i];
+
+        if (Line->Address == MEMORY_CACHE_NO_LINE ||
+                Line->Address >= End || Line->Address + MEMORY_CACHE_LINE_SIZE <= Address) {
+            continue;
+        }
+
+        if (Line->Dirty) {
+            FRAMWrite(Line->Data, Line->Address, MEMORY_CACHE_LINE_SIZE);
+            Line->Dirty = false;
+        }
+
+        if (Invalidate) {
+            Line->Address = MEMORY_CACHE_NO_LINE;
+        }
+    }
+#endif
+}
+
+static void MemoryCacheInvalidate(void) {
+#if MEMORY_CACHE_LINES > 0
+    for (uint8_t i = 0; i < MEMORY_CACHE_LINES; i++) {
+        MemoryCache[i].Address = MEMORY_CACHE_NO_LINE;
+        MemoryCache[i].Dirty = false;
+    }
+#endif
+}
+
+#if MEMORY_CACHE_LINES > 0
+/* Returns the line holding LineAddress, loading it from FRAM unless the whole line is
+ * about to be overwritten */
+static MemoryCacheLineType *MemoryCacheLookup(uint16_t LineAddress, bool Fill) {
+    MemoryCacheLineType *Line = &MemoryCache[(LineAddress / MEMORY_CACHE_LINE_SIZE) & (MEMORY_CACHE_LINES - 1)];
+
+    if (Line->Address == LineAddress) {
+        if (MemoryCacheHits < UINT16_MAX) {
+            MemoryCacheHits++;
+        }
+        return Line;
+    }
+
+    if (MemoryCacheMisses < UINT16_MAX) {
+        MemoryCacheMisses++;
+    }
+
+    if (Line->Address != MEMORY_CACHE_NO_LINE && Line->Dirty) {
+        FRAMWrite(Line->Data, Line->Address, MEMORY_CACHE_LINE_SIZE);
+    }
+
+    if (Fill) {
+        FRAMRead(Line->Data, LineAddress, MEMORY_CACHE_LINE_SIZE);
+    }
+
+    Line->Address = LineAddress;
+    Line->Dirty = false;
+    return Line;
+}
+#endif
+
+static void MemoryCacheRead(void *Buffer, uint16_t Address, uint16_t ByteCount) {
+#if MEMORY_CACHE_LINES > 0
+    uint8_t *BufPtr = (uint8_t *) Buffer;
+
+    while (ByteCount > 0) {
+        uint8_t Offset = Address % MEMORY_CACHE_LINE_SIZE;
+        uint8_t Count = MIN(ByteCount, MEMORY_CACHE_LINE_SIZE - Offset);
+        MemoryCacheLineType *Line = MemoryCacheLookup(Address - Offset, true);
+
+        memcpy(BufPtr, &Line->Data[Offset], Count);
+
+        BufPtr += Count;
+        Address += Count;
+        ByteCount -= Count;
+    }
+#endif
+}
+
+static void MemoryCacheWrite(const void *Buffer, uint16_t Address, uint16_t ByteCount) {
+#if MEMORY_CACHE_LINES > 0
+    const uint8_t *BufPtr = (const uint8_t *) Buffer;
+
+    while (ByteCount > 0) {
+        uint8_t Offset = Address % MEMORY_CACHE_LINE_SIZE;
+        uint8_t Count = MIN(ByteCount, MEMORY_CACHE_LINE_SIZE - Offset);
+        MemoryCacheLineType *Line = MemoryCacheLookup(Address - Offset, Count < MEMORY_CACHE_LINE_SIZE);
+
+        memcpy(&Line->Data[Offset], BufPtr, Count);
+        Line->Dirty = true;
+
+        BufPtr += Count;
+        Address += Count;
+        ByteCount -= Count;
+    }
+#endif
+}
+
+void MemoryCacheWriteBack(void) {
+    MemoryCacheSync(0, MEMORY_CACHE_LIMIT, false);
+}
+
+void MemoryTick(void) {
+    /* Keep the time that changes only live in SRAM short */
+    MemoryCacheWriteBack();
+}
+
+void MemoryCacheGetStats(uint16_t *Hits, uint16_t *Misses) {
+    *Hits = MemoryCacheHits;
+    *Misses = MemoryCacheMisses;
+}
+
+void MemoryCacheResetStats(void) {
+    MemoryCacheHits = 0;
+    MemoryCacheMisses = 0;
+}
+
 void MemoryInit(void) {
     /* Configure FRAM_USART for SPI master mode 0 with maximum clock frequency */
     FRAM_PORT.OUTSET = FRAM_CS;
@@ -354,19 +695,61 @@ void MemoryInit(void) {
     SEND_DMA.DESTADDR1 = ((uintptr_t) &FRAM_USART.DATA >> 8) & 0xFF;
     SEND_DMA.DESTADDR2 = 0;
     SEND_DMA.CTRLA = DMA_CH_SINGLE_bm | DMA_CH_BURSTLEN_1BYTE_gc;
+
+    /* FRAM may hold changes that were not stored before power down */
+    memset(MemoryDirtyPages, 0xFF, sizeof(MemoryDirtyPages));
+    MemoryCacheInvalidate();
+}
+
+/* Address of the block in XModemPrefetchBuffer, or MEMORY_NO_PREFETCH */
+#define MEMORY_NO_PREFETCH		0xFFFFFFFF
+static uint32_t MemoryPrefetchAddress = MEMORY_NO_PREFETCH;
+
+/* Drop the prefetched download block when a write overlaps it */
+INLINE void MemoryPrefetchInvalidate(uint16_t Address, uint16_t ByteCount) {
+    if (MemoryPrefetchAddress != MEMORY_NO_PREFETCH &&
+            Address < MemoryPrefetchAddress + XMODEM_BLOCK_SIZE &&
+            (uint32_t) Address + ByteCount > MemoryPrefetchAddress) {
+        MemoryPrefetchAddress = MEMORY_NO_PREFETCH;
+    }
+}
+
+/* Reads and writes on the working copy go through the cache */
+INLINE void MemoryRead(void *Buffer, uint16_t Address, uint16_t ByteCount) {
+    PROFILE_SCOPE(PROFILE_MEMORY_READ);
+
+    if (MemoryCacheable(Address, ByteCount)) {
+        MemoryCacheRead(Buffer, Address, ByteCount);
+    } else {
+        MemoryCacheSync(Address, ByteCount, false);
+        FRAMRead(Buffer, Address, ByteCount);
+    }
+}
+
+INLINE void MemoryWrite(const void *Buffer, uint16_t Address, uint16_t ByteCount) {
+    PROFILE_SCOPE(PROFILE_MEMORY_WRITE);
+
+    MemoryPrefetchInvalidate(Address, ByteCount);
+    if (MemoryCacheable(Address, ByteCount)) {
+        MemoryCacheWrite(Buffer, Address, ByteCount);
+    } else {
+        MemoryCacheSync(Address, ByteCount, true);
+        FRAMWrite(Buffer, Address, ByteCount);
+    }
+    MemoryMarkDirty(Address, ByteCount);
+    LEDHook(LED_MEMORY_CHANGED, LED_ON);
 }
 
 void MemoryReadBlock(void *Buffer, uint16_t Address, uint16_t ByteCount) {
     if (ByteCount == 0)
         return;
-    FRAMRead(Buffer, Address, ByteCount);
+    MemoryRead(Buffer, Address, ByteCount);
 }
 
 void MemoryWriteBlock(const void *Buffer, uint16_t Address, uint16_t ByteCount) {
     if (ByteCount == 0)
         return;
-    FRAMWrite(Buffer, Address, ByteCount);
-    LEDHook(LED_MEMORY_CHANGED, LED_ON);
+    MemoryWrite(Buffer, Address, ByteCount);
 }
 
 void MemoryReadBlockInSetting(void *Buffer, uint16_t Address, uint16_t ByteCount) {
@@ -375,7 +758,7 @@ void MemoryReadBlockInSetting(void *Buffer, uint16_t Address, uint16_t ByteCount
     uint16_t ShiftedAddress = Address + GlobalSettings.ActiveSettingIdx * MEMORY_SIZE_PER_SETTING;
     if (ShiftedAddress < Address)
         return;
-    FRAMRead(Buffer, ShiftedAddress, ByteCount);
+    MemoryRead(Buffer, ShiftedAddress, ByteCount);
 }
 
 void MemoryWriteBlockInSetting(const void *Buffer, uint16_t Address, uint16_t ByteCount) {
@@ -384,24 +767,99 @@ void MemoryWriteBlockInSetting(const void *Buffer, uint16_t Address, uint16_t By
     uint16_t ShiftedAddress = Address + GlobalSettings.ActiveSettingIdx * MEMORY_SIZE_PER_SETTING;
     if (ShiftedAddress < Address)
         return;
-    FRAMWrite(Buffer, ShiftedAddress, ByteCount);
+    MemoryWrite(Buffer, ShiftedAddress, ByteCount);
+}
+
+bool MemoryReadBlockAsync(void *Buffer, uint16_t Address, uint16_t ByteCount, MemoryCallbackType Callback) {
+    MemoryCacheSync(Address, ByteCount, false);
+    return MemoryAsyncEnqueue(Buffer, Address, ByteCount, false, Callback);
+}
+
+bool MemoryWriteBlockAsync(const void *Buffer, uint16_t Address, uint16_t ByteCount, MemoryCallbackType Callback) {
+    MemoryPrefetchInvalidate(Address, ByteCount);
+    MemoryCacheSync(Address, ByteCount, true);
+
+    if (!MemoryAsyncEnqueue((void *) Buffer, Address, ByteCount, true, Callback)) {
+        return false;
+    }
+
+    MemoryMarkDirty(Address, ByteCount);
     LEDHook(LED_MEMORY_CHANGED, LED_ON);
+    return true;
 }
 
 void MemoryClear(void) {
+    /* A running recall reads from flash */
+    MemoryAsyncFlush();
     FlashErase((uint32_t) GlobalSettings.ActiveSettingIdx * MEMORY_SIZE_PER_SETTING, MEMORY_SIZE_PER_SETTING);
     MemoryRecall();
 }
 
+/* Recall is done chunk by chunk in the background: each finished FRAM write
+ * loads the next chunk from flash and queues it. Without the DMA interrupt
+ * the chunks are copied in place, as at boot. */
+#define MEMORY_RECALL_CHUNK_SIZE	64
+
+static uint8_t MemoryRecallBuffer[MEMORY_RECALL_CHUNK_SIZE];
+static uint32_t MemoryRecallFlashAddress;
+static uint16_t MemoryRecallFRAMAddress;
+
+#ifdef USE_DMA
+static void MemoryRecallNextChunk(void) {
+    if (MemoryRecallFRAMAddress < MEMORY_SIZE_PER_SETTING) {
+        FlashRead(MemoryRecallBuffer, MemoryRecallFlashAddress + MemoryRecallFRAMAddress, sizeof(MemoryRecallBuffer));
+        /* Cannot fail: the interrupt has just freed a slot, and MemoryRecall starts with an empty queue */
+        MemoryAsyncEnqueue(MemoryRecallBuffer, MemoryRecallFRAMAddress, sizeof(MemoryRecallBuffer), true, MemoryRecallNextChunk);
+        MemoryRecallFRAMAddress += sizeof(MemoryRecallBuffer);
+    }
+}
+#endif
+
 void MemoryRecall(void) {
-    /* Recall memory from permanent flash */
-    FlashToFRAM((uint32_t) GlobalSettings.ActiveSettingIdx * MEMORY_SIZE_PER_SETTING, MEMORY_SIZE_PER_SETTING);
+    /* Recall memory from permanent flash. Blocking FRAM accesses wait until this has finished. */
+    MemoryAsyncFlush();
+    MemoryCacheInvalidate();
+    MemoryPrefetchAddress = MEMORY_NO_PREFETCH;
+    memset(MemoryDirtyPages, 0, sizeof(MemoryDirtyPages));
+
+    MemoryRecallFlashAddress = (uint32_t) GlobalSettings.ActiveSettingIdx * MEMORY_SIZE_PER_SETTING;
+    MemoryRecallFRAMAddress = 0;
+
+#ifdef USE_DMA
+    if (MemoryAsyncInterruptReady()) {
+        MemoryRecallNextChunk();
+    } else
+#endif
+    {
+        while (MemoryRecallFRAMAddress < MEMORY_SIZE_PER_SETTING) {
+            FlashRead(MemoryRecallBuffer, MemoryRecallFlashAddress + MemoryRecallFRAMAddress, sizeof(MemoryRecallBuffer));
+            FRAMWrite(MemoryRecallBuffer, MemoryRecallFRAMAddress, sizeof(MemoryRecallBuffer));
+            MemoryRecallFRAMAddress += sizeof(MemoryRecallBuffer);
+        }
+    }
+
     SystemTickClearFlag();
 }
 
 void MemoryStore(void) {
-    /* Store current memory into permanent flash */
-    FRAMToFlash((uint32_t) GlobalSettings.ActiveSettingIdx * MEMORY_SIZE_PER_SETTING, MEMORY_SIZE_PER_SETTING);
+    /* Store current memory into permanent flash. Only pages that have been written
+     * to and actually differ from flash are reprogrammed. */
+    uint32_t SettingAddress = (uint32_t) GlobalSettings.ActiveSettingIdx * MEMORY_SIZE_PER_SETTING;
+
+    MemoryCacheWriteBack();
+    MemoryAsyncFlush();
+
+    for (uint8_t Page = 0; Page < MEMORY_PAGES_PER_SETTING; Page++) {
+        if (MemoryDirtyPages[Page / 8] & (1 << (Page % 8))) {
+            uint16_t PageAddress = Page * APP_SECTION_PAGE_SIZE;
+
+            if (!FRAMEqualsFlash(PageAddress, SettingAddress + PageAddress, APP_SECTION_PAGE_SIZE)) {
+                FRAMToFlash(PageAddress, SettingAddress + PageAddress, APP_SECTION_PAGE_SIZE);
+            }
+        }
+    }
+
+    memset(MemoryDirtyPages, 0, sizeof(MemoryDirtyPages));
 
     LEDHook(LED_MEMORY_CHANGED, LED_OFF);
     LEDHook(LED_MEMORY_STORED, LED_PULSE);
@@ -419,15 +877,24 @@ bool MemoryUploadBlock(void *Buffer, uint32_t BlockAddress, uint16_t ByteCount)
         ByteCount = MIN(ByteCount, BytesLeft);
 
         /* Store to local memory */
+        MemoryPrefetchInvalidate(BlockAddress, ByteCount);
+        MemoryCacheSync(BlockAddress, ByteCount, true);
         FRAMWrite(Buffer, BlockAddress, ByteCount);
+        MemoryMarkDirty(BlockAddress, ByteCount);
 
         return true;
     }
 }
 
 bool MemoryDownloadBlock(void *Buffer, uint32_t BlockAddress, uint16_t ByteCount) {
+    if (BlockAddress == 0) {
+        /* A new download, the prefetch buffer may have been overwritten in between */
+        MemoryPrefetchAddress = MEMORY_NO_PREFETCH;
+    }
+
     if (BlockAddress >= MEMORY_SIZE_PER_SETTING) {
         /* There are bytes out of bounds to be read. Notify that we are done. */
+        MemoryPrefetchAddress = MEMORY_NO_PREFETCH;
         return false;
     } else {
         /* Calculate bytes left in memory and issue reading */
@@ -435,10 +902,215 @@ bool MemoryDownloadBlock(void *Buffer, uint32_t BlockAddress, uint16_t ByteCount
         ByteCount = MIN(ByteCount, BytesLeft);
 
         /* Output local memory contents */
-        FRAMRead(Buffer, BlockAddress, ByteCount);
+        if (BlockAddress == MemoryPrefetchAddress && ByteCount <= XMODEM_BLOCK_SIZE) {
+            MemoryAsyncFlush();
+            memcpy(Buffer, XModemPrefetchBuffer, ByteCount);
+        } else {
+            MemoryCacheSync(BlockAddress, ByteCount, false);
+            FRAMRead(Buffer, BlockAddress, ByteCount);
+        }
+
+        /* Read the next block while this one is on its way to the host */
+        MemoryPrefetchAddress = BlockAddress + ByteCount;
+        if (MemoryPrefetchAddress >= MEMORY_SIZE_PER_SETTING ||
+                !MemoryReadBlockAsync(XModemPrefetchBuffer, MemoryPrefetchAddress,
+                                      MIN(XMODEM_BLOCK_SIZE, MEMORY_SIZE_PER_SETTING - MemoryPrefetchAddress), NULL)) {
+            MemoryPrefetchAddress = MEMORY_NO_PREFETCH;
+        }
+
+        return true;
+    }
+}
+
+/* Archive of all settings for BACKUP and RESTORE. It starts with a header and the
+ * SettingsEntryType of each setting, followed by the flash image of each setting.
+ * The images start at a flash page boundary and are copied from and to flash
+ * directly, the working copy in FRAM is not involved. */
+#define MEMORY_ARCHIVE_MAGIC		"CMAR"
+#define MEMORY_ARCHIVE_VERSION		2
+
+typedef struct {
+    uint8_t Magic[4];
+    uint8_t Version;
+    uint8_t SettingsCount;
+    uint8_t ActiveSettingIdx;
+    uint8_t EntrySize;		/* sizeof(SettingsEntryType) */
+    uint16_t SlotSize;		/* Bytes per flash image */
+    uint16_t ImageOffset;	/* Offset of the first flash image */
+    uint16_t ConfigurationLayout;	/* ConfigurationGetLayoutCRC, the settings hold ConfigurationEnum values */
+    uint8_t Reserved[2];
+} MemoryArchiveHeaderType;
+
+#define MEMORY_ARCHIVE_ENTRIES_END	(sizeof(MemoryArchiveHeaderType) + sizeof(GlobalSettings.Settings))
+#define MEMORY_ARCHIVE_IMAGE_OFFSET	((MEMORY_ARCHIVE_ENTRIES_END + APP_SECTION_PAGE_SIZE - 1) / APP_SECTION_PAGE_SIZE * APP_SECTION_PAGE_SIZE)
+#define MEMORY_ARCHIVE_SIZE		(MEMORY_ARCHIVE_IMAGE_OFFSET + (uint32_t) SETTINGS_COUNT * MEMORY_SIZE_PER_SETTING)
+
+#if MEMORY_SIZE_PER_SETTING % APP_SECTION_PAGE_SIZE != 0 || APP_SECTION_PAGE_SIZE != 2 * XMODEM_BLOCK_SIZE
+#error "Restoring an archive writes flash pages from two XModem blocks"
+#endif
+
+bool MemoryArchiveDownloadBlock(void *Buffer, uint32_t BlockAddress, uint16_t ByteCount) {
+    uint8_t *BufPtr = (uint8_t *) Buffer;
+
+    if (BlockAddress >= MEMORY_ARCHIVE_SIZE) {
+        /* Every setting has been sent */
+        return false;
+    }
+
+    if (BlockAddress < MEMORY_ARCHIVE_IMAGE_OFFSET) {
+        /* Header and settings, padded with zeros up to the first image */
+        const MemoryArchiveHeaderType Header = {
+            .Magic = MEMORY_ARCHIVE_MAGIC,
+            .Version = MEMORY_ARCHIVE_VERSION,
+            .SettingsCount = SETTINGS_COUNT,
+            .ActiveSettingIdx = GlobalSettings.ActiveSettingIdx,
+            .EntrySize = sizeof(SettingsEntryType),
+            .SlotSize = MEMORY_SIZE_PER_SETTING,
+            .ImageOffset = MEMORY_ARCHIVE_IMAGE_OFFSET,
+            .ConfigurationLayout = ConfigurationGetLayoutCRC()
+        };
+
+        for (uint16_t i = 0; i < ByteCount; i++) {
+            uint32_t Offset = BlockAddress + i;
+
+            if (Offset < sizeof(Header)) {
+                BufPtr[i] = ((const uint8_t *) &Header)[Offset];
+            } else if (Offset < MEMORY_ARCHIVE_ENTRIES_END) {
+                BufPtr[i] = ((const uint8_t *) GlobalSettings.Settings)[Offset - sizeof(Header)];
+            } else {
+                BufPtr[i] = 0;
+            }
+        }
+    } else {
+        /* Straight from flash, ByteCount never reaches past the last image */
+        FlashRead(Buffer, BlockAddress - MEMORY_ARCHIVE_IMAGE_OFFSET, ByteCount);
+    }
+
+    return true;
+}
+
+/* What is needed of the header of the archive that is being restored. RESTORE
+ * receives it with XModemReceiveClassic, so every block has been checked and
+ * arrives once and in order. */
+static bool MemoryArchiveValid = false;
+static uint8_t MemoryArchiveSettingIdx;
+static uint8_t MemoryArchiveEntrySize;
+static uint16_t MemoryArchiveEntriesEnd;
+static uint16_t MemoryArchiveImageOffset;
+static uint32_t MemoryArchiveImagesEnd;
+
+/* The restored settings are only taken over once the whole archive has arrived.
+ * Until then they wait in the EEPROM, next to StoredSettings, to spare the SRAM. */
+static SettingsEntryType EEMEM MemoryArchiveSettings[SETTINGS_COUNT];
+
+bool MemoryArchiveUploadBlock(void *Buffer, uint32_t BlockAddress, uint16_t ByteCount) {
+    const uint8_t *BufPtr = (const uint8_t *) Buffer;
+
+    if (BlockAddress == 0) {
+        const MemoryArchiveHeaderType *Header = (const MemoryArchiveHeaderType *) Buffer;
+
+        /* The images have to be page aligned and as large as ours. Any other
+         * archive cancels the transfer before anything has been overwritten. */
+        MemoryArchiveValid = !memcmp(Header->Magic, MEMORY_ARCHIVE_MAGIC, sizeof(Header->Magic)) &&
+                             Header->Version == MEMORY_ARCHIVE_VERSION &&
+                             Header->SlotSize == MEMORY_SIZE_PER_SETTING &&
+                             Header->ConfigurationLayout == ConfigurationGetLayoutCRC() &&
+                             Header->ImageOffset % APP_SECTION_PAGE_SIZE == 0 &&
+                             Header->ImageOffset >= sizeof(*Header) + Header->SettingsCount * Header->EntrySize;
+
+        if (!MemoryArchiveValid) {
+            return false;
+        }
 
+        MemoryArchiveSettingIdx = Header->ActiveSettingIdx;
+        MemoryArchiveEntrySize = Header->EntrySize;
+        MemoryArchiveEntriesEnd = sizeof(*Header) + Header->SettingsCount * Header->EntrySize;
+        MemoryArchiveImageOffset = Header->ImageOffset;
+        MemoryArchiveImagesEnd = Header->ImageOffset + (uint32_t) Header->SettingsCount * MEMORY_SIZE_PER_SETTING;
+
+        WriteEEPBlock((uint16_t) MemoryArchiveSettings, GlobalSettings.Settings, sizeof(GlobalSettings.Settings));
+    }
+
+    if (!MemoryArchiveValid) {
+        /* Trailing blocks after the archive has been restored */
         return true;
     }
+
+    if (BlockAddress < MemoryArchiveEntriesEnd) {
+        /* Entries of a different firmware build are cut or keep our remaining fields.
+         * Bytes that continue in the buffer and in the EEPROM are written in one go. */
+        uint16_t RunStart = 0;
+        uint16_t RunLength = 0;
+        uint16_t RunAddress = 0;
+
+        for (uint16_t i = 0; i < ByteCount; i++) {
+            uint32_t Offset = BlockAddress + i;
+
+            if (Offset >= sizeof(MemoryArchiveHeaderType) && Offset < MemoryArchiveEntriesEnd) {
+                uint8_t Entry = (Offset - sizeof(MemoryArchiveHeaderType)) / MemoryArchiveEntrySize;
+                uint8_t Field = (Offset - sizeof(MemoryArchiveHeaderType)) % MemoryArchiveEntrySize;
+
+                if (Entry < SETTINGS_COUNT && Field < sizeof(SettingsEntryType)) {
+                    uint16_t Address = (uint16_t) &MemoryArchiveSettings[Entry] + Field;
+
+                    if (RunLength > 0 && (i != RunStart + RunLength || Address != RunAddress + RunLength)) {
+                        WriteEEPBlock(RunAddress, &BufPtr[RunStart], RunLength);
+                        RunLength = 0;
+                    }
+
+                    if (RunLength == 0) {
+                        RunStart = i;
+                        RunAddress = Address;
+                    }
+
+                    RunLength++;
+                }
+            }
+        }
+
+        if (RunLength > 0) {
+            WriteEEPBlock(RunAddress, &BufPtr[RunStart], RunLength);
+        }
+    } else if (BlockAddress >= MemoryArchiveImageOffset && BlockAddress < MemoryArchiveImagesEnd) {
+        uint32_t Address = BlockAddress - MemoryArchiveImageOffset;
+
+        if (Address < MEMORY_SIZE) {
+            /* Images of settings we do not have are skipped. A page is written once both
+             * of its blocks have arrived, the first one waits in XModemPrefetchBuffer. */
+            if (Address % APP_SECTION_PAGE_SIZE == 0) {
+                memcpy(XModemPrefetchBuffer, Buffer, XMODEM_BLOCK_SIZE);
+            } else {
+                uint16_t Word;
+
+                /* A running recall reads from flash */
+                MemoryAsyncFlush();
+
+                FlashWaitForSPM();
+                FlashEraseFlashBuffer();
+                FlashWaitForSPM();
+
+                for (uint16_t i = 0; i < APP_SECTION_PAGE_SIZE; i += 2) {
+                    const uint8_t *Data = (i < XMODEM_BLOCK_SIZE) ? &XModemPrefetchBuffer[i] : &BufPtr[i - XMODEM_BLOCK_SIZE];
+
+                    Word = ((uint16_t) Data[0] << 0) | ((uint16_t) Data[1] << 8);
+                    FlashLoadFlashWord(i, Word);
+                    FlashWaitForSPM();
+                }
+
+                FlashEraseWriteApplicationPage(FLASH_DATA_ADDR + Address - XMODEM_BLOCK_SIZE);
+                FlashWaitForSPM();
+            }
+        }
+    }
+
+    if (BlockAddress + ByteCount >= MemoryArchiveImagesEnd) {
+        /* Complete, activate the restored settings */
+        MemoryArchiveValid = false;
+        ReadEEPBlock((uint16_t) MemoryArchiveSettings, GlobalSettings.Settings, sizeof(GlobalSettings.Settings));
+        SettingsReload(SETTINGS_FIRST + (MemoryArchiveSettingIdx < SETTINGS_COUNT ? MemoryArchiveSettingIdx : 0));
+    }
+
+    return true;
 }
 
 // EEPROM functions
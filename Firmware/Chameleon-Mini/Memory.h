@@ -26,9 +26,40 @@ void MemoryClear(void);
 void MemoryRecall(void);
 void MemoryStore(void);
 
+/* Non-blocking FRAM transfers. Requests are queued and run by DMA one after the other,
+ * the optional callback is called from the DMA interrupt when a request has finished.
+ * Buffers must stay valid until then. Return false if the queue is full.
+ * All blocking memory functions wait for queued requests to finish first. */
+typedef void (*MemoryCallbackType)(void);
+
+#define MEMORY_ASYNC_QUEUE_SIZE		4
+
+bool MemoryReadBlockAsync(void *Buffer, uint16_t Address, uint16_t ByteCount, MemoryCallbackType Callback);
+bool MemoryWriteBlockAsync(const void *Buffer, uint16_t Address, uint16_t ByteCount, MemoryCallbackType Callback);
+bool MemoryAsyncBusy(void);
+void MemoryAsyncFlush(void);
+
+/* Write-back cache of FRAM lines in SRAM for small accesses to the working copy of the
+ * current setting. Dirty lines are written back by MemoryTick, outside of the time
+ * critical frame handling, and by MemoryStore (and thus on a setting change); uploads and
+ * MemoryRecall drop the affected lines. Set MEMORY_CACHE_LINES to 0
+ * to disable the cache. */
+#ifndef MEMORY_CACHE_LINES
+#define MEMORY_CACHE_LINES		8 /* Must be a power of 2 */
+#endif
+#define MEMORY_CACHE_LINE_SIZE		16
+
+void MemoryTick(void);
+void MemoryCacheWriteBack(void);
+void MemoryCacheGetStats(uint16_t *Hits, uint16_t *Misses);
+void MemoryCacheResetStats(void);
+
 /* For use with XModem */
 bool MemoryUploadBlock(void *Buffer, uint32_t BlockAddress, uint16_t ByteCount);
 bool MemoryDownloadBlock(void *Buffer, uint32_t BlockAddress, uint16_t ByteCount);
+/* All settings and their flash images in one archive, see BACKUP and RESTORE */
+bool MemoryArchiveUploadBlock(void *Buffer, uint32_t BlockAddress, uint16_t ByteCount);
+bool MemoryArchiveDownloadBlock(void *Buffer, uint32_t BlockAddress, uint16_t ByteCount);
 
 /* EEPROM functions */
 uint16_t WriteEEPBlock(uint16_t Address, const void *SrcPtr, uint16_t ByteCount);
@@ -0,0 +1,118 @@
+/*
+ * Profile.c
+ *
+ * Aggregation of the hot path measurements, see Profile.h.
+ */
+
+#include "Profile.h"
+
+#ifdef PROFILE_HOTPATHS
+
+#include <string.h>
+#include <util/atomic.h>
+
+static ProfileProbeType ProfileProbes[PROFILE_PROBE_COUNT];
+
+static const char PROGMEM ProfileNamePause[] = "PAUSE";
+static const char PROGMEM ProfileNameSample[] = "SAMPLE";
+static const char PROGMEM ProfileNameLoadmod[] = "LOADMOD";
+static const char PROGMEM ProfileNameTurnaround[] = "TURNAROUND";
+static const char PROGMEM ProfileNameAppProcess[] = "APP";
+static const char PROGMEM ProfileNameLogEntry[] = "LOG";
+static const char PROGMEM ProfileNameMemoryRead[] = "MEMRD";
+static const char PROGMEM ProfileNameMemoryWrite[] = "MEMWR";
+
+static const char *const PROGMEM ProfileNames[PROFILE_PROBE_COUNT] = {
+    [PROFILE_CODEC_PAUSE] = ProfileNamePause,
+    [PROFILE_CODEC_SAMPLE] = ProfileNameSample,
+    [PROFILE_CODEC_LOADMOD] = ProfileNameLoadmod,
+    [PROFILE_CODEC_TURNAROUND] = ProfileNameTurnaround,
+    [PROFILE_APP_PROCESS] = ProfileNameAppProcess,
+    [PROFILE_LOG_ENTRY] = ProfileNameLogEntry,
+    [PROFILE_MEMORY_READ] = ProfileNameMemoryRead,
+    [PROFILE_MEMORY_WRITE] = ProfileNameMemoryWrite,
+};
+
+void ProfileInit(void) {
+    ProfileReset();
+}
+
+void ProfileReset(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        memset(ProfileProbes, 0, sizeof(ProfileProbes));
+
+        for (uint8_t i = 0; i < PROFILE_PROBE_COUNT; i++)
+            ProfileProbes[i].Min = UINT16_MAX;
+
+        /* (Re)start the free running timer, the reader and sniffer codecs reprogram it */
+        PROFILE_TIMER.CTRLA = TC_CLKSEL_OFF_gc;
+        PROFILE_TIMER.CTRLB = TC_WGMODE_NORMAL_gc;
+        PROFILE_TIMER.CTRLD = TC_EVACT_OFF_gc;
+        PROFILE_TIMER.INTCTRLA = 0;
+        PROFILE_TIMER.INTCTRLB = 0;
+        PROFILE_TIMER.PER = 0xFFFF;
+        PROFILE_TIMER.CNT = 0;
+        PROFILE_TIMER.CTRLA = PROFILE_TIMER_CLKSEL;
+    }
+}
+
+void ProfileRecord(ProfileProbeEnum Probe, uint16_t Start) {
+    uint16_t Duration = ProfileTimestamp() - Start;
+    ProfileProbeType *Stats = &ProfileProbes[Probe];
+
+    /* Durations are split into buckets of powers of 4 */
+    uint8_t Bucket = 0;
+    uint16_t Scaled = Duration >> 2;
+
+    while (Scaled != 0 && Bucket < PROFILE_HISTOGRAM_SIZE - 1) {
+        Scaled >>= 2;
+        Bucket++;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        Stats->Count++;
+
+        if (Stats->SumCount == UINT16_MAX) {
+            Stats->Sum >>= 1;
+            Stats->SumCount >>= 1;
+        }
+
+        Stats->Sum += Duration;
+        Stats->SumCount++;
+
+        if (Duration < Stats->Min)
+            Stats->Min = Duration;
+
+        if (Duration > Stats->Max)
+            Stats->Max = Duration;
+
+        if (Stats->Histogram[Bucket] == UINT16_MAX) {
+            /* Keep the shape of the distribution */
+            for (uint8_t i = 0; i < PROFILE_HISTOGRAM_SIZE; i++)
+                Stats->Histogram[i] >>= 1;
+        }
+
+        Stats->Histogram[Bucket]++;
+    }
+}
+
+bool ProfileGetProbe(ProfileProbeEnum Probe, ProfileProbeType *Stats) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *Stats = ProfileProbes[Probe];
+    }
+
+    return Stats->Count != 0;
+}
+
+uint16_t ProfileGetMean(const ProfileProbeType *Stats) {
+    if (Stats->SumCount == 0)
+        return 0;
+
+    return Stats->Sum / Stats->SumCount;
+}
+
+const char *ProfileGetProbeNameP(ProfileProbeEnum Probe) {
+    return (const char *) pgm_read_ptr(&ProfileNames[Probe]);
+}
+
+#endif /* PROFILE_HOTPATHS */
@@ -0,0 +1,114 @@
+/*
+ * Profile.h
+ *
+ * Optional run time measurement of the time critical code paths, enabled
+ * with -DPROFILE_HOTPATHS in the Makefile. Every probe aggregates the
+ * durations between its start and stop marks (count, min, max, mean and a
+ * logarithmic histogram) in SRAM; the PROFILE terminal command reports and
+ * resets them. Without PROFILE_HOTPATHS all marks compile to nothing.
+ *
+ * The durations are taken from PROFILE_TIMER, which runs freely at
+ * F_CPU / PROFILE_TIMER_DIVIDER. The timer is shared with the reader and
+ * sniffer codecs, which reprogram it, so these configurations can not be
+ * profiled; `PROFILE` restarts it after switching back to card emulation.
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include "Common.h"
+
+typedef enum {
+    PROFILE_CODEC_PAUSE,        /* ISO14443-2A first modulation pause ISR */
+    PROFILE_CODEC_SAMPLE,       /* ISO14443-2A demodulation ISR, twice per bit */
+    PROFILE_CODEC_LOADMOD,      /* ISO14443-2A load modulation ISR, twice per bit */
+    PROFILE_CODEC_TURNAROUND,   /* ISO14443-2A end of reader frame until the answer is ready */
+    PROFILE_APP_PROCESS,        /* ApplicationProcessFunc of the active configuration */
+    PROFILE_LOG_ENTRY,          /* LogEntry */
+    PROFILE_MEMORY_READ,        /* MemoryReadBlock */
+    PROFILE_MEMORY_WRITE,       /* MemoryWriteBlock */
+    PROFILE_PROBE_COUNT
+} ProfileProbeEnum;
+
+/* Bucket i counts the durations below 4^(i+1) timer ticks, the last one all longer ones */
+#define PROFILE_HISTOGRAM_SIZE      8
+
+#ifdef PROFILE_HOTPATHS
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#define PROFILE_TIMER               TCD1 /* CODEC_TIMER_TIMESTAMPS */
+#ifndef PROFILE_TIMER_DIVIDER
+#define PROFILE_TIMER_DIVIDER       4
+#endif
+
+#if PROFILE_TIMER_DIVIDER == 1
+#define PROFILE_TIMER_CLKSEL        TC_CLKSEL_DIV1_gc
+#elif PROFILE_TIMER_DIVIDER == 2
+#define PROFILE_TIMER_CLKSEL        TC_CLKSEL_DIV2_gc
+#elif PROFILE_TIMER_DIVIDER == 4
+#define PROFILE_TIMER_CLKSEL        TC_CLKSEL_DIV4_gc
+#elif PROFILE_TIMER_DIVIDER == 8
+#define PROFILE_TIMER_CLKSEL        TC_CLKSEL_DIV8_gc
+#else
+#error "PROFILE_TIMER_DIVIDER has to be 1, 2, 4 or 8"
+#endif
+
+typedef struct {
+    uint32_t Count;
+    uint32_t Sum;           /* Sum over the last SumCount durations, halved together on overflow */
+    uint16_t SumCount;
+    uint16_t Min;
+    uint16_t Max;
+    uint16_t Histogram[PROFILE_HISTOGRAM_SIZE]; /* All buckets are halved when one saturates */
+} ProfileProbeType;
+
+/* The 16 bit timer register is read through the shared TEMP register,
+ * which an interrupt reading the same timer would clobber */
+INLINE uint16_t ProfileTimestamp(void) {
+    uint8_t SavedSREG = SREG;
+    cli();
+    uint16_t Timestamp = PROFILE_TIMER.CNT;
+    SREG = SavedSREG;
+
+    return Timestamp;
+}
+
+void ProfileInit(void);
+void ProfileReset(void);
+void ProfileRecord(ProfileProbeEnum Probe, uint16_t Start);
+/* Copy the statistics of a probe with interrupts disabled, returns false for an unused probe */
+bool ProfileGetProbe(ProfileProbeEnum Probe, ProfileProbeType *Stats);
+uint16_t ProfileGetMean(const ProfileProbeType *Stats);
+const char *ProfileGetProbeNameP(ProfileProbeEnum Probe);
+
+typedef struct {
+    uint8_t Probe;
+    uint16_t Start;
+} ProfileScopeType;
+
+INLINE void ProfileScopeExit(ProfileScopeType *Scope) {
+    ProfileRecord(Scope->Probe, Scope->Start);
+}
+
+/* Measures from here until the enclosing block is left by any return */
+#define PROFILE_SCOPE(Probe) \
+    ProfileScopeType __ProfileScope __attribute__((cleanup(ProfileScopeExit))) = { (Probe), ProfileTimestamp() }
+#define PROFILE_START(Var)          uint16_t Var = ProfileTimestamp()
+#define PROFILE_STOP(Probe, Var)    ProfileRecord((Probe), (Var))
+/* For measurements that start and stop in different functions */
+#define PROFILE_MARK(Var)           ((Var) = ProfileTimestamp())
+
+#else
+
+#define PROFILE_SCOPE(Probe)
+#define PROFILE_START(Var)
+#define PROFILE_STOP(Probe, Var)
+#define PROFILE_MARK(Var)
+
+INLINE void ProfileInit(void) { }
+
+#endif /* PROFILE_HOTPATHS */
+
+#endif /* PROFILE_H_ */
@@ -1,29 +1,123 @@
-#include <stdlib.h>
+/* Random numbers for nonces, challenges and random UIDs.
+ *
+ * An xorshift128 generator produces four bytes per step without any
+ * multiplication, which is expensive on the AVR. Its state is seeded from ADC
+ * noise and from the jitter between the RTC, clocked by the ULP oscillator, and
+ * the CPU clock. More samples are collected in an entropy pool and mixed into the
+ * state every 100 ms.
+ *
+ * RandomTask keeps RandomBuffer filled from the main loop, so that RandomGetBuffer
+ * only has to copy bytes while a reader waits for a nonce. */
 
 #include "Random.h"
 #include "System.h"
+#include "AntennaLevel.h"
+#include "Codec/Codec.h"
+
+#define RANDOM_SEED_SAMPLES	8
+
+/* Nonzero start values of the reference implementation, the seed is mixed in */
+static uint32_t RandomState[4] = { 123456789, 362436069, 521288629, 88675123 };
+static uint32_t RandomPool = 0;
+static uint8_t RandomMixIdx = 0;
+
+static uint8_t RandomBuffer[RANDOM_BUFFER_SIZE];
+static uint8_t RandomBufferCount = 0;
+
+INLINE uint32_t RandomNext(void) {
+    uint32_t t = RandomState[0] ^ (RandomState[0] << 11);
+
+    RandomState[0] = RandomState[1];
+    RandomState[1] = RandomState[2];
+    RandomState[2] = RandomState[3];
+    RandomState[3] ^= (RandomState[3] >> 19) ^ t ^ (t >> 8);
+
+    return RandomState[3];
+}
+
+INLINE void RandomFill(void) {
+    /* One step of the generator appends four bytes */
+    uint32_t Value = RandomNext();
+
+    RandomBuffer[RandomBufferCount++] = (Value >> 0) & 0xFF;
+    RandomBuffer[RandomBufferCount++] = (Value >> 8) & 0xFF;
+    RandomBuffer[RandomBufferCount++] = (Value >> 16) & 0xFF;
+    RandomBuffer[RandomBufferCount++] = (Value >> 24) & 0xFF;
+}
+
+static void RandomMixPool(void) {
+    RandomState[RandomMixIdx] ^= RandomPool;
+    RandomMixIdx = (RandomMixIdx + 1) % 4;
+
+    if ((RandomState[0] | RandomState[1] | RandomState[2] | RandomState[3]) == 0) {
+        /* The only state xorshift never leaves */
+        RandomState[0] = 1;
+    }
+}
+
+static uint16_t RandomClockJitter(void) {
+    /* Count loop iterations until the RTC advances. Both clocks come from independent
+     * oscillators, so the count varies from run to run. Takes up to 1 ms. */
+    uint16_t Count = 0;
+    uint16_t Start = RTC.CNT;
+
+    while (RTC.CNT == Start) {
+        Count++;
+    }
+
+    return Count;
+}
 
 void RandomInit(void) {
-    uint32_t randomSeed = (uint32_t)((uint32_t)(SystemGetSysTick() + 768) |
-                                     ((uint32_t)(SystemGetSysTick() % 512) << 20));
-    srand(randomSeed);
+    /* Needs AntennaLevelInit */
+    for (uint8_t i = 0; i < RANDOM_SEED_SAMPLES; i++) {
+        RandomAddEntropy(RandomClockJitter());
+        RandomAddEntropy(AntennaLevelGet());
+        RandomMixPool();
+    }
+
+    RandomBufferCount = 0;
 }
 
 uint8_t RandomGetByte(void) {
-    return rand() & 0xFF;
+    uint8_t Byte;
+
+    RandomGetBuffer(&Byte, sizeof(Byte));
+
+    return Byte;
 }
 
 void RandomGetBuffer(void *Buffer, uint8_t ByteCount) {
     uint8_t *BufferPtr = (uint8_t *) Buffer;
 
+    /* When a reader asks for a nonce is up to the reader */
+    RandomAddEntropy(RTC.CNT);
+
     while (ByteCount--) {
-        *BufferPtr++ = RandomGetByte();
+        if (RandomBufferCount == 0) {
+            /* More bytes asked for than RandomTask had ready */
+            RandomFill();
+        }
+
+        *BufferPtr++ = RandomBuffer[--RandomBufferCount];
+    }
+}
+
+void RandomAddEntropy(uint16_t Sample) {
+    /* Rotate, so that the noisy low bits of consecutive samples end up in different places */
+    RandomPool = ((RandomPool << 7) | (RandomPool >> 25)) ^ Sample;
+}
+
+void RandomTask(void) {
+    if (RandomBufferCount <= RANDOM_BUFFER_SIZE - 4) {
+        RandomFill();
     }
 }
 
 void RandomTick(void) {
-    rand();
-    rand();
-    rand();
-    rand();
+    /* Result of the previous antenna level measurement and, while a codec is
+     * active, the phase of the sampling timer that runs off the reader field */
+    RandomAddEntropy(ADCA.CH0RES);
+    RandomAddEntropy(CODEC_TIMER_SAMPLING.CNT);
+    RandomMixPool();
 }
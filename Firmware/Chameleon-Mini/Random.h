@@ -10,9 +10,15 @@
 
 #include "Common.h"
 
+/* Generated bytes kept ready for nonces and challenges, a multiple of 4.
+ * Enough for two AES challenges of DESFire or eight MIFARE Classic nonces. */
+#define RANDOM_BUFFER_SIZE	32
+
 void RandomInit(void);
 uint8_t RandomGetByte(void);
 void RandomGetBuffer(void *Buffer, uint8_t ByteCount);
+void RandomAddEntropy(uint16_t Sample);
+void RandomTask(void);
 void RandomTick(void);
 
 #endif /* RANDOM_H_ */
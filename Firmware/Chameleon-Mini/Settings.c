@@ -93,6 +93,24 @@ bool SettingsSetActiveById(uint8_t Setting) {
     }
 }
 
+void SettingsReload(uint8_t Setting) {
+    /* All settings and flash images have been replaced at once (RESTORE). Unlike on
+     * a setting change, the working copy in FRAM is outdated and must not be stored. */
+    uint8_t SettingIdx = SETTING_TO_INDEX(Setting);
+
+    GlobalSettings.ActiveSettingIdx = SettingIdx;
+    GlobalSettings.ActiveSettingPtr = &GlobalSettings.Settings[SettingIdx];
+
+    MemoryRecall();
+
+    ConfigurationSetById(GlobalSettings.ActiveSettingPtr->Configuration, false);
+    LogSetModeById(GlobalSettings.ActiveSettingPtr->LogMode);
+
+    SettingsSave();
+
+    LEDHook(LED_SETTING_CHANGE, LED_BLINK + SettingIdx);
+}
+
 uint8_t SettingsGetActiveById(void) {
     return INDEX_TO_SETTING(GlobalSettings.ActiveSettingIdx);
 }
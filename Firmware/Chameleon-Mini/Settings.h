@@ -74,6 +74,7 @@ void SettingsSave(void);
 
 void SettingsCycle(void);
 bool SettingsSetActiveById(uint8_t Setting);
+void SettingsReload(uint8_t Setting);
 uint8_t SettingsGetActiveById(void);
 void SettingsGetActiveByName(char *SettingOut, uint16_t BufferSize);
 bool SettingsSetActiveByName(const char *Setting);
@@ -36,97 +36,139 @@
 #define STATUS_MESSAGE_TRAILER    "\r\n"
 #define OPTIONAL_ANSWER_TRAILER   "\r\n"
 
+/* A batch that stalls for this long is dropped */
+#define BATCH_TIMEOUT_MS          1000
+
 /* Include all command functions */
 #include "Commands.h"
 
+/*
+ * NOTE: The entries are sorted by their command name (in strcmp order,
+ *       i.e. '_' after the letters), since FindCommandEntry() performs a
+ *       binary search on the table. New commands, also those that are
+ *       included from other files, have to be inserted at their place
+ *       and not just appended. Conditionally compiled entries do not
+ *       break the order. The empty terminating entry is not searched.
+ */
 const PROGMEM CommandEntryType CommandTable[] = {
     {
-        .Command    = COMMAND_VERSION,
-        .ExecFunc   = NO_FUNCTION,
+        .Command    = COMMAND_AUTOCALIBRATE,
+        .ExecFunc   = CommandExecAutocalibrate,
         .ExecParamFunc = NO_FUNCTION,
         .SetFunc    = NO_FUNCTION,
-        .GetFunc    = CommandGetVersion,
+        .GetFunc    = NO_FUNCTION
     },
+#ifdef CONFIG_ISO15693_SNIFF_SUPPORT
     {
-        .Command    = COMMAND_CONFIG,
-        .ExecFunc   = NO_FUNCTION,
+        .Command        = COMMAND_AUTOTHRESHOLD,
+        .ExecFunc       = NO_FUNCTION,
+        .ExecParamFunc  = NO_FUNCTION,
+        .SetFunc        = CommandSetAutoThreshold,
+        .GetFunc        = CommandGetAutoThreshold
+    },
+#endif
+    {
+        .Command    = COMMAND_BACKUP,
+        .ExecFunc   = CommandExecBackup,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc    = CommandSetConfig,
-        .GetFunc    = CommandGetConfig
+        .SetFunc    = NO_FUNCTION,
+        .GetFunc    = NO_FUNCTION
     },
     {
-        .Command    = COMMAND_UID,
-        .ExecFunc   = NO_FUNCTION,
+        .Command	= COMMAND_BATCH,
+        .ExecFunc	= CommandExecBatch,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc    = CommandSetUid,
-        .GetFunc    = CommandGetUid
+        .SetFunc	= NO_FUNCTION,
+        .GetFunc	= NO_FUNCTION
     },
     {
-        .Command    = COMMAND_READONLY,
+        .Command    = COMMAND_CHARGING,
         .ExecFunc   = NO_FUNCTION,
         .ExecParamFunc = NO_FUNCTION,
-        .GetFunc    = CommandGetReadOnly,
-        .SetFunc    = CommandSetReadOnly
-
+        .SetFunc    = NO_FUNCTION,
+        .GetFunc    = CommandGetCharging
     },
     {
-        .Command    = COMMAND_UPLOAD,
-        .ExecFunc   = CommandExecUpload,
+        .Command	= COMMAND_CLEAR,
+        .ExecFunc	= CommandExecClear,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc    = NO_FUNCTION,
-        .GetFunc    = NO_FUNCTION
+        .SetFunc	= NO_FUNCTION,
+        .GetFunc	= NO_FUNCTION
+    },
+#ifdef CONFIG_ISO14443A_READER_SUPPORT
+    {
+        .Command        = COMMAND_CLONE,
+        .ExecFunc       = CommandExecClone,
+        .ExecParamFunc  = NO_FUNCTION,
+        .SetFunc        = NO_FUNCTION,
+        .GetFunc        = NO_FUNCTION
     },
     {
-        .Command    = COMMAND_DOWNLOAD,
-        .ExecFunc   = CommandExecDownload,
+        .Command	= COMMAND_CLONE_MFU,
+        .ExecFunc 	= CommandExecCloneMFU,
+        .ExecParamFunc  = NO_FUNCTION,
+        .SetFunc 	= NO_FUNCTION,
+        .GetFunc 	= NO_FUNCTION
+    },
+#endif
+    {
+        .Command    = COMMAND_CONFIG,
+        .ExecFunc   = NO_FUNCTION,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc    = NO_FUNCTION,
-        .GetFunc    = NO_FUNCTION
+        .SetFunc    = CommandSetConfig,
+        .GetFunc    = CommandGetConfig
     },
+#if defined(CONFIG_MF_DESFIRE_SUPPORT) && !defined(DISABLE_DESFIRE_TERMINAL_COMMANDS)
+#include "../Application/DESFire/DESFireChameleonTerminalInclude.c"
+#endif
     {
-        .Command    = COMMAND_RESET,
-        .ExecFunc   = CommandExecReset,
+        .Command    = COMMAND_DOWNLOAD,
+        .ExecFunc   = CommandExecDownload,
         .ExecParamFunc = NO_FUNCTION,
         .SetFunc    = NO_FUNCTION,
         .GetFunc    = NO_FUNCTION
     },
-#ifdef SUPPORT_FIRMWARE_UPGRADE
+#ifdef CONFIG_ISO14443A_READER_SUPPORT
     {
-        .Command    = COMMAND_UPGRADE,
-        .ExecFunc   = CommandExecUpgrade,
+        .Command	= COMMAND_DUMP_MFU,
+        .ExecFunc 	= CommandExecDumpMFU,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc    = NO_FUNCTION,
-        .GetFunc    = NO_FUNCTION
+        .SetFunc 	= NO_FUNCTION,
+        .GetFunc 	= NO_FUNCTION
     },
 #endif
     {
-        .Command    = COMMAND_MEMSIZE,
+        .Command    = COMMAND_FIELD,
         .ExecFunc   = NO_FUNCTION,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc    = NO_FUNCTION,
-        .GetFunc    = CommandGetMemSize
+        .SetFunc    = CommandSetField,
+        .GetFunc    = CommandGetField
     },
+#ifdef CONFIG_ISO14443A_READER_SUPPORT
     {
-        .Command    = COMMAND_UIDSIZE,
-        .ExecFunc   = NO_FUNCTION,
+        .Command	= COMMAND_GETUID,
+        .ExecFunc 	= CommandExecGetUid,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc    = NO_FUNCTION,
-        .GetFunc    = CommandGetUidSize
+        .SetFunc 	= NO_FUNCTION,
+        .GetFunc 	= NO_FUNCTION
     },
+#endif
     {
-        .Command    = COMMAND_RBUTTON,
-        .ExecFunc   = NO_FUNCTION,
+        .Command    = COMMAND_HELP,
+        .ExecFunc   = CommandExecHelp,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc    = CommandSetRButton,
-        .GetFunc    = CommandGetRButton
+        .SetFunc    = NO_FUNCTION,
+        .GetFunc    = NO_FUNCTION
     },
+#ifdef CONFIG_ISO14443A_READER_SUPPORT
     {
-        .Command    = COMMAND_RBUTTON_LONG,
-        .ExecFunc   = NO_FUNCTION,
+        .Command	= COMMAND_IDENTIFY_CARD,
+        .ExecFunc 	= CommandExecIdentifyCard,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc    = CommandSetRButtonLong,
-        .GetFunc    = CommandGetRButtonLong
+        .SetFunc 	= NO_FUNCTION,
+        .GetFunc 	= NO_FUNCTION
     },
+#endif
     {
         .Command    = COMMAND_LBUTTON,
         .ExecFunc   = NO_FUNCTION,
@@ -156,18 +198,18 @@ const PROGMEM CommandEntryType CommandTable[] = {
         .GetFunc    = CommandGetLedRed
     },
     {
-        .Command    = COMMAND_PIN,
-        .ExecFunc   = NO_FUNCTION,
+        .Command    = COMMAND_LOGCLEAR,
+        .ExecFunc   = CommandExecLogClear,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc    = CommandSetPin,
-        .GetFunc    = CommandGetPin
+        .SetFunc    = NO_FUNCTION,
+        .GetFunc    = NO_FUNCTION
     },
     {
-        .Command    = COMMAND_LOGMODE,
-        .ExecFunc   = NO_FUNCTION,
+        .Command    = COMMAND_LOGDOWNLOAD,
+        .ExecFunc   = CommandExecLogDownload,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc    = CommandSetLogMode,
-        .GetFunc    = CommandGetLogMode
+        .SetFunc    = NO_FUNCTION,
+        .GetFunc    = NO_FUNCTION
     },
     {
         .Command    = COMMAND_LOGMEM,
@@ -177,11 +219,11 @@ const PROGMEM CommandEntryType CommandTable[] = {
         .GetFunc    = CommandGetLogMem
     },
     {
-        .Command    = COMMAND_LOGDOWNLOAD,
-        .ExecFunc   = CommandExecLogDownload,
+        .Command    = COMMAND_LOGMODE,
+        .ExecFunc   = NO_FUNCTION,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc    = NO_FUNCTION,
-        .GetFunc    = NO_FUNCTION
+        .SetFunc    = CommandSetLogMode,
+        .GetFunc    = CommandGetLogMode
     },
     {
         .Command    = COMMAND_STORELOG,
@@ -191,32 +233,56 @@ const PROGMEM CommandEntryType CommandTable[] = {
         .GetFunc    = NO_FUNCTION
     },
     {
-        .Command    = COMMAND_LOGCLEAR,
-        .ExecFunc   = CommandExecLogClear,
+        .Command	= COMMAND_MEMCACHE,
+        .ExecFunc 	= CommandExecMemCache,
+        .ExecParamFunc = NO_FUNCTION,
+        .SetFunc 	= NO_FUNCTION,
+        .GetFunc 	= CommandGetMemCache
+    },
+    {
+        .Command    = COMMAND_MEMSIZE,
+        .ExecFunc   = NO_FUNCTION,
         .ExecParamFunc = NO_FUNCTION,
         .SetFunc    = NO_FUNCTION,
-        .GetFunc    = NO_FUNCTION
+        .GetFunc    = CommandGetMemSize
     },
     {
-        .Command	= COMMAND_SETTING,
-        .ExecFunc	= NO_FUNCTION,
+        .Command    = COMMAND_PIN,
+        .ExecFunc   = NO_FUNCTION,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc	= CommandSetSetting,
-        .GetFunc	= CommandGetSetting
+        .SetFunc    = CommandSetPin,
+        .GetFunc    = CommandGetPin
     },
+#ifdef PROFILE_HOTPATHS
     {
-        .Command	= COMMAND_CLEAR,
-        .ExecFunc	= CommandExecClear,
+        .Command	= COMMAND_PROFILE,
+        .ExecFunc 	= CommandExecProfile,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc	= NO_FUNCTION,
-        .GetFunc	= NO_FUNCTION
+        .SetFunc 	= NO_FUNCTION,
+        .GetFunc 	= CommandGetProfile
     },
+#endif
     {
-        .Command	= COMMAND_STORE,
-        .ExecFunc	= CommandExecStore,
+        .Command    = COMMAND_RBUTTON,
+        .ExecFunc   = NO_FUNCTION,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc	= NO_FUNCTION,
-        .GetFunc	= NO_FUNCTION
+        .SetFunc    = CommandSetRButton,
+        .GetFunc    = CommandGetRButton
+    },
+    {
+        .Command    = COMMAND_RBUTTON_LONG,
+        .ExecFunc   = NO_FUNCTION,
+        .ExecParamFunc = NO_FUNCTION,
+        .SetFunc    = CommandSetRButtonLong,
+        .GetFunc    = CommandGetRButtonLong
+    },
+    {
+        .Command    = COMMAND_READONLY,
+        .ExecFunc   = NO_FUNCTION,
+        .ExecParamFunc = NO_FUNCTION,
+        .GetFunc    = CommandGetReadOnly,
+        .SetFunc    = CommandSetReadOnly
+
     },
     {
         .Command	= COMMAND_RECALL,
@@ -226,15 +292,15 @@ const PROGMEM CommandEntryType CommandTable[] = {
         .GetFunc	= NO_FUNCTION
     },
     {
-        .Command    = COMMAND_CHARGING,
-        .ExecFunc   = NO_FUNCTION,
+        .Command    = COMMAND_RESET,
+        .ExecFunc   = CommandExecReset,
         .ExecParamFunc = NO_FUNCTION,
         .SetFunc    = NO_FUNCTION,
-        .GetFunc    = CommandGetCharging
+        .GetFunc    = NO_FUNCTION
     },
     {
-        .Command    = COMMAND_HELP,
-        .ExecFunc   = CommandExecHelp,
+        .Command    = COMMAND_RESTORE,
+        .ExecFunc   = CommandExecRestore,
         .ExecParamFunc = NO_FUNCTION,
         .SetFunc    = NO_FUNCTION,
         .GetFunc    = NO_FUNCTION
@@ -246,57 +312,53 @@ const PROGMEM CommandEntryType CommandTable[] = {
         .SetFunc 	= NO_FUNCTION,
         .GetFunc 	= CommandGetRssi
     },
-    {
-        .Command	= COMMAND_SYSTICK,
-        .ExecFunc 	= NO_FUNCTION,
-        .ExecParamFunc = NO_FUNCTION,
-        .SetFunc 	= NO_FUNCTION,
-        .GetFunc 	= CommandGetSysTick
-    },
+#ifdef ENABLE_RUNTESTS_TERMINAL_COMMAND
+#include "../Tests/ChameleonTerminalInclude.c"
+#endif
 #ifdef CONFIG_ISO14443A_READER_SUPPORT
     {
-        .Command	= COMMAND_SEND_RAW,
+        .Command	= COMMAND_SEND,
         .ExecFunc 	= NO_FUNCTION,
-        .ExecParamFunc = CommandExecParamSendRaw,
+        .ExecParamFunc = CommandExecParamSend,
         .SetFunc 	= NO_FUNCTION,
         .GetFunc 	= NO_FUNCTION
     },
     {
-        .Command	= COMMAND_SEND,
+        .Command	= COMMAND_SEND_RAW,
         .ExecFunc 	= NO_FUNCTION,
-        .ExecParamFunc = CommandExecParamSend,
+        .ExecParamFunc = CommandExecParamSendRaw,
         .SetFunc 	= NO_FUNCTION,
         .GetFunc 	= NO_FUNCTION
     },
+#endif
     {
-        .Command	= COMMAND_GETUID,
-        .ExecFunc 	= CommandExecGetUid,
+        .Command	= COMMAND_SETTING,
+        .ExecFunc	= NO_FUNCTION,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc 	= NO_FUNCTION,
-        .GetFunc 	= NO_FUNCTION
+        .SetFunc	= CommandSetSetting,
+        .GetFunc	= CommandGetSetting
     },
     {
-        .Command	= COMMAND_DUMP_MFU,
-        .ExecFunc 	= CommandExecDumpMFU,
+        .Command	= COMMAND_STORE,
+        .ExecFunc	= CommandExecStore,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc 	= NO_FUNCTION,
-        .GetFunc 	= NO_FUNCTION
+        .SetFunc	= NO_FUNCTION,
+        .GetFunc	= NO_FUNCTION
     },
     {
-        .Command	= COMMAND_CLONE_MFU,
-        .ExecFunc 	= CommandExecCloneMFU,
-        .ExecParamFunc  = NO_FUNCTION,
+        .Command	= COMMAND_SYSTICK,
+        .ExecFunc 	= NO_FUNCTION,
+        .ExecParamFunc = NO_FUNCTION,
         .SetFunc 	= NO_FUNCTION,
-        .GetFunc 	= NO_FUNCTION
+        .GetFunc 	= CommandGetSysTick
     },
     {
-        .Command	= COMMAND_IDENTIFY_CARD,
-        .ExecFunc 	= CommandExecIdentifyCard,
+        .Command	= COMMAND_THRESHOLD,
+        .ExecFunc 	= NO_FUNCTION,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc 	= NO_FUNCTION,
-        .GetFunc 	= NO_FUNCTION
+        .SetFunc 	= CommandSetThreshold,
+        .GetFunc 	= CommandGetThreshold
     },
-#endif
     {
         .Command	= COMMAND_TIMEOUT,
         .ExecFunc 	= NO_FUNCTION,
@@ -305,50 +367,42 @@ const PROGMEM CommandEntryType CommandTable[] = {
         .GetFunc 	= CommandGetTimeout
     },
     {
-        .Command	= COMMAND_THRESHOLD,
-        .ExecFunc 	= NO_FUNCTION,
+        .Command    = COMMAND_UID,
+        .ExecFunc   = NO_FUNCTION,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc 	= CommandSetThreshold,
-        .GetFunc 	= CommandGetThreshold
+        .SetFunc    = CommandSetUid,
+        .GetFunc    = CommandGetUid
     },
     {
-        .Command    = COMMAND_AUTOCALIBRATE,
-        .ExecFunc   = CommandExecAutocalibrate,
+        .Command    = COMMAND_UIDSIZE,
+        .ExecFunc   = NO_FUNCTION,
         .ExecParamFunc = NO_FUNCTION,
         .SetFunc    = NO_FUNCTION,
-        .GetFunc    = NO_FUNCTION
+        .GetFunc    = CommandGetUidSize
     },
+#ifdef SUPPORT_FIRMWARE_UPGRADE
     {
-        .Command    = COMMAND_FIELD,
-        .ExecFunc   = NO_FUNCTION,
+        .Command    = COMMAND_UPGRADE,
+        .ExecFunc   = CommandExecUpgrade,
         .ExecParamFunc = NO_FUNCTION,
-        .SetFunc    = CommandSetField,
-        .GetFunc    = CommandGetField
+        .SetFunc    = NO_FUNCTION,
+        .GetFunc    = NO_FUNCTION
     },
-#ifdef CONFIG_ISO14443A_READER_SUPPORT
+#endif
     {
-        .Command        = COMMAND_CLONE,
-        .ExecFunc       = CommandExecClone,
-        .ExecParamFunc  = NO_FUNCTION,
-        .SetFunc        = NO_FUNCTION,
-        .GetFunc        = NO_FUNCTION
+        .Command    = COMMAND_UPLOAD,
+        .ExecFunc   = CommandExecUpload,
+        .ExecParamFunc = NO_FUNCTION,
+        .SetFunc    = NO_FUNCTION,
+        .GetFunc    = NO_FUNCTION
     },
-#endif
-#ifdef CONFIG_ISO15693_SNIFF_SUPPORT
     {
-        .Command        = COMMAND_AUTOTHRESHOLD,
-        .ExecFunc       = NO_FUNCTION,
-        .ExecParamFunc  = NO_FUNCTION,
-        .SetFunc        = CommandSetAutoThreshold,
-        .GetFunc        = CommandGetAutoThreshold
+        .Command    = COMMAND_VERSION,
+        .ExecFunc   = NO_FUNCTION,
+        .ExecParamFunc = NO_FUNCTION,
+        .SetFunc    = NO_FUNCTION,
+        .GetFunc    = CommandGetVersion,
     },
-#endif
-#ifdef ENABLE_RUNTESTS_TERMINAL_COMMAND
-#include "../Tests/ChameleonTerminalInclude.c"
-#endif
-#if defined(CONFIG_MF_DESFIRE_SUPPORT) && !defined(DISABLE_DESFIRE_TERMINAL_COMMANDS)
-#include "../Application/DESFire/DESFireChameleonTerminalInclude.c"
-#endif
     {
         /* This has to be last element */
         .Command    = COMMAND_LIST_END,
@@ -385,6 +439,37 @@ void (*CommandLinePendingTaskTimeout)(void) = NO_FUNCTION;  // gets called on Ti
 static bool TaskPending = false;
 static uint16_t TaskPendingSince;
 
+/*
+ * Batch mode: `BATCH` is answered with `100:OK`, after which the host sends
+ * a binary frame
+ *   <Count> Count * { <Length> <Command line, Length bytes, without CR> }
+ * which may directly follow the CR of `BATCH`. Every command is run as soon
+ * as it is complete, and its result is sent as one record of the response
+ * frame
+ *   Count * { <Status ID> <Length, 16 bit little endian> <Answer, Length bytes> }
+ * so that the host can stream all commands without waiting for each answer.
+ * The top bit of Length (BATCH_LENGTH_TRUNCATED) takes the place of the
+ * `--TRUNCATED OUTPUT--` line: the answer did not fit into the terminal buffer.
+ * A command that hands the terminal over, i.e. that answers with
+ * COMMAND_INFO_XMODEM_WAIT_ID or is a timeout command (TIMEOUT_COMMAND),
+ * ends the response frame. The rest of the request frame is discarded
+ * before the XMODEM transfer or the pending task sees any input.
+ */
+typedef enum {
+    BATCH_IDLE,
+    BATCH_COUNT,
+    BATCH_LENGTH,
+    BATCH_COMMAND,
+} BatchStateEnum;
+
+#define BATCH_LENGTH_TRUNCATED    0x8000
+
+static BatchStateEnum BatchState = BATCH_IDLE;
+static uint8_t BatchCommandsLeft;
+static uint8_t BatchBytesLeft;
+static bool BatchDiscard;
+static uint16_t BatchLastByteTick;
+
 static const char *GetStatusMessageP(CommandStatusIdType StatusId) {
     uint8_t i;
 
@@ -435,20 +520,35 @@ static CommandStatusIdType CallCommandFunc(
     return Status;
 }
 
-void CommandExecute(const char *command) {
-    uint8_t i;
+static const CommandEntryType *FindCommandEntry(const char *Command) {
+    uint8_t Lower = 0, Upper = ARRAY_COUNT(CommandTable) - 1; /* Without COMMAND_LIST_END */
 
-    for (i = 0; i < ARRAY_COUNT(CommandTable); i++) {
-        if (strcmp_P(command, CommandTable[i].Command) == 0) {
-            CallCommandFunc(&CommandTable[i], CHAR_EXEC_MODE, NULL);
-            break;
-        }
+    while (Lower < Upper) {
+        uint8_t Middle = Lower + (Upper - Lower) / 2;
+        int Comparison = strcmp_P(Command, CommandTable[Middle].Command);
+
+        if (Comparison == 0)
+            return &CommandTable[Middle];
+        else if (Comparison > 0)
+            Lower = Middle + 1;
+        else
+            Upper = Middle;
     }
+
+    return NULL;
 }
 
-static void DecodeCommand(void) {
-    uint8_t i;
-    bool CommandFound = false;
+void CommandExecute(const char *command) {
+    const CommandEntryType *CommandEntry = FindCommandEntry(command);
+
+    if (CommandEntry != NULL)
+        CallCommandFunc(CommandEntry, CHAR_EXEC_MODE, NULL);
+}
+
+/* Runs the command line in the terminal buffer, which afterwards holds the
+ * optional answer or is empty */
+static CommandStatusIdType RunCommandLine(void) {
+    const CommandEntryType *CommandEntry;
     CommandStatusIdType StatusId = COMMAND_ERR_UNKNOWN_CMD_ID;
     char *pTerminalBuffer = (char *) TerminalBuffer;
 
@@ -465,21 +565,27 @@ static void DecodeCommand(void) {
         *pCommandDelimiter = '\0';
 
         /* Search in command table */
-        for (i = 0; i < ARRAY_COUNT(CommandTable); i++) {
-            if (strcmp_P(pTerminalBuffer, CommandTable[i].Command) == 0) {
-                /* Command found. Clear buffer, and call appropriate function */
-                char *pParam = ++pCommandDelimiter;
+        CommandEntry = FindCommandEntry(pTerminalBuffer);
 
-                pTerminalBuffer[0] = '\0';
-                CommandFound = true;
+        if (CommandEntry != NULL) {
+            /* Command found. Clear buffer, and call appropriate function */
+            char *pParam = ++pCommandDelimiter;
 
-                StatusId = CallCommandFunc(&CommandTable[i], CommandDelimiter, pParam);
+            pTerminalBuffer[0] = '\0';
 
-                break;
-            }
+            return CallCommandFunc(CommandEntry, CommandDelimiter, pParam);
         }
     }
 
+    pTerminalBuffer[0] = '\0';
+
+    return StatusId;
+}
+
+static void DecodeCommand(void) {
+    CommandStatusIdType StatusId = RunCommandLine();
+    char *pTerminalBuffer = (char *) TerminalBuffer;
+
     if (StatusId == TIMEOUT_COMMAND) // it is a timeout command, so we return
         return;
 
@@ -487,7 +593,7 @@ static void DecodeCommand(void) {
     TerminalSendStringP(GetStatusMessageP(StatusId));
     TerminalSendStringP(PSTR(STATUS_MESSAGE_TRAILER));
 
-    if (CommandFound && (pTerminalBuffer[0] != '\0')) {
+    if (pTerminalBuffer[0] != '\0') {
         /* Send optional answer */
         TerminalSendString(pTerminalBuffer);
         TerminalSendStringP(PSTR(OPTIONAL_ANSWER_TRAILER));
@@ -503,8 +609,94 @@ static void DecodeCommand(void) {
     }
 }
 
+static void SendBatchRecord(CommandStatusIdType StatusId, uint16_t Length) {
+    /* Same condition as the --TRUNCATED OUTPUT-- notice of DecodeCommand */
+    uint16_t LengthField = (Length + 1 >= TERMINAL_BUFFER_SIZE) ? (Length | BATCH_LENGTH_TRUNCATED) : Length;
+
+    TerminalSendByte(StatusId);
+    TerminalSendByte((LengthField >> 0) & 0xFF);
+    TerminalSendByte((LengthField >> 8) & 0xFF);
+    TerminalSendBlock(TerminalBuffer, Length);
+}
+
+static void RunBatchCommand(void) {
+    CommandStatusIdType StatusId;
+
+    TerminalBuffer[TerminalBufferIdx] = '\0';
+    TerminalBufferIdx = 0;
+
+    StatusId = RunCommandLine();
+
+    if (StatusId == TIMEOUT_COMMAND) {
+        /* The answer follows as a regular status line when the task has finished */
+        SendBatchRecord(StatusId, 0);
+        BatchDiscard = true;
+    } else {
+        SendBatchRecord(StatusId, strnlen((char *) TerminalBuffer, TERMINAL_BUFFER_SIZE - 1));
+        BatchDiscard = (StatusId == COMMAND_INFO_XMODEM_WAIT_ID);
+    }
+}
+
+bool CommandLineBatchStart(void) {
+    if (BatchState != BATCH_IDLE)
+        return false;
+
+    BatchState = BATCH_COUNT;
+    BatchDiscard = false;
+    BatchLastByteTick = SystemGetSysTick();
+
+    return true;
+}
+
+bool CommandLineBatchProcessByte(uint8_t Byte) {
+    if (BatchState == BATCH_IDLE)
+        return false;
+
+    switch (BatchState) {
+        case BATCH_COUNT:
+            BatchCommandsLeft = Byte;
+            BatchState = BATCH_LENGTH;
+            break;
+
+        case BATCH_LENGTH:
+            BatchBytesLeft = Byte;
+            TerminalBufferIdx = 0;
+            BatchState = BATCH_COMMAND;
+            break;
+
+        case BATCH_COMMAND:
+            BatchBytesLeft--;
+
+            /* Same filtering as on the command line */
+            if (!BatchDiscard && IS_CHARACTER(Byte) && TerminalBufferIdx < TERMINAL_BUFFER_SIZE - 1)
+                TerminalBuffer[TerminalBufferIdx++] = IS_LOWERCASE(Byte) ? TO_UPPERCASE(Byte) : Byte;
+            break;
+
+        default:
+            break;
+    }
+
+    /* An empty command line is complete right after its length */
+    if (BatchState == BATCH_COMMAND && BatchBytesLeft == 0) {
+        if (!BatchDiscard)
+            RunBatchCommand();
+
+        BatchCommandsLeft--;
+        BatchState = BATCH_LENGTH;
+    }
+
+    if (BatchState == BATCH_LENGTH && BatchCommandsLeft == 0)
+        BatchState = BATCH_IDLE;
+
+    /* Taken after the command has run, which may have taken a while */
+    BatchLastByteTick = SystemGetSysTick();
+
+    return true;
+}
+
 void CommandLineInit(void) {
     TerminalBufferIdx = 0;
+    BatchState = BATCH_IDLE;
 }
 
 bool CommandLineProcessByte(uint8_t Byte) {
@@ -552,6 +744,12 @@ INLINE void Timeout(void) {
 }
 
 void CommandLineTick(void) {
+    if (BatchState != BATCH_IDLE && SYSTICK_DIFF(BatchLastByteTick) >= BATCH_TIMEOUT_MS) {
+        /* The host gave up in the middle of a frame */
+        BatchState = BATCH_IDLE;
+        TerminalBufferIdx = 0;
+    }
+
     if (TaskPending &&
             GlobalSettings.ActiveSettingPtr->PendingTaskTimeout != 0 && // 0 means no timeout
             SYSTICK_DIFF_100MS(TaskPendingSince) >= GlobalSettings.ActiveSettingPtr->PendingTaskTimeout) { // timeout expired
@@ -18,6 +18,11 @@ void CommandLineTick(void);
 void CommandExecute(const char *command);
 void CommandLineAppendData(void const *const Buffer, uint16_t Bytes);
 
+/* Batch mode, see CommandLine.c. The terminal offers every received byte to
+ * CommandLineBatchProcessByte first, it returns false outside of a batch. */
+bool CommandLineBatchStart(void);
+bool CommandLineBatchProcessByte(uint8_t Byte);
+
 /* Functions for timeout commands */
 void CommandLinePendingTaskFinished(CommandStatusIdType ReturnStatusID, char const *const OutMessage);  // must be called, when the intended task is finished
 extern void (*CommandLinePendingTaskTimeout)(void);  // gets called on timeout to end the pending task
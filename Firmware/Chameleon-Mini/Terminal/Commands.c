@@ -10,6 +10,7 @@
 #include "../Configuration.h"
 #include "../Random.h"
 #include "../Memory.h"
+#include "../Profile.h"
 #include "../System.h"
 #include "../Button.h"
 #include "../AntennaLevel.h"
@@ -141,6 +142,21 @@ CommandStatusIdType CommandExecDownload(char *OutMessage) {
     return COMMAND_INFO_XMODEM_WAIT_ID;
 }
 
+CommandStatusIdType CommandExecBackup(char *OutMessage) {
+    /* The images are read from flash, bring the active one up to date */
+    MemoryStore();
+    XModemSend(MemoryArchiveDownloadBlock);
+    return COMMAND_INFO_XMODEM_WAIT_ID;
+}
+
+CommandStatusIdType CommandExecRestore(char *OutMessage) {
+    /* Nothing left in FRAM that could be stored over the restored image later */
+    MemoryStore();
+    /* The flash is written directly, so only checked blocks may get there */
+    XModemReceiveClassic(MemoryArchiveUploadBlock);
+    return COMMAND_INFO_XMODEM_WAIT_ID;
+}
+
 CommandStatusIdType CommandExecReset(char *OutMessage) {
     USB_Detach();
     USB_Disable();
@@ -424,6 +440,56 @@ CommandStatusIdType CommandGetSysTick(char *OutParam) {
     return COMMAND_INFO_OK_WITH_TEXT_ID;
 }
 
+CommandStatusIdType CommandExecBatch(char *OutMessage) {
+    if (!CommandLineBatchStart())
+        return COMMAND_ERR_INVALID_USAGE_ID;
+
+    return COMMAND_INFO_OK_ID;
+}
+
+CommandStatusIdType CommandExecMemCache(char *OutMessage) {
+    MemoryCacheResetStats();
+
+    return COMMAND_INFO_OK_ID;
+}
+
+CommandStatusIdType CommandGetMemCache(char *OutParam) {
+    uint16_t Hits, Misses;
+
+    MemoryCacheGetStats(&Hits, &Misses);
+    snprintf_P(OutParam, TERMINAL_BUFFER_SIZE, PSTR("%u,%u"), Hits, Misses);
+
+    return COMMAND_INFO_OK_WITH_TEXT_ID;
+}
+
+#ifdef PROFILE_HOTPATHS
+CommandStatusIdType CommandExecProfile(char *OutMessage) {
+    ProfileReset();
+
+    return COMMAND_INFO_OK_ID;
+}
+
+CommandStatusIdType CommandGetProfile(char *OutParam) {
+    /* Timer frequency, then NAME:count,min,max,mean,histogram... for every probe that has been hit */
+    uint16_t Length = snprintf_P(OutParam, TERMINAL_BUFFER_SIZE, PSTR("%lu"), (uint32_t)(F_CPU / PROFILE_TIMER_DIVIDER));
+
+    for (uint8_t i = 0; i < PROFILE_PROBE_COUNT && Length < TERMINAL_BUFFER_SIZE; i++) {
+        ProfileProbeType Stats;
+
+        if (!ProfileGetProbe(i, &Stats))
+            continue;
+
+        Length += snprintf_P(&OutParam[Length], TERMINAL_BUFFER_SIZE - Length, PSTR(";%S:%lu,%u,%u,%u"),
+                             ProfileGetProbeNameP(i), Stats.Count, Stats.Min, Stats.Max, ProfileGetMean(&Stats));
+
+        for (uint8_t j = 0; j < PROFILE_HISTOGRAM_SIZE && Length < TERMINAL_BUFFER_SIZE; j++)
+            Length += snprintf_P(&OutParam[Length], TERMINAL_BUFFER_SIZE - Length, PSTR(",%u"), Stats.Histogram[j]);
+    }
+
+    return COMMAND_INFO_OK_WITH_TEXT_ID;
+}
+#endif
+
 #ifdef CONFIG_ISO14443A_READER_SUPPORT
 CommandStatusIdType CommandExecParamSend(char *OutMessage, const char *InParams) {
 #ifndef CONFIG_ISO14443A_READER_SUPPORT
@@ -76,6 +76,12 @@ CommandStatusIdType CommandExecUpload(char *OutMessage);
 #define COMMAND_DOWNLOAD      "DOWNLOAD"
 CommandStatusIdType CommandExecDownload(char *OutMessage);
 
+#define COMMAND_BACKUP        "BACKUP"
+CommandStatusIdType CommandExecBackup(char *OutMessage);
+
+#define COMMAND_RESTORE       "RESTORE"
+CommandStatusIdType CommandExecRestore(char *OutMessage);
+
 #define COMMAND_RESET         "RESET"
 CommandStatusIdType CommandExecReset(char *OutMessage);
 
@@ -152,12 +158,25 @@ CommandStatusIdType CommandGetCharging(char *OutParam);
 #define COMMAND_HELP          "HELP"
 CommandStatusIdType CommandExecHelp(char *OutMessage);
 
+#define COMMAND_BATCH		"BATCH"
+CommandStatusIdType CommandExecBatch(char *OutMessage);
+
 #define COMMAND_RSSI		"RSSI"
 CommandStatusIdType CommandGetRssi(char *OutParam);
 
 #define COMMAND_SYSTICK		"SYSTICK"
 CommandStatusIdType CommandGetSysTick(char *OutParam);
 
+#define COMMAND_MEMCACHE	"MEMCACHE"
+CommandStatusIdType CommandExecMemCache(char *OutMessage);
+CommandStatusIdType CommandGetMemCache(char *OutParam);
+
+#ifdef PROFILE_HOTPATHS
+#define COMMAND_PROFILE		"PROFILE"
+CommandStatusIdType CommandExecProfile(char *OutMessage);
+CommandStatusIdType CommandGetProfile(char *OutParam);
+#endif
+
 #define COMMAND_SEND_RAW	     "SEND_RAW"
 CommandStatusIdType CommandExecParamSendRaw(char *OutMessage, const char *InParams);
 
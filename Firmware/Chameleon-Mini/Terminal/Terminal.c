@@ -2,6 +2,7 @@
 #include "Terminal.h"
 #include "../System.h"
 #include "../LEDHook.h"
+#include "../LiveLogTick.h"
 
 #include "../LUFADescriptors.h"
 
@@ -68,7 +69,9 @@ static void ProcessByte(void) {
         /* Byte received */
         LEDHook(LED_TERMINAL_RXTX, LED_PULSE);
 
-        if (XModemProcessByte(Byte)) {
+        if (CommandLineBatchProcessByte(Byte)) {
+            /* Part of a command batch */
+        } else if (XModemProcessByte(Byte)) {
             /* XModem handled the byte */
         } else if (CommandLineProcessByte(Byte)) {
             /* CommandLine handled the byte */
@@ -125,6 +128,8 @@ void TerminalTask(void) {
         USB_USBTask();
 
         ProcessByte();
+        XModemTask();
+        LiveLogTask();
     }
 }
 
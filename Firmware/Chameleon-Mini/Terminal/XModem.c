@@ -1,22 +1,25 @@
 #include "XModem.h"
 #include "Terminal.h"
+#include <util/crc16.h>
 
 #define BYTE_NAK        0x15
 #define BYTE_SOH        0x01
+#define BYTE_STX        0x02
 #define BYTE_ACK        0x06
 #define BYTE_CAN        0x18
 #define BYTE_EOF        0x1A
 #define BYTE_EOT        0x04
 #define BYTE_ESC		0x1B
-
-#define XMODEM_BLOCK_SIZE   128
+#define BYTE_SYN        0x16
 
 #define RECV_INIT_TIMEOUT   5  /* #Ticks between sending of NAKs to the sender */
 #define RECV_INIT_COUNT     60 /* #Timeouts until receive failure */
 #define SEND_INIT_TIMEOUT   300 /* #Ticks waiting for NAKs from the receiver before failure */
+#define WINDOW_TIMEOUT      50  /* #Ticks without a byte from the peer until a windowed transfer is dropped */
 
 #define FIRST_FRAME_NUMBER  1
 #define CHECKSUM_INIT_VALUE 0
+#define CRC16_INIT_VALUE    0
 
 static enum {
     STATE_OFF,
@@ -28,7 +31,15 @@ static enum {
     STATE_RECEIVE_PROCESS,
     STATE_SEND_INIT,
     STATE_SEND_WAIT,
-    STATE_SEND_EOT
+    STATE_SEND_EOT,
+    /* Windowed mode, has to stay behind the classic states */
+    STATE_WINDOW_RECEIVE_WAIT,
+    STATE_WINDOW_RECEIVE_FRAMENUM1,
+    STATE_WINDOW_RECEIVE_FRAMENUM2,
+    STATE_WINDOW_RECEIVE_DATA,
+    STATE_WINDOW_RECEIVE_CRC1,
+    STATE_WINDOW_RECEIVE_CRC2,
+    STATE_WINDOW_SEND
 } State = STATE_OFF;
 
 static uint8_t CurrentFrameNumber;
@@ -39,6 +50,17 @@ static uint16_t RetryTimeout;
 static uint16_t BufferIdx;
 static uint32_t BlockAddress;
 
+/* Windowed mode */
+static uint16_t FrameCRC;
+static bool WindowAllowed;      /* The receive callback may see blocks of damaged frames */
+static bool FrameExpected;      /* Receiving the next frame in order, its data is stored */
+static bool NakSent;            /* Frames are dropped until CurrentFrameNumber is sent again */
+static uint8_t AckedFrameNumber;
+static uint8_t ResendFrameNumber;
+static bool ResendPending;      /* Go back to ResendFrameNumber after the current frame */
+static bool EndOfData;
+static uint8_t ControlByte;     /* ACK or NAK that waits for its frame number, or 0 */
+
 static XModemCallbackType CallbackFunc;
 
 static uint8_t CalcChecksum(const void *Buffer, uint16_t ByteCount) {
@@ -52,16 +74,43 @@ static uint8_t CalcChecksum(const void *Buffer, uint16_t ByteCount) {
     return Checksum;
 }
 
+static uint16_t CalcCRC16(uint16_t CRC, const void *Buffer, uint16_t ByteCount) {
+    uint8_t *DataPtr = (uint8_t *) Buffer;
+
+    while (ByteCount--) {
+        CRC = _crc_xmodem_update(CRC, *DataPtr++);
+    }
+
+    return CRC;
+}
+
+static void SendWindowNak(void) {
+    /* Ask once for the frames from the expected one on, the frames already on
+     * their way are dropped until it is sent again */
+    if (!NakSent) {
+        TerminalSendByte(BYTE_NAK);
+        TerminalSendByte(CurrentFrameNumber);
+        NakSent = true;
+    }
+}
+
 void XModemReceive(XModemCallbackType TheCallbackFunc) {
     State = STATE_RECEIVE_INIT;
     CurrentFrameNumber = FIRST_FRAME_NUMBER;
     RetryCount = RECV_INIT_COUNT;
     RetryTimeout = RECV_INIT_TIMEOUT;
     BlockAddress = 0;
+    WindowAllowed = true;
 
     CallbackFunc = TheCallbackFunc;
 }
 
+void XModemReceiveClassic(XModemCallbackType TheCallbackFunc) {
+    /* The SYN of the sender is ignored, it falls back to the classic protocol */
+    XModemReceive(TheCallbackFunc);
+    WindowAllowed = false;
+}
+
 void XModemSend(XModemCallbackType TheCallbackFunc) {
     State = STATE_SEND_INIT;
     RetryTimeout = SEND_INIT_TIMEOUT;
@@ -71,8 +120,24 @@ void XModemSend(XModemCallbackType TheCallbackFunc) {
 }
 
 bool XModemProcessByte(uint8_t Byte) {
+    if (State >= STATE_WINDOW_RECEIVE_WAIT) {
+        /* The peer is still there */
+        RetryTimeout = WINDOW_TIMEOUT;
+    }
+
     switch (State) {
         case STATE_RECEIVE_INIT:
+            if (Byte == BYTE_SYN && WindowAllowed) {
+                /* The sender asks for the windowed mode */
+                TerminalSendByte(BYTE_SYN);
+                NakSent = false;
+                RetryTimeout = WINDOW_TIMEOUT;
+                State = STATE_WINDOW_RECEIVE_WAIT;
+                break;
+            }
+
+        /* Fallthrough */
+
         case STATE_RECEIVE_WAIT:
             if (Byte == BYTE_SOH) {
                 /* Next frame incoming */
@@ -161,6 +226,17 @@ bool XModemProcessByte(uint8_t Byte) {
             if (Byte == BYTE_NAK) {
                 CurrentFrameNumber = FIRST_FRAME_NUMBER - 1;
                 Byte = BYTE_ACK;
+            } else if (Byte == BYTE_SYN) {
+                /* The receiver asks for the windowed mode, the frames are sent by XModemTask() */
+                CurrentFrameNumber = FIRST_FRAME_NUMBER;
+                AckedFrameNumber = FIRST_FRAME_NUMBER - 1;
+                ResendPending = false;
+                EndOfData = false;
+                ControlByte = 0;
+                BufferIdx = 0;
+                RetryTimeout = WINDOW_TIMEOUT;
+                State = STATE_WINDOW_SEND;
+                break;
             } else if (Byte == BYTE_ESC) {
                 State = STATE_OFF;
             }
@@ -206,6 +282,137 @@ bool XModemProcessByte(uint8_t Byte) {
             State = STATE_OFF;
             break;
 
+        case STATE_WINDOW_RECEIVE_WAIT:
+            if (Byte == BYTE_STX) {
+                /* Next frame incoming */
+                BufferIdx = 0;
+                FrameCRC = CRC16_INIT_VALUE;
+                State = STATE_WINDOW_RECEIVE_FRAMENUM1;
+            } else if (NakSent) {
+                /* Looking for the next frame within the data of a damaged one */
+            } else if (Byte == BYTE_EOT) {
+                /* Transmission finished */
+                TerminalSendByte(BYTE_ACK);
+                State = STATE_OFF;
+            } else if ((Byte == BYTE_CAN) || (Byte == BYTE_ESC)) {
+                /* Cancel transmission */
+                State = STATE_OFF;
+            } else {
+                /* Frames follow each other directly, so the start of this one got lost */
+                SendWindowNak();
+            }
+
+            break;
+
+        case STATE_WINDOW_RECEIVE_FRAMENUM1:
+            ReceivedFrameNumber = Byte;
+            State = STATE_WINDOW_RECEIVE_FRAMENUM2;
+            break;
+
+        case STATE_WINDOW_RECEIVE_FRAMENUM2:
+            if (Byte == (255 - ReceivedFrameNumber)) {
+                /* frame-number check passed. */
+                FrameExpected = (ReceivedFrameNumber == CurrentFrameNumber);
+                State = STATE_WINDOW_RECEIVE_DATA;
+            } else {
+                /* Not a frame start, or a damaged one. Look for the next one */
+                SendWindowNak();
+                State = STATE_WINDOW_RECEIVE_WAIT;
+            }
+
+            break;
+
+        case STATE_WINDOW_RECEIVE_DATA:
+            TerminalBuffer[BufferIdx % XMODEM_BLOCK_SIZE] = Byte;
+            FrameCRC = _crc_xmodem_update(FrameCRC, Byte);
+            BufferIdx++;
+
+            if (BufferIdx == XMODEM_WINDOW_FRAME_SIZE) {
+                /* The last block stays in TerminalBuffer until the CRC has been checked */
+                State = STATE_WINDOW_RECEIVE_CRC1;
+            } else if ((BufferIdx % XMODEM_BLOCK_SIZE) == 0) {
+                /* Store every other full block right away, the frame does not fit into TerminalBuffer */
+                if (FrameExpected &&
+                        !CallbackFunc(TerminalBuffer, BlockAddress + BufferIdx - XMODEM_BLOCK_SIZE, XMODEM_BLOCK_SIZE)) {
+                    /* Application signals to cancel the transmission */
+                    TerminalSendByte(BYTE_CAN);
+                    TerminalSendByte(BYTE_CAN);
+                    State = STATE_OFF;
+                }
+            }
+
+            break;
+
+        case STATE_WINDOW_RECEIVE_CRC1:
+            Checksum = Byte;
+            State = STATE_WINDOW_RECEIVE_CRC2;
+            break;
+
+        case STATE_WINDOW_RECEIVE_CRC2:
+            if (FrameExpected) {
+                /* The frame that was asked for, a NAK is due again if it is damaged */
+                NakSent = false;
+            }
+
+            if (FrameCRC != (((uint16_t) Checksum << 8) | Byte)) {
+                /* Data seems to be damaged */
+                SendWindowNak();
+            } else if (FrameExpected) {
+                /* Store the last block, proceed to next frame */
+                if (!CallbackFunc(TerminalBuffer, BlockAddress + XMODEM_WINDOW_FRAME_SIZE - XMODEM_BLOCK_SIZE, XMODEM_BLOCK_SIZE)) {
+                    /* Application signals to cancel the transmission */
+                    TerminalSendByte(BYTE_CAN);
+                    TerminalSendByte(BYTE_CAN);
+                    State = STATE_OFF;
+                    break;
+                }
+
+                TerminalSendByte(BYTE_ACK);
+                TerminalSendByte(CurrentFrameNumber);
+                CurrentFrameNumber++;
+                BlockAddress += XMODEM_WINDOW_FRAME_SIZE;
+            } else if ((uint8_t)(CurrentFrameNumber - ReceivedFrameNumber) <= XMODEM_WINDOW_FRAME_COUNT) {
+                /* This is a retransmission */
+                TerminalSendByte(BYTE_ACK);
+                TerminalSendByte(CurrentFrameNumber - 1);
+            } else {
+                /* Frames in between got lost */
+                SendWindowNak();
+            }
+
+            State = STATE_WINDOW_RECEIVE_WAIT;
+            break;
+
+        case STATE_WINDOW_SEND:
+            if (ControlByte != 0) {
+                /* Frame number of an ACK or NAK, including a frame that is partly sent */
+                uint8_t SentFrames = CurrentFrameNumber - AckedFrameNumber - ((BufferIdx == 0) ? 1 : 0);
+                uint8_t Frames = Byte - AckedFrameNumber;
+
+                if (ControlByte == BYTE_ACK && Frames >= 1 && Frames <= SentFrames) {
+                    AckedFrameNumber = Byte;
+                } else if (ControlByte == BYTE_NAK && Frames >= 1 && Frames <= SentFrames) {
+                    /* The frames before the damaged one have been received */
+                    AckedFrameNumber = Byte - 1;
+                    ResendFrameNumber = Byte;
+                    ResendPending = true;
+                }
+
+                ControlByte = 0;
+            } else if ((Byte == BYTE_ACK) || (Byte == BYTE_NAK)) {
+                ControlByte = Byte;
+            } else if (Byte == BYTE_CAN) {
+                /* Cancel */
+                TerminalSendByte(BYTE_ACK);
+                State = STATE_OFF;
+            } else if (Byte == BYTE_ESC) {
+                State = STATE_OFF;
+            } else {
+                /* Ignore other chars */
+            }
+
+            break;
+
         default:
             return false;
             break;
@@ -214,6 +421,63 @@ bool XModemProcessByte(uint8_t Byte) {
     return true;
 }
 
+void XModemTask(void) {
+    /* Streams the frames of a windowed send, one block at a time */
+    if (State != STATE_WINDOW_SEND) {
+        return;
+    }
+
+    if (BufferIdx == 0) {
+        /* Between two frames */
+        if (ResendPending) {
+            BlockAddress -= (uint32_t)(uint8_t)(CurrentFrameNumber - ResendFrameNumber) * XMODEM_WINDOW_FRAME_SIZE;
+            CurrentFrameNumber = ResendFrameNumber;
+            ResendPending = false;
+            EndOfData = false;
+        }
+
+        if (EndOfData) {
+            if ((uint8_t)(CurrentFrameNumber - 1) == AckedFrameNumber) {
+                /* Everything has been acknowledged */
+                TerminalSendByte(BYTE_EOT);
+                State = STATE_SEND_EOT;
+            }
+
+            return;
+        }
+
+        if ((uint8_t)(CurrentFrameNumber - AckedFrameNumber - 1) >= XMODEM_WINDOW_FRAME_COUNT) {
+            /* Window is full, wait for an ACK */
+            return;
+        }
+
+        if (!CallbackFunc(TerminalBuffer, BlockAddress, XMODEM_BLOCK_SIZE)) {
+            EndOfData = true;
+            return;
+        }
+
+        TerminalSendByte(BYTE_STX);
+        TerminalSendByte(CurrentFrameNumber);
+        TerminalSendByte(255 - CurrentFrameNumber);
+        FrameCRC = CRC16_INIT_VALUE;
+    } else if (!CallbackFunc(TerminalBuffer, BlockAddress, XMODEM_BLOCK_SIZE)) {
+        /* The data ends within this frame, pad it */
+        memset(TerminalBuffer, 0x00, XMODEM_BLOCK_SIZE);
+    }
+
+    TerminalSendBlock(TerminalBuffer, XMODEM_BLOCK_SIZE);
+    FrameCRC = CalcCRC16(FrameCRC, TerminalBuffer, XMODEM_BLOCK_SIZE);
+    BlockAddress += XMODEM_BLOCK_SIZE;
+    BufferIdx += XMODEM_BLOCK_SIZE;
+
+    if (BufferIdx == XMODEM_WINDOW_FRAME_SIZE) {
+        TerminalSendByte(FrameCRC >> 8);
+        TerminalSendByte(FrameCRC & 0xFF);
+        BufferIdx = 0;
+        CurrentFrameNumber++;
+    }
+}
+
 void XModemTick(void) {
     /* Timeouts go here */
     switch (State) {
@@ -238,6 +502,19 @@ void XModemTick(void) {
             }
             break;
 
+        case STATE_WINDOW_RECEIVE_WAIT:
+        case STATE_WINDOW_RECEIVE_FRAMENUM1:
+        case STATE_WINDOW_RECEIVE_FRAMENUM2:
+        case STATE_WINDOW_RECEIVE_DATA:
+        case STATE_WINDOW_RECEIVE_CRC1:
+        case STATE_WINDOW_RECEIVE_CRC2:
+        case STATE_WINDOW_SEND:
+            if (RetryTimeout-- == 0) {
+                /* The peer has gone away */
+                State = STATE_OFF;
+            }
+            break;
+
         default:
             break;
     }
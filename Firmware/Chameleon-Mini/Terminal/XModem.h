@@ -10,12 +10,40 @@
 
 #include "../Common.h"
 
+#define XMODEM_BLOCK_SIZE   128
+
+/* Windowed streaming mode, requested by the host with a SYN byte instead of the
+ * first NAK (download) or in reply to a NAK (upload, answered with SYN).
+ * Frames are STX, frame number, 255 - frame number, XMODEM_WINDOW_FRAME_SIZE data
+ * bytes and the CRC-16/XMODEM of the data, high byte first. The receiver answers
+ * every frame with ACK or NAK followed by a frame number: ACK n acknowledges all
+ * frames up to n, NAK n requests all frames from n on again (go-back-n). Frames
+ * following a damaged one are dropped by the receiver. The sender may have up to
+ * XMODEM_WINDOW_FRAME_COUNT frames unacknowledged. EOT ends the transfer as usual.
+ *
+ * The frames are passed through TerminalBuffer in XMODEM_BLOCK_SIZE pieces, so
+ * the callbacks are the same as for the classic protocol. A frame does not fit into
+ * TerminalBuffer, so on reception all but the last piece of a frame are passed on
+ * before the CRC of the frame is known. The last piece is passed on once the CRC
+ * has been checked, and a damaged frame is passed on again when it is resent. This
+ * only suits callbacks that store each block at its address, XModemReceiveClassic
+ * refuses the windowed mode for the others. */
+#define XMODEM_WINDOW_FRAME_SIZE    1024
+#define XMODEM_WINDOW_FRAME_COUNT   4
+
+/* The second block of TerminalBuffer is not used by XModem. Send callbacks may use it
+ * to read ahead the next block while the current one is being transferred, receive
+ * callbacks to keep a block until the next one has arrived. */
+#define XModemPrefetchBuffer    (&TerminalBuffer[XMODEM_BLOCK_SIZE])
+
 typedef bool (*XModemCallbackType)(void *ByteBuffer, uint32_t BlockAddress, uint16_t ByteCount);
 
 void XModemReceive(XModemCallbackType CallbackFunc);
+void XModemReceiveClassic(XModemCallbackType CallbackFunc); /* Callback only sees checked blocks */
 void XModemSend(XModemCallbackType CallbackFunc);
 
 bool XModemProcessByte(uint8_t Byte);
+void XModemTask(void);
 void XModemTick(void);
 
 #endif /* TERMINALXMODEM_H_ */
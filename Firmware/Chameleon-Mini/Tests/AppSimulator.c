@@ -0,0 +1,533 @@
+/* AppSimulator.c
+ *
+ * Host-native replay harness for the ISO14443A card applications. Built and
+ * run by `make host-sim`.
+ *
+ * A trace file drives ApplicationProcessFunc of a configuration frame by
+ * frame, with ApplicationTaskFunc in between, compares the answers to the
+ * recorded ones and measures the time spent per reader command together with
+ * the number of FRAM transactions (each one is a full SPI transfer on the
+ * device). Traces are plain text,
+ * one directive per line, '#' starts a comment:
+ *
+ *   CONFIG <name>          Select a configuration, e.g. MF_CLASSIC_1K
+ *   LOAD <file>            Load a card image (relative to the trace), e.g. from Dumps/,
+ *                          and initialize the application again
+ *   RANDOM <hex>           Bytes returned by the next random number requests,
+ *                          e.g. to replay a recorded card nonce
+ *   RESET                  Field reset, calls ApplicationResetFunc
+ *   R <hex>[/bits] [P <parity bits>] [@label]
+ *                          Reader frame. Parity bits default to odd parity.
+ *                          The label groups the timing, default is the first byte.
+ *   C <hex>[/bits] [P <parity bits>]
+ *                          Expected card answer to the previous reader frame
+ *   C -                    The card must not answer
+ *
+ * `chamlog.py -t sim` converts log captures into traces. With -w the simulator
+ * prints the trace with the actual answers, to record new reference traces.
+ * The process exits non-zero on any mismatch.
+ */
+
+#include "HostSim/HostSim.h"
+#include "HostBench.h"
+
+#include <ctype.h>
+#include <libgen.h>
+
+#include "../Configuration.h"
+#include "../Application/Application.h"
+#include "../Memory.h"
+
+#define SIM_LINE_SIZE_MAX           1024
+#define SIM_TASK_RUNS               4 /* Main loop iterations during a reader frame */
+#define SIM_IMAGE_SIZE_MAX          MEMORY_SIZE_PER_SETTING
+#define SIM_LABEL_SIZE_MAX          16
+#define SIM_LABEL_COUNT_MAX         64
+
+typedef enum {
+    SIM_CONFIG,
+    SIM_LOAD,
+    SIM_RANDOM,
+    SIM_RESET,
+    SIM_READER,
+    SIM_CARD,
+} SimStepEnum;
+
+typedef struct {
+    SimStepEnum Type;
+    uint32_t Line;
+    char Text[SIM_LINE_SIZE_MAX];           /* Configuration name or file name */
+    char Label[SIM_LABEL_SIZE_MAX];
+    uint8_t Data[CODEC_BUFFER_SIZE];
+    uint8_t Parity[ISO14443A_BUFFER_PARITY_OFFSET];
+    uint16_t BitCount;
+    bool HasParity;
+    bool NoAnswer;
+} SimStepType;
+
+typedef struct {
+    char Label[SIM_LABEL_SIZE_MAX];
+    uint64_t *Samples;
+    uint32_t SampleCount;
+    uint32_t SampleSize;
+    uint32_t FRAMReads;
+    uint32_t FRAMWrites;
+} SimStatsType;
+
+static SimStatsType Stats[SIM_LABEL_COUNT_MAX];
+static uint8_t StatsCount = 0;
+
+static bool RecordMode = false;
+static uint32_t RepeatCount = 1;
+
+static char *Trim(char *Str) {
+    while (isspace((unsigned char) *Str))
+        Str++;
+
+    char *End = Str + strlen(Str);
+    while (End > Str && isspace((unsigned char) End[-1]))
+        *--End = '\0';
+
+    return Str;
+}
+
+/* Parses "<hex>[/bits]", returns false on malformed input */
+static bool ParseFrame(const char *Token, uint8_t *Data, uint16_t *BitCount) {
+    uint16_t ByteCount = 0;
+
+    while (isxdigit((unsigned char) Token[0]) && isxdigit((unsigned char) Token[1])) {
+        if (ByteCount >= CODEC_BUFFER_SIZE / 2)
+            return false;
+
+        unsigned int Byte;
+        sscanf(Token, "%2x", &Byte);
+        Data[ByteCount++] = Byte;
+        Token += 2;
+    }
+
+    *BitCount = ByteCount * BITS_PER_BYTE;
+
+    if (*Token == '/') {
+        unsigned int Bits = atoi(Token + 1);
+        if (Bits == 0 || Bits > *BitCount || Bits <= *BitCount - BITS_PER_BYTE)
+            return false;
+        *BitCount = Bits;
+    } else if (*Token != '\0') {
+        return false;
+    }
+
+    return ByteCount > 0;
+}
+
+static bool ParseParity(const char *Token, uint8_t *Parity, uint16_t ByteCount) {
+    if (strlen(Token) != ByteCount)
+        return false;
+
+    for (uint16_t i = 0; i < ByteCount; i++) {
+        if (Token[i] != '0' && Token[i] != '1')
+            return false;
+        Parity[i] = Token[i] - '0';
+    }
+
+    return true;
+}
+
+static bool ParseLine(char *Line, SimStepType *Step) {
+    char *Keyword = strtok(Line, " \t");
+    char *Arg = strtok(NULL, " \t");
+
+    memset(Step, 0, sizeof(*Step));
+
+    if (strcmp(Keyword, "CONFIG") == 0 || strcmp(Keyword, "LOAD") == 0) {
+        Step->Type = (Keyword[0] == 'C') ? SIM_CONFIG : SIM_LOAD;
+        if (Arg == NULL)
+            return false;
+        snprintf(Step->Text, sizeof(Step->Text), "%s", Arg);
+        return true;
+    } else if (strcmp(Keyword, "RANDOM") == 0) {
+        Step->Type = SIM_RANDOM;
+        return Arg != NULL && ParseFrame(Arg, Step->Data, &Step->BitCount) &&
+               Step->BitCount <= HOST_SIM_NONCE_SIZE_MAX * BITS_PER_BYTE;
+    } else if (strcmp(Keyword, "RESET") == 0) {
+        Step->Type = SIM_RESET;
+        return true;
+    } else if (strcmp(Keyword, "R") == 0 || strcmp(Keyword, "C") == 0) {
+        Step->Type = (Keyword[0] == 'R') ? SIM_READER : SIM_CARD;
+
+        if (Arg == NULL)
+            return false;
+
+        if (Step->Type == SIM_CARD && strcmp(Arg, "-") == 0) {
+            Step->NoAnswer = true;
+            return strtok(NULL, " \t") == NULL;
+        }
+
+        if (!ParseFrame(Arg, Step->Data, &Step->BitCount))
+            return false;
+
+        uint16_t ByteCount = (Step->BitCount + 7) / BITS_PER_BYTE;
+        while ((Arg = strtok(NULL, " \t")) != NULL) {
+            if (strcmp(Arg, "P") == 0) {
+                Arg = strtok(NULL, " \t");
+                if (Arg == NULL || !ParseParity(Arg, Step->Parity, ByteCount))
+                    return false;
+                Step->HasParity = true;
+            } else if (Arg[0] == '@' && Step->Type == SIM_READER) {
+                snprintf(Step->Label, sizeof(Step->Label), "%s", Arg + 1);
+            } else {
+                return false;
+            }
+        }
+
+        if (Step->Type == SIM_READER && Step->Label[0] == '\0') {
+            snprintf(Step->Label, sizeof(Step->Label), (Step->BitCount % BITS_PER_BYTE) ? "%02X/%u" : "%02X",
+                     Step->Data[0], Step->BitCount);
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+static SimStatsType *GetStats(const char *Label) {
+    for (uint8_t i = 0; i < StatsCount; i++) {
+        if (strcmp(Stats[i].Label, Label) == 0)
+            return &Stats[i];
+    }
+
+    if (StatsCount == SIM_LABEL_COUNT_MAX)
+        return NULL;
+
+    SimStatsType *Entry = &Stats[StatsCount++];
+    memset(Entry, 0, sizeof(*Entry));
+    snprintf(Entry->Label, sizeof(Entry->Label), "%s", Label);
+    return Entry;
+}
+
+static void AddSample(const char *Label, uint64_t Ticks, uint32_t Reads, uint32_t Writes) {
+    SimStatsType *Entry = GetStats(Label);
+
+    if (Entry == NULL)
+        return;
+
+    if (Entry->SampleCount == Entry->SampleSize) {
+        Entry->SampleSize = Entry->SampleSize ? Entry->SampleSize * 2 : 256;
+        Entry->Samples = realloc(Entry->Samples, Entry->SampleSize * sizeof(uint64_t));
+    }
+
+    Entry->Samples[Entry->SampleCount++] = Ticks;
+    Entry->FRAMReads += Reads;
+    Entry->FRAMWrites += Writes;
+}
+
+static void PrintFrame(FILE *Out, const uint8_t *Data, uint16_t BitCount, const uint8_t *Parity) {
+    uint16_t ByteCount = (BitCount + 7) / BITS_PER_BYTE;
+
+    for (uint16_t i = 0; i < ByteCount; i++)
+        fprintf(Out, "%02X", Data[i]);
+
+    if (BitCount % BITS_PER_BYTE)
+        fprintf(Out, "/%u", BitCount);
+
+    if (Parity != NULL) {
+        fprintf(Out, " P ");
+        for (uint16_t i = 0; i < ByteCount; i++)
+            fprintf(Out, "%c", Parity[i] ? '1' : '0');
+    }
+}
+
+static bool LoadImage(const char *TracePath, const char *FileName) {
+    static uint8_t Image[SIM_IMAGE_SIZE_MAX];
+    char Path[SIM_LINE_SIZE_MAX * 2];
+    char *TraceCopy = strdup(TracePath);
+
+    if (FileName[0] == '/')
+        snprintf(Path, sizeof(Path), "%s", FileName);
+    else
+        snprintf(Path, sizeof(Path), "%s/%s", dirname(TraceCopy), FileName);
+    free(TraceCopy);
+
+    FILE *File = fopen(Path, "rb");
+    if (File == NULL) {
+        printf("  cannot open %s\n", Path);
+        return false;
+    }
+
+    size_t ByteCount = fread(Image, 1, sizeof(Image), File);
+    fclose(File);
+
+    HostSimLoadImage(Image, ByteCount);
+    return true;
+}
+
+/* Runs the trace once. Returns the number of mismatches. */
+static uint32_t RunSteps(const char *TracePath, const SimStepType *Steps, uint32_t StepCount, bool Measure, bool Print) {
+    static uint8_t Buffer[CODEC_BUFFER_SIZE];
+    uint16_t AnswerBitCount = 0;
+    bool CustomParity = false;
+    bool Unsupported = false;
+    uint32_t Mismatches = 0;
+
+    HostSimInit();
+    ConfigurationInit();
+
+    for (uint32_t i = 0; i < StepCount; i++) {
+        const SimStepType *Step = &Steps[i];
+
+        switch (Step->Type) {
+            case SIM_CONFIG:
+                if (!ConfigurationSetByName(Step->Text, true)) {
+                    printf("  %s:%u: unknown configuration %s\n", TracePath, Step->Line, Step->Text);
+                    return Mismatches + 1;
+                }
+                if (Print)
+                    printf("CONFIG %s\n", Step->Text);
+                break;
+
+            case SIM_LOAD:
+                if (!LoadImage(TracePath, Step->Text))
+                    return Mismatches + 1;
+                /* Like activating a slot that holds the image, the application
+                 * caches parts of its configuration from memory on init */
+                ApplicationInit();
+                if (Print)
+                    printf("LOAD %s\n", Step->Text);
+                break;
+
+            case SIM_RANDOM:
+                HostSimSetRandom(Step->Data, Step->BitCount / BITS_PER_BYTE);
+                if (Print) {
+                    printf("RANDOM ");
+                    PrintFrame(stdout, Step->Data, Step->BitCount, NULL);
+                    printf("\n");
+                }
+                break;
+
+            case SIM_RESET:
+                ApplicationReset();
+                if (Print)
+                    printf("RESET\n");
+                break;
+
+            case SIM_READER: {
+                uint16_t ByteCount = (Step->BitCount + 7) / BITS_PER_BYTE;
+
+                memset(Buffer, 0, sizeof(Buffer));
+                memcpy(Buffer, Step->Data, ByteCount);
+                for (uint16_t j = 0; j < ByteCount; j++) {
+                    Buffer[ISO14443A_BUFFER_PARITY_OFFSET + j] =
+                        Step->HasParity ? Step->Parity[j] : ODD_PARITY(Step->Data[j]);
+                }
+
+                /* The main loop runs the task while the frame is being received, its
+                 * work is not part of the time until the answer */
+                for (uint8_t j = 0; j < SIM_TASK_RUNS; j++)
+                    ApplicationTask();
+
+                HostSimMemoryStats.ReadCount = HostSimMemoryStats.WriteCount = 0;
+                HostSimUnsupported = false;
+
+                uint64_t Start = HostBenchStart();
+                uint16_t Result = ApplicationProcess(Buffer, Step->BitCount);
+                uint64_t Ticks = HostBenchStop() - Start;
+
+                CustomParity = (Result & ISO14443A_APP_CUSTOM_PARITY) != 0;
+                AnswerBitCount = Result & ~ISO14443A_APP_CUSTOM_PARITY;
+                Unsupported = HostSimUnsupported;
+                HostSimSysTick++;
+
+                if (Measure && !Unsupported)
+                    AddSample(Step->Label, Ticks, HostSimMemoryStats.ReadCount, HostSimMemoryStats.WriteCount);
+
+                if (Print) {
+                    printf("R ");
+                    PrintFrame(stdout, Step->Data, Step->BitCount, Step->HasParity ? Step->Parity : NULL);
+                    printf("\nC ");
+                    if (AnswerBitCount == 0)
+                        printf("-");
+                    else
+                        PrintFrame(stdout, Buffer, AnswerBitCount, CustomParity ? &Buffer[ISO14443A_BUFFER_PARITY_OFFSET] : NULL);
+                    printf("\n");
+                }
+                break;
+            }
+
+            case SIM_CARD: {
+                bool Match;
+
+                if (Unsupported) {
+                    printf("  %s:%u: skipped, needs the XMEGA crypto hardware\n", TracePath, Step->Line);
+                    break;
+                }
+
+                if (Step->NoAnswer) {
+                    Match = (AnswerBitCount == 0);
+                } else {
+                    uint16_t ByteCount = (Step->BitCount + 7) / BITS_PER_BYTE;
+
+                    Match = (AnswerBitCount == Step->BitCount) && (memcmp(Buffer, Step->Data, ByteCount) == 0);
+
+                    /* Partial bytes are compared on the valid bits only */
+                    if (Match && (Step->BitCount % BITS_PER_BYTE)) {
+                        uint8_t Mask = (1 << (Step->BitCount % BITS_PER_BYTE)) - 1;
+                        Match = ((Buffer[ByteCount - 1] ^ Step->Data[ByteCount - 1]) & Mask) == 0;
+                    }
+
+                    for (uint16_t j = 0; Match && Step->HasParity && j < ByteCount; j++) {
+                        uint8_t Parity = CustomParity ? (Buffer[ISO14443A_BUFFER_PARITY_OFFSET + j] != 0) : ODD_PARITY(Buffer[j]);
+                        Match = (Parity == Step->Parity[j]);
+                    }
+                }
+
+                if (!Match) {
+                    Mismatches++;
+                    printf("  %s:%u: expected ", TracePath, Step->Line);
+                    if (Step->NoAnswer)
+                        printf("no answer");
+                    else
+                        PrintFrame(stdout, Step->Data, Step->BitCount, Step->HasParity ? Step->Parity : NULL);
+                    printf(", got ");
+                    if (AnswerBitCount == 0)
+                        printf("no answer");
+                    else
+                        PrintFrame(stdout, Buffer, AnswerBitCount, CustomParity ? &Buffer[ISO14443A_BUFFER_PARITY_OFFSET] : NULL);
+                    printf("\n");
+                }
+                break;
+            }
+        }
+    }
+
+    return Mismatches;
+}
+
+static SimStepType *ReadTrace(const char *TracePath, uint32_t *StepCount) {
+    FILE *File = fopen(TracePath, "r");
+    char Line[SIM_LINE_SIZE_MAX];
+    uint32_t LineNumber = 0, StepSize = 0;
+    SimStepType *Steps = NULL;
+
+    *StepCount = 0;
+
+    if (File == NULL) {
+        printf("  cannot open %s\n", TracePath);
+        return NULL;
+    }
+
+    while (fgets(Line, sizeof(Line), File) != NULL) {
+        LineNumber++;
+
+        char *Comment = strchr(Line, '#');
+        if (Comment != NULL)
+            *Comment = '\0';
+
+        char *Text = Trim(Line);
+        if (*Text == '\0')
+            continue;
+
+        /* Expected answers are not kept in record mode, they are regenerated */
+        if (RecordMode && Text[0] == 'C' && isspace((unsigned char) Text[1]))
+            continue;
+
+        if (*StepCount == StepSize) {
+            StepSize = StepSize ? StepSize * 2 : 64;
+            Steps = realloc(Steps, StepSize * sizeof(SimStepType));
+        }
+
+        if (!ParseLine(Text, &Steps[*StepCount])) {
+            printf("  %s:%u: cannot parse line\n", TracePath, LineNumber);
+            fclose(File);
+            free(Steps);
+            return NULL;
+        }
+
+        Steps[(*StepCount)++].Line = LineNumber;
+    }
+
+    fclose(File);
+    return Steps;
+}
+
+static void PrintStats(void) {
+    printf("  %-16s %8s %12s %12s %12s %10s %10s\n", "command", "frames",
+           "median", "min", "p99", "FRAM rd", "FRAM wr");
+
+    for (uint8_t i = 0; i < StatsCount; i++) {
+        SimStatsType *Entry = &Stats[i];
+
+        qsort(Entry->Samples, Entry->SampleCount, sizeof(uint64_t), HostBenchCompare);
+        printf("  %-16s %8u %12llu %12llu %12llu %10.1f %10.1f\n", Entry->Label, Entry->SampleCount,
+               (unsigned long long) Entry->Samples[Entry->SampleCount / 2],
+               (unsigned long long) Entry->Samples[0],
+               (unsigned long long) Entry->Samples[(Entry->SampleCount * 99) / 100],
+               (double) Entry->FRAMReads / Entry->SampleCount,
+               (double) Entry->FRAMWrites / Entry->SampleCount);
+
+        free(Entry->Samples);
+    }
+
+    printf("  (time in %s per frame, FRAM transactions per frame)\n", HOST_BENCH_UNIT);
+    StatsCount = 0;
+}
+
+static void Usage(const char *Name) {
+    printf("Usage: %s [-v] [-w] [-n <repeat>] <trace>...\n"
+           "  -v  print the application log entries\n"
+           "  -w  print the traces with the actual answers instead of checking them\n"
+           "  -n  replay each trace <repeat> times for the timing (default 1)\n", Name);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t Failures = 0;
+    int i;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            HostSimVerbose = true;
+        } else if (strcmp(argv[i], "-w") == 0) {
+            RecordMode = true;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            RepeatCount = atoi(argv[++i]);
+            RepeatCount = MAX(RepeatCount, 1);
+        } else {
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (i == argc) {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    for (; i < argc; i++) {
+        uint32_t StepCount;
+        SimStepType *Steps = ReadTrace(argv[i], &StepCount);
+
+        if (Steps == NULL) {
+            Failures++;
+            continue;
+        }
+
+        if (RecordMode) {
+            RunSteps(argv[i], Steps, StepCount, false, true);
+            free(Steps);
+            continue;
+        }
+
+        printf("%s\n", argv[i]);
+
+        uint32_t Mismatches = 0;
+        for (uint32_t Run = 0; Run < RepeatCount; Run++)
+            Mismatches += RunSteps(argv[i], Steps, StepCount, true, false);
+
+        PrintStats();
+        printf("  %s\n", Mismatches ? "FAILED" : "OK");
+
+        Failures += Mismatches;
+        free(Steps);
+    }
+
+    return Failures ? 1 : 0;
+}
@@ -0,0 +1,152 @@
+/* CRCAHostBench.c
+ *
+ * Host-native regression check and microbenchmark for the streaming CRC-A in
+ * Application/ISO14443-3A.c. Built and run by `make host-bench`.
+ *
+ * The table driven ISO14443ACRCAUpdate is compared against the bytewise
+ * _crc_ccitt_update loop that the applications used before, for every frame
+ * length up to a full codec buffer, random data and random split points of the
+ * streaming calls. ISO14443AAppendCRCA and ISO14443ACheckCRCA are checked on
+ * the same frames, including a flipped bit.
+ *
+ * The process exits non-zero on any mismatch.
+ */
+
+#include "../Application/ISO14443-3A.h"
+#include <util/crc16.h>
+
+#include "HostBench.h"
+
+#define CRCA_BENCH_RANDOM_TRIALS         64
+#define CRCA_BENCH_MAX_BYTES             (CODEC_BUFFER_SIZE - ISO14443A_CRCA_SIZE)
+#define CRCA_BENCH_FRAME_SIZE            64 /* DESFire frame */
+
+static uint32_t BenchRandomState = 0x1337C0DE;
+
+static uint8_t BenchRandomByte(void) {
+    /* xorshift32, only needs to be reproducible */
+    BenchRandomState ^= BenchRandomState << 13;
+    BenchRandomState ^= BenchRandomState >> 17;
+    BenchRandomState ^= BenchRandomState << 5;
+    return (uint8_t) BenchRandomState;
+}
+
+static void BenchRandomBuffer(uint8_t *Buffer, uint16_t Count) {
+    while (Count--)
+        *Buffer++ = BenchRandomByte();
+}
+
+static uint16_t FailureCount = 0;
+
+static void CheckFailed(const char *What, uint16_t ByteCount, uint32_t Trial) {
+    if (FailureCount++ < 10)
+        printf("  MISMATCH: %s (%u bytes, trial %u)\n", What, ByteCount, Trial);
+}
+
+/*
+ * Reference: the bytewise software CRC
+ */
+static uint16_t RefCRCA(const uint8_t *Buffer, uint16_t ByteCount) {
+    uint16_t Checksum = CRC_INIT;
+
+    while (ByteCount--)
+        Checksum = _crc_ccitt_update(Checksum, *Buffer++);
+
+    return Checksum;
+}
+
+/*
+ * Cross-check
+ */
+static void CheckFrame(uint16_t ByteCount, uint32_t Trial) {
+    uint8_t Buffer[CODEC_BUFFER_SIZE];
+    uint16_t Expected, Checksum;
+
+    BenchRandomBuffer(Buffer, sizeof(Buffer));
+    Expected = RefCRCA(Buffer, ByteCount);
+
+    if (ISO14443ACRCAUpdate(ISO14443ACRCAInit(), Buffer, ByteCount) != Expected)
+        CheckFailed("ISO14443ACRCAUpdate", ByteCount, Trial);
+
+    /* The same frame in up to three pieces of random length */
+    uint16_t Split1 = ByteCount ? BenchRandomByte() % (ByteCount + 1) : 0;
+    uint16_t Split2 = Split1 + (ByteCount - Split1 ? BenchRandomByte() % (ByteCount - Split1 + 1) : 0);
+
+    Checksum = ISO14443ACRCAInit();
+    Checksum = ISO14443ACRCAUpdate(Checksum, Buffer, Split1);
+    Checksum = ISO14443ACRCAUpdate(Checksum, &Buffer[Split1], Split2 - Split1);
+    Checksum = ISO14443ACRCAUpdate(Checksum, &Buffer[Split2], ByteCount - Split2);
+
+    if (Checksum != Expected)
+        CheckFailed("ISO14443ACRCAUpdate in pieces", ByteCount, Trial);
+
+    ISO14443AAppendCRCA(Buffer, ByteCount);
+
+    if (Buffer[ByteCount] != (Expected & 0xFF) || Buffer[ByteCount + 1] != (Expected >> 8))
+        CheckFailed("ISO14443AAppendCRCA", ByteCount, Trial);
+
+    if (!ISO14443ACheckCRCA(Buffer, ByteCount))
+        CheckFailed("ISO14443ACheckCRCA intact", ByteCount, Trial);
+
+    uint16_t Bit = (BenchRandomByte() | BenchRandomByte() << 8) % ((ByteCount + ISO14443A_CRCA_SIZE) * 8);
+    Buffer[Bit / 8] ^= 1 << (Bit % 8);
+
+    if (ISO14443ACheckCRCA(Buffer, ByteCount))
+        CheckFailed("ISO14443ACheckCRCA flipped bit", ByteCount, Trial);
+}
+
+static void CheckAgainstReference(void) {
+    for (uint32_t Trial = 0; Trial < CRCA_BENCH_RANDOM_TRIALS; Trial++) {
+        for (uint16_t ByteCount = 0; ByteCount <= CRCA_BENCH_MAX_BYTES; ByteCount++)
+            CheckFrame(ByteCount, Trial);
+    }
+}
+
+/*
+ * Benchmarks
+ */
+static HostBenchType Bench;
+
+static void RunBenchmarks(void) {
+    static const uint16_t FrameSizes[] = { 2, 18, CRCA_BENCH_FRAME_SIZE };
+    uint8_t Buffer[CODEC_BUFFER_SIZE];
+    char Name[64];
+    volatile uint16_t Sink;
+
+    for (uint8_t i = 0; i < sizeof(FrameSizes) / sizeof(*FrameSizes); i++) {
+        uint16_t ByteCount = FrameSizes[i];
+
+        BenchRandomBuffer(Buffer, sizeof(Buffer));
+
+        snprintf(Name, sizeof(Name), "_crc_ccitt_update (%u bytes)", ByteCount);
+        Bench.Name = Name;
+        HOST_BENCH_RUN(&Bench, Sink = RefCRCA(Buffer, ByteCount));
+        HostBenchReport(&Bench, ByteCount, "byte");
+
+        snprintf(Name, sizeof(Name), "ISO14443ACRCAUpdate (%u bytes)", ByteCount);
+        HOST_BENCH_RUN(&Bench, Sink = ISO14443ACRCAUpdate(ISO14443ACRCAInit(), Buffer, ByteCount));
+        HostBenchReport(&Bench, ByteCount, "byte");
+    }
+
+    (void) Sink;
+}
+
+int main(int argc, char *argv[]) {
+    printf("CRC-A: streaming table driven CRC vs. _crc_ccitt_update (%u random trials)\n",
+           CRCA_BENCH_RANDOM_TRIALS);
+    CheckAgainstReference();
+
+    if (FailureCount > 0) {
+        printf("CRC-A: %u mismatches, not benchmarking\n", FailureCount);
+        return EXIT_FAILURE;
+    }
+
+    printf("CRC-A: all checks passed\n");
+
+    if (argc > 1 && !strcmp(argv[1], "--check-only"))
+        return EXIT_SUCCESS;
+
+    RunBenchmarks();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,336 @@
+/* Crypto1HostBench.c
+ *
+ * Host-native microbenchmark and regression check for the NO_INLINE_ASM
+ * build of Application/Crypto1.c. Built and run by `make host-bench`.
+ *
+ * Three things are checked before anything is timed:
+ *   1. The portable SPLIT_BYTE/SHIFT24/SHIFT24_COND_DECRYPT/SHIFT8 macros
+ *      against an instruction-by-instruction model (lsr/ror/eor/sbrc with an
+ *      explicit carry flag) of the AVR inline assembly, including the side
+ *      effects on the input operands.
+ *   2. ODD_PARITY against a plain bit count.
+ *   3. Crypto1Setup, Crypto1SetupNested, Crypto1Auth, Crypto1ByteArray and
+ *      Crypto1ByteArrayWithParity against a textbook bit-serial 48 bit
+ *      Crypto1 implementation, for random keys, UIDs, nonces and buffers.
+ *      Crypto1SaveState/Crypto1LoadState are checked on the way.
+ *
+ * The process exits non-zero on any mismatch, so the target can gate
+ * changes to the Crypto1 code without a device.
+ */
+
+#ifndef NO_INLINE_ASM
+#error "Crypto1HostBench.c has to be compiled with -DNO_INLINE_ASM"
+#endif
+
+/* Pull in the implementation itself to get access to the macros and the
+ * static LFSR state */
+#include "../Application/Crypto1.c"
+
+#include "HostBench.h"
+
+#define CRYPTO1_BENCH_RANDOM_TRIALS      20000
+#define CRYPTO1_BENCH_FRAME_SIZE         18 /* READ response: 16 data + 2 CRC */
+
+static uint32_t BenchRandomState = 0x1337C0DE;
+
+static uint8_t BenchRandomByte(void) {
+    /* xorshift32, only needs to be reproducible */
+    BenchRandomState ^= BenchRandomState << 13;
+    BenchRandomState ^= BenchRandomState >> 17;
+    BenchRandomState ^= BenchRandomState << 5;
+    return (uint8_t) BenchRandomState;
+}
+
+static void BenchRandomBuffer(uint8_t *Buffer, uint16_t Count) {
+    while (Count--)
+        *Buffer++ = BenchRandomByte();
+}
+
+static uint16_t FailureCount = 0;
+
+static void CheckFailed(const char *What, uint32_t Trial) {
+    if (FailureCount++ < 10)
+        printf("  MISMATCH: %s (trial %u)\n", What, Trial);
+}
+
+/*
+ * 1. Model of the AVR macros. Each line corresponds to one instruction.
+ */
+static uint8_t AvrCarry;
+
+#define AVR_LSR(Rd)     do { AvrCarry = (Rd) & 1; (Rd) >>= 1; } while (0)
+#define AVR_ROR(Rd)     do { uint8_t __c = AvrCarry; AvrCarry = (Rd) & 1; \
+                             (Rd) = ((Rd) >> 1) | (__c << 7); } while (0)
+
+static void AvrSplitByte(uint8_t *Even, uint8_t *Odd, uint8_t *Byte) {
+    for (uint8_t i = 0; i < 4; i++) {
+        AVR_LSR(*Byte);
+        AVR_ROR(*Even);
+        AVR_LSR(*Byte);
+        AVR_ROR(*Odd);
+    }
+}
+
+static void AvrShift24(uint8_t *B0, uint8_t *B1, uint8_t *B2, uint8_t *In) {
+    AVR_LSR(*In);
+    AVR_ROR(*B2);
+    AVR_ROR(*B1);
+    AVR_ROR(*B0);
+}
+
+static void AvrShift24CondDecrypt(uint8_t *B0, uint8_t *B1, uint8_t *B2, uint8_t *In,
+                                  uint8_t Stream, uint8_t Decrypt) {
+    if (Decrypt & 0x01) /* sbrc %5, 0 */
+        *In ^= Stream;  /* eor  %3, %4 */
+    AVR_LSR(*In);
+    AVR_ROR(*B2);
+    AVR_ROR(*B1);
+    AVR_ROR(*B0);
+}
+
+static void AvrShift8(uint8_t *Byte, uint8_t *In) {
+    AVR_LSR(*In);
+    AVR_ROR(*Byte);
+}
+
+static void CheckMacroModel(void) {
+    uint32_t Trial = 0;
+
+    for (uint32_t i = 0; i < (1UL << 16); i++) {
+        uint8_t In = i, Byte = i >> 8;
+        uint8_t AvrIn = In, AvrByte = Byte;
+        SHIFT8(Byte, In);
+        AvrShift8(&AvrByte, &AvrIn);
+        if (Byte != AvrByte || In != AvrIn)
+            CheckFailed("SHIFT8", i);
+    }
+
+    for (uint32_t i = 0; i < (1UL << 24); i++) {
+        uint8_t Byte = i, Even = i >> 8, Odd = i >> 16;
+        uint8_t AvrByte = Byte, AvrEven = Even, AvrOdd = Odd;
+        SPLIT_BYTE(Even, Odd, Byte);
+        AvrSplitByte(&AvrEven, &AvrOdd, &AvrByte);
+        if (Byte != AvrByte || Even != AvrEven || Odd != AvrOdd)
+            CheckFailed("SPLIT_BYTE", i);
+    }
+
+    for (uint32_t i = 0; i < (1UL << 18); i++, Trial++) {
+        uint8_t In = i, B2 = i >> 8, Decrypt = i >> 16;
+        uint8_t B0 = BenchRandomByte(), B1 = BenchRandomByte();
+        uint8_t Stream = BenchRandomByte();
+        uint8_t A0 = B0, A1 = B1, A2 = B2, AIn = In;
+
+        AvrShift24(&A0, &A1, &A2, &AIn);
+        {
+            uint8_t P0 = B0, P1 = B1, P2 = B2, PIn = In;
+            SHIFT24(P0, P1, P2, PIn);
+            if (P0 != A0 || P1 != A1 || P2 != A2 || PIn != AIn)
+                CheckFailed("SHIFT24", Trial);
+        }
+
+        A0 = B0, A1 = B1, A2 = B2, AIn = In;
+        AvrShift24CondDecrypt(&A0, &A1, &A2, &AIn, Stream, Decrypt);
+        {
+            uint8_t P0 = B0, P1 = B1, P2 = B2, PIn = In;
+            SHIFT24_COND_DECRYPT(P0, P1, P2, PIn, Stream, Decrypt);
+            if (P0 != A0 || P1 != A1 || P2 != A2 || PIn != AIn)
+                CheckFailed("SHIFT24_COND_DECRYPT", Trial);
+        }
+    }
+
+    for (uint16_t i = 0; i < 256; i++) {
+        if (ODD_PARITY(i) != !(__builtin_popcount(i) & 0x01))
+            CheckFailed("ODD_PARITY", i);
+    }
+}
+
+/*
+ * 2. Textbook Crypto1: one 48 bit LFSR, bit i holds the i-th key bit
+ *    (LSB first), new bits are shifted in at bit 47.
+ */
+#define REF_BIT(s, n)   ((uint8_t) (((s) >> (n)) & 0x01))
+
+static const uint8_t RefFeedbackTaps[] = {
+    0, 5, 9, 10, 12, 14, 15, 17, 19, 24, 25, 27, 29, 35, 39, 41, 42, 43
+};
+
+static uint8_t RefFilter(uint64_t s) {
+    uint8_t a = FA(REF_BIT(s, 15), REF_BIT(s, 13), REF_BIT(s, 11), REF_BIT(s, 9));
+    uint8_t b = FB(REF_BIT(s, 23), REF_BIT(s, 21), REF_BIT(s, 19), REF_BIT(s, 17));
+    uint8_t c = FB(REF_BIT(s, 31), REF_BIT(s, 29), REF_BIT(s, 27), REF_BIT(s, 25));
+    uint8_t d = FA(REF_BIT(s, 39), REF_BIT(s, 37), REF_BIT(s, 35), REF_BIT(s, 33));
+    uint8_t e = FB(REF_BIT(s, 47), REF_BIT(s, 45), REF_BIT(s, 43), REF_BIT(s, 41));
+    return FC(e, d, c, b, a) & 0x01;
+}
+
+static uint64_t RefClock(uint64_t s, uint8_t In) {
+    uint8_t Feedback = In & 0x01;
+    for (uint8_t i = 0; i < sizeof(RefFeedbackTaps); i++)
+        Feedback ^= REF_BIT(s, RefFeedbackTaps[i]);
+    return (s >> 1) | ((uint64_t) Feedback << 47);
+}
+
+static uint64_t RefLoadKey(const uint8_t Key[6]) {
+    uint64_t s = 0;
+    for (uint8_t i = 0; i < 6; i++)
+        s |= (uint64_t) Key[i] << (8 * i);
+    return s;
+}
+
+static void RefSetup(uint64_t *s, const uint8_t Key[6], const uint8_t Uid[4],
+                     uint8_t CardNonce[8], bool Nested, bool Decrypt) {
+    *s = RefLoadKey(Key);
+    for (uint8_t i = 0; i < NONCE_SIZE; i++) {
+        uint8_t KeyStream = 0;
+        for (uint8_t Bit = 0; Bit < 8; Bit++) {
+            uint8_t Out = RefFilter(*s);
+            uint8_t In = REF_BIT(Uid[i], Bit) ^ REF_BIT(CardNonce[i], Bit);
+            if (Decrypt)
+                In ^= Out;
+            KeyStream |= Out << Bit;
+            *s = RefClock(*s, In);
+        }
+        if (Nested)
+            CardNonce[NONCE_SIZE + i] = RefFilter(*s) ^ !(__builtin_popcount(CardNonce[i]) & 0x01);
+        CardNonce[i] ^= KeyStream;
+    }
+}
+
+static void RefAuth(uint64_t *s, const uint8_t EncryptedReaderNonce[4]) {
+    for (uint8_t i = 0; i < 32; i++)
+        *s = RefClock(*s, RefFilter(*s) ^ REF_BIT(EncryptedReaderNonce[i / 8], i % 8));
+}
+
+static void RefByteArray(uint64_t *s, uint8_t *Buffer, uint8_t Count, bool WithParity) {
+    for (uint8_t i = 0; i < Count; i++) {
+        uint8_t KeyStream = 0;
+        for (uint8_t Bit = 0; Bit < 8; Bit++) {
+            KeyStream |= RefFilter(*s) << Bit;
+            *s = RefClock(*s, 0);
+        }
+        if (WithParity)
+            Buffer[ISO14443A_BUFFER_PARITY_OFFSET + i] =
+                RefFilter(*s) ^ !(__builtin_popcount(Buffer[i]) & 0x01);
+        Buffer[i] ^= KeyStream;
+    }
+}
+
+static bool StateMatches(uint64_t s) {
+    uint8_t Even[3], Odd[3];
+    Crypto1GetState(Even, Odd);
+    for (uint8_t i = 0; i < 24; i++) {
+        if (REF_BIT(Even[i / 8], i % 8) != REF_BIT(s, 2 * i) ||
+                REF_BIT(Odd[i / 8], i % 8) != REF_BIT(s, 2 * i + 1))
+            return false;
+    }
+    return true;
+}
+
+static void CheckAgainstReference(void) {
+    uint8_t Key[6], Uid[4], Nonce[8], RefNonce[8];
+    uint8_t Buffer[CODEC_BUFFER_SIZE], RefBuffer[CODEC_BUFFER_SIZE];
+    uint64_t s;
+
+    for (uint32_t Trial = 0; Trial < CRYPTO1_BENCH_RANDOM_TRIALS; Trial++) {
+        uint8_t Count = 1 + BenchRandomByte() % (ISO14443A_BUFFER_PARITY_OFFSET - 1);
+        bool Decrypt = BenchRandomByte() & 0x01;
+
+        BenchRandomBuffer(Key, sizeof(Key));
+        BenchRandomBuffer(Uid, sizeof(Uid));
+        BenchRandomBuffer(Nonce, sizeof(Nonce));
+        memcpy(RefNonce, Nonce, sizeof(Nonce));
+
+        Crypto1Setup(Key, Uid, Nonce);
+        RefSetup(&s, Key, Uid, RefNonce, false, false);
+        if (memcmp(Nonce, RefNonce, NONCE_SIZE) || !StateMatches(s))
+            CheckFailed("Crypto1Setup", Trial);
+
+        BenchRandomBuffer(Nonce, NONCE_SIZE);
+        memcpy(RefNonce, Nonce, NONCE_SIZE);
+        Crypto1Auth(Nonce);
+        RefAuth(&s, RefNonce);
+        if (!StateMatches(s))
+            CheckFailed("Crypto1Auth", Trial);
+
+        BenchRandomBuffer(Buffer, sizeof(Buffer));
+        memcpy(RefBuffer, Buffer, sizeof(Buffer));
+        Crypto1ByteArray(Buffer, Count);
+        RefByteArray(&s, RefBuffer, Count, false);
+        if (memcmp(Buffer, RefBuffer, sizeof(Buffer)) || !StateMatches(s))
+            CheckFailed("Crypto1ByteArray", Trial);
+
+        Crypto1ByteArrayWithParity(Buffer, Count);
+        RefByteArray(&s, RefBuffer, Count, true);
+        if (memcmp(Buffer, RefBuffer, sizeof(Buffer)) || !StateMatches(s))
+            CheckFailed("Crypto1ByteArrayWithParity", Trial);
+
+        BenchRandomBuffer(Nonce, sizeof(Nonce));
+        memcpy(RefNonce, Nonce, sizeof(Nonce));
+        Crypto1SetupNested(Key, Uid, Nonce, Decrypt);
+        RefSetup(&s, Key, Uid, RefNonce, true, Decrypt);
+        if (memcmp(Nonce, RefNonce, sizeof(Nonce)) || !StateMatches(s))
+            CheckFailed(Decrypt ? "Crypto1SetupNested (Decrypt)" : "Crypto1SetupNested", Trial);
+
+        /* A prepared state survives other use of the cipher */
+        Crypto1StateType Saved;
+        Crypto1SaveState(&Saved);
+        Crypto1ByteArray(Buffer, Count);
+        Crypto1LoadState(&Saved);
+        if (!StateMatches(s))
+            CheckFailed("Crypto1SaveState/Crypto1LoadState", Trial);
+    }
+}
+
+/*
+ * 3. Benchmarks
+ */
+static HostBenchType Bench;
+
+static void RunBenchmarks(void) {
+    uint8_t Key[6], Uid[4], Nonce[8];
+    uint8_t Buffer[CODEC_BUFFER_SIZE];
+
+    BenchRandomBuffer(Key, sizeof(Key));
+    BenchRandomBuffer(Uid, sizeof(Uid));
+    BenchRandomBuffer(Nonce, sizeof(Nonce));
+    BenchRandomBuffer(Buffer, sizeof(Buffer));
+
+    Bench.Name = "Crypto1Setup";
+    HOST_BENCH_RUN(&Bench, Crypto1Setup(Key, Uid, Nonce));
+    HostBenchReport(&Bench, 1, "call");
+
+    Bench.Name = "Crypto1SetupNested";
+    HOST_BENCH_RUN(&Bench, Crypto1SetupNested(Key, Uid, Nonce, false));
+    HostBenchReport(&Bench, 1, "call");
+
+    Bench.Name = "Crypto1Auth";
+    HOST_BENCH_RUN(&Bench, Crypto1Auth(Nonce));
+    HostBenchReport(&Bench, 1, "call");
+
+    Bench.Name = "Crypto1ByteArray (18 bytes)";
+    HOST_BENCH_RUN(&Bench, Crypto1ByteArray(Buffer, CRYPTO1_BENCH_FRAME_SIZE));
+    HostBenchReport(&Bench, CRYPTO1_BENCH_FRAME_SIZE, "byte");
+
+    Bench.Name = "Crypto1ByteArrayWithParity (18 bytes)";
+    HOST_BENCH_RUN(&Bench, Crypto1ByteArrayWithParity(Buffer, CRYPTO1_BENCH_FRAME_SIZE));
+    HostBenchReport(&Bench, CRYPTO1_BENCH_FRAME_SIZE, "byte");
+}
+
+int main(int argc, char *argv[]) {
+    printf("Crypto1: portable macros vs. AVR instruction model\n");
+    CheckMacroModel();
+    printf("Crypto1: API vs. bit-serial reference (%u random trials)\n", CRYPTO1_BENCH_RANDOM_TRIALS);
+    CheckAgainstReference();
+
+    if (FailureCount > 0) {
+        printf("Crypto1: %u mismatches, not benchmarking\n", FailureCount);
+        return EXIT_FAILURE;
+    }
+
+    printf("Crypto1: all checks passed\n");
+    if (argc > 1 && !strcmp(argv[1], "--check-only"))
+        return EXIT_SUCCESS;
+
+    RunBenchmarks();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+/* HostBench.h
+ *
+ * Minimal timing helpers for the host-native (non-AVR) benchmarks that are
+ * built by the `make host-bench` target. Never included by the firmware.
+ */
+
+#ifndef __TESTS_HOST_BENCH_H__
+#define __TESTS_HOST_BENCH_H__
+
+#ifndef HOST_BUILD
+#error "HostBench.h is only meant for host builds (-DHOST_BUILD)"
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HOST_BENCH_UNIT                  "cycles"
+
+/* Serialized time stamp counter read, so that out-of-order execution does not
+ * move the measured code across the start/stop markers */
+static inline uint64_t HostBenchStart(void) {
+    _mm_lfence();
+    return __rdtsc();
+}
+
+static inline uint64_t HostBenchStop(void) {
+    unsigned int Aux;
+    uint64_t Ticks = __rdtscp(&Aux);
+    _mm_lfence();
+    return Ticks;
+}
+#else
+#define HOST_BENCH_UNIT                  "ns"
+
+static inline uint64_t HostBenchStart(void) {
+    struct timespec Now;
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    return (uint64_t) Now.tv_sec * 1000000000ULL + Now.tv_nsec;
+}
+
+#define HostBenchStop HostBenchStart
+#endif
+
+#define HOST_BENCH_SAMPLES               2048
+
+typedef struct {
+    const char *Name;
+    uint64_t Samples[HOST_BENCH_SAMPLES];
+    uint16_t SampleCount;
+} HostBenchType;
+
+static int HostBenchCompare(const void *A, const void *B) {
+    uint64_t a = *(const uint64_t *) A, b = *(const uint64_t *) B;
+    return (a > b) - (a < b);
+}
+
+/* Print min/median/p99 of the collected samples, each divided by Ops
+ * (e.g. the number of bytes processed per sample). */
+static inline void HostBenchReport(HostBenchType *Bench, uint32_t Ops, const char *OpName) {
+    qsort(Bench->Samples, Bench->SampleCount, sizeof(uint64_t), HostBenchCompare);
+    uint64_t Min = Bench->Samples[0];
+    uint64_t Median = Bench->Samples[Bench->SampleCount / 2];
+    uint64_t P99 = Bench->Samples[(Bench->SampleCount * 99) / 100];
+    printf("  %-34s %8.1f %s/%-5s (min %6.1f, p99 %6.1f)\n", Bench->Name,
+           (double) Median / Ops, HOST_BENCH_UNIT, OpName,
+           (double) Min / Ops, (double) P99 / Ops);
+}
+
+/* Time one invocation of the statement block per sample */
+#define HOST_BENCH_RUN(Bench, Statement) do {                        \
+        for ((Bench)->SampleCount = 0;                               \
+             (Bench)->SampleCount < HOST_BENCH_SAMPLES;              \
+             (Bench)->SampleCount++) {                               \
+            uint64_t __Start = HostBenchStart();                     \
+            Statement;                                               \
+            (Bench)->Samples[(Bench)->SampleCount] =                 \
+                HostBenchStop() - __Start;                           \
+        }                                                            \
+    } while (0)
+
+#endif /* __TESTS_HOST_BENCH_H__ */
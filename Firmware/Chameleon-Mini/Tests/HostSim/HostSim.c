@@ -0,0 +1,176 @@
+/* HostSim.c
+ *
+ * Host stand-ins, see HostSim.h. Only what the ISO14443A card applications
+ * and Configuration.c reference is provided.
+ */
+
+#include "HostSim.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../../Memory.h"
+#include "../../Settings.h"
+#include "../../LEDHook.h"
+#include "../../Log.h"
+#include "../../Random.h"
+
+uint8_t HostSimFRAM[HOST_SIM_FRAM_SIZE];
+static uint8_t HostSimFlash[MEMORY_SIZE_PER_SETTING];
+HostSimMemoryStatsType HostSimMemoryStats;
+uint16_t HostSimSysTick = 0;
+bool HostSimVerbose = false;
+
+SettingsType GlobalSettings;
+LEDActionEnum LEDGreenAction, LEDRedAction;
+
+/*
+ * Memory.h: a single setting, FRAM and flash are plain arrays
+ */
+void MemoryInit(void) {
+    memset(HostSimFRAM, MEMORY_INIT_VALUE, sizeof(HostSimFRAM));
+    memset(HostSimFlash, MEMORY_INIT_VALUE, sizeof(HostSimFlash));
+}
+
+void MemoryReadBlock(void *Buffer, uint16_t Address, uint16_t ByteCount) {
+    if (ByteCount == 0)
+        return;
+    HostSimMemoryStats.ReadCount++;
+    HostSimMemoryStats.ReadBytes += ByteCount;
+    memcpy(Buffer, &HostSimFRAM[Address], MIN(ByteCount, sizeof(HostSimFRAM) - Address));
+}
+
+void MemoryWriteBlock(const void *Buffer, uint16_t Address, uint16_t ByteCount) {
+    if (ByteCount == 0)
+        return;
+    HostSimMemoryStats.WriteCount++;
+    HostSimMemoryStats.WriteBytes += ByteCount;
+    memcpy(&HostSimFRAM[Address], Buffer, MIN(ByteCount, sizeof(HostSimFRAM) - Address));
+}
+
+void MemoryReadBlockInSetting(void *Buffer, uint16_t Address, uint16_t ByteCount) {
+    if (ByteCount >= MEMORY_SIZE_PER_SETTING)
+        return;
+    MemoryReadBlock(Buffer, Address, ByteCount);
+}
+
+void MemoryWriteBlockInSetting(const void *Buffer, uint16_t Address, uint16_t ByteCount) {
+    if (ByteCount >= MEMORY_SIZE_PER_SETTING)
+        return;
+    MemoryWriteBlock(Buffer, Address, ByteCount);
+}
+
+void MemoryClear(void) {
+    memset(HostSimFlash, MEMORY_INIT_VALUE, sizeof(HostSimFlash));
+    MemoryRecall();
+}
+
+void MemoryRecall(void) {
+    memcpy(HostSimFRAM, HostSimFlash, sizeof(HostSimFlash));
+}
+
+void MemoryStore(void) {
+    memcpy(HostSimFlash, HostSimFRAM, sizeof(HostSimFlash));
+}
+
+void HostSimLoadImage(const uint8_t *Image, uint16_t ByteCount) {
+    ByteCount = MIN(ByteCount, sizeof(HostSimFlash));
+    memcpy(HostSimFlash, Image, ByteCount);
+    memcpy(HostSimFRAM, Image, ByteCount);
+}
+
+/*
+ * Log.h: entries are printed in verbose mode
+ */
+static void HostSimLogFunc(LogEntryEnum Entry, const void *Data, uint8_t Length) {
+    if (HostSimVerbose) {
+        printf("    log %02X:", Entry);
+        for (uint8_t i = 0; i < Length; i++)
+            printf(" %02X", ((const uint8_t *) Data)[i]);
+        printf("\n");
+    }
+}
+
+LogFuncType CurrentLogFunc = HostSimLogFunc;
+
+/*
+ * Random.h: replayed bytes first, then a reproducible xorshift sequence
+ */
+static uint8_t HostSimRandomBytes[HOST_SIM_NONCE_SIZE_MAX];
+static uint8_t HostSimRandomCount = 0;
+static uint8_t HostSimRandomIdx = 0;
+static uint32_t HostSimRandomState;
+
+void HostSimSetRandom(const uint8_t *Bytes, uint8_t ByteCount) {
+    HostSimRandomCount = MIN(ByteCount, sizeof(HostSimRandomBytes));
+    HostSimRandomIdx = 0;
+    memcpy(HostSimRandomBytes, Bytes, HostSimRandomCount);
+}
+
+void RandomInit(void) {
+    HostSimRandomState = 0x1337C0DE;
+    HostSimRandomCount = HostSimRandomIdx = 0;
+}
+
+uint8_t RandomGetByte(void) {
+    if (HostSimRandomIdx < HostSimRandomCount)
+        return HostSimRandomBytes[HostSimRandomIdx++];
+
+    HostSimRandomState ^= HostSimRandomState << 13;
+    HostSimRandomState ^= HostSimRandomState >> 17;
+    HostSimRandomState ^= HostSimRandomState << 5;
+    return (uint8_t) HostSimRandomState;
+}
+
+void RandomGetBuffer(void *Buffer, uint8_t ByteCount) {
+    uint8_t *BufPtr = (uint8_t *) Buffer;
+
+    while (ByteCount--)
+        *BufPtr++ = RandomGetByte();
+}
+
+void RandomTick(void) {
+}
+
+/*
+ * System, codec and terminal
+ */
+uint16_t SystemGetSysTick(void) {
+    return HostSimSysTick;
+}
+
+void ISO14443ACodecInit(void) {
+}
+
+void ISO14443ACodecDeInit(void) {
+}
+
+void ISO14443ACodecTask(void) {
+}
+
+void CommandLinePendingTaskBreak(void) {
+}
+
+void HostSimInit(void) {
+    GlobalSettings.ActiveSettingIdx = 0;
+    GlobalSettings.ActiveSettingPtr = &GlobalSettings.Settings[0];
+    memset(&HostSimMemoryStats, 0, sizeof(HostSimMemoryStats));
+    MemoryInit();
+    RandomInit();
+}
+
+/*
+ * The 2K3DES CBC helpers used by MIFARE Ultralight C are AVR assembly built on
+ * the XMEGA DES instruction. Frames that need them are reported as unsupported.
+ */
+bool HostSimUnsupported = false;
+
+void CryptoEncrypt2KTDEA_CBCSend(uint16_t Count, const void *Input, void *Output, void *IV, const uint8_t *Keys) {
+    HostSimUnsupported = true;
+    memset(Output, 0, Count * 8);
+}
+
+void CryptoDecrypt2KTDEA_CBCReceive(uint16_t Count, const void *Input, void *Output, void *IV, const uint8_t *Keys) {
+    HostSimUnsupported = true;
+    memset(Output, 0, Count * 8);
+}
@@ -0,0 +1,38 @@
+/* HostSim.h
+ *
+ * Host stand-ins for the hardware backed firmware modules (FRAM/flash via the
+ * Memory.h API, log, random numbers, system tick, codec), used by the
+ * application simulator that is built by `make host-sim`.
+ */
+
+#ifndef __TESTS_HOST_SIM_H__
+#define __TESTS_HOST_SIM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HOST_SIM_FRAM_SIZE              0x10000
+#define HOST_SIM_NONCE_SIZE_MAX         16
+
+typedef struct {
+    uint32_t ReadCount;    /* One per MemoryRead* call, i.e. per SPI transaction on the device */
+    uint32_t ReadBytes;
+    uint32_t WriteCount;
+    uint32_t WriteBytes;
+} HostSimMemoryStatsType;
+
+extern uint8_t HostSimFRAM[HOST_SIM_FRAM_SIZE];
+extern HostSimMemoryStatsType HostSimMemoryStats;
+extern uint16_t HostSimSysTick;
+extern bool HostSimVerbose;
+/* Set when the last frame needed a function that cannot run on the host */
+extern bool HostSimUnsupported;
+
+void HostSimInit(void);
+/* Load a card image into the working copy and into the (simulated) flash of the setting */
+void HostSimLoadImage(const uint8_t *Image, uint16_t ByteCount);
+/* The next RandomGetBuffer/RandomGetByte calls return these bytes before falling back
+ * to a fixed pseudo random sequence, e.g. to replay a recorded card nonce */
+void HostSimSetRandom(const uint8_t *Bytes, uint8_t ByteCount);
+
+#endif /* __TESTS_HOST_SIM_H__ */
@@ -0,0 +1,66 @@
+/* HostSimShim.h
+ *
+ * Force-included (-include) into every firmware source of the host simulator,
+ * see `make host-sim`. The card applications only need a handful of
+ * definitions from the codec, terminal and system headers, which otherwise
+ * pull in XMEGA registers and LUFA. Their include guards are claimed here and
+ * the few definitions the applications use are provided instead.
+ */
+
+#ifndef __TESTS_HOST_SIM_SHIM_H__
+#define __TESTS_HOST_SIM_SHIM_H__
+
+#ifndef HOST_BUILD
+#error "HostSimShim.h is only meant for host builds (-DHOST_BUILD)"
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Codec/Codec.h and the codec headers included by it */
+#define CODEC_H_
+#define ISO14443_2A_H_
+#define READER14443_2A_H_
+#define CHAMELEON_MINI_SNIFFISO14443_2A_H
+#define ISO15693_H_
+#define SNIFF_ISO15693_H_
+
+#define CODEC_BUFFER_SIZE                   256
+
+#define ISO14443A_APP_NO_RESPONSE           0x0000
+#define ISO14443A_APP_CUSTOM_PARITY         0x1000
+#define ISO14443A_BUFFER_PARITY_OFFSET      (CODEC_BUFFER_SIZE/2)
+
+#define CodecInit()                         ActiveConfiguration.CodecInitFunc()
+#define CodecDeInit()                       ActiveConfiguration.CodecDeInitFunc()
+#define CodecTask()                         ActiveConfiguration.CodecTaskFunc()
+
+void ISO14443ACodecInit(void);
+void ISO14443ACodecDeInit(void);
+void ISO14443ACodecTask(void);
+
+/* Terminal/Terminal.h, Terminal/CommandLine.h */
+#define TERMINAL_H_
+#define COMMANDLINE_H_
+
+#define TERMINAL_BUFFER_SIZE                512
+
+extern uint8_t TerminalBuffer[TERMINAL_BUFFER_SIZE];
+
+void TerminalSendByte(uint8_t Byte);
+void TerminalSendChar(char c);
+void TerminalSendBlock(const void *Buffer, uint16_t ByteCount);
+
+void CommandLinePendingTaskBreak(void);
+
+/* AntennaLevel.h, included but not used by Configuration.c */
+#define ANTENNALEVEL_H_
+
+/* System.h */
+#define SYSTEM_H
+
+uint16_t SystemGetSysTick(void);
+
+#endif /* __TESTS_HOST_SIM_SHIM_H__ */
@@ -0,0 +1,13 @@
+/* Host stand-in, see HostSimShim.h. The simulator has no persistent settings. */
+#ifndef __TESTS_HOST_SIM_AVR_EEPROM_H__
+#define __TESTS_HOST_SIM_AVR_EEPROM_H__
+
+#include <stdint.h>
+
+#define EEMEM
+
+static inline void eeprom_update_byte(uint8_t *Address, uint8_t Value) { }
+static inline void eeprom_update_word(uint16_t *Address, uint16_t Value) { }
+static inline void eeprom_update_block(const void *Source, void *Address, size_t Size) { }
+
+#endif
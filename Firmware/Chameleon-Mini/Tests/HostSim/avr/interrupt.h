@@ -0,0 +1,5 @@
+/* Host stand-in, see HostSimShim.h */
+#ifndef __TESTS_HOST_SIM_AVR_INTERRUPT_H__
+#define __TESTS_HOST_SIM_AVR_INTERRUPT_H__
+
+#endif
@@ -0,0 +1,16 @@
+/* Host stand-in, see HostSimShim.h */
+#ifndef __TESTS_HOST_SIM_AVR_IO_H__
+#define __TESTS_HOST_SIM_AVR_IO_H__
+
+#include <stdint.h>
+
+/* AES module bits, for the enums of Application/CryptoAES128.h */
+#define AES_DECRYPT_bm                      0x40
+#define AES_AUTO_bm                         0x04
+#define AES_XOR_bm                          0x02
+#define AES_INTLVL_OFF_gc                   0x00
+#define AES_INTLVL_LO_gc                    0x01
+#define AES_INTLVL_MED_gc                   0x02
+#define AES_INTLVL_HI_gc                    0x03
+
+#endif
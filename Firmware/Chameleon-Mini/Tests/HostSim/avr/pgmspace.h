@@ -0,0 +1,24 @@
+/* Host stand-in, see HostSimShim.h. Program memory is ordinary memory. */
+#ifndef __TESTS_HOST_SIM_AVR_PGMSPACE_H__
+#define __TESTS_HOST_SIM_AVR_PGMSPACE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P                       const char *
+#define PSTR(s)                     (s)
+#define pgm_read_byte(Address)      (*(const uint8_t *) (Address))
+#define pgm_read_word(Address)      (*(const uint16_t *) (Address))
+#define pgm_read_dword(Address)     (*(const uint32_t *) (Address))
+#define pgm_read_ptr(Address)       (*(void * const *) (Address))
+#define memcpy_P                    memcpy
+#define memcmp_P                    memcmp
+#define strcpy_P                    strcpy
+#define strncpy_P                   strncpy
+#define strcmp_P                    strcmp
+#define strlen_P                    strlen
+#define snprintf_P                  snprintf
+
+#endif
@@ -0,0 +1,27 @@
+/* Host stand-in, see HostSimShim.h. Same algorithms as the avr-libc versions. */
+#ifndef __TESTS_HOST_SIM_UTIL_CRC16_H__
+#define __TESTS_HOST_SIM_UTIL_CRC16_H__
+
+#include <stdint.h>
+
+static inline uint16_t _crc16_update(uint16_t Crc, uint8_t Data) {
+    Crc ^= Data;
+    for (uint8_t i = 0; i < 8; i++)
+        Crc = (Crc & 1) ? (Crc >> 1) ^ 0xA001 : (Crc >> 1);
+    return Crc;
+}
+
+static inline uint16_t _crc_ccitt_update(uint16_t Crc, uint8_t Data) {
+    Data ^= Crc & 0xFF;
+    Data ^= Data << 4;
+    return ((((uint16_t) Data << 8) | (Crc >> 8)) ^ (uint8_t)(Data >> 4) ^ ((uint16_t) Data << 3));
+}
+
+static inline uint16_t _crc_xmodem_update(uint16_t Crc, uint8_t Data) {
+    Crc ^= (uint16_t) Data << 8;
+    for (uint8_t i = 0; i < 8; i++)
+        Crc = (Crc & 0x8000) ? (Crc << 1) ^ 0x1021 : (Crc << 1);
+    return Crc;
+}
+
+#endif
@@ -0,0 +1,7 @@
+/* Host stand-in, see HostSimShim.h */
+#ifndef __TESTS_HOST_SIM_UTIL_PARITY_H__
+#define __TESTS_HOST_SIM_UTIL_PARITY_H__
+
+#define parity_even_bit(Value)      __builtin_parity((uint8_t) (Value))
+
+#endif
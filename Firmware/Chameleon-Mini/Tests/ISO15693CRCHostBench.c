@@ -0,0 +1,196 @@
+/* ISO15693CRCHostBench.c
+ *
+ * Host-native regression check and microbenchmark for the ISO15693 CRC in
+ * Application/ISO15693-A.c. Built and run by `make host-bench`.
+ *
+ * The nibble table ISO15693CRCUpdate is compared against the bitwise
+ * calculateCRC that the codec and the applications used before, for every
+ * frame length up to a full codec buffer, random data and random split points
+ * of the streaming calls. ISO15693CRCUpdateByte is run the way the codec
+ * interrupts do, a byte at a time. ISO15693AppendCRC and ISO15693CheckCRC are
+ * checked on the same frames, including a flipped bit and a register handed
+ * over with ISO15693CRCReceived.
+ *
+ * The process exits non-zero on any mismatch.
+ */
+
+#include "../Application/ISO15693-A.h"
+
+#include "HostBench.h"
+
+#define CRC15693_BENCH_RANDOM_TRIALS     64
+#define CRC15693_BENCH_MAX_BYTES         (CODEC_BUFFER_SIZE - ISO15693_CRC16_SIZE)
+#define CRC15693_BENCH_FRAME_SIZE        (1 + 32 * 4) /* READ_MULTIPLE of 32 blocks */
+
+static uint32_t BenchRandomState = 0x1337C0DE;
+
+static uint8_t BenchRandomByte(void) {
+    /* xorshift32, only needs to be reproducible */
+    BenchRandomState ^= BenchRandomState << 13;
+    BenchRandomState ^= BenchRandomState >> 17;
+    BenchRandomState ^= BenchRandomState << 5;
+    return (uint8_t) BenchRandomState;
+}
+
+static void BenchRandomBuffer(uint8_t *Buffer, uint16_t Count) {
+    while (Count--)
+        *Buffer++ = BenchRandomByte();
+}
+
+static uint16_t FailureCount = 0;
+
+static void CheckFailed(const char *What, uint16_t ByteCount, uint32_t Trial) {
+    if (FailureCount++ < 10)
+        printf("  MISMATCH: %s (%u bytes, trial %u)\n", What, ByteCount, Trial);
+}
+
+/*
+ * Reference: the previous bitwise implementation
+ */
+static uint16_t RefCRC(void *FrameBuf, uint16_t FrameBufSize) {
+    uint16_t reg = ISO15693_CRC16_PRESET;
+    uint16_t i;
+    uint8_t j;
+
+    uint8_t *DataPtr = (uint8_t *)FrameBuf;
+
+    for (i = 0; i < FrameBufSize; i++) {
+        reg = reg ^ *DataPtr++;
+        for (j = 0; j < 8; j++) {
+            if (reg & 0x0001) {
+                reg = (reg >> 1) ^ ISO15693_CRC16_POLYNORMAL;
+            } else {
+                reg = (reg >> 1);
+            }
+        }
+    }
+
+    return ~reg;
+}
+
+/*
+ * Cross-check
+ */
+static void CheckFrame(uint16_t ByteCount, uint32_t Trial) {
+    uint8_t Buffer[CODEC_BUFFER_SIZE];
+    uint16_t Expected, Checksum;
+
+    BenchRandomBuffer(Buffer, sizeof(Buffer));
+    Expected = RefCRC(Buffer, ByteCount);
+
+    if ((uint16_t) ~ISO15693CRCUpdate(ISO15693CRCInit(), Buffer, ByteCount) != Expected)
+        CheckFailed("ISO15693CRCUpdate", ByteCount, Trial);
+
+    /* The same frame in up to three pieces of random length */
+    uint16_t Split1 = ByteCount ? BenchRandomByte() % (ByteCount + 1) : 0;
+    uint16_t Split2 = Split1 + (ByteCount - Split1 ? BenchRandomByte() % (ByteCount - Split1 + 1) : 0);
+
+    Checksum = ISO15693CRCInit();
+    Checksum = ISO15693CRCUpdate(Checksum, Buffer, Split1);
+    Checksum = ISO15693CRCUpdate(Checksum, &Buffer[Split1], Split2 - Split1);
+    Checksum = ISO15693CRCUpdate(Checksum, &Buffer[Split2], ByteCount - Split2);
+
+    if ((uint16_t) ~Checksum != Expected)
+        CheckFailed("ISO15693CRCUpdate in pieces", ByteCount, Trial);
+
+    /* As the loadmod interrupt sends it */
+    Checksum = ISO15693CRCInit();
+    for (uint16_t i = 0; i < ByteCount; i++)
+        Checksum = ISO15693CRCUpdateByte(Checksum, Buffer[i]);
+
+    ISO15693CRCFinal(Checksum, &Buffer[ByteCount]);
+
+    if (Buffer[ByteCount] != (Expected & 0xFF) || Buffer[ByteCount + 1] != (Expected >> 8))
+        CheckFailed("ISO15693CRCUpdateByte", ByteCount, Trial);
+
+    Buffer[ByteCount] = ~Buffer[ByteCount];
+    ISO15693AppendCRC(Buffer, ByteCount);
+
+    if (Buffer[ByteCount] != (Expected & 0xFF) || Buffer[ByteCount + 1] != (Expected >> 8))
+        CheckFailed("ISO15693AppendCRC", ByteCount, Trial);
+
+    if (!ISO15693CheckCRC(Buffer, ByteCount))
+        CheckFailed("ISO15693CheckCRC intact", ByteCount, Trial);
+
+    /* As the demod interrupt receives it */
+    Checksum = ISO15693CRCUpdate(ISO15693CRCInit(), Buffer, ByteCount + ISO15693_CRC16_SIZE);
+    ISO15693CRCReceived(Buffer, ByteCount + ISO15693_CRC16_SIZE, Checksum);
+
+    if (!ISO15693CheckCRC(Buffer, ByteCount))
+        CheckFailed("ISO15693CheckCRC received intact", ByteCount, Trial);
+
+    uint16_t Bit = (BenchRandomByte() | BenchRandomByte() << 8) % ((ByteCount + ISO15693_CRC16_SIZE) * 8);
+    Buffer[Bit / 8] ^= 1 << (Bit % 8);
+
+    if (ISO15693CheckCRC(Buffer, ByteCount))
+        CheckFailed("ISO15693CheckCRC flipped bit", ByteCount, Trial);
+
+    Checksum = ISO15693CRCUpdate(ISO15693CRCInit(), Buffer, ByteCount + ISO15693_CRC16_SIZE);
+    ISO15693CRCReceived(Buffer, ByteCount + ISO15693_CRC16_SIZE, Checksum);
+
+    if (ISO15693CheckCRC(Buffer, ByteCount))
+        CheckFailed("ISO15693CheckCRC received flipped bit", ByteCount, Trial);
+
+    /* A register of another frame is not used */
+    Buffer[Bit / 8] ^= 1 << (Bit % 8);
+    ISO15693CRCReceived(Buffer, ByteCount + ISO15693_CRC16_SIZE + 1, Checksum);
+
+    if (!ISO15693CheckCRC(Buffer, ByteCount))
+        CheckFailed("ISO15693CheckCRC other frame received", ByteCount, Trial);
+}
+
+static void CheckAgainstReference(void) {
+    for (uint32_t Trial = 0; Trial < CRC15693_BENCH_RANDOM_TRIALS; Trial++) {
+        for (uint16_t ByteCount = 0; ByteCount <= CRC15693_BENCH_MAX_BYTES; ByteCount++)
+            CheckFrame(ByteCount, Trial);
+    }
+}
+
+/*
+ * Benchmarks
+ */
+static HostBenchType Bench;
+
+static void RunBenchmarks(void) {
+    static const uint16_t FrameSizes[] = { 10, 12, CRC15693_BENCH_FRAME_SIZE };
+    uint8_t Buffer[CODEC_BUFFER_SIZE];
+    char Name[64];
+    volatile uint16_t Sink;
+
+    for (uint8_t i = 0; i < sizeof(FrameSizes) / sizeof(*FrameSizes); i++) {
+        uint16_t ByteCount = FrameSizes[i];
+
+        BenchRandomBuffer(Buffer, sizeof(Buffer));
+
+        snprintf(Name, sizeof(Name), "bitwise calculateCRC (%u bytes)", ByteCount);
+        Bench.Name = Name;
+        HOST_BENCH_RUN(&Bench, Sink = RefCRC(Buffer, ByteCount));
+        HostBenchReport(&Bench, ByteCount, "byte");
+
+        snprintf(Name, sizeof(Name), "ISO15693CRCUpdate (%u bytes)", ByteCount);
+        HOST_BENCH_RUN(&Bench, Sink = ISO15693CRCUpdate(ISO15693CRCInit(), Buffer, ByteCount));
+        HostBenchReport(&Bench, ByteCount, "byte");
+    }
+
+    (void) Sink;
+}
+
+int main(int argc, char *argv[]) {
+    printf("ISO15693 CRC: nibble table CRC vs. bitwise calculateCRC (%u random trials)\n",
+           CRC15693_BENCH_RANDOM_TRIALS);
+    CheckAgainstReference();
+
+    if (FailureCount > 0) {
+        printf("ISO15693 CRC: %u mismatches, not benchmarking\n", FailureCount);
+        return EXIT_FAILURE;
+    }
+
+    printf("ISO15693 CRC: all checks passed\n");
+
+    if (argc > 1 && !strcmp(argv[1], "--check-only"))
+        return EXIT_SUCCESS;
+
+    RunBenchmarks();
+
+    return EXIT_SUCCESS;
+}
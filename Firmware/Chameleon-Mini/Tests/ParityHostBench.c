@@ -0,0 +1,216 @@
+/* ParityHostBench.c
+ *
+ * Host-native regression check and microbenchmark for the ISO14443A parity
+ * framing in Application/ISO14443-3A.c. Built and run by `make host-bench`.
+ *
+ * ISO14443AAddParityBits, ISO14443ARemoveParityBits and
+ * ISO14443ACheckParityBits are compared against the previous reader mode
+ * implementations (kept below verbatim as the reference) for every frame
+ * length up to a full codec buffer, random data and random parity errors.
+ * The whole buffer is compared, including the bytes behind the frame.
+ *
+ * The process exits non-zero on any mismatch.
+ */
+
+#include "../Application/ISO14443-3A.h"
+
+#include "HostBench.h"
+
+#define PARITY_BENCH_RANDOM_TRIALS       64
+#define PARITY_BENCH_BUFFER_SIZE         (CODEC_BUFFER_SIZE + CODEC_BUFFER_SIZE / 8 + 1)
+/* Largest frame that still fits into the codec buffer with parity bits */
+#define PARITY_BENCH_MAX_BYTES           (CODEC_BUFFER_SIZE * 8 / 9)
+#define PARITY_BENCH_FRAME_SIZE          64 /* DESFire frame */
+
+static uint32_t BenchRandomState = 0x1337C0DE;
+
+static uint8_t BenchRandomByte(void) {
+    /* xorshift32, only needs to be reproducible */
+    BenchRandomState ^= BenchRandomState << 13;
+    BenchRandomState ^= BenchRandomState >> 17;
+    BenchRandomState ^= BenchRandomState << 5;
+    return (uint8_t) BenchRandomState;
+}
+
+static void BenchRandomBuffer(uint8_t *Buffer, uint16_t Count) {
+    while (Count--)
+        *Buffer++ = BenchRandomByte();
+}
+
+static uint16_t FailureCount = 0;
+
+static void CheckFailed(const char *What, uint16_t BitCount, uint32_t Trial) {
+    if (FailureCount++ < 10)
+        printf("  MISMATCH: %s (%u bits, trial %u)\n", What, BitCount, Trial);
+}
+
+/*
+ * Reference: the quadratic insertion and the two pass check/removal
+ */
+static uint16_t RefAddParityBits(uint8_t *Buffer, uint16_t BitCount) {
+    if (BitCount == 7)
+        return 7;
+    if (BitCount % 8)
+        return BitCount;
+    uint8_t *currByte, * tmpByte;
+    uint8_t *const lastByte = Buffer + BitCount / 8 + BitCount / 64; // starting address + number of bytes + number of parity bytes
+    currByte = Buffer + BitCount / 8 - 1;
+    uint8_t parity;
+    memset(currByte + 1, 0, lastByte - currByte); // zeroize all bytes used for parity bits
+    while (currByte >= Buffer) { // loop over all input bytes
+        parity = OddParityBit(*currByte); // get parity bit
+        tmpByte = lastByte;
+        while (tmpByte > currByte) { // loop over all bytes from the last byte to the current one -- shifts the whole byte string
+            *tmpByte <<= 1; // shift this byte
+            *tmpByte |= (*(tmpByte - 1) & 0x80) >> 7; // insert the last bit from the previous byte
+            tmpByte--; // go to the previous byte
+        }
+        *(++tmpByte) &= 0xFE; // zeroize the bit, where we want to put the parity bit
+        *tmpByte |= parity & 1; // add the parity bit
+        currByte--; // go to previous input byte
+    }
+    return BitCount + (BitCount / 8);
+}
+
+static uint16_t RefRemoveParityBits(uint8_t *Buffer, uint16_t BitCount) {
+    // Short frame, no parity bit is added
+    if (BitCount == 7)
+        return 7;
+
+    uint16_t i;
+    for (i = 0; i < (BitCount / 9); i++) {
+        Buffer[i] = (Buffer[i + i / 8] >> (i % 8));
+        if (i % 8)
+            Buffer[i] |= (Buffer[i + i / 8 + 1] << (8 - (i % 8)));
+    }
+    return BitCount / 9 * 8;
+}
+
+static bool RefCheckParityBits(uint8_t *Buffer, uint16_t BitCount) {
+    if (BitCount == 7)
+        return true;
+
+    uint16_t i;
+    uint8_t currentByte, parity;
+    for (i = 0; i < (BitCount / 9); i++) {
+        currentByte = (Buffer[i + i / 8] >> (i % 8));
+        if (i % 8)
+            currentByte |= (Buffer[i + i / 8 + 1] << (8 - (i % 8)));
+        parity = OddParityBit(currentByte);
+        if (((Buffer[i + i / 8 + 1] >> (i % 8)) ^ parity) & 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Cross-check
+ */
+static void CheckAdd(uint16_t BitCount, uint32_t Trial) {
+    uint8_t Buffer[PARITY_BENCH_BUFFER_SIZE], RefBuffer[PARITY_BENCH_BUFFER_SIZE];
+
+    BenchRandomBuffer(Buffer, sizeof(Buffer));
+    memcpy(RefBuffer, Buffer, sizeof(Buffer));
+
+    if (ISO14443AAddParityBits(Buffer, BitCount) != RefAddParityBits(RefBuffer, BitCount))
+        CheckFailed("ISO14443AAddParityBits bit count", BitCount, Trial);
+    else if (memcmp(Buffer, RefBuffer, sizeof(Buffer)))
+        CheckFailed("ISO14443AAddParityBits data", BitCount, Trial);
+}
+
+static void CheckRemove(uint16_t BitCount, uint32_t Trial) {
+    uint8_t Buffer[PARITY_BENCH_BUFFER_SIZE], RefBuffer[PARITY_BENCH_BUFFER_SIZE];
+    bool ParityOk;
+
+    /* Correct parity most of the time, otherwise random bits */
+    BenchRandomBuffer(Buffer, sizeof(Buffer));
+    if (Trial % 4 != 0)
+        RefAddParityBits(Buffer, BitCount / 9 * 8);
+    memcpy(RefBuffer, Buffer, sizeof(Buffer));
+
+    if (ISO14443ACheckParityBits(Buffer, BitCount) != RefCheckParityBits(RefBuffer, BitCount))
+        CheckFailed("ISO14443ACheckParityBits", BitCount, Trial);
+
+    bool RefParityOk = RefCheckParityBits(RefBuffer, BitCount);
+
+    if (ISO14443ARemoveParityBits(Buffer, BitCount, &ParityOk) != RefRemoveParityBits(RefBuffer, BitCount))
+        CheckFailed("ISO14443ARemoveParityBits bit count", BitCount, Trial);
+    else if (memcmp(Buffer, RefBuffer, sizeof(Buffer)))
+        CheckFailed("ISO14443ARemoveParityBits data", BitCount, Trial);
+    else if (ParityOk != RefParityOk)
+        CheckFailed("ISO14443ARemoveParityBits parity", BitCount, Trial);
+}
+
+static void CheckAgainstReference(void) {
+    for (uint32_t Trial = 0; Trial < PARITY_BENCH_RANDOM_TRIALS; Trial++) {
+        /* Every bit count, not only whole bytes, to cover the early returns */
+        for (uint16_t BitCount = 0; BitCount <= PARITY_BENCH_MAX_BYTES * 8; BitCount++)
+            CheckAdd(BitCount, Trial);
+
+        for (uint16_t BitCount = 0; BitCount <= PARITY_BENCH_MAX_BYTES * 9; BitCount++)
+            CheckRemove(BitCount, Trial);
+    }
+}
+
+/*
+ * Benchmarks
+ */
+static HostBenchType Bench;
+
+static void RunBenchmarks(void) {
+    static const uint16_t FrameSizes[] = { 4, 18, PARITY_BENCH_FRAME_SIZE };
+    uint8_t Buffer[PARITY_BENCH_BUFFER_SIZE];
+    char Name[64];
+    bool ParityOk;
+
+    for (uint8_t i = 0; i < sizeof(FrameSizes) / sizeof(*FrameSizes); i++) {
+        uint16_t ByteCount = FrameSizes[i];
+
+        BenchRandomBuffer(Buffer, sizeof(Buffer));
+
+        snprintf(Name, sizeof(Name), "legacy add (%u bytes)", ByteCount);
+        Bench.Name = Name;
+        HOST_BENCH_RUN(&Bench, RefAddParityBits(Buffer, ByteCount * 8));
+        HostBenchReport(&Bench, ByteCount, "byte");
+
+        snprintf(Name, sizeof(Name), "ISO14443AAddParityBits (%u bytes)", ByteCount);
+        HOST_BENCH_RUN(&Bench, ISO14443AAddParityBits(Buffer, ByteCount * 8));
+        HostBenchReport(&Bench, ByteCount, "byte");
+
+        snprintf(Name, sizeof(Name), "add+legacy check+remove (%u bytes)", ByteCount);
+        HOST_BENCH_RUN(&Bench, {
+            ISO14443AAddParityBits(Buffer, ByteCount * 8);
+            RefCheckParityBits(Buffer, ByteCount * 9);
+            RefRemoveParityBits(Buffer, ByteCount * 9);
+        });
+        HostBenchReport(&Bench, ByteCount, "byte");
+
+        snprintf(Name, sizeof(Name), "add+ISO14443ARemove (%u bytes)", ByteCount);
+        HOST_BENCH_RUN(&Bench, {
+            ISO14443AAddParityBits(Buffer, ByteCount * 8);
+            ISO14443ARemoveParityBits(Buffer, ByteCount * 9, &ParityOk);
+        });
+        HostBenchReport(&Bench, ByteCount, "byte");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    printf("Parity: ISO14443-3A codec vs. previous reader implementation (%u random trials)\n",
+           PARITY_BENCH_RANDOM_TRIALS);
+    CheckAgainstReference();
+
+    if (FailureCount > 0) {
+        printf("Parity: %u mismatches, not benchmarking\n", FailureCount);
+        return EXIT_FAILURE;
+    }
+
+    printf("Parity: all checks passed\n");
+
+    if (argc > 1 && !strcmp(argv[1], "--check-only"))
+        return EXIT_SUCCESS;
+
+    RunBenchmarks();
+
+    return EXIT_SUCCESS;
+}
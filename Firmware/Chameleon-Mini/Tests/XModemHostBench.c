@@ -0,0 +1,517 @@
+/* XModemHostBench.c
+ *
+ * Host-native regression check for Terminal/XModem.c. Built and run by
+ * `make host-bench`.
+ *
+ * The firmware side runs unchanged against a simulated USB link. The host side
+ * is a straight C port of the transfers in ChamTool/Chameleon/XModem.py. A
+ * setting slot is uploaded and downloaded with the classic and the windowed
+ * protocol, with and without damaged bytes on the link, and a log download
+ * that ends within a frame is checked for its padding. An upload checks that
+ * the last block of a frame only reaches the callback once its CRC has been
+ * checked, and that XModemReceiveClassic makes the host fall back.
+ *
+ * Instead of a timing, the number of link turnarounds per transfer is
+ * reported: the times both directions ran empty because one side waited for
+ * the other. Over USB CDC each of them costs at least one bus frame, which
+ * makes up most of the transfer time of the classic protocol.
+ *
+ * The process exits non-zero on any mismatch.
+ */
+
+#include "../Terminal/XModem.h"
+#include <util/crc16.h>
+
+#include "HostBench.h"
+
+#define XMODEM_BENCH_SLOT_SIZE           8192 /* MEMORY_SIZE_PER_SETTING */
+#define XMODEM_BENCH_LOG_SIZE            3000
+#define XMODEM_BENCH_LINK_SIZE           (XMODEM_BENCH_SLOT_SIZE * 4)
+#define XMODEM_BENCH_IDLE_TICKS          200
+#define XMODEM_BENCH_PROBE_NAKS          2 /* WINDOW_PROBE_NAKS */
+
+#define BYTE_SOH        0x01
+#define BYTE_STX        0x02
+#define BYTE_EOT        0x04
+#define BYTE_ACK        0x06
+#define BYTE_NAK        0x15
+#define BYTE_SYN        0x16
+
+uint8_t TerminalBuffer[TERMINAL_BUFFER_SIZE];
+
+/*
+ * Simulated link, one queue per direction
+ */
+typedef struct {
+    uint8_t Data[XMODEM_BENCH_LINK_SIZE];
+    uint32_t Head, Tail;
+    uint32_t Total;
+    int32_t CorruptAt;              /* Flip a bit of the n-th byte ever queued, -1 for none */
+} LinkQueueType;
+
+static LinkQueueType ToDevice, ToHost;
+static uint32_t Turnarounds;
+
+static void LinkReset(int32_t CorruptToDevice, int32_t CorruptToHost) {
+    memset(&ToDevice, 0, sizeof(ToDevice));
+    memset(&ToHost, 0, sizeof(ToHost));
+    ToDevice.CorruptAt = CorruptToDevice;
+    ToHost.CorruptAt = CorruptToHost;
+    Turnarounds = 0;
+}
+
+static void LinkPut(LinkQueueType *Queue, uint8_t Byte) {
+    if (Queue->Total++ == Queue->CorruptAt)
+        Byte ^= 0x10;
+
+    Queue->Data[Queue->Head++ % XMODEM_BENCH_LINK_SIZE] = Byte;
+}
+
+static uint32_t LinkCount(const LinkQueueType *Queue) {
+    return Queue->Head - Queue->Tail;
+}
+
+static uint8_t LinkGet(LinkQueueType *Queue) {
+    return Queue->Data[Queue->Tail++ % XMODEM_BENCH_LINK_SIZE];
+}
+
+void TerminalSendByte(uint8_t Byte) {
+    LinkPut(&ToHost, Byte);
+}
+
+void TerminalSendChar(char c) {
+    LinkPut(&ToHost, c);
+}
+
+void TerminalSendBlock(const void *Buffer, uint16_t ByteCount) {
+    const uint8_t *DataPtr = Buffer;
+
+    while (ByteCount--)
+        LinkPut(&ToHost, *DataPtr++);
+}
+
+/*
+ * Firmware side: the terminal loop and the memory callbacks
+ */
+static uint8_t DeviceMemory[XMODEM_BENCH_SLOT_SIZE];
+static uint32_t DeviceDataSize;
+static const uint8_t *UploadData;       /* What the host sends */
+static uint16_t DamagedLastBlocks;      /* Last blocks of a frame that reached the callback damaged */
+
+static bool UploadBlock(void *Buffer, uint32_t BlockAddress, uint16_t ByteCount) {
+    /* As MemoryUploadBlock */
+    if (BlockAddress < XMODEM_BENCH_SLOT_SIZE)
+        memcpy(&DeviceMemory[BlockAddress], Buffer, MIN(ByteCount, XMODEM_BENCH_SLOT_SIZE - BlockAddress));
+
+    if ((BlockAddress + ByteCount) % XMODEM_WINDOW_FRAME_SIZE == 0 && memcmp(Buffer, &UploadData[BlockAddress], ByteCount))
+        DamagedLastBlocks++;
+
+    return true;
+}
+
+static bool DownloadBlock(void *Buffer, uint32_t BlockAddress, uint16_t ByteCount) {
+    /* As MemoryDownloadBlock and LogMemLoadBlock, which pad the last block */
+    if (BlockAddress >= DeviceDataSize)
+        return false;
+
+    memset(Buffer, 0x00, ByteCount);
+    memcpy(Buffer, &DeviceMemory[BlockAddress], MIN(ByteCount, DeviceDataSize - BlockAddress));
+    return true;
+}
+
+/* One pass of TerminalTask, returns false when the device had nothing to do */
+static bool DeviceStep(void) {
+    uint32_t Sent = ToHost.Total;
+
+    if (LinkCount(&ToDevice) > 0) {
+        XModemProcessByte(LinkGet(&ToDevice));
+        return true;
+    }
+
+    XModemTask();
+    return ToHost.Total != Sent;
+}
+
+/* The device has processed everything the host sent and left the transfer */
+static bool DeviceFinished(void) {
+    while (DeviceStep());
+
+    return !XModemProcessByte(0x00);
+}
+
+/* The host waits for ByteCount bytes. A turnaround is counted when the device
+ * runs out of work in between, so that the link stays empty until the host
+ * has answered. */
+static bool HostWait(uint32_t ByteCount) {
+    uint16_t IdleTicks = 0;
+    bool Idle = false;
+
+    if (LinkCount(&ToHost) >= ByteCount)
+        return true;
+
+    while (LinkCount(&ToHost) < ByteCount) {
+        if (!DeviceStep()) {
+            if (IdleTicks++ == XMODEM_BENCH_IDLE_TICKS)
+                return false;
+
+            XModemTick();
+            Idle = true;
+        }
+    }
+
+    Turnarounds += Idle || !DeviceStep();
+    return true;
+}
+
+static int16_t HostRead(void) {
+    return HostWait(1) ? LinkGet(&ToHost) : -1;
+}
+
+static bool HostReadBlock(uint8_t *Buffer, uint32_t ByteCount) {
+    if (!HostWait(ByteCount))
+        return false;
+
+    while (ByteCount--)
+        *Buffer++ = LinkGet(&ToHost);
+
+    return true;
+}
+
+static void HostWrite(const uint8_t *Buffer, uint32_t ByteCount) {
+    while (ByteCount--)
+        LinkPut(&ToDevice, *Buffer++);
+}
+
+static void HostWriteByte(uint8_t Byte) {
+    LinkPut(&ToDevice, Byte);
+}
+
+/*
+ * Host side, as XModem.py
+ */
+static uint16_t HostCRC16(const uint8_t *Buffer, uint32_t ByteCount) {
+    uint16_t CRC = 0;
+
+    while (ByteCount--)
+        CRC = _crc_xmodem_update(CRC, *Buffer++);
+
+    return CRC;
+}
+
+static uint8_t HostChecksum(const uint8_t *Buffer, uint32_t ByteCount) {
+    uint8_t Checksum = 0;
+
+    while (ByteCount--)
+        Checksum += *Buffer++;
+
+    return Checksum;
+}
+
+/* Sends the blocks, after the first NAK has been read */
+static uint32_t HostSendBlocks(const uint8_t *Data, uint32_t ByteCount) {
+    uint8_t Frame[3 + XMODEM_BLOCK_SIZE + 1];
+    uint32_t Offset = 0;
+    uint8_t FrameNumber = 1;
+
+    while (Offset < ByteCount) {
+        Frame[0] = BYTE_SOH;
+        Frame[1] = FrameNumber;
+        Frame[2] = 255 - FrameNumber;
+        memcpy(&Frame[3], &Data[Offset], XMODEM_BLOCK_SIZE);
+        Frame[3 + XMODEM_BLOCK_SIZE] = HostChecksum(&Frame[3], XMODEM_BLOCK_SIZE);
+        HostWrite(Frame, sizeof(Frame));
+
+        int16_t Reply = HostRead();
+
+        if (Reply == BYTE_ACK) {
+            FrameNumber++;
+            Offset += XMODEM_BLOCK_SIZE;
+        } else if (Reply != BYTE_NAK) {
+            return 0;
+        }
+    }
+
+    HostWriteByte(BYTE_EOT);
+    return (HostRead() == BYTE_ACK) ? Offset : 0;
+}
+
+static uint32_t HostSendClassic(const uint8_t *Data, uint32_t ByteCount) {
+    if (HostRead() != BYTE_NAK)
+        return 0;
+
+    return HostSendBlocks(Data, ByteCount);
+}
+
+static uint32_t HostReceiveClassic(uint8_t *Data, uint32_t MaxByteCount) {
+    uint8_t Frame[2 + XMODEM_BLOCK_SIZE + 1];
+    uint32_t Offset = 0;
+    uint8_t FrameNumber = 1;
+
+    HostWriteByte(BYTE_NAK);
+
+    while (true) {
+        int16_t Byte = HostRead();
+
+        if (Byte == BYTE_EOT) {
+            HostWriteByte(BYTE_ACK);
+            return Offset;
+        } else if (Byte != BYTE_SOH || !HostReadBlock(Frame, sizeof(Frame))) {
+            return 0;
+        }
+
+        if (Frame[0] == FrameNumber && Frame[1] == 255 - FrameNumber &&
+                Frame[2 + XMODEM_BLOCK_SIZE] == HostChecksum(&Frame[2], XMODEM_BLOCK_SIZE)) {
+            if (Offset + XMODEM_BLOCK_SIZE <= MaxByteCount)
+                memcpy(&Data[Offset], &Frame[2], XMODEM_BLOCK_SIZE);
+
+            Offset += XMODEM_BLOCK_SIZE;
+            FrameNumber++;
+            HostWriteByte(BYTE_ACK);
+        } else {
+            HostWriteByte(BYTE_NAK);
+        }
+    }
+}
+
+static void HostSendFrame(const uint8_t *Data, uint32_t Frame) {
+    uint8_t Header[3] = { BYTE_STX, (uint8_t)(Frame + 1), (uint8_t)(255 - (Frame + 1)) };
+    uint16_t CRC = HostCRC16(&Data[Frame * XMODEM_WINDOW_FRAME_SIZE], XMODEM_WINDOW_FRAME_SIZE);
+    uint8_t Trailer[2] = { CRC >> 8, CRC & 0xFF };
+
+    HostWrite(Header, sizeof(Header));
+    HostWrite(&Data[Frame * XMODEM_WINDOW_FRAME_SIZE], XMODEM_WINDOW_FRAME_SIZE);
+    HostWrite(Trailer, sizeof(Trailer));
+}
+
+static uint32_t HostSendWindowed(const uint8_t *Data, uint32_t ByteCount) {
+    uint32_t FrameCount = ByteCount / XMODEM_WINDOW_FRAME_SIZE;
+    uint32_t NextFrame = 0, AckedFrames = 0;
+    int16_t Byte;
+
+    if (HostRead() != BYTE_NAK)
+        return 0;
+
+    HostWriteByte(BYTE_SYN);
+
+    for (uint8_t i = 0; (Byte = HostRead()) != BYTE_SYN; i++) {
+        if (Byte != BYTE_NAK)
+            return 0;
+
+        if (i == XMODEM_BENCH_PROBE_NAKS - 1)
+            /* No windowed mode, the classic transfer starts right after the NAK */
+            return HostSendBlocks(Data, ByteCount);
+    }
+
+    while (AckedFrames < FrameCount) {
+        while (NextFrame < FrameCount && NextFrame - AckedFrames < XMODEM_WINDOW_FRAME_COUNT)
+            HostSendFrame(Data, NextFrame++);
+
+        uint8_t Reply[2];
+
+        if (!HostReadBlock(Reply, 1))
+            return 0;
+
+        if (Reply[0] != BYTE_ACK && Reply[0] != BYTE_NAK)
+            continue;
+
+        if (!HostReadBlock(&Reply[1], 1))
+            return 0;
+
+        /* Frame numbers of the outstanding frames */
+        uint8_t Outstanding = (uint8_t)(Reply[1] - (AckedFrames + 1));
+
+        if (Outstanding >= NextFrame - AckedFrames)
+            continue;
+
+        if (Reply[0] == BYTE_ACK) {
+            AckedFrames += Outstanding + 1;
+        } else {
+            AckedFrames += Outstanding;
+            NextFrame = AckedFrames;
+        }
+    }
+
+    HostWriteByte(BYTE_EOT);
+    return (HostRead() == BYTE_ACK) ? ByteCount : 0;
+}
+
+static uint32_t HostReceiveWindowed(uint8_t *Data, uint32_t MaxByteCount) {
+    uint8_t Frame[2 + XMODEM_WINDOW_FRAME_SIZE + 2];
+    uint32_t Offset = 0;
+    uint8_t FrameNumber = 1;
+    bool NakSent = false;
+
+    HostWriteByte(BYTE_SYN);
+
+    while (true) {
+        int16_t Byte = HostRead();
+
+        if (Byte < 0) {
+            return 0;
+        } else if (Byte == BYTE_EOT && !NakSent) {
+            HostWriteByte(BYTE_ACK);
+            return Offset;
+        } else if (Byte != BYTE_STX) {
+            /* Lost the start of a frame, look for the next one */
+            if (!NakSent) {
+                HostWriteByte(BYTE_NAK);
+                HostWriteByte(FrameNumber);
+                NakSent = true;
+            }
+
+            continue;
+        } else if (!HostReadBlock(Frame, 2)) {
+            return 0;
+        }
+
+        bool Intact = false;
+
+        if (Frame[1] == 255 - Frame[0]) {
+            if (!HostReadBlock(&Frame[2], XMODEM_WINDOW_FRAME_SIZE + 2))
+                return 0;
+
+            uint16_t CRC = (Frame[2 + XMODEM_WINDOW_FRAME_SIZE] << 8) | Frame[3 + XMODEM_WINDOW_FRAME_SIZE];
+            Intact = (CRC == HostCRC16(&Frame[2], XMODEM_WINDOW_FRAME_SIZE));
+            NakSent &= (Frame[0] != FrameNumber);
+        }
+
+        if (Intact && Frame[0] == FrameNumber) {
+            if (Offset + XMODEM_WINDOW_FRAME_SIZE <= MaxByteCount)
+                memcpy(&Data[Offset], &Frame[2], XMODEM_WINDOW_FRAME_SIZE);
+
+            Offset += XMODEM_WINDOW_FRAME_SIZE;
+            HostWriteByte(BYTE_ACK);
+            HostWriteByte(FrameNumber++);
+        } else if (Intact && (uint8_t)(FrameNumber - Frame[0]) <= XMODEM_WINDOW_FRAME_COUNT) {
+            /* Sent again */
+            HostWriteByte(BYTE_ACK);
+            HostWriteByte(FrameNumber - 1);
+        } else if (!NakSent) {
+            HostWriteByte(BYTE_NAK);
+            HostWriteByte(FrameNumber);
+            NakSent = true;
+        }
+    }
+}
+
+/*
+ * Cross-check
+ */
+static uint16_t FailureCount = 0;
+
+static void CheckFailed(const char *What) {
+    if (FailureCount++ < 10)
+        printf("  MISMATCH: %s\n", What);
+}
+
+static uint32_t BenchRandomState = 0x1337C0DE;
+
+static void BenchRandomBuffer(uint8_t *Buffer, uint32_t Count) {
+    while (Count--) {
+        /* xorshift32, only needs to be reproducible */
+        BenchRandomState ^= BenchRandomState << 13;
+        BenchRandomState ^= BenchRandomState >> 17;
+        BenchRandomState ^= BenchRandomState << 5;
+        *Buffer++ = (uint8_t) BenchRandomState;
+    }
+}
+
+static void Report(const char *Name) {
+    printf("  %-34s %6u turnarounds, %6u bytes to device, %6u bytes to host\n",
+           Name, Turnarounds, ToDevice.Total, ToHost.Total);
+}
+
+static void CheckUpload(const char *Name, bool Windowed, bool ClassicOnly, int32_t CorruptToDevice, int32_t CorruptToHost) {
+    uint8_t Data[XMODEM_BENCH_SLOT_SIZE];
+    uint32_t ByteCount;
+
+    BenchRandomBuffer(Data, sizeof(Data));
+    memset(DeviceMemory, 0x00, sizeof(DeviceMemory));
+    UploadData = Data;
+    DamagedLastBlocks = 0;
+    LinkReset(CorruptToDevice, CorruptToHost);
+
+    if (ClassicOnly)
+        XModemReceiveClassic(UploadBlock);
+    else
+        XModemReceive(UploadBlock);
+
+    ByteCount = Windowed ? HostSendWindowed(Data, sizeof(Data)) : HostSendClassic(Data, sizeof(Data));
+
+    if (ByteCount != sizeof(Data))
+        CheckFailed(Name);
+    else if (memcmp(Data, DeviceMemory, sizeof(Data)) || DamagedLastBlocks > 0)
+        CheckFailed(Name);
+    else if (!DeviceFinished())
+        CheckFailed(Name);
+    else
+        Report(Name);
+}
+
+static void CheckDownload(const char *Name, bool Windowed, uint32_t DataSize, int32_t CorruptToDevice, int32_t CorruptToHost) {
+    uint8_t Data[XMODEM_BENCH_SLOT_SIZE];
+    uint32_t ByteCount, Expected;
+
+    BenchRandomBuffer(DeviceMemory, sizeof(DeviceMemory));
+    memset(Data, 0xFF, sizeof(Data));
+    DeviceDataSize = DataSize;
+    LinkReset(CorruptToDevice, CorruptToHost);
+
+    XModemSend(DownloadBlock);
+    ByteCount = Windowed ? HostReceiveWindowed(Data, sizeof(Data)) : HostReceiveClassic(Data, sizeof(Data));
+
+    /* The last frame is padded with zeros */
+    if (Windowed)
+        Expected = (DataSize + XMODEM_WINDOW_FRAME_SIZE - 1) / XMODEM_WINDOW_FRAME_SIZE * XMODEM_WINDOW_FRAME_SIZE;
+    else
+        Expected = (DataSize + XMODEM_BLOCK_SIZE - 1) / XMODEM_BLOCK_SIZE * XMODEM_BLOCK_SIZE;
+
+    bool PaddingOk = true;
+
+    for (uint32_t i = DataSize; i < Expected; i++)
+        PaddingOk &= (Data[i] == 0x00);
+
+    if (ByteCount != Expected || memcmp(Data, DeviceMemory, DataSize) || !PaddingOk)
+        CheckFailed(Name);
+    else if (!DeviceFinished())
+        CheckFailed(Name);
+    else
+        Report(Name);
+}
+
+/* Index of a byte of the third frame in the stream of the sender */
+#define THIRD_FRAME(Offset, Prefix)   ((Prefix) + 2 * (3 + XMODEM_WINDOW_FRAME_SIZE + 2) + (Offset))
+
+int main(int argc, char *argv[]) {
+    printf("XModem: classic and windowed transfers over a simulated link\n");
+
+    /* The upload stream starts with SYN, the ACK stream to the device as well */
+    CheckUpload("classic upload", false, false, -1, -1);
+    CheckUpload("windowed upload", true, false, -1, -1);
+    CheckUpload("windowed upload, damaged data", true, false, THIRD_FRAME(100, 1), -1);
+    CheckUpload("windowed upload, damaged last block", true, false, THIRD_FRAME(3 + XMODEM_WINDOW_FRAME_SIZE - 10, 1), -1);
+    CheckUpload("windowed upload, damaged number", true, false, THIRD_FRAME(1, 1), -1);
+    CheckUpload("windowed upload, damaged STX", true, false, THIRD_FRAME(0, 1), -1);
+    CheckUpload("windowed upload, damaged ACK", true, false, -1, 4);
+    CheckUpload("windowed upload, damaged ACK number", true, false, -1, 5);
+    CheckUpload("windowed upload to classic only", true, true, -1, -1);
+    CheckDownload("classic download", false, XMODEM_BENCH_SLOT_SIZE, -1, -1);
+    CheckDownload("windowed download", true, XMODEM_BENCH_SLOT_SIZE, -1, -1);
+    CheckDownload("windowed download, damaged data", true, XMODEM_BENCH_SLOT_SIZE, -1, THIRD_FRAME(100, 0));
+    CheckDownload("windowed download, damaged number", true, XMODEM_BENCH_SLOT_SIZE, -1, THIRD_FRAME(1, 0));
+    CheckDownload("windowed download, damaged STX", true, XMODEM_BENCH_SLOT_SIZE, -1, THIRD_FRAME(0, 0));
+    CheckDownload("windowed download, damaged ACK", true, XMODEM_BENCH_SLOT_SIZE, 3, -1);
+    CheckDownload("classic log download", false, XMODEM_BENCH_LOG_SIZE, -1, -1);
+    CheckDownload("windowed log download", true, XMODEM_BENCH_LOG_SIZE, -1, -1);
+
+    if (FailureCount > 0) {
+        printf("XModem: %u failed transfers\n", FailureCount);
+        return EXIT_FAILURE;
+    }
+
+    printf("XModem: all checks passed\n");
+
+    (void) argc;
+    (void) argv;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+#!/usr/bin/python
+#
+# Recovers MIFARE Classic keys from sniffed authentications using the
+# host library in Software/Crypto1Recovery (build it with make there).
+
+import os
+import ctypes
+import binascii
+
+LIBRARY_NAMES = ['libcrypto1recovery.so', 'libcrypto1recovery.dylib']
+LIBRARY_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                           '..', '..', 'Crypto1Recovery', 'Bin')
+KEY_SIZE = 6
+MAX_KEYS = 8
+
+class AuthTrace(ctypes.Structure):
+    _fields_ = [('uid',             ctypes.c_uint8 * 4),
+                ('cardNonce',       ctypes.c_uint8 * 4),
+                ('encReaderNonce',  ctypes.c_uint8 * 4),
+                ('encReaderAnswer', ctypes.c_uint8 * 4),
+                ('encCardAnswer',   ctypes.c_uint8 * 4)]
+
+_library = None
+
+def loadLibrary():
+    global _library
+
+    if (_library is None):
+        paths = [os.environ.get('CRYPTO1_RECOVERY_LIB')]
+        paths += [os.path.join(LIBRARY_DIR, name) for name in LIBRARY_NAMES]
+
+        for path in paths:
+            if (path is not None and os.path.exists(path)):
+                _library = ctypes.CDLL(path)
+                _library.Crypto1RecoverKeys.restype = ctypes.c_int
+                _library.Crypto1RecoverKeys.argtypes = [ctypes.POINTER(AuthTrace),
+                    ctypes.POINTER(ctypes.c_uint8 * KEY_SIZE), ctypes.c_uint, ctypes.c_uint]
+                break
+        else:
+            raise OSError("libcrypto1recovery not found, run make in Software/Crypto1Recovery "
+                          "or set CRYPTO1_RECOVERY_LIB")
+
+    return _library
+
+def stripParityBits(data):
+    # Encrypted frames carry encrypted parity bits, which never pass the parity
+    # check of the log decoder. Drop every 9th bit without checking it.
+    byteCount = (len(data) * 8) // 9
+    stripped = bytearray(byteCount)
+
+    for i in range(byteCount * 9):
+        if (i % 9 != 8):
+            stripped[i // 9] |= ((data[i // 8] >> (i % 8)) & 0x01) << (i % 9)
+
+    return bytes(stripped)
+
+def frameData(logEntry):
+    data = logEntry['data'].replace(' ', '')
+
+    if (data.endswith('!')):
+        return stripParityBits(binascii.a2b_hex(data[:-1]))
+
+    return binascii.a2b_hex(data)
+
+def findAuthSessions(log):
+    # Walks the sniffed frames and collects every complete first authentication
+    # (anticollision, AUTH, nT, {nR}{aR}, {aT}). Nested authentications are
+    # encrypted from the first frame on and are skipped.
+    sessions = []
+    uid = None
+    pendingSelect = None
+    session = None
+
+    for logEntry in log:
+        if (logEntry['eventName'].startswith('CODEC RX SNI READER')):
+            fromReader = True
+        elif (logEntry['eventName'].startswith('CODEC RX SNI CARD')):
+            fromReader = False
+        else:
+            continue
+
+        if (not logEntry['data']):
+            continue
+
+        data = frameData(logEntry)
+
+        if (fromReader):
+            pendingSelect = None
+
+            if (len(data) == 2 and data[0] in (0x93, 0x95, 0x97) and data[1] == 0x20):
+                pendingSelect = data[0]
+                session = None
+            elif (len(data) == 4 and data[0] in (0x60, 0x61) and uid is not None):
+                session = {'uid': uid, 'keyType': 'A' if data[0] == 0x60 else 'B',
+                           'block': data[1], 'nt': None, 'nr': None, 'ar': None}
+            elif (session is not None and session['nt'] is not None and len(data) == 8):
+                session['nr'] = data[0:4]
+                session['ar'] = data[4:8]
+            else:
+                session = None
+        else:
+            if (pendingSelect is not None and len(data) == 5 and
+                    data[0] ^ data[1] ^ data[2] ^ data[3] == data[4]):
+                # Crypto1 uses the last cascade level, i.e. the one that does
+                # not start with the cascade tag 0x88
+                if (data[0] != 0x88):
+                    uid = data[0:4]
+            elif (session is not None and session['nt'] is None and len(data) == 4):
+                session['nt'] = data
+            elif (session is not None and session['ar'] is not None and len(data) == 4):
+                session['at'] = data
+                sessions.append(session)
+                session = None
+            elif (session is not None):
+                session = None
+
+            pendingSelect = None
+
+    return sessions
+
+def recoverKeys(session, threadCount=0):
+    library = loadLibrary()
+
+    trace = AuthTrace()
+    for field, value in (('uid', session['uid']), ('cardNonce', session['nt']),
+                         ('encReaderNonce', session['nr']), ('encReaderAnswer', session['ar']),
+                         ('encCardAnswer', session['at'])):
+        getattr(trace, field)[:] = list(value)
+
+    keys = (ctypes.c_uint8 * KEY_SIZE * MAX_KEYS)()
+    count = library.Crypto1RecoverKeys(ctypes.byref(trace), keys, MAX_KEYS, threadCount)
+
+    if (count < 0):
+        raise MemoryError("Crypto1 key recovery failed")
+
+    return [bytes(keys[i]) for i in range(count)]
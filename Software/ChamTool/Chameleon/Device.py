@@ -11,6 +11,8 @@ class Device:
     COMMAND_VERSION = "VERSION"
     COMMAND_UPLOAD = "UPLOAD"
     COMMAND_DOWNLOAD = "DOWNLOAD"
+    COMMAND_BACKUP = "BACKUP"
+    COMMAND_RESTORE = "RESTORE"
     COMMAND_SETTING = "SETTING"
     COMMAND_UID = "UID"
     COMMAND_GETUID = "GETUID"
@@ -29,7 +31,9 @@ class Device:
     COMMAND_THRESHOLD = "THRESHOLD"
     COMMAND_AUTOCALIBRATE = "AUTOCALIBRATE"
     COMMAND_AUTOTHRESHOLD = "AUTOTHRESHOLD"
+    COMMAND_PROFILE = "PROFILE"
     COMMAND_UPGRADE = "upgrade"
+    COMMAND_BATCH = "BATCH"
 
     STATUS_CODE_OK = 100
     STATUS_CODE_OK_WITH_TEXT = 101
@@ -39,6 +43,9 @@ class Device:
     STATUS_CODE_UNKNOWN_COMMAND = 200
     STATUS_CODE_UNKNOWN_COMMAND_USAGE = 201
     STATUS_CODE_INVALID_PARAMETER = 202
+    STATUS_CODE_TIMEOUT = 203
+    # Batch record of a timeout command, its status line follows when it has finished
+    STATUS_CODE_PENDING = 255
 
     STATUS_CODES_SUCCESS = [
         STATUS_CODE_OK,
@@ -54,6 +61,25 @@ class Device:
         STATUS_CODE_INVALID_PARAMETER
     ]
 
+    STATUS_TEXTS = {
+        STATUS_CODE_OK: "OK",
+        STATUS_CODE_OK_WITH_TEXT: "OK WITH TEXT",
+        STATUS_CODE_WAITING_FOR_XMODEM: "WAITING FOR XMODEM",
+        STATUS_CODE_FALSE: "FALSE",
+        STATUS_CODE_TRUE: "TRUE",
+        STATUS_CODE_UNKNOWN_COMMAND: "UNKNOWN COMMAND",
+        STATUS_CODE_UNKNOWN_COMMAND_USAGE: "INVALID COMMAND USAGE",
+        STATUS_CODE_INVALID_PARAMETER: "INVALID PARAMETER",
+        STATUS_CODE_TIMEOUT: "TIMEOUT",
+        STATUS_CODE_PENDING: "PENDING",
+    }
+
+    # Limits of the BATCH frame, one length byte per command and one count byte
+    BATCH_MAX_COMMANDS = 255
+    BATCH_MAX_COMMAND_LENGTH = 255
+    # Top bit of the answer length of a batch record, the answer has been truncated
+    BATCH_LENGTH_TRUNCATED = 0x8000
+
     LINE_ENDING = "\r"
     SUGGEST_CHAR = "?"
     SET_CHAR = "="
@@ -64,6 +90,7 @@ class Device:
         self.serial = serial.Serial(None, 9600, timeout=5.0)
         self.versionString = ""
         self.supportedConfs = []
+        self.batchSupported = None
 
     def verboseLog(self, text):
         if (self.verboseFunc):
@@ -165,6 +192,92 @@ class Device:
         else:
             return self.writeCmd("{} {}".format(cmd, args))
 
+    def makeResult(self, statusCode, response):
+        result = {'statusCode': statusCode, 'statusText': self.STATUS_TEXTS.get(statusCode, ""), 'response': None}
+
+        if (statusCode == self.STATUS_CODE_OK_WITH_TEXT):
+            result['response'] = response
+        elif (statusCode == self.STATUS_CODE_TRUE):
+            result['response'] = True
+        elif (statusCode == self.STATUS_CODE_FALSE):
+            result['response'] = False
+
+        return result
+
+    def readExactly(self, size):
+        data = self.serial.read(size)
+
+        if (len(data) != size):
+            raise TimeoutError("Batch response incomplete")
+
+        return data
+
+    def isBatchSupported(self):
+        if (self.batchSupported is None):
+            # An empty batch, older firmware answers UNKNOWN COMMAND and ignores the count byte
+            self.serial.write((self.COMMAND_BATCH + self.LINE_ENDING).encode('ascii') + b"\x00")
+            status = self.serial.readline().decode('ascii').rstrip()
+            self.batchSupported = status.startswith("{}:".format(self.STATUS_CODE_OK))
+            self.verboseLog("Batch mode supported: {}".format(self.batchSupported))
+
+        return self.batchSupported
+
+    def execBatch(self, cmds):
+        """Executes a list of complete command lines, e.g. ["CONFIG=MF_CLASSIC_1K", "UID?"],
+        in as few round trips as possible and returns a list with one result per
+        executed command, in the format of execCmd.
+
+        A command that starts an XMODEM transfer or a timeout command ends the batch:
+        its result is the last one, and the caller continues with the transfer or waits
+        for the status line of the pending command. Firmware without batch mode
+        executes the commands one by one."""
+        if (not self.isBatchSupported()):
+            results = []
+            for cmd in cmds:
+                result = self.writeCmd(cmd)
+                results.append(result)
+                if (result is None or result['statusCode'] == self.STATUS_CODE_WAITING_FOR_XMODEM):
+                    break
+            return results
+
+        results = []
+
+        for first in range(0, len(cmds), self.BATCH_MAX_COMMANDS):
+            chunk = [cmd.encode('ascii') for cmd in cmds[first:first + self.BATCH_MAX_COMMANDS]]
+            frame = bytearray([len(chunk)])
+
+            for cmdLine in chunk:
+                if (len(cmdLine) > self.BATCH_MAX_COMMAND_LENGTH):
+                    raise ValueError("Command too long for a batch: {}".format(cmdLine))
+                frame.append(len(cmdLine))
+                frame += cmdLine
+
+            # The frame directly follows the BATCH command, no waiting in between
+            self.serial.write((self.COMMAND_BATCH + self.LINE_ENDING).encode('ascii') + frame)
+
+            status = self.serial.readline().decode('ascii').rstrip()
+            if (not status.startswith("{}:".format(self.STATUS_CODE_OK))):
+                self.verboseLog("Executing batch: {}".format(status))
+                return results
+
+            for cmdLine in chunk:
+                statusCode = self.readExactly(1)[0]
+                length = int.from_bytes(self.readExactly(2), 'little')
+                truncated = (length & self.BATCH_LENGTH_TRUNCATED) != 0
+                response = self.readExactly(length & ~self.BATCH_LENGTH_TRUNCATED).decode('ascii')
+
+                self.verboseLog("Executing <{}>: {} {}{}".format(cmdLine.decode('ascii'), statusCode, response,
+                                                                 " --TRUNCATED OUTPUT--" if truncated else ""))
+                result = self.makeResult(statusCode, response)
+                result['truncated'] = truncated
+                results.append(result)
+
+                if (statusCode in [self.STATUS_CODE_WAITING_FOR_XMODEM, self.STATUS_CODE_PENDING]):
+                    # The device has dropped the rest of the frame
+                    return results
+
+        return results
+
     def getSetCmd(self, cmd, arg=None):
         # Determine if set or get mode
         if (arg is None):
@@ -199,6 +312,22 @@ class Device:
         else:
             return None
 
+    def cmdBackup(self, dataStream):
+        if (self.execCmd(self.COMMAND_BACKUP)['statusCode'] == self.STATUS_CODE_WAITING_FOR_XMODEM):
+            # XMODEM started
+            xmodem = Chameleon.XModem(self.serial, self.verboseFunc)
+            return xmodem.recvData(dataStream)
+        else:
+            return None
+
+    def cmdRestore(self, dataStream):
+        if (self.execCmd(self.COMMAND_RESTORE)['statusCode'] == self.STATUS_CODE_WAITING_FOR_XMODEM):
+            # XMODEM started, RESTORE only takes the classic protocol
+            xmodem = Chameleon.XModem(self.serial, self.verboseFunc, windowed=False)
+            return xmodem.sendData(dataStream)
+        else:
+            return None
+
     def cmdDownloadLog(self, dataStream):
         if (self.execCmd(self.COMMAND_LOG_DOWNLOAD)['statusCode'] == self.STATUS_CODE_WAITING_FOR_XMODEM):
             # XMODEM started
@@ -285,6 +414,12 @@ class Device:
     def cmdAutoThreshold(self, newLogMode):
         return self.getSetCmd(self.COMMAND_AUTOTHRESHOLD, newLogMode)
 
+    def cmdProfile(self, reset = False):
+        if (reset):
+            return self.execCmd(self.COMMAND_PROFILE)
+        else:
+            return self.getSetCmd(self.COMMAND_PROFILE)
+
     def cmdUpgrade(self):
         # Execute command
         cmdLine = self.COMMAND_UPGRADE + self.LINE_ENDING
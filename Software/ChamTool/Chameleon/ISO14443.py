@@ -1,14 +1,25 @@
 import binascii
-import crcmod
 from enum import Enum
 
 from Chameleon.MFDESFire import MFDESFireDecode
 from Chameleon.utils import TrafficSource
 
-# Parameters for CRC_A
+# Parameters for CRC_A, the reflected CRC-CCITT as in the firmware
 CRC_INIT = 0x6363
-POLY = 0x11021
-CRC_A_func = crcmod.mkCrcFun(POLY, initCrc=CRC_INIT, xorOut=0)
+POLY_REFLECTED = 0x8408
+
+
+def _CRC_A_table():
+    table = []
+    for byte in range(256):
+        crc = byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ POLY_REFLECTED if crc & 1 else crc >> 1
+        table.append(crc)
+    return table
+
+
+CRC_A_TABLE = _CRC_A_table()
 
 
 class ReaderCMD(Enum):
@@ -181,8 +192,21 @@ CardTrafficTypes = {
     }
 }
 
+# Streaming interface, mirrors ISO14443ACRCAInit/Update/Final of the firmware
+def CRC_A_init():
+    return CRC_INIT
+
+def CRC_A_update(crc, data):
+    table = CRC_A_TABLE
+    for byte in data:
+        crc = (crc >> 8) ^ table[(crc ^ byte) & 0xFF]
+    return crc
+
+def CRC_A_final(crc):
+    return crc.to_bytes(2, 'little')
+
 def CRC_A(data):
-    return CRC_A_func(data)
+    return CRC_A_update(CRC_A_init(), data)
 
 def CRC_A_check(data):
     datalen = len(data)
@@ -190,11 +214,8 @@ def CRC_A_check(data):
     if(datalen < 3 ):
         return True
 
-    crc = CRC_A(bytearray(data[0:datalen-2])).to_bytes(2,'little')
-    if (data[datalen-2:datalen] == crc):
-        return True
-    else:
-        return False
+    # Over the data and its CRC the residue is 0
+    return CRC_A(data) == 0
 
 def parseReader_3(data):
     global readerCMD
@@ -0,0 +1,175 @@
+#!/usr/bin/python
+#
+# Receives the log entries of the LIVE log mode. The firmware streams the
+# entries back to back in the normal log format (see LiveLogTick.h), split
+# into USB packets wherever the ring buffer wraps or a packet is full.
+#
+# A reader thread does nothing but move the bytes from the serial port into a
+# queue, stamped with their arrival time, so the port is drained no matter
+# how long decoding and printing take. The consumer decodes the bytes
+# incrementally, carrying a partial entry over to the next read, and maps the
+# 16 bit millisecond SysTick of every entry onto the host clock.
+
+import collections
+import queue
+import struct
+import threading
+import time
+
+import Chameleon.Log
+
+TIMESTAMP_MAX = Chameleon.Log.TIMESTAMP_MAX
+HEADER = struct.Struct('>BBH')
+
+class StreamDecoder:
+    # Incremental decoder: feed() takes the received bytes as they come and
+    # returns the (event, data, timestamp) of every entry they complete.
+    # LIVE mode only sends the normal format, whose framing is cheap enough
+    # in Python. An EMPTY entry (log reset) drops the bytes received so far.
+
+    def __init__(self):
+        self.pending = b''
+
+    def feed(self, data):
+        log = self.pending + data
+        entries = []
+        pos = 0
+
+        while (len(log) - pos >= HEADER.size):
+            (event, dataLength, timestamp) = HEADER.unpack_from(log, pos)
+
+            if (event == Chameleon.Log.LOG_EMPTY):
+                pos = len(log)
+                break
+
+            if (pos + HEADER.size + dataLength > len(log)):
+                break
+
+            entries.append((event, log[pos + HEADER.size:pos + HEADER.size + dataLength], timestamp))
+            pos += HEADER.size + dataLength
+
+        self.pending = log[pos:]
+
+        return entries
+
+class LiveClock:
+    # Fuses the SysTick of the entries with the host clock. The SysTick is
+    # unwrapped into a continuous device time, using the host time between
+    # two entries to count SysTick overflows when the log was quiet for
+    # longer than 65 s. An entry cannot arrive before it was logged, so the
+    # smallest difference between arrival and device time over the last
+    # OFFSET_WINDOW seconds is taken as the offset between both clocks. The
+    # window lets the offset follow the drift between the two crystals.
+    OFFSET_WINDOW = 10.0
+
+    def __init__(self):
+        self.deviceTime = None
+        self.lastTimestamp = None
+        self.lastArrival = None
+        self.offsets = collections.deque()
+
+    def fuse(self, timestamp, arrival):
+        # Returns the host time (seconds since the epoch) at which an entry
+        # with SysTick timestamp was logged, arrival being when it came in.
+        if (self.deviceTime is None):
+            self.deviceTime = timestamp
+        else:
+            tickDelta = (timestamp - self.lastTimestamp) % TIMESTAMP_MAX
+            hostDelta = (arrival - self.lastArrival) * 1000
+            overflows = max(0, round((hostDelta - tickDelta) / TIMESTAMP_MAX))
+            self.deviceTime += tickDelta + overflows * TIMESTAMP_MAX
+
+        self.lastTimestamp = timestamp
+        self.lastArrival = arrival
+
+        # Sliding window minimum of the offset, in ms
+        offset = arrival * 1000 - self.deviceTime
+
+        while (self.offsets and self.offsets[-1][1] >= offset):
+            self.offsets.pop()
+
+        self.offsets.append((arrival, offset))
+
+        while (self.offsets[0][0] < arrival - self.OFFSET_WINDOW):
+            self.offsets.popleft()
+
+        return (self.deviceTime + self.offsets[0][1]) / 1000
+
+class LiveReader(threading.Thread):
+    # Moves everything the serial port receives into a queue as
+    # (arrival time, bytes). An exception ends the thread and is queued
+    # as (arrival time, exception).
+    READ_TIMEOUT = 0.05
+
+    def __init__(self, serialPort):
+        super().__init__(daemon=True)
+        self.serialPort = serialPort
+        self.chunks = queue.Queue()
+        self.stopEvent = threading.Event()
+
+    def run(self):
+        savedTimeout = self.serialPort.timeout
+        self.serialPort.timeout = self.READ_TIMEOUT
+
+        try:
+            while (not self.stopEvent.is_set()):
+                # Everything that is there, or wait for the next byte
+                data = self.serialPort.read(max(1, self.serialPort.in_waiting))
+
+                if (len(data) > 0):
+                    self.chunks.put((time.time(), data))
+        except Exception as error:
+            self.chunks.put((time.time(), error))
+        finally:
+            self.serialPort.timeout = savedTimeout
+
+    def stop(self):
+        self.stopEvent.set()
+        self.join()
+
+class LiveLog:
+    # Entries of the LIVE log mode from serialPort, see read()
+
+    def __init__(self, serialPort):
+        self.reader = LiveReader(serialPort)
+        self.decoder = StreamDecoder()
+        self.clock = LiveClock()
+        self.error = None
+
+    def start(self):
+        self.reader.start()
+
+    def stop(self):
+        self.reader.stop()
+
+    def read(self, timeout=None):
+        # Waits up to timeout seconds (None: forever) for data, then returns
+        # the entries of everything received so far as a list of
+        # (event, data, timestamp, hostTime), hostTime as from LiveClock.
+        # The entries are in the order they were logged. An error of the
+        # serial port is raised once the entries before it have been returned.
+        if (self.error is not None):
+            raise self.error
+
+        try:
+            chunks = [self.reader.chunks.get(timeout=timeout)]
+        except queue.Empty:
+            return []
+
+        while (True):
+            try:
+                chunks.append(self.reader.chunks.get_nowait())
+            except queue.Empty:
+                break
+
+        entries = []
+
+        for (arrival, data) in chunks:
+            if (isinstance(data, Exception)):
+                self.error = data
+                break
+
+            for (event, entryData, timestamp) in self.decoder.feed(data):
+                entries.append((event, entryData, timestamp, self.clock.fuse(timestamp, arrival)))
+
+        return entries
@@ -2,8 +2,15 @@
 
 import struct
 import binascii
-import math
 import Chameleon.ISO14443 as iso14443_3
+import Chameleon.LogParser
+
+# Decode with the library in Software/LogParser when it has been built
+useNativeParser = True
+NATIVE_CHUNK_SIZE = 64 * 1024
+
+# Parity check of a 9 bit group: 8 data bits and the odd parity bit
+parityGroupValid = [bin(group).count('1') % 2 == 1 for group in range(512)]
 
 def checkParityBit(data):
     byteCount = len(data)
@@ -11,31 +18,20 @@ def checkParityBit(data):
     if (byteCount == 1):
         return (True, data)
 
-    # 9 bit is a group, validate bit count is calculated below
-    bitCount = int((byteCount*8)/9) * 9
-    parsedData = bytearray(int(bitCount/9))
-
-    oneCounter = 0            # Counter for count ones in a byte
-    for i in range(0, bitCount):
-        # Get bit i in data
-        byteIndex = math.floor(i/8)
-        bitIndex = i % 8
-        bit = (data[byteIndex] >> bitIndex) & 0x01
-
-        # Check parityBit
-        # Current bit is parityBit
-        if(i % 9 == 8):
-            # Even number of ones in current byte
-            if(oneCounter % 2 and bit == 1):
-                return (False, data)
-            # Odd number of ones in current byte
-            elif((not oneCounter % 2) and bit == 0):
+    # 9 bit is a group, 9 bytes hold 8 groups
+    frameLength = (byteCount * 8) // 9
+    parsedData = bytearray(frameLength)
+
+    for block in range(0, frameLength, 8):
+        bits = int.from_bytes(data[block * 9 // 8:block * 9 // 8 + 9], 'little')
+
+        for i in range(block, min(block + 8, frameLength)):
+            group = bits & 0x1FF
+            if (not parityGroupValid[group]):
                 return (False, data)
-            oneCounter = 0
-        # Current bit is normal bit
-        else:
-            oneCounter += bit
-            parsedData[int(i/9)] |= bit << (i%9)
+            parsedData[i] = group & 0xFF
+            bits >>= 9
+
     return (True, parsedData)
 
 def noDecoder(data):
@@ -47,6 +43,17 @@ def textDecoder(data):
 def binaryDecoder(data):
     return binascii.hexlify(data).decode()
 
+# SOC and EOC of a sniffed frame in carrier cycles, see SniffISO14443-2A.c
+SNIFF_TIMESTAMPS = struct.Struct('<II')
+SNIFF_CLOCK_MAX = 1 << 32
+CARRIER_PER_US = 13.56
+
+def sniffTimestampsDecoder(data):
+    if (len(data) != SNIFF_TIMESTAMPS.size):
+        return binaryDecoder(data)
+
+    return "SOC {} EOC {}".format(*SNIFF_TIMESTAMPS.unpack(data))
+
 def binaryParityDecoder(data):
     isValid, checkedData = checkParityBit(data)
     if(isValid):
@@ -60,6 +67,7 @@ eventTypes = {
     0x11: { 'name': 'CONFIG SET',     'decoder': textDecoder },
     0x12: { 'name': 'SETTING SET',    'decoder': textDecoder },
     0x13: { 'name': 'UID SET',        'decoder': binaryDecoder },
+    0x14: { 'name': 'COMPACT START',  'decoder': noDecoder },
     0x20: { 'name': 'RESET APP',      'decoder': noDecoder },
 
     0x40: { 'name': 'CODEC RX',          'decoder': binaryDecoder },
@@ -72,6 +80,7 @@ eventTypes = {
     0x46: { 'name': 'CODEC RX SNI CARD',                    'decoder': binaryDecoder },
     0x47: { 'name': 'CODEC RX SNI CARD W/PARITY',           'decoder': binaryParityDecoder },
     0x48: { 'name': 'CODEC RX SNI READER FIELD DETECTED',   'decoder': noDecoder },
+    0x49: { 'name': 'CODEC SNI TIMESTAMPS',                 'decoder': sniffTimestampsDecoder },
    
     0x53: { 'name': 'ISO14443A (DESFIRE) STATE',       'decoder': binaryDecoder },
     0x54: { 'name': 'ISO144443-4 (DESFIRE) STATE',     'decoder': binaryDecoder },
@@ -124,38 +133,246 @@ eventTypes = {
 TIMESTAMP_MAX = 65536
 eventTypes = { i : ({'name': f'UNKNOWN {hex(i)}', 'decoder': binaryDecoder} if i not in eventTypes.keys() else eventTypes[i]) for i in range(256) }
 
-def parseBinary(binaryStream, decoder=None):
-    log = []
-    
-    # Completely read file contents and process them byte by byte
-    # logFile = fileHandle.read()
-    # fileIdx = 0
-    lastTimestamp = 0
-    
+LOG_EMPTY = 0x00
+LOG_INFO_CODEC_SNI_TIMESTAMPS = 0x49
+
+sniffReaderEvents = [0x44, 0x45]
+sniffCardEvents = [0x46, 0x47]
+
+class SniffTiming:
+    # Notes for the SNI TIMESTAMPS entries, which follow the frame they time:
+    # the length of the frame and the time from the end of the frame before.
+    # When the direction changes, that is the frame delay time (FDT).
+
+    def __init__(self):
+        self.frameSource = None
+        self.lastSource = None
+        self.lastEOC = None
+
+    def frame(self, event):
+        if (event in sniffReaderEvents):
+            self.frameSource = 'reader'
+        elif (event in sniffCardEvents):
+            self.frameSource = 'card'
+        else:
+            self.frameSource = None
+
+    def note(self, logData):
+        # Takes the decoded timestamps, as from sniffTimestampsDecoder
+        fields = logData.split()
+
+        if (self.frameSource is None or len(fields) != 4):
+            return ""
+
+        (soc, eoc) = (int(fields[1]), int(fields[3]))
+        length = (eoc - soc) % SNIFF_CLOCK_MAX
+        note = "{} {} ({:.1f} us)".format(self.frameSource, length, length / CARRIER_PER_US)
+
+        if (self.lastEOC is not None):
+            delay = (soc - self.lastEOC) % SNIFF_CLOCK_MAX
+            label = "FDT" if self.frameSource != self.lastSource else "after " + self.lastSource
+            note += ", {} {} ({:.1f} us)".format(label, delay, delay / CARRIER_PER_US)
+
+        self.lastSource = self.frameSource
+        self.lastEOC = eoc
+        self.frameSource = None
+
+        return note
+
+# Compact format of the MEMORY_COMPACT log mode, see Log.c in the firmware
+LOG_INFO_COMPACT_START = 0x14
+LOG_INFO_SYSTEM_BOOT = 0xFF
+COMPACT_LONG = 0x01
+COMPACT_END = 0x02
+COMPACT_NO_DATA = 0x03
+COMPACT_DICTIONARY = 0x40
+COMPACT_SHORT_FRAME = 0x80
+
+compactFrameTypes = [0x40, 0x41, 0x44, 0x47]
+
+compactDictionary = [
+    (0x44, b'\x26'), (0x44, b'\x52'), (0x44, b'\x93\x20'), (0x44, b'\x95\x20'), (0x44, b'\x50\x00\x57\xCD'),
+    (0x47, b'\x04\x00\x02'), (0x47, b'\x44\x01\x02'),
+    (0x40, b'\x26'), (0x40, b'\x52'), (0x40, b'\x93\x20'), (0x40, b'\x95\x20'), (0x40, b'\x50\x00\x57\xCD'),
+    (0x41, b'\x04\x00'), (0x41, b'\x44\x00'),
+    (0x93, b''), (0x94, b''), (0x91, b''),
+]
+
+def readVarint(binaryStream):
+    value = 0
+    shift = 0
     while True:
-        # Read log entry header from file
-        header = binaryStream.read(struct.calcsize('<BBH'))
+        byte = binaryStream.read(1)
+        if (len(byte) < 1):
+            return None
+        value |= (byte[0] & 0x7F) << shift
+        shift += 7
+        if (not byte[0] & 0x80):
+            return value
 
-        if (header is None):
-            # No more data available
-            break
+def readCompactEntry(binaryStream, lastTimestamp):
+    # Returns (event, data, timestamp, compact) or None at the end of the log.
+    # event is None for markers that do not produce a log entry.
+    header = binaryStream.read(1)
+    if (len(header) < 1 or header[0] == 0x00):
+        return None
 
-        if (len(header) < struct.calcsize('<BBH')):
-            # No more data available
-            break
-        
-        (event, dataLength, timestamp) = struct.unpack_from('>BBH', header)
-    
-        # Break if there are no more events
-        if (eventTypes[event]['name'] == 'EMPTY'):
+    header = header[0]
+
+    if (header == LOG_INFO_COMPACT_START or header == LOG_INFO_SYSTEM_BOOT):
+        # Entries in normal format: restart and boot
+        rest = binaryStream.read(3)
+        if (len(rest) < 3):
+            return None
+        (dataLength, timestamp) = struct.unpack_from('>BH', rest)
+        return (header, binaryStream.read(dataLength), timestamp, header == LOG_INFO_COMPACT_START)
+    elif (header == COMPACT_END):
+        return (None, b'', lastTimestamp, False)
+    elif (header == COMPACT_LONG):
+        rest = binaryStream.read(2)
+        if (len(rest) < 2):
+            return None
+        (event, dataLength) = rest
+    elif (header == COMPACT_NO_DATA):
+        rest = binaryStream.read(1)
+        if (len(rest) < 1):
+            return None
+        event = rest[0]
+        dataLength = 0
+    elif (header >= COMPACT_SHORT_FRAME):
+        event = compactFrameTypes[(header >> 5) & 0x03]
+        dataLength = (header & 0x1F) + 1
+    elif (header >= COMPACT_DICTIONARY and header - COMPACT_DICTIONARY < len(compactDictionary)):
+        (event, data) = compactDictionary[header - COMPACT_DICTIONARY]
+        dataLength = None
+    else:
+        return None
+
+    delta = readVarint(binaryStream)
+    if (delta is None):
+        return None
+
+    if (dataLength is not None):
+        data = binaryStream.read(dataLength)
+
+    return (event, data, (lastTimestamp + delta) % TIMESTAMP_MAX, True)
+
+def nativeParserAvailable():
+    return useNativeParser and Chameleon.LogParser.available()
+
+def readNativeBlocks(binaryStream, parityEvents=[]):
+    # Yields the blocks of entries decoded by the native parser, see
+    # Chameleon.LogParser.LogParser.feedBlocks. The stream is read in chunks,
+    # so logs of any size are handled in constant memory.
+    parser = Chameleon.LogParser.LogParser(parityEvents)
+
+    while (not parser.ended):
+        chunk = binaryStream.read(NATIVE_CHUNK_SIZE)
+        final = not chunk
+
+        yield from parser.feedBlocks(chunk or b'', final)
+
+        if (final):
             break
 
-        # Read data from file
-        logData = binaryStream.read(dataLength)
+def iterBinary(binaryStream):
+    # Yields (event, data, timestamp) with the raw data of every log entry
+    if (nativeParserAvailable()):
+        return iterNative(binaryStream)
 
-        # Decode data
-        logData = eventTypes[event]['decoder'](logData)
-        
+    return iterPython(binaryStream)
+
+def iterNative(binaryStream):
+    for (entries, entryData) in readNativeBlocks(binaryStream):
+        yield from [(event, entryData[offset:offset + length], timestamp)
+                    for (offset, timestamp, event, _, length, _) in entries]
+
+def iterPython(binaryStream):
+    # As iterBinary. The stream is read entry by entry, so logs of any size
+    # are handled in constant memory.
+    lastTimestamp = 0
+    compact = False
+
+    while True:
+        if (compact):
+            compactEntry = readCompactEntry(binaryStream, lastTimestamp)
+
+            if (compactEntry is None):
+                break
+
+            (event, logData, timestamp, compact) = compactEntry
+
+            if (event is None):
+                continue
+        else:
+            # Read log entry header from file
+            header = binaryStream.read(struct.calcsize('<BBH'))
+
+            if (header is None):
+                # No more data available
+                break
+
+            if (len(header) < struct.calcsize('<BBH')):
+                # No more data available
+                break
+
+            (event, dataLength, timestamp) = struct.unpack_from('>BBH', header)
+
+            # Break if there are no more events
+            if (eventTypes[event]['name'] == 'EMPTY'):
+                break
+
+            # Read data from file
+            logData = binaryStream.read(dataLength)
+
+            compact = (event == LOG_INFO_COMPACT_START)
+
+        lastTimestamp = timestamp
+
+        yield (event, logData, timestamp)
+
+def iterNativeDecoded(binaryStream):
+    # Yields (event, decoded data, timestamp, data length). Whole blocks of
+    # entries are hex encoded at once, the parity bits are checked and
+    # stripped by the native parser.
+    parityEvents = [event for event in eventTypes if eventTypes[event]['decoder'] == binaryParityDecoder]
+    hexEvents = [eventTypes[event]['decoder'] in (binaryDecoder, binaryParityDecoder) for event in range(256)]
+    parityMarks = ["", "", "!"]             # By entry flags: none, PARITY_OK, PARITY_ERROR
+
+    for (entries, entryData) in readNativeBlocks(binaryStream, parityEvents):
+        hexData = entryData.hex()
+
+        yield from [(event,
+                     hexData[2 * offset:2 * (offset + length)] + parityMarks[flags] if hexEvents[event]
+                     else eventTypes[event]['decoder'](entryData[offset:offset + length]),
+                     timestamp, rawLength)
+                    for (offset, timestamp, event, flags, length, rawLength) in entries]
+
+def parseBinary(binaryStream, decoder=None):
+    if (nativeParserAvailable()):
+        entries = iterNativeDecoded(binaryStream)
+    else:
+        entries = ((event, eventTypes[event]['decoder'](logData), timestamp, len(logData))
+                   for (event, logData, timestamp) in iterPython(binaryStream))
+
+    return buildLog(entries, decoder)
+
+def parseEntries(entries, decoder=None, lastTimestamp=0, timing=None):
+    # As parseBinary, for entries as yielded by iterBinary. lastTimestamp is
+    # the timestamp of the entry before and timing the SniffTiming used for
+    # the entries before, if the entries continue a log.
+    return buildLog(((event, eventTypes[event]['decoder'](logData), timestamp, len(logData))
+                     for (event, logData, timestamp) in entries), decoder, lastTimestamp, timing)
+
+def buildLog(entries, decoder=None, lastTimestamp=0, timing=None):
+    # Creates the list of log entry dicts from (event, decoded data, timestamp, data length)
+    log = []
+    eventNames = [eventTypes[event]['name'] for event in range(256)]
+
+    if (timing is None):
+        timing = SniffTiming()
+
+    for (event, logData, timestamp, dataLength) in entries:
         # Calculate delta timestamp respecting 16 bit overflow
         deltaTimestamp = timestamp - lastTimestamp
         lastTimestamp = timestamp
@@ -172,9 +389,14 @@ def parseBinary(binaryStream, decoder=None):
             elif (event == 0x46 or event == 0x47):
                 note = iso14443_3.parseCard(binascii.a2b_hex(logData), decoder)
 
+        if (event == LOG_INFO_CODEC_SNI_TIMESTAMPS):
+            note = timing.note(logData)
+        else:
+            timing.frame(event)
+
         # Create log entry as dict and append it to event list
         logEntry = {
-            'eventName': eventTypes[event]['name'],
+            'eventName': eventNames[event],
             'dataLength': dataLength,
             'timestamp': timestamp,
             'deltaTimestamp': deltaTimestamp,
@@ -185,6 +407,3 @@ def parseBinary(binaryStream, decoder=None):
         log.append(logEntry)
 
     return log
-
-
-        
@@ -0,0 +1,132 @@
+#!/usr/bin/python
+#
+# Decodes binary Chameleon logs with the host library in Software/LogParser
+# (build it with make there). Chameleon.Log uses it when it is available and
+# falls back to its Python decoder otherwise.
+
+import os
+import ctypes
+import struct
+
+LIBRARY_NAMES = ['liblogparser.so', 'liblogparser.dylib']
+LIBRARY_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                           '..', '..', 'LogParser', 'Bin')
+
+# Entry flags, see LogParser.h
+PARITY_OK = 0x01
+PARITY_ERROR = 0x02
+
+DATA_MAX = 255
+
+class ParserState(ctypes.Structure):
+    _fields_ = [('parityEvents',  ctypes.c_uint8 * 32),
+                ('lastTimestamp', ctypes.c_uint16),
+                ('compact',       ctypes.c_bool),
+                ('ended',         ctypes.c_bool)]
+
+class ParserEntry(ctypes.Structure):
+    _fields_ = [('dataOffset', ctypes.c_uint32),
+                ('timestamp',  ctypes.c_uint16),
+                ('event',      ctypes.c_uint8),
+                ('flags',      ctypes.c_uint8),
+                ('dataLength', ctypes.c_uint16),
+                ('rawLength',  ctypes.c_uint16)]
+
+ENTRY_FORMAT = struct.Struct('<IHBBHH')
+
+_library = None
+_libraryMissing = False
+
+def loadLibrary():
+    global _library, _libraryMissing
+
+    if (_library is None and not _libraryMissing):
+        paths = [os.environ.get('LOG_PARSER_LIB')]
+        paths += [os.path.join(LIBRARY_DIR, name) for name in LIBRARY_NAMES]
+
+        for path in paths:
+            if (path is not None and os.path.exists(path)):
+                _library = ctypes.CDLL(path)
+                _library.LogParserInit.restype = None
+                _library.LogParserInit.argtypes = [ctypes.POINTER(ParserState)]
+                _library.LogParserSetParityEvent.restype = None
+                _library.LogParserSetParityEvent.argtypes = [ctypes.POINTER(ParserState), ctypes.c_uint8]
+                _library.LogParse.restype = ctypes.c_size_t
+                _library.LogParse.argtypes = [ctypes.POINTER(ParserState), ctypes.c_char_p, ctypes.c_size_t,
+                    ctypes.c_bool, ctypes.POINTER(ctypes.c_size_t), ctypes.POINTER(ParserEntry),
+                    ctypes.c_size_t, ctypes.c_char_p, ctypes.c_size_t]
+                break
+        else:
+            _libraryMissing = True
+
+    return _library
+
+def available():
+    return loadLibrary() is not None
+
+class LogParser:
+    # Incremental decoder: feed() takes the log in pieces of any size and
+    # returns the entries completed by each piece.
+
+    def __init__(self, parityEvents = []):
+        self.library = loadLibrary()
+
+        if (self.library is None):
+            raise OSError("liblogparser not found, run make in Software/LogParser or set LOG_PARSER_LIB")
+
+        self.state = ParserState()
+        self.library.LogParserInit(ctypes.byref(self.state))
+
+        for event in parityEvents:
+            self.library.LogParserSetParityEvent(ctypes.byref(self.state), event)
+
+        self.pending = b''
+        self.maxEntries = 0
+
+    @property
+    def ended(self):
+        return self.state.ended
+
+    def allocate(self, size):
+        # An entry takes at least two bytes of the log and expands to at most
+        # four data bytes per log byte (compact dictionary entries)
+        if (size // 2 + 1 > self.maxEntries):
+            self.maxEntries = size // 2 + 1
+            self.entries = (ParserEntry * self.maxEntries)()
+            self.dataSize = 4 * size + DATA_MAX
+            self.data = ctypes.create_string_buffer(self.dataSize)
+
+    def feedBlocks(self, data, final = False):
+        # Returns a list of (entries, entryData) blocks, entries being tuples
+        # (dataOffset, timestamp, event, flags, dataLength, rawLength) into
+        # entryData. With final set, a truncated entry at the end is returned
+        # as far as it goes.
+        log = self.pending + bytes(data)
+        consumed = ctypes.c_size_t()
+        blocks = []
+
+        self.allocate(len(log))
+
+        while (not self.state.ended):
+            count = self.library.LogParse(ctypes.byref(self.state), log, len(log), final, ctypes.byref(consumed),
+                                          self.entries, self.maxEntries, self.data, self.dataSize)
+
+            if (count > 0):
+                rawEntries = ctypes.string_at(self.entries, count * ENTRY_FORMAT.size)
+                (offset, _, _, _, length, _) = ENTRY_FORMAT.unpack_from(rawEntries, (count - 1) * ENTRY_FORMAT.size)
+                blocks.append((list(ENTRY_FORMAT.iter_unpack(rawEntries)), ctypes.string_at(self.data, offset + length)))
+
+            log = log[consumed.value:]
+
+            if (count == 0 and consumed.value == 0):
+                break
+
+        self.pending = b'' if self.state.ended else log
+
+        return blocks
+
+    def feed(self, data, final = False):
+        # As feedBlocks, but returns a list of (event, data, timestamp, flags, rawLength)
+        return [(event, entryData[offset:offset + length], timestamp, flags, rawLength)
+                for (entries, entryData) in self.feedBlocks(data, final)
+                for (offset, timestamp, event, flags, length, rawLength) in entries]
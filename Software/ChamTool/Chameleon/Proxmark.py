@@ -0,0 +1,176 @@
+#!/usr/bin/python
+#
+# Converts Chameleon logs into Proxmark3 trace files, which the Proxmark3
+# client opens with `trace load -f <file>` and shows with `trace list -t 14a`.
+#
+# A trace file is a sequence of tracelog_hdr_t records:
+#     32 bits timestamp (little endian)
+#     16 bits duration (little endian)
+#     15 bits data length, 1 bit isResponse (tag to reader)
+#     data length bytes data
+#     ceil(data length / 8) bytes parity, MSB first
+#
+# Timestamps and durations are in carrier periods (1/13.56 MHz), as the
+# Proxmark3 records them for ISO14443A. Frames followed by an SNI TIMESTAMPS
+# entry (firmware built with ENABLE_SNIFF_TIMESTAMPS) take their start and
+# duration from it. Otherwise the log only has a millisecond SysTick, so a
+# frame starts at its millisecond or right after the previous frame,
+# whichever is later. `trace list -u` shows microseconds.
+
+import struct
+
+import Chameleon.Log
+
+CARRIER_PER_MS = 13560
+CARRIER_PER_BIT = 128           # 106 kbit/s
+TIMESTAMP_MAX = 1 << 32
+DURATION_MAX = 0xFFFF
+DATA_LENGTH_MAX = 0x7FFF
+# Sniff clock and SysTick may disagree by this much before the sniff clock
+# is taken to have been restarted
+CLOCK_RESYNC_LIMIT = 1000 * CARRIER_PER_MS
+
+# Frame events and whether they are sent by the card. In reader mode the
+# codec receives from and sends to the card, in emulation the other way round.
+frameEvents = {
+    0x40: False,                    # CODEC RX: reader to emulated card
+    0x41: True,                     # CODEC TX
+    0x42: True,                     # CODEC RX W/PARITY: card to reader mode
+    0x43: False,                    # CODEC TX W/PARITY
+    0x44: False,                    # CODEC RX SNI READER
+    0x45: False,                    # CODEC RX SNI READER W/PARITY
+    0x46: True,                     # CODEC RX SNI CARD
+    0x47: True,                     # CODEC RX SNI CARD W/PARITY
+}
+
+# Events that log the bit stream as sent, with a parity bit after every byte
+parityEvents = [0x42, 0x43, 0x45, 0x47]
+
+def oddParity(byte):
+    return (bin(byte).count('1') + 1) & 0x01
+
+def splitParityBits(data):
+    # Returns the frame bytes and their parity bits from a bit stream with a
+    # parity bit after every byte. A single byte is a frame without parity.
+    if (len(data) <= 1):
+        return (bytes(data), [oddParity(byte) for byte in data])
+
+    byteCount = (len(data) * 8) // 9
+    stream = int.from_bytes(data, 'little')
+    frame = bytearray(byteCount)
+    parity = []
+
+    for i in range(byteCount):
+        group = stream >> (i * 9)
+        frame[i] = group & 0xFF
+        parity.append((group >> 8) & 0x01)
+
+    return (bytes(frame), parity)
+
+def packParityBits(parity):
+    packed = bytearray((len(parity) + 7) // 8)
+
+    for (i, bit) in enumerate(parity):
+        packed[i // 8] |= bit << (7 - i % 8)
+
+    return bytes(packed)
+
+def frameBitCount(frame, isResponse):
+    # Short frames: 7 bit REQA/WUPA and the 4 bit ACK/NAK
+    if (len(frame) == 1):
+        return 4 if isResponse else 7
+
+    return len(frame) * 9
+
+class TraceWriter:
+    def __init__(self, outStream):
+        self.outStream = outStream
+        self.frameCount = 0
+        self.lastTimestamp = None
+        self.time = 0
+        self.frameEnd = 0
+        # A frame is held back until the next entry, which may be its timestamps
+        self.pending = None
+        self.clockTime = None
+        self.lastSOC = None
+
+    def addEntry(self, event, data, timestamp):
+        # Takes an entry as yielded by Chameleon.Log.iterBinary. Returns True
+        # if it is a frame. Call finish() after the last entry.
+        if (self.lastTimestamp is not None):
+            # The SysTick wraps after 65536 ms
+            self.time += (timestamp - self.lastTimestamp) % Chameleon.Log.TIMESTAMP_MAX
+        self.lastTimestamp = timestamp
+
+        if (event == Chameleon.Log.LOG_INFO_CODEC_SNI_TIMESTAMPS):
+            if (self.pending is not None and len(data) == Chameleon.Log.SNIFF_TIMESTAMPS.size):
+                self.setTimestamps(*Chameleon.Log.SNIFF_TIMESTAMPS.unpack(data))
+            self.finish()
+            return False
+
+        self.finish()
+
+        if (event not in frameEvents or len(data) == 0):
+            return False
+
+        isResponse = frameEvents[event]
+
+        if (event in parityEvents):
+            (frame, parity) = splitParityBits(data)
+        else:
+            frame = bytes(data)
+            parity = [oddParity(byte) for byte in frame]
+
+        if (len(frame) == 0):
+            return False
+
+        frame = frame[:DATA_LENGTH_MAX]
+        parity = parity[:DATA_LENGTH_MAX]
+
+        start = max(self.time * CARRIER_PER_MS, self.frameEnd)
+        duration = min(frameBitCount(frame, isResponse) * CARRIER_PER_BIT, DURATION_MAX)
+        self.pending = [start, duration, frame, parity, isResponse]
+
+        return True
+
+    def setTimestamps(self, soc, eoc):
+        # Places the pending frame by its sniff clock timestamps. The sniff
+        # clock wraps after 2^32 carrier periods and starts over with every
+        # codec initialization, the first frame after that keeps its place.
+        (start, _, _, _, _) = self.pending
+
+        if (self.clockTime is not None):
+            clockStart = self.clockTime + (soc - self.lastSOC) % Chameleon.Log.SNIFF_CLOCK_MAX
+
+            if (abs(clockStart - start) <= CLOCK_RESYNC_LIMIT):
+                start = clockStart
+
+        self.clockTime = start
+        self.lastSOC = soc
+        self.pending[0] = start
+        self.pending[1] = min((eoc - soc) % Chameleon.Log.SNIFF_CLOCK_MAX, DURATION_MAX)
+
+    def finish(self):
+        # Writes the pending frame
+        if (self.pending is None):
+            return
+
+        (start, duration, frame, parity, isResponse) = self.pending
+        self.pending = None
+        self.frameEnd = start + duration
+
+        header = struct.pack('<IHH', start % TIMESTAMP_MAX, duration,
+                             len(frame) | (0x8000 if isResponse else 0))
+        self.outStream.write(header + frame + packParityBits(parity))
+        self.frameCount += 1
+
+def convert(binaryStream, outStream):
+    # Writes all frames of a binary log to outStream. Returns the frame count.
+    writer = TraceWriter(outStream)
+
+    for (event, data, timestamp) in Chameleon.Log.iterBinary(binaryStream):
+        writer.addEntry(event, data, timestamp)
+
+    writer.finish()
+
+    return writer.frameCount
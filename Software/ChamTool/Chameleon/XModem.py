@@ -2,35 +2,103 @@
 #
 # Very lightweight implementation of XModem for Chameleon purposes
 # Because the Chameleon uses a CDC over USB, we don't expect any
-# retransmissions at all and thus don't implement it
+# retransmissions at all and thus don't implement it for the classic
+# protocol.
+#
+# Newer firmware also offers a windowed mode with 1 KiB frames, a CRC-16
+# and several frames in flight, see Terminal/XModem.h of the firmware.
+# It is asked for with a SYN byte, older firmware ignores it and the
+# classic protocol is used.
 
 import io
 import time
+import binascii
 
 class XModem:
     BYTE_SOH = b'\x01'
+    BYTE_STX = b'\x02'
     BYTE_NAK = b'\x15'
     BYTE_ACK = b'\x06'
     BYTE_EOT = b'\x04'
-    
-    def __init__(self, ioStream, verboseFunc = None):
+    BYTE_CAN = b'\x18'
+    BYTE_SYN = b'\x16'
+
+    WINDOW_FRAME_SIZE = 1024
+    WINDOW_FRAME_COUNT = 4
+    # The firmware answers a SYN right away, while it sends a NAK every 500 ms
+    # until the transfer starts
+    WINDOW_PROBE_TIMEOUT = 0.2
+    WINDOW_PROBE_NAKS = 2
+    WINDOW_RETRIES = 3
+
+    def __init__(self, ioStream, verboseFunc = None, windowed = True):
         self.ioStream = ioStream
         self.verboseFunc = verboseFunc
+        self.windowed = windowed
 
     def verboseLog(self, text):
         if (self.verboseFunc):
             self.verboseFunc(text)
-            
+
+    def readTimeout(self, size, timeout):
+        savedTimeout = self.ioStream.timeout
+        self.ioStream.timeout = timeout
+        data = self.ioStream.read(size)
+        self.ioStream.timeout = savedTimeout
+        return data
+
+    def logRate(self, text, byteCount, startTime):
+        deltaTime = time.time() - startTime
+        self.verboseLog("{} Bytes {} in {:.2f} sec. ({:.0f} B/s)".format(byteCount, text, deltaTime, byteCount/deltaTime))
+
     def recvData(self, dataStream):
+        if (self.windowed):
+            # Ask for the windowed mode, the first frame follows immediately
+            self.ioStream.write(self.BYTE_SYN)
+            pktId = self.readTimeout(1, self.WINDOW_PROBE_TIMEOUT)
+
+            if (pktId == self.BYTE_STX):
+                return self.recvWindowed(dataStream, pktId)
+
+            self.verboseLog("No windowed XMODEM, using classic XMODEM")
+
+        return self.recvClassic(dataStream)
+
+    def sendData(self, dataStream):
+        self.verboseLog("Waiting for XMODEM Connection")
+
+        # Wait for NAK from receiver to start transmission
+        if (self.ioStream.read(1) != self.BYTE_NAK):
+            # Timeout or different char received
+            return None
+
+        if (self.windowed):
+            # Ask for the windowed mode. Older firmware keeps sending NAKs,
+            # the classic transfer then starts right after one of them
+            self.ioStream.write(self.BYTE_SYN)
+
+            for i in range(self.WINDOW_PROBE_NAKS):
+                reply = self.ioStream.read(1)
+
+                if (reply == self.BYTE_SYN):
+                    return self.sendWindowed(dataStream)
+                elif (reply != self.BYTE_NAK):
+                    return None
+
+            self.verboseLog("No windowed XMODEM, using classic XMODEM")
+
+        return self.sendClassic(dataStream)
+
+    def recvClassic(self, dataStream):
         packetCounter = 1
         bytesReceived = 0
         startTime = time.time()
-        
+
         self.verboseLog("Starting XMODEM Reception")
-            
+
         # Start transmission by issuing a NAK
         self.ioStream.write(self.BYTE_NAK)
-        
+
         while True:
             pktId = self.ioStream.read(1)
 
@@ -43,7 +111,7 @@ class XModem:
                         #In order packet
                         dataBlock = self.ioStream.read(128)
                         checksum = self.ioStream.read(1)
-                        
+
                         if (int(checksum[0]) == (sum(dataBlock) % 256)):
                             # checksum correct
                             dataStream.write(dataBlock)
@@ -61,22 +129,14 @@ class XModem:
                 # Unknown pktId
                 break
 
-        deltaTime = time.time() - startTime
-        self.verboseLog("{} Bytes received in {:.2f} sec. ({:.0f} B/s)".format(bytesReceived, deltaTime, bytesReceived/deltaTime))
-                
+        self.logRate("received", bytesReceived, startTime)
+
         return bytesReceived
-       
-    def sendData(self, dataStream):
+
+    def sendClassic(self, dataStream):
         packetCounter = 1
         bytesSent = 0
         startTime = time.time()
-        
-        self.verboseLog("Waiting for XMODEM Connection")
-        
-        # Wait for NAK from receiver to start transmission
-        if (self.ioStream.read(1) != self.BYTE_NAK):
-            # Timeout or different char received
-            return None
 
         lastBlock = False
         while True:
@@ -105,9 +165,138 @@ class XModem:
                 self.ioStream.read(1)
                 break
 
-        deltaTime = time.time() - startTime
-        self.verboseLog("{} Bytes sent in {:.2f} sec. ({:.0f} B/s)".format(bytesSent, deltaTime, bytesSent/deltaTime))
-        
+        self.logRate("sent", bytesSent, startTime)
+
         return bytesSent
-            
 
+    def recvWindowed(self, dataStream, pktId):
+        frameNumber = 1
+        bytesReceived = 0
+        nakSent = False
+        startTime = time.time()
+
+        self.verboseLog("Starting windowed XMODEM Reception")
+
+        while True:
+            if (pktId == self.BYTE_STX):
+                header = self.ioStream.read(2)
+
+                if (len(header) < 2):
+                    break
+
+                intact = False
+
+                if (header[0] == (255 - header[1])):
+                    frame = self.ioStream.read(self.WINDOW_FRAME_SIZE + 2)
+
+                    if (len(frame) < self.WINDOW_FRAME_SIZE + 2):
+                        break
+
+                    dataBlock = frame[:self.WINDOW_FRAME_SIZE]
+                    crc = int.from_bytes(frame[self.WINDOW_FRAME_SIZE:], 'big')
+                    intact = (binascii.crc_hqx(dataBlock, 0) == crc)
+
+                    if (header[0] == frameNumber):
+                        # The frame that was asked for, NAK it again if damaged
+                        nakSent = False
+
+                if (intact and header[0] == frameNumber):
+                    dataStream.write(dataBlock)
+                    dataStream.flush()
+                    bytesReceived += self.WINDOW_FRAME_SIZE
+                    self.ioStream.write(self.BYTE_ACK + bytes([frameNumber]))
+                    frameNumber = (frameNumber + 1) % 256
+                elif (intact and (frameNumber - header[0]) % 256 <= self.WINDOW_FRAME_COUNT):
+                    # Retransmission
+                    self.ioStream.write(self.BYTE_ACK + bytes([(frameNumber - 1) % 256]))
+                elif (not nakSent):
+                    # Damaged, or frames in between got lost. Ask for all from the expected one on
+                    self.ioStream.write(self.BYTE_NAK + bytes([frameNumber]))
+                    nakSent = True
+            elif (pktId == self.BYTE_EOT and not nakSent):
+                # Transmission done
+                self.ioStream.write(self.BYTE_ACK)
+                break
+            elif (len(pktId) == 0):
+                # Timeout
+                break
+            elif (not nakSent):
+                # Lost the start of a frame
+                self.ioStream.write(self.BYTE_NAK + bytes([frameNumber]))
+                nakSent = True
+
+            pktId = self.ioStream.read(1)
+
+        self.logRate("received", bytesReceived, startTime)
+
+        return bytesReceived
+
+    def sendWindowed(self, dataStream):
+        frames = []
+        nextFrame = 0
+        ackedFrames = 0
+        retries = 0
+        startTime = time.time()
+
+        while True:
+            dataBlock = dataStream.read(self.WINDOW_FRAME_SIZE)
+
+            if (len(dataBlock) == 0):
+                break
+
+            # Last part smaller than a frame -> pad it
+            frames.append(dataBlock + b'\x00' * (self.WINDOW_FRAME_SIZE - len(dataBlock)))
+
+        while (ackedFrames < len(frames)):
+            # Fill the window
+            while (nextFrame < len(frames) and nextFrame - ackedFrames < self.WINDOW_FRAME_COUNT):
+                frameNumber = (nextFrame + 1) % 256
+                crc = binascii.crc_hqx(frames[nextFrame], 0)
+                self.ioStream.write(self.BYTE_STX + bytes([frameNumber, 255 - frameNumber]) +
+                                    frames[nextFrame] + crc.to_bytes(2, 'big'))
+                nextFrame += 1
+
+            reply = self.ioStream.read(1)
+
+            if (len(reply) == 0):
+                # No answer, send all unacknowledged frames again
+                retries += 1
+
+                if (retries > self.WINDOW_RETRIES):
+                    return None
+
+                nextFrame = ackedFrames
+                continue
+            elif (reply == self.BYTE_CAN):
+                return None
+            elif (reply != self.BYTE_ACK and reply != self.BYTE_NAK):
+                continue
+
+            number = self.ioStream.read(1)
+
+            if (len(number) == 0):
+                continue
+
+            # Position of the frame within the outstanding ones
+            outstanding = (number[0] - (ackedFrames + 1)) % 256
+
+            if (outstanding >= nextFrame - ackedFrames):
+                continue
+
+            retries = 0
+
+            if (reply == self.BYTE_ACK):
+                ackedFrames += outstanding + 1
+            else:
+                # Everything in front of the damaged frame arrived
+                ackedFrames += outstanding
+                nextFrame = ackedFrames
+
+        # Write EOT and wait for ACK
+        self.ioStream.write(self.BYTE_EOT)
+        self.ioStream.read(1)
+
+        bytesSent = ackedFrames * self.WINDOW_FRAME_SIZE
+        self.logRate("sent", bytesSent, startTime)
+
+        return bytesSent
@@ -1,5 +1,8 @@
 # Import modules
 import Chameleon.Log
+import Chameleon.Crypto1Recovery
+import Chameleon.Proxmark
+import Chameleon.LiveLog
 
 # Import classes
 from Chameleon.Device import Device
@@ -13,6 +13,9 @@ import io
 import datetime
 from Chameleon.ISO14443 import CardTypesMap
 
+# Longest wait for LIVE log data, so Ctrl-C is noticed on all platforms (seconds)
+LIVE_READ_TIMEOUT = 0.5
+
 def verboseLog(text):
     formatString = "[{}] {}"
     timeString = datetime.datetime.utcnow()
@@ -26,7 +29,7 @@ def formatText(log):
     text = ''
 
     for logEntry in log:
-        if logEntry['data']:
+        if logEntry['data'] and logEntry['eventName'] != 'CODEC SNI TIMESTAMPS':
             # Add spaces every 2 characters
             logEntry['data'] = ' '.join(logEntry['data'][i:i+2] for i in range(0, len(logEntry['data']), 2))
         if logEntry['eventName'] == 'CODEC RX' or logEntry['eventName'] == 'CODEC RX SNI READER':
@@ -37,8 +40,11 @@ def formatText(log):
             text += "TAG "
         else:
             text += "INF "
+        if 'hostTime' in logEntry:
+            # LIVE mode: host time at which the entry was logged
+            hostTime = datetime.datetime.fromtimestamp(logEntry['hostTime'])
+            text += hostTime.strftime('%H:%M:%S.%f')[:-3] + ' '
         text += formatString.format(**logEntry)
-        print("formatting log entry:" + str(logEntry))
 
     return text
 
@@ -47,52 +53,83 @@ def formatJSON(log):
     
     return text
 
-def formatProxmarkTrace(log):
-    # Proxmark trace specifications:
-    #
-    #      /*
-    #    Traceformat:
-    #    32 bits timestamp (little endian)
-    #    16 bits duration (little endian)
-    #    15 bits data length (little endian) (0x7FFF)
-    #    1 bit isResponse (0=reader to tag, 1=tag to reader)
-    #    data length Bytes data
-    #    x Bytes parity,  where x == ceil(data length/8)
-    # */
-
-    # typedef struct {
-    #     uint32_t timestamp;
-    #     uint16_t duration;
-    #     uint16_t data_len : 15;
-    #     bool isResponse : 1;
-    #     uint8_t frame[];
-    #     // data_len         bytes of data
-    #     // ceil(data_len/8) bytes of parity
-    # } PACKED tracelog_hdr_t;
-
-    # #define TRACELOG_HDR_LEN        sizeof(tracelog_hdr_t)
-    # #define TRACELOG_PARITY_LEN(x)  (((x)->data_len - 1) / 8 + 1)
-
-    pass
+def formatSimTrace(log):
+    # Trace for the firmware application simulator (Firmware/Chameleon-Mini/Tests/AppSimulator.c):
+    # reader frames become R lines, the card answers C lines. Add the CONFIG and LOAD lines for
+    # the emulated card before replaying it with `make host-sim`.
+    readerEvents = ['CODEC RX', 'CODEC RX SNI READER']
+    cardEvents = ['CODEC TX', 'CODEC RX SNI CARD', 'CODEC RX SNI CARD W/PARITY']
+
+    lines = ['# Converted by chamlog', '# CONFIG <configuration>', '# LOAD <card image>']
+    pendingReader = None
+
+    def flushReader(answer):
+        # 1 byte reader frames are the 7 bit REQA/WUPA, 1 byte answers are 4 bit ACK/NAK
+        readerFrame = pendingReader.upper() + ('/7' if len(pendingReader) == 2 else '')
+        if answer is None:
+            lines.append('R {}'.format(readerFrame))
+            lines.append('C -')
+            return
+
+        # The card nonce of a first authentication is sent in the clear, replay it
+        if pendingReader[:2] in ['60', '61'] and len(pendingReader) == 8 and len(answer) == 8:
+            lines.append('RANDOM {}'.format(answer.upper()))
+        lines.append('R {}'.format(readerFrame))
+        lines.append('C {}'.format(answer.upper() + ('/4' if len(answer) == 2 else '')))
+
+    for logEntry in log:
+        data = logEntry['data'].replace(' ', '').rstrip('!')
+
+        if logEntry['eventName'] in readerEvents:
+            if pendingReader is not None:
+                flushReader(None)
+            pendingReader = data
+        elif logEntry['eventName'] in cardEvents and pendingReader is not None:
+            flushReader(data)
+            pendingReader = None
+        elif logEntry['eventName'] == 'RESET APP':
+            if pendingReader is not None:
+                flushReader(None)
+                pendingReader = None
+            lines.append('RESET')
+
+    if pendingReader is not None:
+        flushReader(None)
+
+    return '\n'.join(lines)
+
+def printRecoveredKeys(log):
+    for session in Chameleon.Crypto1Recovery.findAuthSessions(log):
+        keys = Chameleon.Crypto1Recovery.recoverKeys(session)
+        keyText = ', '.join(key.hex() for key in keys) if keys else 'not found'
+
+        print("UID {} block {:3d} key {}: {}".format(session['uid'].hex(), session['block'],
+                                                     session['keyType'], keyText))
 
 def main():
     outputTypes = {
         'text': formatText,
-        'json': formatJSON
+        'json': formatJSON,
+        'sim': formatSimTrace
     }
 
+    # Binary output types, written while the log is read
+    streamTypes = ['pm3']
+
     argParser = argparse.ArgumentParser(description="Analyzes binary Chameleon logfiles")
 
     group = argParser.add_mutually_exclusive_group(required=True)
     group.add_argument("-f", "--file", dest="logfile", metavar="LOGFILE")
     group.add_argument("-p", "--port", dest="port", metavar="COMPORT")
     
-    argParser.add_argument("-t", "--type", choices=outputTypes.keys(), default='text',
-                            help="specifies output type")
+    argParser.add_argument("-t", "--type", choices=list(outputTypes.keys()) + streamTypes, default='text',
+                            help="specifies output type, pm3 writes a Proxmark3 trace file")
+    argParser.add_argument("-o", "--output", dest="output", metavar="OUTFILE", help="Write the output to OUTFILE instead of stdout")
     argParser.add_argument("-d", "--decode", dest="decode", choices=CardTypesMap.keys(), default=None, help="Decode the sniffed traffic and application data with a decoder")
     argParser.add_argument("-l", "--live", dest="live", action='store_true', help="Use live logging capabilities of Chameleon")
     argParser.add_argument("-c", "--clear", dest="clear", action='store_true', help="Clear Chameleon's log memory when using -p")
     argParser.add_argument("-m", "--mode", dest="mode", metavar="LOGMODE", help="Additionally set Chameleon's log mode after reading it's memory")
+    argParser.add_argument("-k", "--recover-keys", dest="recoverKeys", action='store_true', help="Recover MIFARE Classic keys from sniffed authentications (needs Software/Crypto1Recovery)")
     argParser.add_argument("-v", "--verbose", dest="verbose", action='store_true', default=0)
 
     args = argParser.parse_args()
@@ -102,7 +139,14 @@ def main():
     else:
         verboseFunc = None
 
-    print("\nNote: If parityBit check failed, '!' is appended to the decoded data and raw data with parity bit is displayed.\n")
+    if (args.type in streamTypes):
+        output = open(args.output, "wb") if args.output is not None else sys.stdout.buffer
+        writer = Chameleon.Proxmark.TraceWriter(output)
+    elif (args.output is not None):
+        sys.stdout = open(args.output, "w")
+
+    if (args.type == 'text'):
+        print("\nNote: If parityBit check failed, '!' is appended to the decoded data and raw data with parity bit is displayed.\n")
     if (args.live):
         # Live logging mode
         if (args.port is not None):
@@ -111,17 +155,41 @@ def main():
             if (chameleon.connect(args.port)):
                 chameleon.cmdLogMode("LIVE")
 
-                while True:
-                    stream = io.BytesIO(chameleon.read())
-                    log = Chameleon.Log.parseBinary(stream, args.decode)
-                    loglist = []
-                    if (len(log) > 0):
-                        loglist.append(outputTypes[args.type](log))
-                    loglist.sort()
-                    for line in loglist:
-                        print(line)
-                    sys.stdout.flush()
-      
+                # Entries that straddle two USB reads are put back together, the
+                # serial port is read by its own thread while the output is written
+                liveLog = Chameleon.LiveLog.LiveLog(chameleon.serial)
+                liveLog.start()
+                lastTimestamp = 0
+                timing = Chameleon.Log.SniffTiming()
+
+                try:
+                    while True:
+                        entries = liveLog.read(LIVE_READ_TIMEOUT)
+
+                        if (len(entries) == 0):
+                            continue
+
+                        if (args.type in streamTypes):
+                            for (event, data, timestamp, hostTime) in entries:
+                                writer.addEntry(event, data, timestamp)
+                            output.flush()
+                            continue
+
+                        log = Chameleon.Log.parseEntries([entry[:3] for entry in entries], args.decode, lastTimestamp, timing)
+                        lastTimestamp = entries[-1][2]
+
+                        for (logEntry, entry) in zip(log, entries):
+                            logEntry['hostTime'] = entry[3]
+
+                        print(outputTypes[args.type](log))
+                        sys.stdout.flush()
+                except KeyboardInterrupt:
+                    liveLog.stop()
+
+                    if (args.type in streamTypes):
+                        writer.finish()
+                        output.flush()
+
     else:
         if (args.logfile is not None):
             handle = open(args.logfile, "rb")
@@ -143,12 +211,27 @@ def main():
             else:
                 sys.exit(2)
                 
+        if (args.type in streamTypes):
+            # Convert entry by entry, captures of any size are fine
+            for entry in Chameleon.Log.iterBinary(handle):
+                writer.addEntry(*entry)
+
+            writer.finish()
+            output.flush()
+
+            if (verboseFunc):
+                verboseFunc("{} frames written".format(writer.frameCount))
+            return
+
         # Parse actual logfile
         log = Chameleon.Log.parseBinary(handle, args.decode)
 
         # Print to console using chosen output type
         print(outputTypes[args.type](log))
 
+        if (args.recoverKeys):
+            printRecoveredKeys(log)
+
 
 if __name__ == "__main__":
     main()
@@ -72,6 +72,20 @@ def cmdDownload(chameleon, arg):
         bytesReceived = chameleon.cmdDownloadDump(fileHandle)
         return "{} Bytes successfully written to {}".format(bytesReceived, arg)
 
+def cmdBackup(chameleon, arg):
+    with open(arg, 'wb') as fileHandle:
+        bytesReceived = chameleon.cmdBackup(fileHandle)
+        return "{} Bytes of all settings successfully written to {}".format(bytesReceived, arg)
+
+def cmdRestore(chameleon, arg):
+    with open(arg, 'rb') as fileHandle:
+        bytesSent = chameleon.cmdRestore(fileHandle)
+
+        if (bytesSent is None):
+            return "Restoring settings from {} failed".format(arg)
+        else:
+            return "{} Bytes of all settings successfully restored from {}".format(bytesSent, arg)
+
 def cmdLog(chameleon, arg):
     with open(arg, 'wb') as fileHandle:
         bytesReceived = chameleon.cmdDownloadLog(fileHandle)
@@ -200,6 +214,65 @@ def cmdAutoThreshold(chameleon, arg):
         else:
             return "Setting Autothreshold failed: {}".format(arg, result['statusText'])
           
+def cmdProfile(chameleon, arg):
+    # Needs a firmware built with PROFILE_HOTPATHS
+    if (arg == "reset"):
+        result = chameleon.cmdProfile(reset=True)
+
+        if (result['statusCode'] in chameleon.STATUS_CODES_SUCCESS):
+            return "Profiling statistics have been reset"
+        else:
+            return "Resetting profiling statistics failed: {}".format(result['statusText'])
+
+    result = chameleon.cmdProfile()
+
+    if (result['statusCode'] != chameleon.STATUS_CODE_OK_WITH_TEXT):
+        return "Profiling is not available: {}".format(result['statusText'])
+
+    # <timer frequency>;<probe>:<count>,<min>,<max>,<mean>,<histogram>...
+    fields = result['response'].split(";")
+    usPerTick = 1e6 / int(fields[0])
+    # Frame delay time after a reader frame ending with a 1 bit, 1236 carrier cycles
+    fdtUs = 1236 / 13.56
+
+    text = "\n{:<12}{:>10}{:>10}{:>10}{:>10}  {}\n".format("probe", "count", "min us", "mean us", "max us", "histogram (< 4^n ticks)")
+
+    for field in fields[1:]:
+        name, values = field.split(":")
+        values = [int(value) for value in values.split(",")]
+        count, minTicks, maxTicks, meanTicks = values[:4]
+
+        text += "{:<12}{:>10}{:>10.1f}{:>10.1f}{:>10.1f}  {}".format(name, count, minTicks * usPerTick, meanTicks * usPerTick,
+                                                               maxTicks * usPerTick, " ".join(str(value) for value in values[4:]))
+
+        if (name == "TURNAROUND"):
+            text += "  (max {:.0f}% of FDT)".format(100 * maxTicks * usPerTick / fdtUs)
+
+        text += "\n"
+
+    return text
+
+def cmdBatch(chameleon, arg):
+    # One command line per line, e.g. CONFIG=MF_CLASSIC_1K, empty lines and # comments are skipped
+    with open(arg, 'r') as fileHandle:
+        cmds = [line.strip() for line in fileHandle]
+    cmds = [cmd for cmd in cmds if cmd and not cmd.startswith("#")]
+
+    results = chameleon.execBatch(cmds)
+    text = ""
+
+    for (cmd, result) in zip(cmds, results):
+        text += "\n{}: {}".format(cmd, result['statusText'])
+        if (result['response'] is not None):
+            text += " {}".format(result['response'])
+        if (result.get('truncated')):
+            text += " --TRUNCATED OUTPUT--"
+
+    if (len(results) < len(cmds)):
+        text += "\n{} commands not executed".format(len(cmds) - len(results))
+
+    return text
+
 def cmdUpgrade(chameleon, arg):
     if(chameleon.cmdUpgrade() == 0):
         print ("Device changed into Upgrade Mode")
@@ -230,6 +303,8 @@ def main():
                                                                                        "Some of these arguments can be used with '" + Chameleon.Device.SUGGEST_CHAR + "' as parameter to get a list of suggestions.")
     cmdArgGroup.add_argument("-u",  "--upload",      dest="upload",      action=CmdListAction, metavar="DUMPFILE",   help="upload a card dump")
     cmdArgGroup.add_argument("-d",  "--download",    dest="download",    action=CmdListAction, metavar="DUMPFILE",   help="download a card dump")
+    cmdArgGroup.add_argument("-B",  "--backup",      dest="backup",      action=CmdListAction, metavar="ARCHIVE",    help="download all settings and their card dumps into one archive")
+    cmdArgGroup.add_argument("-R",  "--restore",     dest="restore",     action=CmdListAction, metavar="ARCHIVE",    help="restore all settings and their card dumps from an archive")
     cmdArgGroup.add_argument("-l",  "--log",         dest="log",         action=CmdListAction, metavar="LOGFILE",    help="download the device log")
     cmdArgGroup.add_argument("-i",  "--info",        dest="info",        action=CmdListAction, nargs=0,              help="retrieve the version information")
     cmdArgGroup.add_argument("-s",  "--setting",     dest="setting",     action=CmdListAction, nargs='?', type=int, choices=Chameleon.VALID_SETTINGS, help="retrieve or set the current setting")
@@ -248,6 +323,8 @@ def main():
     cmdArgGroup.add_argument("-th",  "--threshold",  dest="threshold",   action=CmdListAction, nargs='?', help="retrieve or set the threshold")
     cmdArgGroup.add_argument("-ac",  "--autocalibrate",  dest="auto_calib",   action=CmdListAction, nargs=0, help="Send AutoCalibration command")
     cmdArgGroup.add_argument("-at",  "--autothreshold",  dest="auto_thres",   action=CmdListAction, metavar="0/1", nargs='?', help="DIS-/ENABLES Autothreshold for SniffIso15693 Codec")
+    cmdArgGroup.add_argument("-P",  "--profile",    dest="profile",     action=CmdListAction, metavar="reset", nargs='?', choices=["reset"], help="retrieve or reset the hot path timing statistics (PROFILE_HOTPATHS firmware)")
+    cmdArgGroup.add_argument("-b",  "--batch",      dest="batch",       action=CmdListAction, metavar="CMDFILE",    help="execute the command lines in a file as one batch")
     cmdArgGroup.add_argument("-ug",  "--upgrade",    dest="upgrade",     action=CmdListAction, nargs=0,   help="set the micro Controller to upgrade mode")
 
     args = argParser.parse_args()
@@ -273,6 +350,8 @@ def main():
                 "config"    : cmdConfig,
                 "upload"    : cmdUpload,
                 "download"  : cmdDownload,
+                "backup"    : cmdBackup,
+                "restore"   : cmdRestore,
                 "log"       : cmdLog,
                 "logmode"   : cmdLogMode,
                 "lbutton"   : cmdLButton,
@@ -284,6 +363,8 @@ def main():
                 "threshold" : cmdThreshold,
                 "auto_calib": cmdAutoCalibrate,
                 "auto_thres": cmdAutoThreshold,
+                "profile"   : cmdProfile,
+                "batch"     : cmdBatch,
                 "upgrade"   : cmdUpgrade,
             }
 
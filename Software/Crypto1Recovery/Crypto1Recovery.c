@@ -0,0 +1,422 @@
+/* Crypto1Recovery.c
+ *
+ * See Crypto1Recovery.h for an outline. Notation: x_i is the i-th bit of the
+ * LFSR sequence, x_0..x_47 being the state right after {nR} has been clocked
+ * in. Keystream bit ks_t = f(x_(t+9), x_(t+11), ..., x_(t+47)), so the even
+ * keystream bits depend on odd sequence bits only and vice versa. Both halves
+ * are searched independently as sequences of every other bit:
+ *   odd half:  o_i = x_(9+2i),  ks_(2j)   = f(o_j .. o_(j+19))
+ *   even half: e_i = x_(10+2i), ks_(2j+1) = f(e_j .. e_(j+19))
+ */
+
+#include "Crypto1Recovery.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/* Reuse the filter tables, LFSR masks and the reference cipher functions of
+ * the firmware. */
+#include "../../Firmware/Chameleon-Mini/Application/Crypto1.c"
+
+#define HALF_ODD                  0
+#define HALF_EVEN                 1
+
+#define HALF_STATE_BITS           24
+#define FILTER_INPUT_BITS         20
+/* Keystream bits per half that are checked during the bitsliced enumeration */
+#define ENUM_CHECK_COUNT          (HALF_STATE_BITS - FILTER_INPUT_BITS + 1)
+/* Number of bits each half is extended by beyond the state. Each extension
+ * bit contributes two bits to the join signature. 24 is well below the limit
+ * of 27 given by 64 bits of keystream and makes false joins very rare. */
+#define EXTEND_BITS               24
+#define CANDIDATE_BITS            (HALF_STATE_BITS + EXTEND_BITS)
+
+#define ENUM_LANE_BITS            6
+#define ENUM_WORD_COUNT           (1UL << (HALF_STATE_BITS - ENUM_LANE_BITS))
+
+#define STATE_MASK                ((1ULL << 48) - 1)
+
+typedef struct {
+    uint64_t Sequence;
+    uint64_t Signature;
+} CandidateType;
+
+typedef struct {
+    CandidateType *Entries;
+    size_t Count;
+    size_t Capacity;
+    bool OutOfMemory;
+} CandidateListType;
+
+typedef struct {
+    uint64_t KeyStream;
+    uint8_t Half;
+    uint32_t WordStart;
+    uint32_t WordEnd;
+    CandidateListType List;
+} EnumWorkerType;
+
+/* Lane patterns for the six lowest sequence bits in bitsliced enumeration */
+static const uint64_t LanePattern[ENUM_LANE_BITS] = {
+    0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL, 0xF0F0F0F0F0F0F0F0ULL,
+    0xFF00FF00FF00FF00ULL, 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL
+};
+
+/* LFSR feedback taps on the interleaved 48 bit state (bit i = x_i) */
+static uint64_t FeedbackTaps48;
+
+static void InitFeedbackTaps(void) {
+    FeedbackTaps48 = 0;
+    for (uint8_t i = 0; i < HALF_STATE_BITS; i++) {
+        FeedbackTaps48 |= (uint64_t)((LFSR_MASK_EVEN >> i) & 0x01) << (2 * i);
+        FeedbackTaps48 |= (uint64_t)((LFSR_MASK_ODD >> i) & 0x01) << (2 * i + 1);
+    }
+}
+
+static inline uint8_t Parity64(uint64_t Value) {
+    return __builtin_parityll(Value);
+}
+
+/* Filter on a 20 bit window of one half, using the firmware's tables */
+static inline uint8_t FilterWindow(uint32_t Window) {
+    uint8_t O0 = (uint8_t)(Window << 4);
+    uint8_t O1 = (uint8_t)(Window >> 4);
+    uint8_t O2 = (uint8_t)(Window >> 12);
+    return CRYPTO1_FILTER_OUTPUT_B0_24(O0, O1, O2);
+}
+
+/* Filter on 64 windows at once. Window[m] holds bit m of all 64 windows. */
+static inline uint64_t FilterBitsliced(const uint64_t Window[FILTER_INPUT_BITS]) {
+    uint64_t a = FA(Window[3], Window[2], Window[1], Window[0]);
+    uint64_t b = FB(Window[7], Window[6], Window[5], Window[4]);
+    uint64_t c = FB(Window[11], Window[10], Window[9], Window[8]);
+    uint64_t d = FA(Window[15], Window[14], Window[13], Window[12]);
+    uint64_t e = FB(Window[19], Window[18], Window[17], Window[16]);
+    return FC(e, d, c, b, a);
+}
+
+/* Filter on the full state (bit i = x_(t+i)), Offset 0 for ks_t */
+static inline uint8_t FilterState(uint64_t Lfsr, uint8_t Offset) {
+    uint32_t Window = 0;
+    for (uint8_t m = 0; m < FILTER_INPUT_BITS; m++)
+        Window |= (uint32_t)((Lfsr >> (Offset + 9 + 2 * m)) & 0x01) << m;
+    return FilterWindow(Window);
+}
+
+static inline uint8_t KeyStreamBit(uint64_t KeyStream, uint8_t Index) {
+    return (KeyStream >> Index) & 0x01;
+}
+
+static void CandidateListAppend(CandidateListType *List, uint64_t Sequence, uint64_t Signature) {
+    if (List->Count == List->Capacity) {
+        size_t Capacity = List->Capacity ? 2 * List->Capacity : 4096;
+        CandidateType *Entries = realloc(List->Entries, Capacity * sizeof(CandidateType));
+        if (Entries == NULL) {
+            List->OutOfMemory = true;
+            return;
+        }
+        List->Entries = Entries;
+        List->Capacity = Capacity;
+    }
+    List->Entries[List->Count].Sequence = Sequence;
+    List->Entries[List->Count].Signature = Signature;
+    List->Count++;
+}
+
+/* Contribution of one half to the LFSR recurrence x_(n+48) = sum x_(n+T).
+ * For a new odd bit o_(24+m) (n = 9+2m) the even taps of the recurrence fall
+ * onto odd sequence bits o_(m+k), k in LFSR_MASK_EVEN, the odd taps onto even
+ * sequence bits e_(m+k), k in LFSR_MASK_ODD. For a new even bit e_(24+m)
+ * (n = 10+2m) it is e_(m+k), k in LFSR_MASK_EVEN, and o_(m+1+k), k in
+ * LFSR_MASK_ODD. Both halves compute their share, equal signatures join. */
+static uint64_t Signature(uint64_t Sequence, uint8_t Half) {
+    uint64_t Result = 0;
+
+    for (uint8_t m = 0; m < EXTEND_BITS; m++) {
+        uint64_t NewBitTerm, OtherHalfTerm;
+
+        if (Half == HALF_ODD) {
+            NewBitTerm = ((Sequence >> (HALF_STATE_BITS + m)) & 0x01) ^ Parity64((Sequence >> m) & LFSR_MASK_EVEN);
+            OtherHalfTerm = Parity64((Sequence >> (m + 1)) & LFSR_MASK_ODD);
+        } else {
+            NewBitTerm = Parity64((Sequence >> m) & LFSR_MASK_ODD);
+            OtherHalfTerm = ((Sequence >> (HALF_STATE_BITS + m)) & 0x01) ^ Parity64((Sequence >> m) & LFSR_MASK_EVEN);
+        }
+
+        Result |= NewBitTerm << m;
+        Result |= OtherHalfTerm << (EXTEND_BITS + m);
+    }
+
+    return Result;
+}
+
+/* Depth-first extension of a half sequence by one bit per step. The new bit
+ * at index Length completes the window starting at Length - 19. */
+static void Extend(EnumWorkerType *Worker, uint64_t Sequence, uint8_t Length) {
+    if (Length == CANDIDATE_BITS) {
+        CandidateListAppend(&Worker->List, Sequence, Signature(Sequence, Worker->Half));
+        return;
+    }
+
+    uint8_t WindowStart = Length - (FILTER_INPUT_BITS - 1);
+    uint8_t Expected = KeyStreamBit(Worker->KeyStream, 2 * WindowStart + Worker->Half);
+
+    for (uint8_t Bit = 0; Bit < 2; Bit++) {
+        uint64_t Next = Sequence | ((uint64_t) Bit << Length);
+        if (FilterWindow((uint32_t)(Next >> WindowStart) & 0xFFFFF) == Expected)
+            Extend(Worker, Next, Length + 1);
+    }
+}
+
+static void *EnumWorker(void *Arg) {
+    EnumWorkerType *Worker = Arg;
+    uint64_t Bits[HALF_STATE_BITS];
+    uint64_t Expected[ENUM_CHECK_COUNT];
+
+    for (uint8_t j = 0; j < ENUM_CHECK_COUNT; j++)
+        Expected[j] = KeyStreamBit(Worker->KeyStream, 2 * j + Worker->Half) ? ~0ULL : 0;
+
+    memcpy(Bits, LanePattern, sizeof(LanePattern));
+
+    for (uint32_t Word = Worker->WordStart; Word < Worker->WordEnd && !Worker->List.OutOfMemory; Word++) {
+        uint64_t Valid = ~0ULL;
+
+        for (uint8_t i = ENUM_LANE_BITS; i < HALF_STATE_BITS; i++)
+            Bits[i] = ((Word >> (i - ENUM_LANE_BITS)) & 0x01) ? ~0ULL : 0;
+
+        for (uint8_t j = 0; j < ENUM_CHECK_COUNT && Valid; j++)
+            Valid &= ~(FilterBitsliced(&Bits[j]) ^ Expected[j]);
+
+        while (Valid) {
+            uint8_t Lane = __builtin_ctzll(Valid);
+            Valid &= Valid - 1;
+            Extend(Worker, ((uint64_t) Word << ENUM_LANE_BITS) | Lane, HALF_STATE_BITS);
+        }
+    }
+
+    return NULL;
+}
+
+static int CompareSignature(const void *A, const void *B) {
+    uint64_t a = ((const CandidateType *) A)->Signature;
+    uint64_t b = ((const CandidateType *) B)->Signature;
+    return (a > b) - (a < b);
+}
+
+static void *SortWorker(void *Arg) {
+    CandidateListType *List = Arg;
+    qsort(List->Entries, List->Count, sizeof(CandidateType), CompareSignature);
+    return NULL;
+}
+
+/* Run the enumeration of both halves on ThreadCount threads each and gather
+ * the results in one sorted list per half */
+static int SearchHalves(uint64_t KeyStream, unsigned ThreadCount, CandidateListType Halves[2]) {
+    unsigned WorkerCount = 2 * ThreadCount;
+    EnumWorkerType *Workers = calloc(WorkerCount, sizeof(EnumWorkerType));
+    pthread_t *Threads = calloc(WorkerCount, sizeof(pthread_t));
+    int Result = 0;
+
+    if (Workers == NULL || Threads == NULL) {
+        free(Workers);
+        free(Threads);
+        return -1;
+    }
+
+    for (unsigned i = 0; i < WorkerCount; i++) {
+        unsigned Slice = i % ThreadCount;
+        Workers[i].KeyStream = KeyStream;
+        Workers[i].Half = i / ThreadCount;
+        Workers[i].WordStart = (uint32_t)((ENUM_WORD_COUNT * Slice) / ThreadCount);
+        Workers[i].WordEnd = (uint32_t)((ENUM_WORD_COUNT * (Slice + 1)) / ThreadCount);
+        if (pthread_create(&Threads[i], NULL, EnumWorker, &Workers[i]) != 0) {
+            /* Fall back to doing it ourselves */
+            EnumWorker(&Workers[i]);
+            Threads[i] = 0;
+        }
+    }
+
+    for (unsigned i = 0; i < WorkerCount; i++) {
+        if (Threads[i] != 0)
+            pthread_join(Threads[i], NULL);
+    }
+
+    for (uint8_t Half = 0; Half < 2; Half++) {
+        CandidateListType *List = &Halves[Half];
+        size_t Count = 0;
+
+        for (unsigned i = Half * ThreadCount; i < (Half + 1) * ThreadCount; i++) {
+            if (Workers[i].List.OutOfMemory)
+                Result = -1;
+            Count += Workers[i].List.Count;
+        }
+
+        memset(List, 0, sizeof(CandidateListType));
+        List->Entries = malloc((Count ? Count : 1) * sizeof(CandidateType));
+        if (List->Entries == NULL)
+            Result = -1;
+
+        for (unsigned i = Half * ThreadCount; i < (Half + 1) * ThreadCount; i++) {
+            if (List->Entries != NULL) {
+                memcpy(&List->Entries[List->Count], Workers[i].List.Entries,
+                       Workers[i].List.Count * sizeof(CandidateType));
+                List->Count += Workers[i].List.Count;
+            }
+            free(Workers[i].List.Entries);
+        }
+        List->Capacity = List->Count;
+    }
+
+    free(Workers);
+    free(Threads);
+
+    if (Result == 0) {
+        pthread_t SortThread;
+        if (pthread_create(&SortThread, NULL, SortWorker, &Halves[HALF_ODD]) == 0) {
+            SortWorker(&Halves[HALF_EVEN]);
+            pthread_join(SortThread, NULL);
+        } else {
+            SortWorker(&Halves[HALF_ODD]);
+            SortWorker(&Halves[HALF_EVEN]);
+        }
+    }
+
+    return Result;
+}
+
+/* Undo one LFSR clock. Lfsr holds x_(t+1)..x_(t+48), returns x_t..x_(t+47).
+ * With EncryptedInput set, In is the encrypted bit that was fed back after
+ * decryption with the filter output (as in Crypto1Auth). */
+static uint64_t RollbackBit(uint64_t Lfsr, uint8_t In, bool EncryptedInput) {
+    if (EncryptedInput)
+        In ^= FilterState(Lfsr << 1, 0);
+
+    uint8_t Bit = ((Lfsr >> 47) ^ In ^ Parity64((Lfsr << 1) & FeedbackTaps48)) & 0x01;
+    return ((Lfsr << 1) | Bit) & STATE_MASK;
+}
+
+static uint64_t RollbackWord(uint64_t Lfsr, const uint8_t Input[4], bool EncryptedInput) {
+    for (int8_t i = 31; i >= 0; i--)
+        Lfsr = RollbackBit(Lfsr, (Input[i / 8] >> (i % 8)) & 0x01, EncryptedInput);
+    return Lfsr;
+}
+
+static bool StateMatchesKeyStream(uint64_t Lfsr, uint64_t KeyStream) {
+    for (uint8_t t = 0; t < 64; t++) {
+        if (FilterState(Lfsr, 0) != KeyStreamBit(KeyStream, t))
+            return false;
+        Lfsr = (Lfsr >> 1) | ((uint64_t) Parity64(Lfsr & FeedbackTaps48) << 47);
+    }
+    return true;
+}
+
+static void ExpectedAnswers(const Crypto1AuthTraceType *Trace, uint8_t ReaderAnswer[4], uint8_t CardAnswer[4]) {
+    memcpy(ReaderAnswer, Trace->CardNonce, NONCE_SIZE);
+    Crypto1PRNG(ReaderAnswer, 64);
+    memcpy(CardAnswer, ReaderAnswer, NONCE_SIZE);
+    Crypto1PRNG(CardAnswer, 32);
+}
+
+bool Crypto1VerifyKey(const Crypto1AuthTraceType *Trace, const uint8_t Key[CRYPTO1_RECOVERY_KEY_SIZE]) {
+    uint8_t ReaderAnswer[NONCE_SIZE], CardAnswer[NONCE_SIZE];
+    uint8_t KeyCopy[CRYPTO1_RECOVERY_KEY_SIZE], Uid[NONCE_SIZE], Nonce[NONCE_SIZE];
+    uint8_t Buffer[2 * NONCE_SIZE];
+
+    ExpectedAnswers(Trace, ReaderAnswer, CardAnswer);
+
+    memcpy(KeyCopy, Key, sizeof(KeyCopy));
+    memcpy(Uid, Trace->Uid, sizeof(Uid));
+    memcpy(Nonce, Trace->CardNonce, sizeof(Nonce));
+    memcpy(Buffer, Trace->EncReaderNonce, NONCE_SIZE);
+    memcpy(&Buffer[NONCE_SIZE], Trace->EncReaderAnswer, NONCE_SIZE);
+
+    /* Same sequence as the MIFARE Classic emulation */
+    Crypto1Setup(KeyCopy, Uid, Nonce);
+    Crypto1Auth(&Buffer[0]);
+    Crypto1ByteArray(&Buffer[NONCE_SIZE], NONCE_SIZE);
+    if (memcmp(&Buffer[NONCE_SIZE], ReaderAnswer, NONCE_SIZE))
+        return false;
+
+    memcpy(Buffer, Trace->EncCardAnswer, NONCE_SIZE);
+    Crypto1ByteArray(Buffer, NONCE_SIZE);
+    return memcmp(Buffer, CardAnswer, NONCE_SIZE) == 0;
+}
+
+int Crypto1RecoverKeys(const Crypto1AuthTraceType *Trace, uint8_t (*Keys)[CRYPTO1_RECOVERY_KEY_SIZE],
+                       unsigned MaxKeys, unsigned ThreadCount) {
+    uint8_t ReaderAnswer[NONCE_SIZE], CardAnswer[NONCE_SIZE];
+    uint8_t UidXorNonce[NONCE_SIZE];
+    CandidateListType Halves[2];
+    uint64_t KeyStream = 0;
+    int KeyCount = 0;
+
+    InitFeedbackTaps();
+
+    if (ThreadCount == 0) {
+        long Online = sysconf(_SC_NPROCESSORS_ONLN);
+        ThreadCount = (Online > 0) ? (unsigned) Online : 1;
+    }
+
+    /* ks for {aR} (bits 0..31) and {aT} (bits 32..63) */
+    ExpectedAnswers(Trace, ReaderAnswer, CardAnswer);
+    for (uint8_t i = 0; i < NONCE_SIZE; i++) {
+        KeyStream |= (uint64_t)(uint8_t)(Trace->EncReaderAnswer[i] ^ ReaderAnswer[i]) << (8 * i);
+        KeyStream |= (uint64_t)(uint8_t)(Trace->EncCardAnswer[i] ^ CardAnswer[i]) << (8 * i + 32);
+        UidXorNonce[i] = Trace->Uid[i] ^ Trace->CardNonce[i];
+    }
+
+    if (SearchHalves(KeyStream, ThreadCount, Halves) != 0) {
+        free(Halves[HALF_ODD].Entries);
+        free(Halves[HALF_EVEN].Entries);
+        return -1;
+    }
+
+    /* Merge join on the signatures */
+    size_t i = 0, j = 0;
+    const CandidateListType *Odd = &Halves[HALF_ODD], *Even = &Halves[HALF_EVEN];
+
+    while (i < Odd->Count && j < Even->Count) {
+        uint64_t SigOdd = Odd->Entries[i].Signature, SigEven = Even->Entries[j].Signature;
+
+        if (SigOdd < SigEven) {
+            i++;
+        } else if (SigOdd > SigEven) {
+            j++;
+        } else {
+            size_t EvenStart = j;
+
+            for (; i < Odd->Count && Odd->Entries[i].Signature == SigOdd; i++) {
+                for (j = EvenStart; j < Even->Count && Even->Entries[j].Signature == SigOdd; j++) {
+                    /* Interleave into x_9..x_56 and roll back to x_0..x_47 */
+                    uint64_t Lfsr = 0;
+                    for (uint8_t k = 0; k < HALF_STATE_BITS; k++) {
+                        Lfsr |= ((Odd->Entries[i].Sequence >> k) & 0x01) << (2 * k);
+                        Lfsr |= ((Even->Entries[j].Sequence >> k) & 0x01) << (2 * k + 1);
+                    }
+                    for (uint8_t k = 0; k < 9; k++)
+                        Lfsr = RollbackBit(Lfsr, 0, false);
+
+                    if (!StateMatchesKeyStream(Lfsr, KeyStream))
+                        continue;
+
+                    Lfsr = RollbackWord(Lfsr, Trace->EncReaderNonce, true);
+                    Lfsr = RollbackWord(Lfsr, UidXorNonce, false);
+
+                    uint8_t Key[CRYPTO1_RECOVERY_KEY_SIZE];
+                    for (uint8_t k = 0; k < CRYPTO1_RECOVERY_KEY_SIZE; k++)
+                        Key[k] = (uint8_t)(Lfsr >> (8 * k));
+
+                    if (Crypto1VerifyKey(Trace, Key) && (unsigned) KeyCount < MaxKeys)
+                        memcpy(Keys[KeyCount++], Key, CRYPTO1_RECOVERY_KEY_SIZE);
+                }
+            }
+        }
+    }
+
+    free(Halves[HALF_ODD].Entries);
+    free(Halves[HALF_EVEN].Entries);
+
+    return KeyCount;
+}
@@ -0,0 +1,45 @@
+/* Crypto1Recovery.h
+ *
+ * Host-side MIFARE Classic key recovery from a single sniffed (non-nested)
+ * authentication, using the Crypto1 implementation of the firmware
+ * (Firmware/Chameleon-Mini/Application/Crypto1.c).
+ *
+ * The 64 bits of keystream that encrypt the reader answer {aR} and the card
+ * answer {aT} are enough to recover the 48 bit LFSR state. The state is split
+ * into its odd and even halves (as in the firmware), all 2^24 candidates of
+ * each half are checked against the keystream 64 at a time in bitsliced form,
+ * the survivors are extended bit by bit and finally joined on their LFSR
+ * feedback contributions. The joined states are rolled back through {nR} and
+ * uid^nT to the sector key, which is verified by replaying the whole exchange.
+ */
+
+#ifndef CRYPTO1_RECOVERY_H
+#define CRYPTO1_RECOVERY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CRYPTO1_RECOVERY_KEY_SIZE        6
+#define CRYPTO1_RECOVERY_NONCE_SIZE      4
+
+/* One authentication as seen on the air. All values are in transmission
+ * order, i.e. exactly as logged by the sniffer (with parity bits removed). */
+typedef struct {
+    uint8_t Uid[CRYPTO1_RECOVERY_NONCE_SIZE];               /* UID (CL2 for 7 byte UIDs) */
+    uint8_t CardNonce[CRYPTO1_RECOVERY_NONCE_SIZE];         /* nT, plain */
+    uint8_t EncReaderNonce[CRYPTO1_RECOVERY_NONCE_SIZE];    /* {nR} */
+    uint8_t EncReaderAnswer[CRYPTO1_RECOVERY_NONCE_SIZE];   /* {aR} */
+    uint8_t EncCardAnswer[CRYPTO1_RECOVERY_NONCE_SIZE];     /* {aT} */
+} Crypto1AuthTraceType;
+
+/* Recover the key used in Trace. Up to MaxKeys verified keys are written to
+ * Keys. ThreadCount = 0 uses all online CPUs. Returns the number of keys found
+ * (normally exactly one) or -1 on memory/thread errors. */
+int Crypto1RecoverKeys(const Crypto1AuthTraceType *Trace, uint8_t (*Keys)[CRYPTO1_RECOVERY_KEY_SIZE],
+                       unsigned MaxKeys, unsigned ThreadCount);
+
+/* Re-run the authentication in Trace with Key using the firmware Crypto1
+ * functions, true if both {aR} and {aT} decrypt to the expected answers. */
+bool Crypto1VerifyKey(const Crypto1AuthTraceType *Trace, const uint8_t Key[CRYPTO1_RECOVERY_KEY_SIZE]);
+
+#endif /* CRYPTO1_RECOVERY_H */
@@ -0,0 +1,123 @@
+/* Crypto1RecoveryTool.c
+ *
+ * Command line front end for Crypto1Recovery:
+ *   crypto1recover <uid> <nt> <{nr}> <{ar}> <{at}>   (hex, transmission order)
+ *   crypto1recover --selftest [count]
+ */
+
+#include "Crypto1Recovery.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_KEYS                  8
+
+static bool ParseHex(const char *Hex, uint8_t *Buffer, size_t Size) {
+    if (strlen(Hex) != 2 * Size)
+        return false;
+    for (size_t i = 0; i < Size; i++) {
+        unsigned int Byte;
+        if (sscanf(&Hex[2 * i], "%2x", &Byte) != 1)
+            return false;
+        Buffer[i] = (uint8_t) Byte;
+    }
+    return true;
+}
+
+static void PrintKey(const uint8_t Key[CRYPTO1_RECOVERY_KEY_SIZE]) {
+    for (uint8_t i = 0; i < CRYPTO1_RECOVERY_KEY_SIZE; i++)
+        printf("%02x", Key[i]);
+    printf("\n");
+}
+
+static double Seconds(void) {
+    struct timespec Now;
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    return Now.tv_sec + Now.tv_nsec / 1e9;
+}
+
+/* Emulate card and reader with the firmware functions for random values and
+ * check that the key comes back out. The reader side is not needed: any
+ * {nR} works, the card derives nR from it. */
+extern void Crypto1Setup(uint8_t Key[6], uint8_t Uid[4], uint8_t CardNonce[4]);
+extern void Crypto1Auth(uint8_t EncryptedReaderNonce[4]);
+extern void Crypto1ByteArray(uint8_t *Buffer, uint8_t Count);
+extern void Crypto1PRNG(uint8_t State[4], uint8_t ClockCount);
+
+static int SelfTest(unsigned Count) {
+    unsigned Failures = 0;
+
+    srand((unsigned) time(NULL));
+
+    for (unsigned n = 0; n < Count; n++) {
+        Crypto1AuthTraceType Trace;
+        uint8_t Key[CRYPTO1_RECOVERY_KEY_SIZE], KeyCopy[CRYPTO1_RECOVERY_KEY_SIZE];
+        uint8_t Uid[4], Nonce[4], Keys[MAX_KEYS][CRYPTO1_RECOVERY_KEY_SIZE];
+
+        for (uint8_t i = 0; i < sizeof(Key); i++)
+            Key[i] = rand();
+        for (uint8_t i = 0; i < 4; i++) {
+            Trace.Uid[i] = rand();
+            Trace.CardNonce[i] = rand();
+            Trace.EncReaderNonce[i] = rand();
+        }
+
+        memcpy(KeyCopy, Key, sizeof(Key));
+        memcpy(Uid, Trace.Uid, sizeof(Uid));
+        memcpy(Nonce, Trace.CardNonce, sizeof(Nonce));
+        Crypto1Setup(KeyCopy, Uid, Nonce);
+        Crypto1Auth(Trace.EncReaderNonce);
+
+        memcpy(Trace.EncReaderAnswer, Trace.CardNonce, 4);
+        Crypto1PRNG(Trace.EncReaderAnswer, 64);
+        memcpy(Trace.EncCardAnswer, Trace.EncReaderAnswer, 4);
+        Crypto1PRNG(Trace.EncCardAnswer, 32);
+        Crypto1ByteArray(Trace.EncReaderAnswer, 4);
+        Crypto1ByteArray(Trace.EncCardAnswer, 4);
+
+        double Start = Seconds();
+        int Found = Crypto1RecoverKeys(&Trace, Keys, MAX_KEYS, 0);
+        double Elapsed = Seconds() - Start;
+
+        bool Ok = false;
+        for (int i = 0; i < Found; i++)
+            Ok |= !memcmp(Keys[i], Key, sizeof(Key));
+
+        printf("selftest %u: %s (%d key(s), %.2f s)\n", n, Ok ? "ok" : "FAILED", Found, Elapsed);
+        Failures += !Ok;
+    }
+
+    return Failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    Crypto1AuthTraceType Trace;
+    uint8_t Keys[MAX_KEYS][CRYPTO1_RECOVERY_KEY_SIZE];
+
+    if (argc >= 2 && !strcmp(argv[1], "--selftest"))
+        return SelfTest(argc >= 3 ? (unsigned) atoi(argv[2]) : 3);
+
+    if (argc != 6 ||
+            !ParseHex(argv[1], Trace.Uid, 4) ||
+            !ParseHex(argv[2], Trace.CardNonce, 4) ||
+            !ParseHex(argv[3], Trace.EncReaderNonce, 4) ||
+            !ParseHex(argv[4], Trace.EncReaderAnswer, 4) ||
+            !ParseHex(argv[5], Trace.EncCardAnswer, 4)) {
+        fprintf(stderr, "usage: %s <uid> <nt> <{nr}> <{ar}> <{at}>   (4 byte hex values)\n", argv[0]);
+        fprintf(stderr, "       %s --selftest [count]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int Found = Crypto1RecoverKeys(&Trace, Keys, MAX_KEYS, 0);
+    if (Found < 0) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    for (int i = 0; i < Found; i++)
+        PrintKey(Keys[i]);
+
+    return Found > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,251 @@
+/* LogParser.c
+ *
+ * See LogParser.h. The compact format is described in Log.c of the firmware,
+ * the dictionary and the frame types below have to match the ones there.
+ */
+
+#include "LogParser.h"
+
+#include <string.h>
+
+#define LOG_EMPTY                       0x00
+#define LOG_INFO_COMPACT_START          0x14
+#define LOG_INFO_SYSTEM_BOOT            0xFF
+
+#define LOG_COMPACT_LONG                0x01
+#define LOG_COMPACT_END                 0x02
+#define LOG_COMPACT_NO_DATA             0x03
+#define LOG_COMPACT_DICTIONARY          0x40
+#define LOG_COMPACT_SHORT_FRAME         0x80
+#define LOG_COMPACT_DICT_DATA_MAX       4
+
+#define LOG_NORMAL_HEADER_SIZE          4
+
+typedef struct {
+    uint8_t Event;
+    uint8_t Length;
+    uint8_t Data[LOG_COMPACT_DICT_DATA_MAX];
+} LogCompactDictEntryType;
+
+static const LogCompactDictEntryType LogCompactDictionary[] = {
+    { 0x44, 1, { 0x26 } },                      /* SNI READER: REQA */
+    { 0x44, 1, { 0x52 } },                      /* SNI READER: WUPA */
+    { 0x44, 2, { 0x93, 0x20 } },                /* SNI READER: ANTICOLLISION CL1 */
+    { 0x44, 2, { 0x95, 0x20 } },                /* SNI READER: ANTICOLLISION CL2 */
+    { 0x44, 4, { 0x50, 0x00, 0x57, 0xCD } },    /* SNI READER: HLTA */
+    { 0x47, 3, { 0x04, 0x00, 0x02 } },          /* SNI CARD W/PARITY: ATQA 0400 */
+    { 0x47, 3, { 0x44, 0x01, 0x02 } },          /* SNI CARD W/PARITY: ATQA 4400 */
+    { 0x40, 1, { 0x26 } },                      /* CODEC RX: REQA */
+    { 0x40, 1, { 0x52 } },                      /* CODEC RX: WUPA */
+    { 0x40, 2, { 0x93, 0x20 } },                /* CODEC RX: ANTICOLLISION CL1 */
+    { 0x40, 2, { 0x95, 0x20 } },                /* CODEC RX: ANTICOLLISION CL2 */
+    { 0x40, 4, { 0x50, 0x00, 0x57, 0xCD } },    /* CODEC RX: HLTA */
+    { 0x41, 2, { 0x04, 0x00 } },                /* CODEC TX: ATQA 0400 */
+    { 0x41, 2, { 0x44, 0x00 } },                /* CODEC TX: ATQA 4400 */
+    { 0x93, 0, { 0 } },                         /* APP REQA */
+    { 0x94, 0, { 0 } },                         /* APP WUPA */
+    { 0x91, 0, { 0 } },                         /* APP HALT */
+};
+
+#define LOG_COMPACT_DICT_COUNT          (sizeof(LogCompactDictionary) / sizeof(*LogCompactDictionary))
+
+static const uint8_t LogCompactFrameTypes[] = { 0x40, 0x41, 0x44, 0x47 };
+
+void LogParserInit(LogParserStateType *State) {
+    memset(State, 0, sizeof(*State));
+}
+
+void LogParserSetParityEvent(LogParserStateType *State, uint8_t Event) {
+    State->ParityEvents[Event / 8] |= 1 << (Event % 8);
+}
+
+int LogParserStripParity(const uint8_t *Data, size_t Length, uint8_t *Frame) {
+    if (Length <= 1) {
+        memcpy(Frame, Data, Length);
+        return Length;
+    }
+
+    /* Groups of 9 bits, least significant first: 8 data bits and the parity bit */
+    size_t ByteCount = Length * 8 / 9;
+    uint32_t Bits = 0;
+    uint8_t BitCount = 0;
+
+    for (size_t i = 0; i < ByteCount; i++) {
+        while (BitCount < 9) {
+            Bits |= (uint32_t) *Data++ << BitCount;
+            BitCount += 8;
+        }
+
+        uint8_t Byte = (uint8_t) Bits;
+
+        if (!((__builtin_parity(Byte) ^ (Bits >> 8)) & 0x01))
+            return -1;
+
+        Frame[i] = Byte;
+        Bits >>= 9;
+        BitCount -= 9;
+    }
+
+    return ByteCount;
+}
+
+/* Decodes the compact header at Entry. Returns the header size without the
+ * delta, 0 if more input is needed and -1 at the end of the log. */
+static int ParseCompactHeader(const uint8_t *Entry, size_t Left, uint8_t *Event, size_t *Length,
+                              const uint8_t **DictData) {
+    uint8_t Header = Entry[0];
+
+    *DictData = NULL;
+
+    if (Header == LOG_COMPACT_LONG) {
+        if (Left < 3)
+            return 0;
+        *Event = Entry[1];
+        *Length = Entry[2];
+        return 3;
+    } else if (Header == LOG_COMPACT_NO_DATA) {
+        if (Left < 2)
+            return 0;
+        *Event = Entry[1];
+        *Length = 0;
+        return 2;
+    } else if (Header >= LOG_COMPACT_SHORT_FRAME) {
+        *Event = LogCompactFrameTypes[(Header >> 5) & 0x03];
+        *Length = (Header & 0x1F) + 1;
+        return 1;
+    } else if (Header >= LOG_COMPACT_DICTIONARY && (size_t)(Header - LOG_COMPACT_DICTIONARY) < LOG_COMPACT_DICT_COUNT) {
+        const LogCompactDictEntryType *DictEntry = &LogCompactDictionary[Header - LOG_COMPACT_DICTIONARY];
+        *Event = DictEntry->Event;
+        *Length = DictEntry->Length;
+        *DictData = DictEntry->Data;
+        return 1;
+    }
+
+    return -1;
+}
+
+size_t LogParse(LogParserStateType *State, const uint8_t *Log, size_t Size, bool Final, size_t *Consumed,
+                LogParserEntryType *Entries, size_t MaxEntries, uint8_t *Data, size_t DataSize) {
+    size_t Pos = 0;
+    size_t Count = 0;
+    size_t DataUsed = 0;
+
+    while (!State->Ended && Count < MaxEntries && DataSize - DataUsed >= LOG_PARSER_DATA_MAX) {
+        const uint8_t *Entry = &Log[Pos];
+        size_t Left = Size - Pos;
+        const uint8_t *EntryData;
+        size_t HeaderSize;
+        size_t Length;
+        uint8_t Event;
+        uint16_t Timestamp;
+
+        if (Left == 0) {
+            State->Ended = Final;
+            break;
+        }
+
+        uint8_t Header = Entry[0];
+
+        if (!State->Compact || Header == LOG_INFO_COMPACT_START || Header == LOG_INFO_SYSTEM_BOOT) {
+            if (Left < LOG_NORMAL_HEADER_SIZE) {
+                State->Ended = Final;
+                break;
+            } else if (Header == LOG_EMPTY) {
+                State->Ended = true;
+                break;
+            }
+
+            Event = Header;
+            Length = Entry[1];
+            Timestamp = ((uint16_t) Entry[2] << 8) | Entry[3];
+            HeaderSize = LOG_NORMAL_HEADER_SIZE;
+            EntryData = &Entry[HeaderSize];
+            State->Compact = (Header == LOG_INFO_COMPACT_START);
+        } else if (Header == LOG_COMPACT_END) {
+            State->Compact = false;
+            Pos++;
+            continue;
+        } else {
+            const uint8_t *DictData;
+            int Result = ParseCompactHeader(Entry, Left, &Event, &Length, &DictData);
+
+            if (Result <= 0) {
+                State->Ended = (Result < 0) || Final;
+                break;
+            }
+
+            /* Timestamp delta, 7 bits per byte. Only the lower 16 bits count. */
+            uint32_t Delta = 0;
+            uint8_t Shift = 0;
+            bool DeltaComplete = false;
+
+            HeaderSize = Result;
+
+            while (HeaderSize < Left) {
+                uint8_t Byte = Entry[HeaderSize++];
+
+                if (Shift < 16) {
+                    Delta |= (uint32_t)(Byte & 0x7F) << Shift;
+                    Shift += 7;
+                }
+
+                if (!(Byte & 0x80)) {
+                    DeltaComplete = true;
+                    break;
+                }
+            }
+
+            if (!DeltaComplete) {
+                State->Ended = Final;
+                break;
+            }
+
+            Timestamp = (uint16_t)(State->LastTimestamp + Delta);
+            EntryData = (DictData != NULL) ? DictData : &Entry[HeaderSize];
+        }
+
+        /* Size of the entry in the log */
+        size_t EntrySize = HeaderSize + ((EntryData == &Entry[HeaderSize]) ? Length : 0);
+
+        if (EntrySize > Left) {
+            if (!Final)
+                break;
+
+            /* Truncated log, keep what is there */
+            Length = Left - HeaderSize;
+            EntrySize = Left;
+        }
+
+        LogParserEntryType *Out = &Entries[Count++];
+        uint8_t *OutData = &Data[DataUsed];
+
+        Out->DataOffset = DataUsed;
+        Out->Timestamp = Timestamp;
+        Out->Event = Event;
+        Out->Flags = 0;
+        Out->RawLength = Length;
+        Out->DataLength = Length;
+
+        if (State->ParityEvents[Event / 8] & (1 << (Event % 8))) {
+            int FrameLength = LogParserStripParity(EntryData, Length, OutData);
+
+            if (FrameLength >= 0) {
+                Out->Flags = LOG_PARSER_PARITY_OK;
+                Out->DataLength = FrameLength;
+            } else {
+                Out->Flags = LOG_PARSER_PARITY_ERROR;
+                memcpy(OutData, EntryData, Length);
+            }
+        } else {
+            memcpy(OutData, EntryData, Length);
+        }
+
+        DataUsed += Out->DataLength;
+        State->LastTimestamp = Timestamp;
+        Pos += EntrySize;
+    }
+
+    *Consumed = Pos;
+
+    return Count;
+}
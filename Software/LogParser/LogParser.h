@@ -0,0 +1,61 @@
+/* LogParser.h
+ *
+ * Host-side decoder for the binary Chameleon log as returned by LOGDOWNLOAD,
+ * LIVE mode and the FRAM log, in both the normal and the MEMORY_COMPACT
+ * format (see Firmware/Chameleon-Mini/Log.c). It does the per-byte work of
+ * Chameleon.Log in ChamTool: entry framing, the compact decoding and the
+ * parity check and strip of frames logged with parity bits.
+ *
+ * The log may be handed over in arbitrary pieces: an entry that is not
+ * complete yet is left unconsumed and is decoded with the next piece.
+ */
+
+#ifndef LOG_PARSER_H
+#define LOG_PARSER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define LOG_PARSER_DATA_MAX             255     /* Largest data of a single entry */
+
+/* Entry flags */
+#define LOG_PARSER_PARITY_OK            0x01    /* Parity bits checked and removed from the data */
+#define LOG_PARSER_PARITY_ERROR         0x02    /* Parity bits wrong, the data is as logged */
+
+typedef struct {
+    uint32_t DataOffset;                        /* Into the Data buffer of LogParse */
+    uint16_t Timestamp;                         /* SysTick in ms */
+    uint8_t Event;                              /* LogEntryEnum */
+    uint8_t Flags;
+    uint16_t DataLength;                        /* Of the data in the Data buffer */
+    uint16_t RawLength;                         /* Of the data as logged */
+} LogParserEntryType;
+
+typedef struct {
+    uint8_t ParityEvents[256 / 8];              /* Events whose data is checked for parity bits */
+    uint16_t LastTimestamp;
+    bool Compact;
+    bool Ended;                                 /* End of log reached */
+} LogParserStateType;
+
+/* Start a new log, with no parity events */
+void LogParserInit(LogParserStateType *State);
+
+/* Check and strip the parity bits of Event entries */
+void LogParserSetParityEvent(LogParserStateType *State, uint8_t Event);
+
+/* Decode as many entries of Log as fit into Entries and Data. Final marks the
+ * last piece of the log, otherwise a truncated entry at the end is left for the
+ * next call. The number of bytes used from Log is written to Consumed. Returns
+ * the number of entries, 0 with nothing consumed means that more input (or
+ * Final) is needed or State->Ended is set. */
+size_t LogParse(LogParserStateType *State, const uint8_t *Log, size_t Size, bool Final, size_t *Consumed,
+                LogParserEntryType *Entries, size_t MaxEntries, uint8_t *Data, size_t DataSize);
+
+/* Check the odd parity bit after every byte of a frame logged with parity
+ * bits and write the bare bytes to Frame. A single byte is a frame without
+ * parity. Returns the number of bytes written to Frame, or -1 on a parity error. */
+int LogParserStripParity(const uint8_t *Data, size_t Length, uint8_t *Frame);
+
+#endif /* LOG_PARSER_H */
@@ -0,0 +1,414 @@
+/* LogParserTool.c
+ *
+ * Command line front end for LogParser:
+ *   logparse <logfile>                  print the entries
+ *   logparse --bench <logfile> [MiB]    decode throughput
+ *   logparse --selftest [count]
+ */
+
+#include "LogParser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CHUNK_SIZE                (64 * 1024)
+#define MAX_ENTRIES               (CHUNK_SIZE / 2 + 1)
+#define DATA_SIZE                 (4 * CHUNK_SIZE + LOG_PARSER_DATA_MAX)
+
+/* As in ChamTool: sniffed frames with parity bits */
+static const uint8_t ParityEvents[] = { 0x45, 0x47 };
+
+static LogParserEntryType Entries[MAX_ENTRIES];
+static uint8_t Data[DATA_SIZE];
+
+static double Seconds(void) {
+    struct timespec Now;
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    return Now.tv_sec + Now.tv_nsec / 1e9;
+}
+
+static void InitState(LogParserStateType *State) {
+    LogParserInit(State);
+
+    for (uint8_t i = 0; i < sizeof(ParityEvents); i++)
+        LogParserSetParityEvent(State, ParityEvents[i]);
+}
+
+static uint8_t *ReadFile(const char *Path, size_t *Size) {
+    FILE *File = fopen(Path, "rb");
+    uint8_t *Buffer = NULL;
+    long Length;
+
+    if (File == NULL)
+        return NULL;
+
+    if (fseek(File, 0, SEEK_END) == 0 && (Length = ftell(File)) >= 0 && fseek(File, 0, SEEK_SET) == 0) {
+        Buffer = malloc(Length + 1);
+
+        if (Buffer != NULL && fread(Buffer, 1, Length, File) != (size_t) Length) {
+            free(Buffer);
+            Buffer = NULL;
+        }
+
+        *Size = Length;
+    }
+
+    fclose(File);
+    return Buffer;
+}
+
+/* Decode Log in pieces of at most PieceSize bytes, calling Handler for every entry */
+static size_t ParseAll(const uint8_t *Log, size_t Size, size_t PieceSize,
+                       void (*Handler)(const LogParserEntryType *Entry, const uint8_t *Data, void *Context),
+                       void *Context) {
+    LogParserStateType State;
+    size_t Pos = 0, Pending = 0, EntryCount = 0;
+
+    InitState(&State);
+
+    while (!State.Ended) {
+        size_t Available = Pending + ((Size - Pos - Pending < PieceSize) ? Size - Pos - Pending : PieceSize);
+        bool Final = (Pos + Available == Size);
+        size_t Consumed;
+        size_t Count = LogParse(&State, &Log[Pos], Available, Final, &Consumed,
+                                Entries, MAX_ENTRIES, Data, DATA_SIZE);
+
+        for (size_t i = 0; i < Count; i++)
+            Handler(&Entries[i], &Data[Entries[i].DataOffset], Context);
+
+        if (Count == 0 && Consumed == 0 && Final)
+            break;
+
+        Pos += Consumed;
+        Pending = Available - Consumed;
+        EntryCount += Count;
+    }
+
+    return EntryCount;
+}
+
+static void PrintEntry(const LogParserEntryType *Entry, const uint8_t *EntryData, void *Context) {
+    printf("%02X %3u %05u ", Entry->Event, Entry->RawLength, Entry->Timestamp);
+
+    for (uint16_t i = 0; i < Entry->DataLength; i++)
+        printf("%02x", EntryData[i]);
+
+    printf("%s\n", (Entry->Flags & LOG_PARSER_PARITY_ERROR) ? "!" : "");
+}
+
+static void CountEntry(const LogParserEntryType *Entry, const uint8_t *EntryData, void *Context) {
+    *(size_t *) Context += Entry->DataLength;
+}
+
+static int Bench(const char *Path, unsigned MiB) {
+    size_t Size, DataBytes = 0, EntryCount = 0, Bytes = 0;
+    uint8_t *Log = ReadFile(Path, &Size);
+
+    if (Log == NULL || Size == 0) {
+        fprintf(stderr, "cannot read %s\n", Path);
+        return EXIT_FAILURE;
+    }
+
+    double Start = Seconds();
+
+    while (Bytes < (size_t) MiB << 20) {
+        EntryCount += ParseAll(Log, Size, CHUNK_SIZE, CountEntry, &DataBytes);
+        Bytes += Size;
+    }
+
+    double Elapsed = Seconds() - Start;
+
+    printf("%zu entries, %zu bytes in %.3f s: %.1f MB/s, %.1f M entries/s\n",
+           EntryCount, Bytes, Elapsed, Bytes / Elapsed / 1e6, EntryCount / Elapsed / 1e6);
+
+    free(Log);
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Self test: random entries are written in the normal and the compact format
+ * the way Log.c does, and decoded again in random pieces.
+ */
+#define SELFTEST_ENTRIES          2000
+#define SELFTEST_LOG_SIZE         (SELFTEST_ENTRIES * (LOG_PARSER_DATA_MAX + 8) + 16)
+
+typedef struct {
+    uint8_t Event;
+    uint16_t Timestamp;
+    uint8_t Length;
+    uint8_t Data[LOG_PARSER_DATA_MAX];
+} TestEntryType;
+
+typedef struct {
+    const TestEntryType *Expected;
+    size_t Count;
+    unsigned Failures;
+} TestContextType;
+
+static const uint8_t TestEvents[] = { 0x10, 0x14, 0x20, 0x40, 0x41, 0x42, 0x44, 0x45, 0x46, 0x47, 0x80, 0x91, 0x93, 0xFF };
+static const uint8_t TestFrameTypes[] = { 0x40, 0x41, 0x44, 0x47 };
+
+static const struct {
+    uint8_t Event, Length, Data[4];
+} TestDictionary[] = {
+    { 0x44, 1, { 0x26 } }, { 0x44, 1, { 0x52 } }, { 0x44, 2, { 0x93, 0x20 } }, { 0x44, 2, { 0x95, 0x20 } },
+    { 0x44, 4, { 0x50, 0x00, 0x57, 0xCD } }, { 0x47, 3, { 0x04, 0x00, 0x02 } }, { 0x47, 3, { 0x44, 0x01, 0x02 } },
+    { 0x40, 1, { 0x26 } }, { 0x40, 1, { 0x52 } }, { 0x40, 2, { 0x93, 0x20 } }, { 0x40, 2, { 0x95, 0x20 } },
+    { 0x40, 4, { 0x50, 0x00, 0x57, 0xCD } }, { 0x41, 2, { 0x04, 0x00 } }, { 0x41, 2, { 0x44, 0x00 } },
+    { 0x93, 0, { 0 } }, { 0x94, 0, { 0 } }, { 0x91, 0, { 0 } },
+};
+
+/* Bit by bit, as checkParityBit in ChamTool */
+static int RefStripParity(const uint8_t *EntryData, size_t Length, uint8_t *Frame) {
+    if (Length <= 1) {
+        memcpy(Frame, EntryData, Length);
+        return Length;
+    }
+
+    size_t BitCount = Length * 8 / 9 * 9;
+    uint8_t Ones = 0;
+
+    memset(Frame, 0, Length);
+
+    for (size_t i = 0; i < BitCount; i++) {
+        uint8_t Bit = (EntryData[i / 8] >> (i % 8)) & 0x01;
+
+        if (i % 9 == 8) {
+            if ((Ones + Bit) % 2 == 0)
+                return -1;
+            Ones = 0;
+        } else {
+            Ones += Bit;
+            Frame[i / 9] |= Bit << (i % 9);
+        }
+    }
+
+    return BitCount / 9;
+}
+
+static void RandomEntry(TestEntryType *Entry, uint16_t *Tick) {
+    uint8_t Kind = rand() % 8;
+
+    *Tick += (rand() % 4 == 0) ? rand() : rand() % 200;
+    Entry->Timestamp = *Tick;
+
+    if (Kind == 0) {
+        uint8_t Index = rand() % (sizeof(TestDictionary) / sizeof(*TestDictionary));
+        Entry->Event = TestDictionary[Index].Event;
+        Entry->Length = TestDictionary[Index].Length;
+        memcpy(Entry->Data, TestDictionary[Index].Data, Entry->Length);
+        return;
+    }
+
+    Entry->Event = TestEvents[rand() % sizeof(TestEvents)];
+    Entry->Length = (Kind < 4) ? rand() % 33 : rand() % (LOG_PARSER_DATA_MAX + 1);
+
+    for (uint16_t i = 0; i < Entry->Length; i++)
+        Entry->Data[i] = rand();
+
+    if ((Entry->Event == 0x45 || Entry->Event == 0x47) && Entry->Length > 1 && rand() % 4) {
+        /* Valid parity bits */
+        uint16_t ByteCount = Entry->Length * 8 / 9;
+        uint8_t Frame[LOG_PARSER_DATA_MAX];
+
+        memcpy(Frame, Entry->Data, ByteCount);
+        memset(Entry->Data, 0, Entry->Length);
+
+        for (uint16_t i = 0; i < ByteCount * 9; i++) {
+            uint8_t Bit = (i % 9 == 8) ? !__builtin_parity(Frame[i / 9]) : (Frame[i / 9] >> (i % 9)) & 0x01;
+            Entry->Data[i / 8] |= Bit << (i % 8);
+        }
+    }
+}
+
+static size_t WriteNormal(uint8_t *Log, const TestEntryType *Entry) {
+    Log[0] = Entry->Event;
+    Log[1] = Entry->Length;
+    Log[2] = Entry->Timestamp >> 8;
+    Log[3] = Entry->Timestamp;
+    memcpy(&Log[4], Entry->Data, Entry->Length);
+    return 4 + Entry->Length;
+}
+
+static size_t WriteCompact(uint8_t *Log, const TestEntryType *Entry, uint16_t LastTick) {
+    uint16_t Delta = Entry->Timestamp - LastTick;
+    size_t Size = 0;
+    bool WithData = true;
+
+    for (uint8_t i = 0; i < sizeof(TestDictionary) / sizeof(*TestDictionary); i++) {
+        if (TestDictionary[i].Event == Entry->Event && TestDictionary[i].Length == Entry->Length &&
+                !memcmp(TestDictionary[i].Data, Entry->Data, Entry->Length)) {
+            Log[Size++] = 0x40 + i;
+            WithData = false;
+            break;
+        }
+    }
+
+    if (WithData) {
+        uint8_t FrameType = 0xFF;
+
+        for (uint8_t i = 0; i < sizeof(TestFrameTypes); i++) {
+            if (TestFrameTypes[i] == Entry->Event)
+                FrameType = i;
+        }
+
+        /* 0xFF is the boot entry, a 32 byte card frame takes the long header */
+        if (Entry->Length > 0 && Entry->Length <= 32 && FrameType != 0xFF && (FrameType != 3 || Entry->Length != 32)) {
+            Log[Size++] = 0x80 | (FrameType << 5) | (Entry->Length - 1);
+        } else if (Entry->Length == 0) {
+            Log[Size++] = 0x03;
+            Log[Size++] = Entry->Event;
+        } else {
+            Log[Size++] = 0x01;
+            Log[Size++] = Entry->Event;
+            Log[Size++] = Entry->Length;
+        }
+    }
+
+    do {
+        Log[Size++] = (Delta & 0x7F) | ((Delta > 0x7F) ? 0x80 : 0x00);
+        Delta >>= 7;
+    } while (Delta);
+
+    if (WithData && Entry->Length > 0) {
+        memcpy(&Log[Size], Entry->Data, Entry->Length);
+        Size += Entry->Length;
+    }
+
+    return Size;
+}
+
+/* Random log, half of it in the compact format */
+static size_t WriteTestLog(uint8_t *Log, TestEntryType *Expected, size_t *ExpectedCount) {
+    uint16_t Tick = rand();
+    bool Compact = false;
+    size_t Size = 0, Count = 0;
+
+    while (Count < SELFTEST_ENTRIES) {
+        TestEntryType *Entry = &Expected[Count];
+
+        if (rand() % 64 == 0) {
+            if (!Compact) {
+                /* Start of compact entries */
+                Entry->Event = 0x14;
+                Entry->Length = 0;
+                Entry->Timestamp = Tick;
+                Size += WriteNormal(&Log[Size], Entry);
+                Compact = true;
+                Count++;
+            } else {
+                Log[Size++] = 0x02;
+                Compact = false;
+            }
+            continue;
+        }
+
+        RandomEntry(Entry, &Tick);
+
+        if (Compact && Entry->Event != 0x14 && Entry->Event != 0xFF) {
+            Size += WriteCompact(&Log[Size], Entry, Count ? Expected[Count - 1].Timestamp : 0);
+        } else {
+            /* Restart and boot entries are always in the normal format */
+            Size += WriteNormal(&Log[Size], Entry);
+            Compact = (Entry->Event == 0x14);
+        }
+
+        Count++;
+    }
+
+    if (rand() % 2)
+        Log[Size++] = 0x00;
+
+    *ExpectedCount = Count;
+    return Size;
+}
+
+static void CheckEntry(const LogParserEntryType *Entry, const uint8_t *EntryData, void *Context) {
+    TestContextType *Test = Context;
+    const TestEntryType *Expected = &Test->Expected[Test->Count++];
+    uint8_t Frame[LOG_PARSER_DATA_MAX];
+    int FrameLength = Expected->Length;
+    uint8_t Flags = 0;
+
+    memcpy(Frame, Expected->Data, Expected->Length);
+
+    if (Expected->Event == 0x45 || Expected->Event == 0x47) {
+        FrameLength = RefStripParity(Expected->Data, Expected->Length, Frame);
+        Flags = (FrameLength >= 0) ? LOG_PARSER_PARITY_OK : LOG_PARSER_PARITY_ERROR;
+
+        if (FrameLength < 0) {
+            memcpy(Frame, Expected->Data, Expected->Length);
+            FrameLength = Expected->Length;
+        }
+    }
+
+    if (Entry->Event != Expected->Event || Entry->Timestamp != Expected->Timestamp ||
+            Entry->RawLength != Expected->Length || Entry->DataLength != FrameLength ||
+            Entry->Flags != Flags || memcmp(EntryData, Frame, FrameLength)) {
+        if (Test->Failures++ < 10)
+            printf("  MISMATCH: entry %zu (event %02X, %u bytes)\n", Test->Count - 1, Expected->Event, Expected->Length);
+    }
+}
+
+static int SelfTest(unsigned Count) {
+    static uint8_t Log[SELFTEST_LOG_SIZE];
+    static TestEntryType Expected[SELFTEST_ENTRIES];
+    unsigned Failures = 0;
+
+    srand((unsigned) time(NULL));
+
+    for (unsigned n = 0; n < Count; n++) {
+        size_t ExpectedCount;
+        size_t Size = WriteTestLog(Log, Expected, &ExpectedCount);
+        static const size_t PieceSizes[] = { 1, 3, 7, 64, CHUNK_SIZE };
+        bool Ok = true;
+
+        for (uint8_t i = 0; i < sizeof(PieceSizes) / sizeof(*PieceSizes); i++) {
+            TestContextType Test = { .Expected = Expected, .Count = 0, .Failures = 0 };
+            size_t PieceSize = (i == 0) ? (size_t) rand() % 300 + 1 : PieceSizes[i];
+
+            ParseAll(Log, Size, PieceSize, CheckEntry, &Test);
+
+            if (Test.Failures > 0 || Test.Count != ExpectedCount) {
+                printf("  %zu of %zu entries in pieces of %zu bytes, %u mismatches\n",
+                       Test.Count, ExpectedCount, PieceSize, Test.Failures);
+                Ok = false;
+            }
+        }
+
+        printf("selftest %u: %s (%zu entries, %zu bytes)\n", n, Ok ? "ok" : "FAILED", ExpectedCount, Size);
+        Failures += !Ok;
+    }
+
+    return Failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc >= 2 && !strcmp(argv[1], "--selftest"))
+        return SelfTest(argc >= 3 ? (unsigned) atoi(argv[2]) : 3);
+
+    if (argc >= 3 && !strcmp(argv[1], "--bench"))
+        return Bench(argv[2], argc >= 4 ? (unsigned) atoi(argv[3]) : 64);
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <logfile>\n", argv[0]);
+        fprintf(stderr, "       %s --bench <logfile> [MiB]\n", argv[0]);
+        fprintf(stderr, "       %s --selftest [count]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    size_t Size;
+    uint8_t *Log = ReadFile(argv[1], &Size);
+
+    if (Log == NULL) {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    ParseAll(Log, Size, CHUNK_SIZE, PrintEntry, NULL);
+
+    free(Log);
+    return EXIT_SUCCESS;
+}